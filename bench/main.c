@@ -0,0 +1,491 @@
+#include "arena.h"
+#include "command.h"
+#include "execute.h"
+#include "input.h"
+#include "pool.h"
+#include "shell.h"
+#include "shell_impl.h"
+#include "stats.h"
+#include "util.h"
+#include <dc_posix/dc_stdlib.h>
+#include <dc_posix/dc_string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define DEFAULT_ROUNDS 20
+#define BENCH_PATH "/usr/local/sbin:/usr/local/bin:/usr/sbin:/usr/bin:/sbin:/bin:~/bin"
+#define NANOSECONDS_PER_SECOND 1000000000.0
+#define BENCH_WORKERS 4
+
+/*! \struct benchmark
+    \brief One microbenchmark: each round runs the same number of operations and is timed as a whole.
+*/
+struct benchmark
+{
+    const char *name;     /**< the name in the JSON and on the command line */
+    size_t operations;    /**< the number of operations in a round */
+    void *(*setup)(const struct dc_posix_env *env, struct dc_error *err, size_t operations); /**< run once first */
+    void (*run)(const struct dc_posix_env *env, struct dc_error *err, void *data, size_t operations); /**< a round */
+    void (*teardown)(const struct dc_posix_env *env, void *data); /**< run once at the end */
+};
+
+/**
+ * The lines of the synthetic workload, the kind of commands people type.
+ */
+static const char *const lines[] = {
+    "ls -al /tmp > out.txt 2>> err.txt",
+    "grep -n 'main' src/shell.c",
+    "cat < in.txt",
+    "echo hello world",
+    "cc -O2 -Wall -o prog prog.c 2> errors.txt",
+    "printf \"%s\\n\" $HOME/bin",
+};
+
+#define LINE_COUNT (sizeof(lines) / sizeof(lines[0]))
+
+/**
+ * Create a script of the workload lines, one per operation.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param operations the number of lines.
+ * @param workload the lines to repeat.
+ * @param count the number of lines to repeat.
+ * @return the script, to be freed by the caller.
+ */
+static char *create_script(const struct dc_posix_env *env, struct dc_error *err, size_t operations,
+                           const char *const *workload, size_t count);
+
+/**
+ * Run a benchmark and write its result as a JSON object.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param benchmark the benchmark.
+ * @param rounds the number of rounds to time.
+ * @param first is this the first result (no comma before it).
+ * @return true if the benchmark ran without an error.
+ */
+static bool run_benchmark(const struct dc_posix_env *env, struct dc_error *err, const struct benchmark *benchmark,
+                          size_t rounds, bool first);
+
+/**
+ * The benchmarks: setup creates what the rounds need, run does the operations, teardown frees it.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param data what setup returned.
+ * @param operations the number of operations.
+ */
+static void *setup_read_command_line(const struct dc_posix_env *env, struct dc_error *err, size_t operations);
+static void run_read_command_line(const struct dc_posix_env *env, struct dc_error *err, void *data, size_t operations);
+static void *setup_parse_command(const struct dc_posix_env *env, struct dc_error *err, size_t operations);
+static void run_parse_command(const struct dc_posix_env *env, struct dc_error *err, void *data, size_t operations);
+static void teardown_parse_command(const struct dc_posix_env *env, void *data);
+static void run_parse_path(const struct dc_posix_env *env, struct dc_error *err, void *data, size_t operations);
+static void *setup_execute(const struct dc_posix_env *env, struct dc_error *err, size_t operations);
+static void run_execute(const struct dc_posix_env *env, struct dc_error *err, void *data, size_t operations);
+static void run_launch_spawn(const struct dc_posix_env *env, struct dc_error *err, void *data, size_t operations);
+static void teardown_execute(const struct dc_posix_env *env, void *data);
+static void *setup_launch_pool(const struct dc_posix_env *env, struct dc_error *err, size_t operations);
+static void run_launch_pool(const struct dc_posix_env *env, struct dc_error *err, void *data, size_t operations);
+static void teardown_launch_pool(const struct dc_posix_env *env, void *data);
+static void launch_true(const struct dc_posix_env *env, struct dc_error *err, char **path, size_t operations,
+                        enum launcher launcher);
+static void *setup_fsm(const struct dc_posix_env *env, struct dc_error *err, size_t operations);
+static void run_fsm_iterations(const struct dc_posix_env *env, struct dc_error *err, void *data, size_t operations);
+static void teardown_script(const struct dc_posix_env *env, void *data);
+
+static const struct benchmark benchmarks[] = {
+    { "read_command_line", 10000, setup_read_command_line, run_read_command_line, teardown_script },
+    { "parse_command",     1000,  setup_parse_command,     run_parse_command,     teardown_parse_command },
+    { "parse_path",        1000,  NULL,                    run_parse_path,        NULL },
+    { "execute",           20,    setup_execute,           run_execute,           teardown_execute },
+    { "launch_spawn",      20,    setup_execute,           run_launch_spawn,      teardown_execute },
+    { "launch_pool",       20,    setup_launch_pool,       run_launch_pool,       teardown_launch_pool },
+    { "fsm",               1000,  setup_fsm,               run_fsm_iterations,    teardown_script },
+};
+
+int main(int argc, char *argv[])
+{
+    struct dc_posix_env env;
+    struct dc_error err;
+    size_t rounds;
+    bool first;
+    int opt;
+    int ret_val;
+
+    dc_posix_env_init(&env, NULL);
+    dc_error_init(&err, NULL);
+    rounds = DEFAULT_ROUNDS;
+
+    while ((opt = getopt(argc, argv, "r:")) != -1)
+    {
+        if (opt == 'r' && atoi(optarg) > 0)
+        {
+            rounds = (size_t)atoi(optarg);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-r rounds] [benchmark...]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    ret_val = EXIT_SUCCESS;
+    first = true;
+    printf("{\"rounds\":%zu,\"benchmarks\":[", rounds);
+
+    for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++)
+    {
+        bool selected;
+
+        //every benchmark unless some are named
+        selected = optind == argc;
+        for (int arg = optind; arg < argc && !selected; arg++)
+        {
+            selected = dc_strcmp(&env, argv[arg], benchmarks[i].name) == 0;
+        }
+
+        if (!selected)
+        {
+            continue;
+        }
+
+        //only an entry that was printed needs a ',' before the next one
+        if (run_benchmark(&env, &err, &benchmarks[i], rounds, first))
+        {
+            first = false;
+        }
+        else
+        {
+            fprintf(stderr, "%s: %s\n", benchmarks[i].name, err.message);
+            dc_error_reset(&err);
+            ret_val = EXIT_FAILURE;
+        }
+    }
+
+    printf("\n]}\n");
+
+    return ret_val;
+}
+
+static bool run_benchmark(const struct dc_posix_env *env, struct dc_error *err, const struct benchmark *benchmark,
+                          size_t rounds, bool first)
+{
+    static struct histogram histogram;
+    void *data;
+    uint64_t total;
+    double mean;
+
+    memset(&histogram, 0, sizeof(histogram));
+    data = NULL;
+
+    if (benchmark->setup != NULL)
+    {
+        data = benchmark->setup(env, err, benchmark->operations);
+        if (dc_error_has_error(err))
+        {
+            return false;
+        }
+    }
+
+    //one round that is not timed to fill the caches and fault in the memory
+    benchmark->run(env, err, data, benchmark->operations);
+    total = 0;
+
+    for (size_t round = 0; round < rounds && dc_error_has_no_error(err); round++)
+    {
+        uint64_t start;
+        uint64_t elapsed;
+
+        start = stats_now();
+        benchmark->run(env, err, data, benchmark->operations);
+        elapsed = stats_now() - start;
+        total += elapsed;
+        histogram_record(&histogram, elapsed / benchmark->operations);
+    }
+
+    if (benchmark->teardown != NULL)
+    {
+        benchmark->teardown(env, data);
+    }
+
+    if (dc_error_has_error(err))
+    {
+        return false;
+    }
+
+    mean = (double)total / (double)(rounds * benchmark->operations);
+    printf("%s\n{\"name\":\"%s\",\"operations\":%zu,\"mean_ns\":%.1f,\"min_ns\":%lu,\"p50_ns\":%lu,"
+           "\"p99_ns\":%lu,\"max_ns\":%lu,\"ops_per_second\":%.1f}",
+           first ? "" : ",", benchmark->name, benchmark->operations, mean, (unsigned long)histogram.min,
+           (unsigned long)histogram_percentile(&histogram, 50.0),
+           (unsigned long)histogram_percentile(&histogram, 99.0), (unsigned long)histogram.max,
+           NANOSECONDS_PER_SECOND / mean);
+    fflush(stdout);
+
+    return true;
+}
+
+static char *create_script(const struct dc_posix_env *env, struct dc_error *err, size_t operations,
+                           const char *const *workload, size_t count)
+{
+    char *script;
+    size_t length;
+    size_t used;
+
+    length = 0;
+    for (size_t i = 0; i < operations; i++)
+    {
+        length += dc_strlen(env, workload[i % count]) + 1;
+    }
+
+    script = dc_malloc(env, err, length + 1);
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    used = 0;
+    for (size_t i = 0; i < operations; i++)
+    {
+        size_t line_length;
+
+        line_length = dc_strlen(env, workload[i % count]);
+        dc_memcpy(env, &script[used], workload[i % count], line_length);
+        used += line_length;
+        script[used++] = '\n';
+    }
+
+    script[used] = '\0';
+
+    return script;
+}
+
+static void *setup_read_command_line(const struct dc_posix_env *env, struct dc_error *err, size_t operations)
+{
+    return create_script(env, err, operations, lines, LINE_COUNT);
+}
+
+static void run_read_command_line(const struct dc_posix_env *env, struct dc_error *err, void *data, size_t operations)
+{
+    struct line_reader *reader;
+
+    reader = line_reader_create_string(env, err, data, (size_t)sysconf(_SC_ARG_MAX));
+    if (dc_error_has_error(err))
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < operations && dc_error_has_no_error(err); i++)
+    {
+        size_t line_size;
+
+        read_command_line(env, err, reader, NULL, &line_size);
+    }
+
+    line_reader_destroy(env, &reader);
+}
+
+static void *setup_parse_command(const struct dc_posix_env *env, struct dc_error *err, size_t operations)
+{
+    struct state *states;
+
+    (void)operations;
+
+    states = dc_calloc(env, err, 1, sizeof(struct state));
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    states->input_fd = -1;
+    init_state(env, err, states);
+
+    return states;
+}
+
+static void run_parse_command(const struct dc_posix_env *env, struct dc_error *err, void *data, size_t operations)
+{
+    struct state *states;
+
+    states = data;
+
+    for (size_t i = 0; i < operations && dc_error_has_no_error(err); i++)
+    {
+        const char *line;
+
+        // the same as separate_commands, the command and everything parsed in to it are in the state's arena
+        line = lines[i % LINE_COUNT];
+        arena_reset(env, states->arena);
+        states->command = arena_calloc(env, err, states->arena, 1, sizeof(struct command));
+        states->command_count = 1;
+        states->command->arena = states->arena;
+        states->command->line = arena_strndup(env, err, states->arena, line, dc_strlen(env, line));
+        parse_command(env, err, states, states->command);
+    }
+}
+
+static void teardown_parse_command(const struct dc_posix_env *env, void *data)
+{
+    struct dc_error err;
+
+    dc_error_init(&err, NULL);
+    destroy_state(env, &err, data);
+    dc_error_reset(&err);
+    dc_free(env, data, sizeof(struct state));
+}
+
+static void run_parse_path(const struct dc_posix_env *env, struct dc_error *err, void *data, size_t operations)
+{
+    (void)data;
+
+    for (size_t i = 0; i < operations && dc_error_has_no_error(err); i++)
+    {
+        char **path;
+
+        path = parse_path(env, err, BENCH_PATH);
+        free_path(env, &path);
+    }
+}
+
+static void *setup_execute(const struct dc_posix_env *env, struct dc_error *err, size_t operations)
+{
+    char *path_str;
+    char **path;
+
+    (void)operations;
+
+    path_str = get_path(env, err);
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    path = parse_path(env, err, path_str);
+    dc_free(env, path_str, dc_strlen(env, path_str) + 1);
+
+    return path;
+}
+
+static void run_execute(const struct dc_posix_env *env, struct dc_error *err, void *data, size_t operations)
+{
+    for (size_t i = 0; i < operations && dc_error_has_no_error(err); i++)
+    {
+        struct command command;
+        char *argv[2];
+        char name[] = "true";
+
+        // fork, search the path and wait, the same as a line with one program on it
+        memset(&command, 0, sizeof(command));
+        argv[0] = NULL;
+        argv[1] = NULL;
+        command.command = name;
+        command.argc = 1;
+        command.argv = argv;
+        execute(env, err, &command, data);
+    }
+}
+
+static void run_launch_spawn(const struct dc_posix_env *env, struct dc_error *err, void *data, size_t operations)
+{
+    // posix_spawn of a program the command hash has already found
+    launch_true(env, err, data, operations, LAUNCHER_SPAWN);
+}
+
+static void teardown_execute(const struct dc_posix_env *env, void *data)
+{
+    char **path;
+
+    path = data;
+    free_path(env, &path);
+}
+
+static void *setup_launch_pool(const struct dc_posix_env *env, struct dc_error *err, size_t operations)
+{
+    if (!worker_pool_start(env, err, BENCH_WORKERS))
+    {
+        return NULL;
+    }
+
+    return setup_execute(env, err, operations);
+}
+
+static void run_launch_pool(const struct dc_posix_env *env, struct dc_error *err, void *data, size_t operations)
+{
+    // a worker forked ahead of time only has to exec, the next one is forked while the program runs
+    launch_true(env, err, data, operations, LAUNCHER_POOL);
+}
+
+static void teardown_launch_pool(const struct dc_posix_env *env, void *data)
+{
+    teardown_execute(env, data);
+    worker_pool_stop(env);
+}
+
+static void launch_true(const struct dc_posix_env *env, struct dc_error *err, char **path, size_t operations,
+                        enum launcher launcher)
+{
+    for (size_t i = 0; i < operations && dc_error_has_no_error(err); i++)
+    {
+        struct command command;
+        char *argv[2];
+        char name[] = "true";
+        pid_t pid;
+
+        memset(&command, 0, sizeof(command));
+        argv[0] = NULL;
+        argv[1] = NULL;
+        command.command = name;
+        command.resolved_path = "/bin/true";
+        command.argc = 1;
+        command.argv = argv;
+        pid = launch(env, err, &command, path, launcher, -1, -1);
+
+        if (pid > 0)
+        {
+            waitpid(pid, NULL, 0);
+        }
+    }
+}
+
+static void *setup_fsm(const struct dc_posix_env *env, struct dc_error *err, size_t operations)
+{
+    static const char *const builtin_lines[] = {
+        "true",
+        "echo hello world > /dev/null",
+        "test -n bench && false || true",
+        "printf '%s %d\\n' bench 42 > /dev/null",
+    };
+
+    // builtins only, the time is the FSM and the parsing, not the programs
+    return create_script(env, err, operations, builtin_lines, sizeof(builtin_lines) / sizeof(builtin_lines[0]));
+}
+
+static void run_fsm_iterations(const struct dc_posix_env *env, struct dc_error *err, void *data, size_t operations)
+{
+    FILE *null_file;
+
+    (void)operations;
+
+    null_file = fopen("/dev/null", "w");
+    if (null_file == NULL)
+    {
+        DC_ERROR_RAISE_ERRNO(err, errno);
+        return;
+    }
+
+    run_shell_batch(env, err, -1, data, null_file, null_file, NULL);
+    fclose(null_file);
+}
+
+static void teardown_script(const struct dc_posix_env *env, void *data)
+{
+    dc_free(env, data, dc_strlen(env, data) + 1);
+}
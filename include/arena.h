@@ -0,0 +1,127 @@
+#ifndef DC_SHELL_ARENA_H
+#define DC_SHELL_ARENA_H
+
+/*
+ * This file is part of dc_shell.
+ *
+ *  dc_shell is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <dc_posix/dc_posix_env.h>
+#include <stddef.h>
+
+/*! \struct arena_block
+    \brief A block of memory that allocations are taken from, the memory follows the header.
+*/
+struct arena_block
+{
+    struct arena_block *next; /**< the block that was filled before this one */
+    size_t size;              /**< the number of bytes after the header */
+    size_t used;              /**< the number of bytes handed out */
+};
+
+/*! \struct arena
+    \brief A bump pointer allocator: allocating moves a pointer, everything is freed at once by arena_reset.
+
+    Used for the memory of a command line (the commands, their words and file names), which all
+    lives exactly as long as one trip around the FSM.
+*/
+struct arena
+{
+    struct arena_block *blocks; /**< the current block, the older ones follow it */
+    size_t block_size;          /**< the smallest block to allocate */
+};
+
+/**
+ * Create an arena with one block.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param block_size the size of the first block, later blocks are at least this big.
+ * @return the arena, or NULL if it could not be allocated.
+ */
+struct arena *arena_create(const struct dc_posix_env *env, struct dc_error *err, size_t block_size);
+
+/**
+ * Free the arena and all of its blocks.
+ *
+ * @param env the posix environment.
+ * @param parena pointer to the arena, set to NULL.
+ */
+void arena_destroy(const struct dc_posix_env *env, struct arena **parena);
+
+/**
+ * Free everything allocated from the arena.
+ * The largest block is kept for reuse, so once the arena has grown to fit a command line
+ * the following lines do not allocate at all.
+ *
+ * @param env the posix environment.
+ * @param arena the arena.
+ */
+void arena_reset(const struct dc_posix_env *env, struct arena *arena);
+
+/**
+ * Allocate memory, suitably aligned for any type. It is freed by arena_reset.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param arena the arena, or NULL to allocate from the heap (to be freed with dc_free).
+ * @param size the number of bytes.
+ * @return the memory, or NULL if a new block could not be allocated.
+ */
+void *arena_alloc(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena, size_t size);
+
+/**
+ * Allocate zeroed memory for count elements (see arena_alloc).
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param arena the arena, or NULL for the heap.
+ * @param count the number of elements.
+ * @param size the size of each element.
+ * @return the memory, or NULL if a new block could not be allocated.
+ */
+void *arena_calloc(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena, size_t count,
+                   size_t size);
+
+/**
+ * Grow an allocation. The most recent allocation grows in place when there is room, anything else is copied.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param arena the arena, or NULL for the heap.
+ * @param ptr the memory from arena_alloc, or NULL.
+ * @param old_size the size ptr was allocated with.
+ * @param new_size the size needed.
+ * @return the memory, or NULL (ptr is left as it was) if a new block could not be allocated.
+ */
+void *arena_realloc(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena, void *ptr,
+                    size_t old_size, size_t new_size);
+
+/**
+ * Copy a string in to the arena.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param arena the arena, or NULL for the heap.
+ * @param str the string (does not need to be '\0' terminated).
+ * @param length the number of characters to copy.
+ * @return the '\0' terminated copy, or NULL if a new block could not be allocated.
+ */
+char *arena_strndup(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena, const char *str,
+                    size_t length);
+
+#endif // DC_SHELL_ARENA_H
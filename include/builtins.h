@@ -18,9 +18,63 @@
  *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include "command_hash.h"
 #include "execute.h"
+#include "history.h"
+#include "jobs.h"
+#include "state.h"
+#include "stats.h"
 #include <dc_posix/dc_posix_env.h>
 
+/*! \struct builtin
+    \brief A command that is run in the shell process instead of starting a program.
+*/
+struct builtin
+{
+    const char *name; /**< the name of the command */
+    int (*function)(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                    struct command *command); /**< run the command, returns RESET_STATE, EXIT or ERROR */
+    bool (*handles)(const struct dc_posix_env *env,
+                    const struct command *command); /**< NULL if the builtin runs every command, else see builtin_handles */
+};
+
+/**
+ * Find the builtin for a command name.
+ * The builtins are a table sorted by name that is binary searched, no allocation or hashing is done.
+ *
+ * @param env the posix environment.
+ * @param name the name of the command.
+ * @return the builtin, or NULL if the command is not a builtin.
+ */
+const struct builtin *builtin_find(const struct dc_posix_env *env, const char *name);
+
+/**
+ * Can the builtin run the command. echo, printf and test only do part of what the programs of the same name do,
+ * for an option, conversion or operator they do not know the program is run instead (see resolve_command).
+ *
+ * @param env the posix environment.
+ * @param builtin the builtin found for the command.
+ * @param command the command information
+ * @return true if the builtin runs the command, false if the program has to.
+ */
+bool builtin_handles(const struct dc_posix_env *env, const struct builtin *builtin, const struct command *command);
+
+/**
+ * Run a builtin for a command that is not part of a pipeline.
+ * The builtin writes to the command's stdout and stderr files if they are redirected, otherwise to the state's
+ * streams. Its output is flushed before it returns so it comes before what the next program writes.
+ * A redirection that cannot be opened is reported and the builtin is not run (the exit code is 1).
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param states the state with the streams, path, command hash and job table.
+ * @param builtin the builtin to run.
+ * @param command the command information
+ * @return EXIT (if the builtin is exit), RESET_STATE or ERROR
+ */
+int builtin_run(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                const struct builtin *builtin, struct command *command);
+
 /**
  * Change the working directory.
  * ~ is converted to the users home directory.
@@ -35,4 +89,191 @@
 void builtin_cd(const struct dc_posix_env *env, struct dc_error *err,
                 struct command *command, FILE *errstream);
 
+/**
+ * Display or change the command hash.
+ * - no arguments displays the hashed commands.
+ * - -r removes all of the hashed commands.
+ * - names are looked up on the path and added to the hash.
+ * The command->exit_code is set to 0 on success or 1 if a name could not be found.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the command information
+ * @param hash the command hash
+ * @param path the directories to search for names
+ * @param outstream the stream to display the hash on
+ * @param errstream the stream to print error messages to
+ */
+void builtin_hash(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                  struct command_hash *hash, char **path, FILE *outstream, FILE *errstream);
+
+/**
+ * Display the background jobs, the ones that are done are removed.
+ * The command->exit_code is set to 0.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the command information
+ * @param jobs the job table
+ * @param outstream the stream to display the jobs on
+ */
+void builtin_jobs(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                  struct job_table *jobs, FILE *outstream);
+
+/**
+ * Wait for background jobs to finish and remove them.
+ * - no arguments waits for every job, the exit code is 0.
+ * - %N (or %+, %%) waits for job N, a number waits for the job with that process.
+ * The command->exit_code is set to the exit code of the last job, or 127 if it is not a job.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the command information
+ * @param jobs the job table
+ * @param errstream the stream to print error messages to
+ */
+void builtin_wait(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                  struct job_table *jobs, FILE *errstream);
+
+/**
+ * Bring a background job to the foreground: display it and wait for it (there is no job control).
+ * - no arguments is the current job.
+ * - %N or N is job N.
+ * The command->exit_code is set to the exit code of the job, or 1 if there is no such job.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the command information
+ * @param jobs the job table
+ * @param outstream the stream to display the job on
+ * @param errstream the stream to print error messages to
+ */
+void builtin_fg(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                struct job_table *jobs, FILE *outstream, FILE *errstream);
+
+/**
+ * Display the arguments separated by spaces and followed by a newline.
+ * - -n as the first argument leaves out the newline.
+ * Escapes are not interpreted (use printf for that), echo -e and the other options are left to the echo program
+ * (see builtin_handles).
+ * The command->exit_code is set to 0, or 1 if the output could not be written.
+ *
+ * @param env the posix environment.
+ * @param command the command information
+ * @param outstream the stream to display the arguments on
+ */
+void builtin_echo(const struct dc_posix_env *env, struct command *command, FILE *outstream);
+
+/**
+ * Display the arguments according to a format: printf format [arguments].
+ * The format has the escapes \\ \a \b \f \n \r \t \v and \NNN (octal), and the conversions %d %i %o %u %x %X
+ * (numbers, 'c gives the code of c), %c, %s, %b (a string with escapes) and %% with the flags - + space # 0, a width
+ * and a precision ('*' takes them from the arguments). The format is reused while there are arguments left,
+ * a missing argument is "" or 0. A format with other conversions (%f, %e...) is left to the printf program.
+ * The command->exit_code is set to 0, 1 if an argument is not a number or 2 if there is no format.
+ *
+ * @param env the posix environment.
+ * @param command the command information
+ * @param outstream the stream to display the output on
+ * @param errstream the stream to print error messages to
+ */
+void builtin_printf(const struct dc_posix_env *env, struct command *command, FILE *outstream, FILE *errstream);
+
+/**
+ * Display the working directory.
+ * The command->exit_code is set to 0, or 1 if the working directory cannot be found.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the command information
+ * @param working_dir the cached working directory, it is looked up and cached if it is NULL
+ * @param outstream the stream to display the directory on
+ */
+void builtin_pwd(const struct dc_posix_env *env, struct dc_error *err, struct command *command, char **working_dir,
+                 FILE *outstream);
+
+/**
+ * Display how long each FSM state and each transition between states has taken: the count, p50, p99 and max.
+ * The command->exit_code is set to 0, or 2 if there are any arguments.
+ *
+ * @param env the posix environment.
+ * @param command the command information
+ * @param stats the times recorded by the FSM
+ * @param outstream the stream to display the times on
+ * @param errstream the stream to print error messages to
+ */
+void builtin_stats(const struct dc_posix_env *env, struct command *command, const struct fsm_stats *stats,
+                   FILE *outstream, FILE *errstream);
+
+/**
+ * Display or clear the history.
+ * - no arguments displays every line in the history.
+ * - n displays the last n lines.
+ * - -c forgets the lines in memory, the history file is not changed.
+ * The command->exit_code is set to 0, or 2 if the arguments are not valid.
+ *
+ * @param env the posix environment.
+ * @param command the command information
+ * @param history the lines that were read
+ * @param outstream the stream to display the lines on
+ * @param errstream the stream to print error messages to
+ */
+void builtin_history(const struct dc_posix_env *env, struct command *command, struct history *history,
+                     FILE *outstream, FILE *errstream);
+
+/**
+ * Evaluate an expression: test expression or [ expression ].
+ * The expression is chosen by the number of arguments the same as POSIX test: ! negates, ( ) group, the unary
+ * operators are -b -c -d -e -f -g -h -L -n -p -r -s -S -t -u -w -x -z and the binary operators are = != -eq -ne
+ * -lt -le -gt -ge. An expression with other operators (-a, -o, -nt...) is left to the test program.
+ * The command->exit_code is set to 0 if the expression is true, 1 if it is false or 2 if it is not valid.
+ *
+ * @param env the posix environment.
+ * @param command the command information
+ * @param errstream the stream to print error messages to
+ */
+void builtin_test(const struct dc_posix_env *env, struct command *command, FILE *errstream);
+
+/**
+ * Set environment variables for the shell and the programs it starts: export NAME=value...
+ * - no arguments (or -p) displays every variable as export NAME='value'.
+ * - NAME without a value is left as it is, every variable of the shell is already exported.
+ * The command->exit_code is set to 0, or 1 if a name is not valid.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the command information
+ * @param outstream the stream to display the variables on
+ * @param errstream the stream to print error messages to
+ */
+void builtin_export(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                    FILE *outstream, FILE *errstream);
+
+/**
+ * Remove environment variables: unset [-v] NAME...
+ * The command->exit_code is set to 0, or 1 if a name is not valid.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the command information
+ * @param errstream the stream to print error messages to
+ */
+void builtin_unset(const struct dc_posix_env *env, struct dc_error *err, struct command *command, FILE *errstream);
+
+/**
+ * Display how each name would be run: "name is a shell builtin" or "name is /path/to/name".
+ * The programs are looked up in the command hash (see command_hash_lookup).
+ * The command->exit_code is set to 0, or 1 if a name could not be found.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the command information
+ * @param hash the command hash
+ * @param path the directories to search for names
+ * @param outstream the stream to display the names on
+ * @param errstream the stream to print error messages to
+ */
+void builtin_type(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                  struct command_hash *hash, char **path, FILE *outstream, FILE *errstream);
+
 #endif // DC_SHELL_BUILTINS_H
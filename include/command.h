@@ -20,9 +20,47 @@
 
 #include "state.h"
 #include <dc_posix/dc_posix_env.h>
+#include <stdint.h>
+
+/*! \enum connector
+    \brief What joins a command to the next command on the line.
+*/
+enum connector
+{
+    CONNECTOR_END,        /**< the last command on the line */
+    CONNECTOR_PIPE,       /**< | the stdout of the command is the stdin of the next one */
+    CONNECTOR_SEQUENCE,   /**< ; the next pipeline runs when this one is done */
+    CONNECTOR_AND,        /**< && the next pipeline only runs if this one succeeded */
+    CONNECTOR_OR,         /**< || the next pipeline only runs if this one failed */
+    CONNECTOR_BACKGROUND  /**< & the and-or list that ends here is a job, the next one runs without waiting for it */
+};
+
+/*! \struct command_usage
+    \brief The resources a command used, from wait4 (see the time prefix and the --usage log).
+*/
+struct command_usage
+{
+    uint64_t wall;              /**< the ns from when the command was started until it was waited for */
+    uint64_t user;              /**< the ns of CPU time in user mode */
+    uint64_t system;            /**< the ns of CPU time in the kernel */
+    long max_rss;               /**< the largest resident set size, in KiB (bytes on macOS) */
+    long voluntary_switches;    /**< the times the command gave up the CPU (e.g. waiting for I/O) */
+    long involuntary_switches;  /**< the times the command was preempted */
+};
+
+/*! \struct command_limits
+    \brief The limits on a program that is started (see the timeout prefix and the limit settings), 0 is no limit.
+*/
+struct command_limits
+{
+    uint64_t timeout;       /**< the ns the program can run before it is sent SIGTERM (and SIGKILL after a grace) */
+    uint64_t cpu;           /**< the soft RLIMIT_CPU, in seconds */
+    uint64_t address_space; /**< the soft RLIMIT_AS, in bytes */
+    uint64_t open_files;    /**< the soft RLIMIT_NOFILE */
+};
 
 /*! \struct command
-    \brief The commands to enter, currently there is only one.
+    \brief One command of the line, the line is a list of them joined by their connectors.
 
     The state passed around to the FSM functions.
 */
@@ -30,6 +68,7 @@ struct command
 {
   char *line;               /**< the current command line */
   char *command;            /**< the program/builtin to run */
+  const char *resolved_path; /**< the absolute path of the program, NULL to search the path (in the arena, not owned without one) */
   size_t argc;              /**< the number of arguments to the command */
   char **argv;              /**< the arguments to the command, arg[0] must be NULL */
   char *stdin_file;         /**< the file to redirect stdin from */
@@ -38,14 +77,22 @@ struct command
   char *stderr_file;        /**< the file to redirect strderr to */
   bool stderr_overwrite;    /**< append or overwrite the strerr file (true = overwrite) */
   int exit_code;            /**< the exit code from the program/builtin */
+  enum connector connector; /**< what joins the command to the next one */
+  uint64_t started;         /**< when the command was started (see stats_now), 0 if it has not been */
+  struct command_usage usage; /**< the resources the command used, set when it is waited for */
+  struct command_limits limits; /**< the limits the program is started with */
+  struct arena *arena;      /**< where the strings and argv are allocated, NULL if each is on the heap */
 };
 
 /**
  * Parse the command. Take the command->line and use it to fill in all of the fields.
+ * The line is scanned once (see next_token), redirections can appear anywhere, even before the command.
+ * Words without quotes or expansion characters are used as they are, the others are expanded with expand_word.
+ * The words and file names are allocated from command->arena.
  *
  * @param env the posix environment.
  * @param err the error object.
- * @param state the current state, to set the fatal_error and access the command line and regex for redirection.
+ * @param state the current state, to set the fatal_error.
  * @param command the command to parse.
  */
 void parse_command(const struct dc_posix_env *env, struct dc_error *err,
@@ -53,6 +100,7 @@ void parse_command(const struct dc_posix_env *env, struct dc_error *err,
 
 /**
  * Destroys command structure values and memory.
+ * Nothing is freed for a command in an arena, the arena is reset once for the whole line instead.
  *
  * @param env the posix environment.
  * @param command the command struct object to be destroyed.
@@ -0,0 +1,126 @@
+#ifndef DC_SHELL_COMMAND_CACHE_H
+#define DC_SHELL_COMMAND_CACHE_H
+
+/*
+ * This file is part of dc_shell.
+ *
+ *  dc_shell is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "command.h"
+#include <dc_posix/dc_posix_env.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct arena;
+
+/*! \struct command_cache_entry
+    \brief The parsed commands of one line.
+*/
+struct command_cache_entry
+{
+    uint64_t hash;                      /**< the hash of the line */
+    char *line;                         /**< the line, in the entry's arena */
+    size_t length;                      /**< the length of the line */
+    struct command *commands;           /**< the parsed commands, exit codes and resolved paths are not kept */
+    size_t count;                       /**< the number of commands */
+    struct arena *arena;                /**< the memory of the line and the commands */
+    struct command_cache_entry *next;   /**< the next entry in the same bucket */
+    struct command_cache_entry *newer;  /**< the entry used after this one, NULL for the most recent */
+    struct command_cache_entry *older;  /**< the entry used before this one, NULL for the least recent */
+};
+
+/*! \struct command_cache
+    \brief The parsed commands of the most recently used lines (LRU), so a line that comes again is not parsed again.
+
+    Only lines whose parse cannot change are cached: nothing that depends on the environment (parameters, command
+    substitution, ~) or on the files that exist (patterns). See command_cache_can_cache.
+*/
+struct command_cache
+{
+    struct command_cache_entry **buckets; /**< the chains of entries */
+    size_t bucket_count;                  /**< the number of buckets, always a power of 2 */
+    size_t count;                         /**< the number of entries */
+    size_t capacity;                      /**< the most entries there can be, the least recent is dropped after */
+    struct command_cache_entry *newest;   /**< the most recently used entry */
+    struct command_cache_entry *oldest;   /**< the least recently used entry, the next to be dropped */
+    size_t hits;                          /**< the number of lines that were found */
+    size_t misses;                        /**< the number of lines that were looked for and not found */
+};
+
+/**
+ * Create an empty command cache.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param capacity the most lines to keep.
+ * @return the command cache, or NULL if it could not be allocated.
+ */
+struct command_cache *command_cache_create(const struct dc_posix_env *env, struct dc_error *err, size_t capacity);
+
+/**
+ * Free the command cache and all of its entries.
+ *
+ * @param env the posix environment.
+ * @param pcache pointer to the command cache, set to NULL.
+ */
+void command_cache_destroy(const struct dc_posix_env *env, struct command_cache **pcache);
+
+/**
+ * Can the commands of a line be cached: the line has no '$', '`', '~' or pattern characters ('*', '?', '[') at all,
+ * quoted or not, so parsing it gives the same commands whatever the environment and the working directory are.
+ *
+ * @param line the line (not '\0' terminated).
+ * @param length the length of the line.
+ * @return true if the line can be cached.
+ */
+bool command_cache_can_cache(const char *line, size_t length);
+
+/**
+ * Find the commands of a line and copy them in to an arena, the same as separate_commands and parse_command would
+ * have made them.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param cache the command cache.
+ * @param line the line (not '\0' terminated).
+ * @param length the length of the line.
+ * @param arena where the copies are allocated.
+ * @param commands set to the copies of the commands.
+ * @param count set to the number of commands.
+ * @return true if the line was found.
+ */
+bool command_cache_get(const struct dc_posix_env *env, struct dc_error *err, struct command_cache *cache,
+                       const char *line, size_t length, struct arena *arena, struct command **commands,
+                       size_t *count);
+
+/**
+ * Add the parsed commands of a line, dropping the least recently used line if the cache is full.
+ * The commands are copied, the cache does not keep them.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param cache the command cache.
+ * @param line the line (not '\0' terminated).
+ * @param length the length of the line.
+ * @param commands the parsed commands.
+ * @param count the number of commands.
+ */
+void command_cache_put(const struct dc_posix_env *env, struct dc_error *err, struct command_cache *cache,
+                       const char *line, size_t length, const struct command *commands, size_t count);
+
+#endif // DC_SHELL_COMMAND_CACHE_H
@@ -0,0 +1,102 @@
+#ifndef DC_SHELL_COMMAND_HASH_H
+#define DC_SHELL_COMMAND_HASH_H
+
+/*
+ * This file is part of dc_shell.
+ *
+ *  dc_shell is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <dc_posix/dc_posix_env.h>
+#include <stdio.h>
+#include <time.h>
+
+/*! \struct command_hash_entry
+    \brief A program that has been found on the PATH.
+*/
+struct command_hash_entry
+{
+    char *name;                        /**< the command name, as typed */
+    char *path;                        /**< the absolute path the command was found at */
+    char *dir;                         /**< the PATH directory the command was found in */
+    struct timespec dir_mtime;         /**< the modification time of dir when the command was found */
+    size_t hits;                       /**< the number of times the entry has been used */
+    struct command_hash_entry *next;   /**< the next entry in the same bucket */
+};
+
+/*! \struct command_hash
+    \brief Remembers where commands were found on the PATH (like the bash hash builtin).
+
+    Entries are dropped when the PATH environ var changes or when the directory an entry was found in
+    has been modified since.
+*/
+struct command_hash
+{
+    struct command_hash_entry **buckets; /**< the chains of entries */
+    size_t bucket_count;                 /**< the number of buckets, always a power of 2 */
+    size_t count;                        /**< the number of entries */
+    char *path_var;                      /**< the PATH environ var the entries were found with */
+};
+
+/**
+ * Create an empty command hash.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @return the command hash, or NULL if it could not be allocated.
+ */
+struct command_hash *command_hash_create(const struct dc_posix_env *env, struct dc_error *err);
+
+/**
+ * Free the command hash and all of its entries.
+ *
+ * @param env the posix environment.
+ * @param phash pointer to the command hash, set to NULL.
+ */
+void command_hash_destroy(const struct dc_posix_env *env, struct command_hash **phash);
+
+/**
+ * Remove all of the entries (hash -r).
+ *
+ * @param env the posix environment.
+ * @param hash the command hash.
+ */
+void command_hash_clear(const struct dc_posix_env *env, struct command_hash *hash);
+
+/**
+ * Find the absolute path of a command.
+ * A cached entry is used if it is still valid, otherwise the path directories are searched
+ * for an executable regular file and the result is cached.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param hash the command hash.
+ * @param name the command to find, must not contain a '/'.
+ * @param path the directories to search for the command.
+ * @return the absolute path (owned by the hash, only valid until the next lookup or clear, copy it to keep it) or
+ *         NULL if not found.
+ */
+const char *command_hash_lookup(const struct dc_posix_env *env, struct dc_error *err, struct command_hash *hash,
+                                const char *name, char **path);
+
+/**
+ * Display the entries the same way as bash (hits and path, one per line).
+ *
+ * @param env the posix environment.
+ * @param hash the command hash.
+ * @param stream the stream to display the entries on.
+ */
+void command_hash_print(const struct dc_posix_env *env, const struct command_hash *hash, FILE *stream);
+
+#endif // DC_SHELL_COMMAND_HASH_H
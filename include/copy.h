@@ -0,0 +1,65 @@
+#ifndef DC_SHELL_COPY_H
+#define DC_SHELL_COPY_H
+
+/*
+ * This file is part of dc_shell.
+ *
+ *  dc_shell is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "command.h"
+#include <dc_posix/dc_posix_env.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+/**
+ * Can the command be run by copying in the kernel instead of exec'ing the program.
+ * Only "cat" with file operands and "tee" with one file operand, without any options, typed without a '/'
+ * and only where splice/tee/copy_file_range exist (Linux).
+ * Every launcher does this (see launch), it shadows whatever cat or tee is first on the PATH; "/bin/cat" (a name
+ * with a '/') always runs the program.
+ *
+ * @param env the posix environment.
+ * @param command the parsed command.
+ * @return true if run_copy_command can be used for the command.
+ */
+bool is_copy_command(const struct dc_posix_env *env, const struct command *command);
+
+/**
+ * Run a cat or tee command in the current process, on the already redirected stdin/stdout
+ * (the child after redirect(), in place of the exec).
+ * tee is only done in the kernel when stdin and stdout are both pipes.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the command accepted by is_copy_command.
+ * @return the exit code, or -1 if the command has to be exec'ed after all.
+ */
+int run_copy_command(const struct dc_posix_env *env, struct dc_error *err, const struct command *command);
+
+/**
+ * Copy everything from in_fd to out_fd, in the kernel where possible:
+ * copy_file_range between regular files, splice when either side is a pipe,
+ * and read/write when neither works for the descriptors.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param in_fd the descriptor to read until end of file.
+ * @param out_fd the descriptor to write to.
+ * @return the number of bytes copied.
+ */
+off_t copy_fd(const struct dc_posix_env *env, struct dc_error *err, int in_fd, int out_fd);
+
+#endif // DC_SHELL_COPY_H
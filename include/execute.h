@@ -19,13 +19,16 @@
  */
 
 #include "command.h"
+#include "launcher.h"
 #include <dc_posix/dc_posix_env.h>
 #include <stdio.h>
+#include <sys/types.h>
 
 /**
  * Create a child process, exec the command with any redirection, set the exit code.
  * If there is an err executing the command print an err message.
  * If the command cannot be found set the command->exit_code to 127.
+ * If command->resolved_path is set it is run directly, otherwise path is searched.
  *
  * @param env the posix environment.
  * @param err the err object
@@ -34,4 +37,86 @@
  */
 void execute(const struct dc_posix_env *env, struct dc_error *err, struct command *command, char **path);
 
+/**
+ * Start the command without waiting for it, command->started is set.
+ * LAUNCHER_SPAWN uses posix_spawn when the program is known (command->resolved_path or a command with a '/'),
+ * otherwise, and for LAUNCHER_FORK, the child is forked and does the redirection and path search itself.
+ * LAUNCHER_POOL hands a known program to a worker of the pool (see worker_pool_launch), the same as LAUNCHER_SPAWN
+ * if none is ready.
+ * Commands with resource limits (command->limits) are always forked since posix_spawn cannot set them.
+ * cat and tee are done by copying in the kernel (see is_copy_command) with every launcher: a worker does the copy
+ * itself and LAUNCHER_SPAWN forks them, there is no program to spawn.
+ * in_fd and out_fd (pipe ends) are put on stdin/stdout before the file redirections, so a file
+ * redirection wins over the pipe the same as in sh.
+ *
+ * @param env the posix environment.
+ * @param err the err object
+ * @param command the command to start
+ * @param path the directories to search for the command
+ * @param launcher how to start the command
+ * @param in_fd the descriptor to use as stdin, -1 to inherit it
+ * @param out_fd the descriptor to use as stdout, -1 to inherit it
+ * @return the pid of the child, or -1 if it could not be started (command->exit_code is set).
+ */
+pid_t launch(const struct dc_posix_env *env, struct dc_error *err, struct command *command, char **path,
+             enum launcher launcher, int in_fd, int out_fd);
+
+/**
+ * Do what the child of a fork does to run a command: set the limits, put in_fd and out_fd on stdin/stdout,
+ * do the redirections, then copy (see is_copy_command) or exec the program.
+ * It does not return, the process exits with the exit code if the program cannot be run.
+ *
+ * @param env the posix environment.
+ * @param err the err object
+ * @param command the command to run
+ * @param path the directories to search for the command
+ * @param in_fd the descriptor to use as stdin, -1 to inherit it
+ * @param out_fd the descriptor to use as stdout, -1 to inherit it
+ */
+void exec_command(const struct dc_posix_env *env, struct dc_error *err, struct command *command, char **path,
+                  int in_fd, int out_fd);
+
+/**
+ * Start the commands as a pipeline without waiting for them (see execute_pipeline).
+ * If one of the commands cannot be started because of an error the ones already started are waited for.
+ *
+ * @param env the posix environment.
+ * @param err the err object
+ * @param commands the commands to run, in order
+ * @param count the number of commands
+ * @param path the directories to search for the commands
+ * @param launcher how to start the commands
+ * @param pids set to the pid of each command, -1 if it could not be started (command->exit_code is set)
+ */
+void start_pipeline(const struct dc_posix_env *env, struct dc_error *err, struct command *commands, size_t count,
+                    char **path, enum launcher launcher, pid_t *pids);
+
+/**
+ * Run the commands as a pipeline: every command is started before any is waited for,
+ * the stdout of each is connected to the stdin of the next with a pipe.
+ * The exit code of every command is set, the last one is the exit code of the pipeline.
+ *
+ * @param env the posix environment.
+ * @param err the err object
+ * @param commands the commands to run, in order
+ * @param count the number of commands
+ * @param path the directories to search for the commands
+ * @param launcher how to start the commands
+ */
+void execute_pipeline(const struct dc_posix_env *env, struct dc_error *err, struct command *commands, size_t count,
+                      char **path, enum launcher launcher);
+
+/**
+ * Wait for a child started by launch and set the command->exit_code and command->usage.
+ * If the command could not be found print a message.
+ * If command->limits.timeout is set the child is sent SIGTERM when it runs past it, SIGKILL if it is still running
+ * a grace period later, and the exit code is 124 the same as timeout(1).
+ *
+ * @param env the posix environment.
+ * @param err the err object
+ * @param command the command that was started
+ * @param pid the pid returned by launch
+ */
+void wait_for_command(const struct dc_posix_env *env, struct dc_error *err, struct command *command, pid_t pid);
+
 #endif // DC_SHELL_EXECUTE_H
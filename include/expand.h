@@ -0,0 +1,90 @@
+#ifndef DC_SHELL_EXPAND_H
+#define DC_SHELL_EXPAND_H
+
+/*
+ * This file is part of dc_shell.
+ *
+ *  dc_shell is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <dc_posix/dc_posix_env.h>
+#include <stddef.h>
+
+struct arena;
+struct shell_options;
+
+/*! \enum expansion
+    \brief The expansions to do on a word, or'ed together.
+*/
+enum expansion
+{
+    EXPAND_TILDE = 0x01,      /**< ~ and ~user at the start of the word */
+    EXPAND_PARAMETERS = 0x02, /**< $NAME, ${NAME} and $$ */
+    EXPAND_COMMANDS = 0x04,   /**< $(commands) and `commands`, run by dc_shell in a child */
+    EXPAND_FIELDS = 0x08,     /**< split the unquoted parameters and commands on IFS */
+    EXPAND_GLOB = 0x10,       /**< replace a word with unquoted * ? [ with the matching paths */
+    EXPAND_ALL = 0x1F         /**< everything, the same as sh does for a command word */
+};
+
+/**
+ * Expand a word the way sh does and add the resulting words to the list.
+ * The quotes are removed, a word with no unquoted expansions always gives exactly one word.
+ * An unquoted expansion that is empty gives no word at all, a pattern that matches nothing is left as it is.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param text the word (not '\0' terminated).
+ * @param length the length of the word.
+ * @param flags the expansions to do.
+ * @param options the settings to run command substitutions with, or NULL for the defaults.
+ * @param exit_code set to the exit code of the last command substitution, left as it is if there was none (may be NULL).
+ * @param arena where the words and the list are allocated, NULL for the heap.
+ * @param words the list of words, grown as needed and always NULL terminated.
+ * @param count the number of words in the list.
+ * @param capacity the number of words the list can hold.
+ * @return the number of words that were added.
+ */
+size_t expand_word(const struct dc_posix_env *env, struct dc_error *err, const char *text, size_t length, int flags,
+                   const struct shell_options *options, int *exit_code, struct arena *arena, char ***words,
+                   size_t *count, size_t *capacity);
+
+/**
+ * Expand a word to a single string: the fields are not split and the result is not globbed.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param text the word to expand.
+ * @param flags the expansions to do (EXPAND_FIELDS and EXPAND_GLOB are ignored).
+ * @param options the settings to run command substitutions with, or NULL for the defaults.
+ * @return the expanded word (to be freed by the caller), or NULL on error.
+ */
+char *expand_string(const struct dc_posix_env *env, struct dc_error *err, const char *text, int flags,
+                    const struct shell_options *options);
+
+/**
+ * Add a word to the end of a list, growing the list as needed.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param arena where the list is allocated, NULL for the heap.
+ * @param word the word, owned by the list (freed if it is on the heap and cannot be added).
+ * @param words the list of words, NULL terminated, may start as NULL.
+ * @param count the number of words in the list.
+ * @param capacity the number of words the list can hold.
+ */
+void append_word(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena, char *word,
+                 char ***words, size_t *count, size_t *capacity);
+
+#endif // DC_SHELL_EXPAND_H
@@ -0,0 +1,139 @@
+#ifndef DC_SHELL_HISTORY_H
+#define DC_SHELL_HISTORY_H
+
+/*
+ * This file is part of dc_shell.
+ *
+ *  dc_shell is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <dc_posix/dc_posix_env.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*! \struct history_entry
+    \brief One line of the history.
+*/
+struct history_entry
+{
+    char *line;       /**< the line (not '\0' terminated) */
+    size_t length;    /**< the length of the line */
+    bool owned;       /**< was the line allocated for the entry (false = it is in the loaded file) */
+};
+
+/*! \struct history
+    \brief The most recent lines, a ring that drops the oldest line when it is full, and the file they are saved in.
+
+    The lines are appended to the file in a buffer that is written when it is full, every HISTORY_FLUSH_INTERVAL and
+    when the history is destroyed, never one write (or fsync) per line.
+*/
+struct history
+{
+    struct history_entry *entries; /**< the ring of lines, capacity of them */
+    size_t capacity;               /**< the most lines to keep */
+    size_t count;                  /**< the number of lines */
+    size_t oldest;                 /**< the index in entries of the oldest line */
+    size_t number;                 /**< the number of the oldest line, displayed by the history builtin */
+    int fd;                        /**< the history file, opened for appending (-1 if the history is not saved) */
+    char *pending;                 /**< the lines waiting to be written to the file */
+    size_t pending_length;         /**< the length of the pending lines */
+    uint64_t last_flush;           /**< when the pending lines were last written (see stats_now) */
+    char *mapped;                  /**< the file as it was loaded, the loaded entries point into it (NULL if none) */
+    size_t mapped_length;          /**< the length of the mapping */
+};
+
+/**
+ * Create an empty history that is not saved (see history_open).
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param capacity the most lines to keep.
+ * @return the history, or NULL if it could not be allocated.
+ */
+struct history *history_create(const struct dc_posix_env *env, struct dc_error *err, size_t capacity);
+
+/**
+ * Load the last lines of a history file and append the lines that are added after to it.
+ * The file is created if it does not exist. It is mapped instead of read and only the lines that fit in the
+ * history are looked at, from the end back, so a large file does not slow down the start.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param history the history, empty.
+ * @param path the history file.
+ */
+void history_open(const struct dc_posix_env *env, struct dc_error *err, struct history *history, const char *path);
+
+/**
+ * Write the pending lines, then stop saving the history and free it.
+ *
+ * @param env the posix environment.
+ * @param phistory pointer to the history, set to NULL.
+ */
+void history_destroy(const struct dc_posix_env *env, struct history **phistory);
+
+/**
+ * Add a line, dropping the oldest line if the history is full.
+ * The line is appended to the pending lines, they are written if the buffer is full or HISTORY_FLUSH_INTERVAL
+ * has passed.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param history the history.
+ * @param line the line (not '\0' terminated, no '\n').
+ * @param length the length of the line.
+ */
+void history_add(const struct dc_posix_env *env, struct dc_error *err, struct history *history, const char *line,
+                 size_t length);
+
+/**
+ * Write the pending lines to the history file.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param history the history.
+ */
+void history_flush(const struct dc_posix_env *env, struct dc_error *err, struct history *history);
+
+/**
+ * Get a line of the history.
+ *
+ * @param history the history.
+ * @param index the index of the line, 0 is the oldest.
+ * @return the line, or NULL if index is not less than history->count.
+ */
+const struct history_entry *history_get(const struct history *history, size_t index);
+
+/**
+ * Forget the lines in memory, the numbers start again at 1. The history file is not changed.
+ *
+ * @param env the posix environment.
+ * @param history the history.
+ */
+void history_clear(const struct dc_posix_env *env, struct history *history);
+
+/**
+ * Display the most recent lines, oldest first, as "number  line".
+ *
+ * @param history the history.
+ * @param last the most lines to display.
+ * @param stream the stream to display the lines on.
+ */
+void history_print(const struct history *history, size_t last, FILE *stream);
+
+#endif // DC_SHELL_HISTORY_H
@@ -20,17 +20,109 @@
 
 #include <dc_posix/dc_posix_env.h>
 #include <dc_posix/dc_stdlib.h>
+#include <stdbool.h>
 #include <stdio.h>
 
+/*! \enum line_source
+    \brief Where a line reader gets its lines from.
+*/
+enum line_source
+{
+    LINE_SOURCE_STREAM, /**< one line at a time from a FILE * (interactive) */
+    LINE_SOURCE_FD,     /**< large blocks read from a file descriptor and split in to lines */
+    LINE_SOURCE_MAP,    /**< a regular file mapped read-only, lines are handed out in place */
+    LINE_SOURCE_STRING, /**< a string given up front (eg. -C 'cmd') */
+};
+
+/*! \struct line_reader
+    \brief A reusable buffer for reading command lines.
+
+    The buffer is grown as needed and kept between reads, so reading a line does not allocate once the
+    buffer is large enough. For the block sources the buffer holds many lines, start and end mark the
+    part that has not been handed out yet. For LINE_SOURCE_MAP start and end index the mapping instead,
+    and the lines handed out are not '\0' terminated.
+*/
+struct line_reader
+{
+    enum line_source source; /**< where the lines come from */
+    int fd;                  /**< the file descriptor to read blocks from (LINE_SOURCE_FD only) */
+    char *buffer;            /**< the line buffer, reused for every read */
+    void *mapping;           /**< the read-only mapped file (LINE_SOURCE_MAP only) */
+    size_t capacity;         /**< the number of bytes allocated for buffer */
+    size_t start;            /**< offset of the first unread byte in buffer (block sources) */
+    size_t end;              /**< offset one past the last byte in buffer (block sources) */
+    size_t max_line_length;  /**< the largest line that will be accepted */
+    bool eof;                /**< has the end of the stream been reached (true = end of stream) */
+};
+
+/**
+ * Create a line reader.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param max_line_length the largest line that will be accepted.
+ * @return the line reader, or NULL if it could not be allocated.
+ */
+struct line_reader *line_reader_create(const struct dc_posix_env *env, struct dc_error *err, size_t max_line_length);
+
+/**
+ * Create a line reader for a file descriptor.
+ * A non-empty regular file is mapped read-only and its lines are handed out in place (LINE_SOURCE_MAP),
+ * anything else (eg. a pipe) is read in large blocks and split in to lines (LINE_SOURCE_FD).
+ * The file descriptor is not closed by the reader.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param fd the file descriptor to read from.
+ * @param max_line_length the largest line that will be accepted.
+ * @return the line reader, or NULL if it could not be allocated.
+ */
+struct line_reader *line_reader_create_fd(const struct dc_posix_env *env, struct dc_error *err, int fd,
+                                          size_t max_line_length);
+
+/**
+ * Create a line reader that hands out the lines of a string.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param str the lines to read, copied by the reader.
+ * @param max_line_length the largest line that will be accepted.
+ * @return the line reader, or NULL if it could not be allocated.
+ */
+struct line_reader *line_reader_create_string(const struct dc_posix_env *env, struct dc_error *err, const char *str,
+                                              size_t max_line_length);
+
+/**
+ * Free the line reader and its buffer.
+ *
+ * @param env the posix environment.
+ * @param preader pointer to the line reader, set to NULL.
+ */
+void line_reader_destroy(const struct dc_posix_env *env, struct line_reader **preader);
+
+/**
+ * Has every line been read. The block sources set eof when the last block is read, the lines still in the buffer
+ * (blank ones too) have to be handed out before the reader is done.
+ *
+ * @param reader the line reader.
+ * @return true if the end of the stream was reached and there is nothing left in the buffer.
+ */
+bool line_reader_done(const struct line_reader *reader);
+
 /**
  * Read the command line from the user.
+ * The line is trimmed in place, the returned pointer is a view into the reader's buffer (or mapping)
+ * and is only valid until the next read. Use line_size for the length: lines from a LINE_SOURCE_MAP
+ * reader are not '\0' terminated.
  *
  * @param env the posix environment.
  * @param err the error object
- * @param stream The stream to read from (eg. stdin)
- * @param line_size the maximum characters to read.
+ * @param reader the line reader that owns the buffer.
+ * @param stream The stream to read from (eg. stdin), only used by LINE_SOURCE_STREAM readers.
+ * @param line_size set to the length of the line.
  * @return The command line that the user entered.
  */
-char *read_command_line(const struct dc_posix_env *env, struct dc_error *err, FILE *stream, size_t *line_size);
+const char *read_command_line(const struct dc_posix_env *env, struct dc_error *err, struct line_reader *reader,
+                              FILE *stream, size_t *line_size);
 
 #endif // DC_SHELL_INPUT_H
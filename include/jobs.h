@@ -0,0 +1,173 @@
+#ifndef DC_SHELL_JOBS_H
+#define DC_SHELL_JOBS_H
+
+/*
+ * This file is part of dc_shell.
+ *
+ *  dc_shell is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <dc_posix/dc_posix_env.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+/*! \struct job_process
+    \brief A process of a background job.
+*/
+struct job_process
+{
+    pid_t pid;           /**< the process id, -1 if it could not be started */
+    bool running;        /**< the process has not been reaped yet */
+};
+
+/*! \struct job
+    \brief A pipeline that was started in the background with &.
+*/
+struct job
+{
+    int id;              /**< the job number, %id */
+    char *line;          /**< the command line as it was typed */
+    struct job_process *processes; /**< the process of each command in the pipeline */
+    size_t count;        /**< the number of processes */
+    size_t running;      /**< the number of processes that have not been reaped yet */
+    int exit_code;       /**< the exit code of the last command, set once it has been reaped */
+    struct job *next;    /**< the next job, the list is in order of id */
+};
+
+/*! \struct job_table
+    \brief The background jobs of the shell.
+
+    SIGCHLD is blocked and read from a signalfd so the shell can check for finished children
+    without a waitpid per job every time around the FSM (on systems without signalfd every job is polled).
+*/
+struct job_table
+{
+    struct job *jobs;    /**< the jobs, in order of id */
+    struct job *current; /**< the most recently started job, %+ */
+    int signal_fd;       /**< the signalfd SIGCHLD is read from, -1 to poll */
+    sigset_t old_mask;   /**< the signal mask before SIGCHLD was blocked */
+};
+
+/**
+ * Create an empty job table and start listening for SIGCHLD.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @return the job table, or NULL if it could not be allocated.
+ */
+struct job_table *job_table_create(const struct dc_posix_env *env, struct dc_error *err);
+
+/**
+ * Free the job table, the jobs that are still running are left to run.
+ *
+ * @param env the posix environment.
+ * @param ptable pointer to the job table, set to NULL.
+ */
+void job_table_destroy(const struct dc_posix_env *env, struct job_table **ptable);
+
+/**
+ * Add a job for a pipeline that has been started.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param table the job table.
+ * @param line the command line (not '\0' terminated).
+ * @param length the length of the line.
+ * @param pids the process of each command, -1 for a command that could not be started.
+ * @param count the number of processes.
+ * @param exit_code the exit code of the last command if it could not be started.
+ * @return the new job, or NULL if it could not be allocated.
+ */
+struct job *job_add(const struct dc_posix_env *env, struct dc_error *err, struct job_table *table, const char *line,
+                    size_t length, const pid_t *pids, size_t count, int exit_code);
+
+/**
+ * Find a job by its id, or the current job for 0.
+ *
+ * @param table the job table.
+ * @param id the job number, 0 for the current job.
+ * @return the job, or NULL if there is no such job.
+ */
+struct job *job_find(const struct job_table *table, int id);
+
+/**
+ * Find the job a process belongs to.
+ *
+ * @param table the job table.
+ * @param pid the process id.
+ * @return the job, or NULL if the process is not in a job.
+ */
+struct job *job_find_pid(const struct job_table *table, pid_t pid);
+
+/**
+ * Reap the background processes that have finished, without blocking.
+ * Nothing is waited for unless a SIGCHLD has arrived since the last call.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param table the job table.
+ */
+void job_table_reap(const struct dc_posix_env *env, struct dc_error *err, struct job_table *table);
+
+/**
+ * Block until a child process has finished, without reaping it (see job_table_reap).
+ * Returns straight away if a child finished since the last job_table_reap.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param table the job table.
+ */
+void job_table_wait_child(const struct dc_posix_env *env, struct dc_error *err, const struct job_table *table);
+
+/**
+ * Wait for every process in a job to finish.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param job the job to wait for.
+ * @return the exit code of the job.
+ */
+int job_wait(const struct dc_posix_env *env, struct dc_error *err, struct job *job);
+
+/**
+ * Remove a job from the table and free it.
+ *
+ * @param env the posix environment.
+ * @param table the job table.
+ * @param job the job to remove.
+ */
+void job_remove(const struct dc_posix_env *env, struct job_table *table, struct job *job);
+
+/**
+ * Display the jobs (see the jobs builtin), the ones that are done are removed.
+ *
+ * @param env the posix environment.
+ * @param table the job table.
+ * @param stream the stream to display the jobs on.
+ */
+void job_table_print(const struct dc_posix_env *env, struct job_table *table, FILE *stream);
+
+/**
+ * Tell the user about the jobs that finished since the last prompt and remove them.
+ *
+ * @param env the posix environment.
+ * @param table the job table.
+ * @param stream the stream to display the jobs on.
+ */
+void job_table_notify(const struct dc_posix_env *env, struct job_table *table, FILE *stream);
+
+#endif // DC_SHELL_JOBS_H
@@ -0,0 +1,31 @@
+#ifndef DC_SHELL_LAUNCHER_H
+#define DC_SHELL_LAUNCHER_H
+
+/*
+ * This file is part of dc_shell.
+ *
+ *  dc_shell is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*! \enum launcher
+    \brief How programs are started.
+*/
+enum launcher
+{
+    LAUNCHER_SPAWN, /**< posix_spawn with file actions for the redirections (the default) */
+    LAUNCHER_FORK,  /**< fork, redirect in the child, then exec */
+    LAUNCHER_POOL,  /**< a worker forked ahead of time execs the program (see worker_pool_start), else spawn */
+};
+
+#endif // DC_SHELL_LAUNCHER_H
@@ -0,0 +1,107 @@
+#ifndef DC_SHELL_LEXER_H
+#define DC_SHELL_LEXER_H
+
+/*
+ * This file is part of dc_shell.
+ *
+ *  dc_shell is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*! \enum token_type
+    \brief The kinds of token in a command line.
+*/
+enum token_type
+{
+    TOKEN_END,                 /**< the end of the line */
+    TOKEN_WORD,                /**< a word, the quotes are left for the expansion */
+    TOKEN_PIPE,                /**< | */
+    TOKEN_BACKGROUND,          /**< & */
+    TOKEN_SEMICOLON,           /**< ; */
+    TOKEN_AND,                 /**< && */
+    TOKEN_OR,                  /**< || */
+    TOKEN_REDIRECT_IN,         /**< < */
+    TOKEN_REDIRECT_OUT,        /**< > or 1> */
+    TOKEN_REDIRECT_OUT_APPEND, /**< >> or 1>> */
+    TOKEN_REDIRECT_ERR,        /**< 2> */
+    TOKEN_REDIRECT_ERR_APPEND, /**< 2>> */
+    TOKEN_ERROR                /**< a quote that is not closed */
+};
+
+/*! \struct token
+    \brief A token, a view in to the line that was scanned.
+*/
+struct token
+{
+    enum token_type type; /**< what the token is */
+    const char *text;     /**< the start of the token in the line (not '\0' terminated) */
+    size_t length;        /**< the length of the token */
+    bool plain;           /**< a word without quotes or expansion characters, it can be used as is */
+};
+
+/*! \struct lexer
+    \brief Splits a line in to tokens in a single scan from start to end.
+*/
+struct lexer
+{
+    const char *line; /**< the line to scan (does not need to be '\0' terminated) */
+    size_t length;    /**< the length of the line */
+    size_t position;  /**< where the next token starts */
+};
+
+/**
+ * Start scanning a line.
+ *
+ * @param lexer the lexer to set up.
+ * @param line the line to scan.
+ * @param length the length of the line.
+ */
+void lexer_init(struct lexer *lexer, const char *line, size_t length);
+
+/**
+ * Scan the next token. Whitespace between tokens is skipped.
+ * A digit is only a file descriptor (1> 2> 2>>) at the start of a token, "a2>b" is the word a2 and a redirect.
+ * "||" and "&&" are single tokens, "| |" is two pipes.
+ * A '#' at the start of a token is a comment, the rest of the line is skipped (TOKEN_END), "a#b" is one word.
+ *
+ * @param lexer the lexer.
+ * @param token set to the token.
+ * @return the type of the token, TOKEN_END at the end of the line.
+ */
+enum token_type next_token(struct lexer *lexer, struct token *token);
+
+/**
+ * Find the character that closes a quote or substitution, skipping anything nested inside it.
+ * end is '"' for a double quoted string, '`' for a backquoted command, ')' for $( and '}' for ${.
+ *
+ * @param line the line to scan.
+ * @param length the length of the line.
+ * @param position just after the opening character(s).
+ * @param end the closing character.
+ * @return the position of the closing character, or length if it is not closed.
+ */
+size_t scan_substitution(const char *line, size_t length, size_t position, char end);
+
+/**
+ * Is the token a redirection (which must be followed by a word).
+ *
+ * @param type the type of the token.
+ * @return true for the TOKEN_REDIRECT_ types.
+ */
+bool is_redirect_token(enum token_type type);
+
+#endif // DC_SHELL_LEXER_H
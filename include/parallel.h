@@ -0,0 +1,40 @@
+#ifndef DC_SHELL_PARALLEL_H
+#define DC_SHELL_PARALLEL_H
+
+/*
+ * This file is part of dc_shell.
+ *
+ *  dc_shell is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "state.h"
+#include <dc_posix/dc_posix_env.h>
+
+/**
+ * Run the command lines of a file (or stdin) with up to N of them running at once: parallel [-j N] [file].
+ * Each line is separated and parsed the same as a line typed at the prompt and the whole line is started as a
+ * background job (see start_job). The finished lines are reaped as they end and
+ * "exit code<tab>line" is displayed for each line in input order. N is the number of online processors by default.
+ * The exit code of the parallel command is 0 if every line succeeded, 1 otherwise.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param states the state with the job table and the streams.
+ * @param command the parallel command.
+ */
+void builtin_parallel(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                      struct command *command);
+
+#endif // DC_SHELL_PARALLEL_H
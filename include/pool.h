@@ -0,0 +1,73 @@
+#ifndef DC_SHELL_POOL_H
+#define DC_SHELL_POOL_H
+
+/*
+ * This file is part of dc_shell.
+ *
+ *  dc_shell is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "command.h"
+#include <dc_posix/dc_posix_env.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+/*
+ * A pool of processes forked before the shell grows, each one waits to exec a single program for LAUNCHER_POOL.
+ * The workers are made by a small helper process (the zygote) that is forked when the pool starts. It clones each
+ * worker with CLONE_PARENT so the worker is a child of the shell, the same as a program the shell forked itself,
+ * and the cost of making one does not depend on how large the shell is. A worker is replaced after it is used,
+ * which is not on the path of the command that used it.
+ *
+ * There is one pool per process, only the process that started it uses it (a forked copy of the shell cannot wait
+ * for the workers). Only Linux has CLONE_PARENT, worker_pool_start fails with ENOSYS everywhere else.
+ */
+
+/**
+ * Start the pool: fork the zygote and wait for it to make the workers.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param size the number of workers to keep ready.
+ * @return false if the pool could not be started or is already running.
+ */
+bool worker_pool_start(const struct dc_posix_env *env, struct dc_error *err, size_t size);
+
+/**
+ * Run a program with a worker: the worker is sent the program, arguments, redirections, limits, environment and
+ * working directory of the shell, and the in_fd and out_fd, then does what the child of a fork does
+ * (see exec_command). A replacement worker is asked for.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the command to run.
+ * @param program the path of the program.
+ * @param in_fd the descriptor to use as stdin, -1 to inherit it
+ * @param out_fd the descriptor to use as stdout, -1 to inherit it
+ * @return the pid of the worker (now the program), or -1 if there is no worker ready (start it another way).
+ */
+pid_t worker_pool_launch(const struct dc_posix_env *env, struct dc_error *err, const struct command *command,
+                         const char *program, int in_fd, int out_fd);
+
+/**
+ * Stop the pool, the zygote and the idle workers exit when their sockets are closed.
+ *
+ * @param env the posix environment.
+ */
+void worker_pool_stop(const struct dc_posix_env *env);
+
+#endif // DC_SHELL_POOL_H
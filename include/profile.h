@@ -0,0 +1,80 @@
+#ifndef DC_SHELL_PROFILE_H
+#define DC_SHELL_PROFILE_H
+
+/*
+ * This file is part of dc_shell.
+ *
+ *  dc_shell is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <dc_posix/dc_posix_env.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+ * A dc_posix_tracer that profiles the dc_* functions. The tracer is only called when a function starts, so a call
+ * is timed from its start to the start of the next traced function: the time of a dc_fork or dc_execvp is the time
+ * until the shell traces anything else.
+ *
+ * The tracer has no argument to keep its data in, there is one profile per process.
+ */
+
+/**
+ * Start counting the calls and times of the traced functions.
+ *
+ * @param keep_events keep every call for profile_print_trace, not just the totals.
+ * @return false if the profile is already running.
+ */
+bool profile_start(bool keep_events);
+
+/**
+ * The tracer to give to dc_posix_env_init, it does nothing until profile_start is called.
+ *
+ * @param env the posix environment.
+ * @param file_name the file of the traced function.
+ * @param function_name the traced function.
+ * @param line_number the line of the traced function.
+ */
+void profile_tracer(const struct dc_posix_env *env, const char *file_name, const char *function_name,
+                    size_t line_number);
+
+/**
+ * Stop counting, the last call ends now.
+ */
+void profile_stop(void);
+
+/**
+ * Display each function with its number of calls, total time and average time, the most total time first.
+ *
+ * @param stream the stream to display the report on.
+ */
+void profile_print_report(FILE *stream);
+
+/**
+ * Write every call as a Chrome trace (chrome://tracing, Perfetto) JSON file.
+ * Only the calls since profile_start(true) are kept, the calls after there are too many are left out.
+ *
+ * @param stream the stream to write the JSON to.
+ */
+void profile_print_trace(FILE *stream);
+
+/**
+ * Free the profile so it can be started again.
+ */
+void profile_reset(void);
+
+#endif // DC_SHELL_PROFILE_H
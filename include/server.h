@@ -0,0 +1,104 @@
+#ifndef DC_SHELL_SERVER_H
+#define DC_SHELL_SERVER_H
+
+/*
+ * This file is part of dc_shell.
+ *
+ *  dc_shell is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <dc_posix/dc_posix_env.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+/*! \enum frame_type
+    \brief The first byte of each frame sent back to a client, it is followed by the 4 byte (big endian) length
+    of the payload and the payload.
+*/
+enum frame_type
+{
+    FRAME_STDOUT = 'o', /**< what was written to stdout, a line can have more than one */
+    FRAME_STDERR = 'e', /**< what was written to stderr, a line can have more than one */
+    FRAME_EXIT = 'x',   /**< the exit code of the line (4 bytes, big endian), always the last frame of a line */
+};
+
+/*! \struct server_connection
+    \brief A client connected to the server, the shell process that serves it has stdout and stderr
+    captured in files that are sent back after each line.
+*/
+struct server_connection
+{
+    int fd;         /**< the connected socket, the command lines are read from it */
+    char *buffer;   /**< what is read from the captured output before it is sent */
+    size_t capacity; /**< the size of the buffer */
+};
+
+/**
+ * Create a Unix domain socket listening on a path. A socket that is already at the path (eg. from a server that
+ * was killed) is removed first, anything else at the path is an error.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param path the path of the socket.
+ * @return the listening socket, or -1 on error.
+ */
+int server_listen(const struct dc_posix_env *env, struct dc_error *err, const char *path);
+
+/**
+ * Wait for the next client. The connection processes that have finished are reaped first.
+ * The socket is close on exec so the programs that are run do not hold the client open.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param listen_fd the socket from server_listen.
+ * @return the connected socket, or -1 on error.
+ */
+int server_accept(const struct dc_posix_env *env, struct dc_error *err, int listen_fd);
+
+/**
+ * Set up the process that serves a client: stdin is /dev/null and stdout and stderr are captured in files,
+ * the builtins and every program started write to them the same as they do to a terminal.
+ * Only call this in the process that was forked for the client.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param fd the connected socket, closed by server_connection_destroy.
+ * @return the connection, or NULL on error.
+ */
+struct server_connection *server_connection_create(const struct dc_posix_env *env, struct dc_error *err, int fd);
+
+/**
+ * Send the result of a line to the client: what was written to stdout and stderr since the last line
+ * (FRAME_STDOUT and FRAME_STDERR frames) then the exit code (FRAME_EXIT). The captured output is emptied.
+ * Anything a background job writes is sent with the line that is running when it is written.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param connection the connection.
+ * @param exit_code the exit code of the line.
+ */
+void server_connection_reply(const struct dc_posix_env *env, struct dc_error *err,
+                             struct server_connection *connection, int exit_code);
+
+/**
+ * Close the connection and free it.
+ *
+ * @param env the posix environment.
+ * @param pconnection the connection to free, set to NULL.
+ */
+void server_connection_destroy(const struct dc_posix_env *env, struct server_connection **pconnection);
+
+#endif // DC_SHELL_SERVER_H
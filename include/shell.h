@@ -18,8 +18,11 @@
  *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include "command.h"
+#include "launcher.h"
 #include <dc_fsm/fsm.h>
 #include <dc_posix/dc_posix_env.h>
+#include <stdbool.h>
 #include <stdio.h>
 
 /*! \enum state
@@ -41,6 +44,18 @@ enum shell_states
   DESTROY_STATE,                  /**< destroy the state */             // 10
 };
 
+/*! \struct shell_options
+    \brief The settings from the command line or config file.
+*/
+struct shell_options
+{
+    enum launcher launcher;   /**< how programs are started */
+    bool verbose;             /**< display the time of each FSM state when the shell exits */
+    const char *history_file; /**< the file the history is saved in, NULL to only keep it in memory */
+    FILE *usage_log;          /**< where the resources each command used are logged (see usage_log), NULL for none */
+    struct command_limits limits; /**< the limits on every program that is started, 0 for none */
+};
+
 /**
  * Run the shell FSM.
  *
@@ -49,9 +64,44 @@ enum shell_states
  * @param in the keyboard (stdin) file
  * @param out the keyboard (stdout) file
  * @param err the keyboard (stderr) file
+ * @param options the settings to run with, or NULL for the defaults
+ *
+ * @return the exit code of the last pipeline that ran, or the argument of exit.
+ */
+int run_shell(const struct dc_posix_env *env, struct dc_error *error, FILE *in, FILE *out, FILE *err,
+              const struct shell_options *options);
+
+/**
+ * Run the shell FSM in batch mode: no prompt, no exit codes, the input is read in large blocks.
+ *
+ * @param env the posix environment.
+ * @param error the error object
+ * @param in_fd the file descriptor to read the commands from (eg. a script file), ignored if commands is set
+ * @param commands the commands to run (eg. from -C), or NULL to read in_fd
+ * @param out the keyboard (stdout) file
+ * @param err the keyboard (stderr) file
+ * @param options the settings to run with, or NULL for the defaults
+ *
+ * @return the exit code of the last pipeline that ran, or the argument of exit.
+ */
+int run_shell_batch(const struct dc_posix_env *env, struct dc_error *error, int in_fd, const char *commands,
+                    FILE *out, FILE *err, const struct shell_options *options);
+
+/**
+ * Run the shell as a server on a Unix domain socket (see server_listen). The state is set up once (see init_state)
+ * and each client is served by a forked copy of it that runs the FSM in batch mode on the socket.
+ * After each line the client is sent what the line wrote to stdout and stderr and its exit code
+ * (see server_connection_reply). Only returns if the socket cannot be listened on or accept fails.
+ *
+ * @param env the posix environment.
+ * @param error the error object
+ * @param path the path of the socket.
+ * @param err where the errors of the server itself are displayed.
+ * @param options the settings to run with, or NULL for the defaults
  *
- * @return the exit code from the shell.
+ * @return the exit code from the server.
  */
-int run_shell(const struct dc_posix_env *env, struct dc_error *error, FILE *in, FILE *out, FILE *err);
+int run_shell_server(const struct dc_posix_env *env, struct dc_error *error, const char *path, FILE *err,
+                     const struct shell_options *options);
 
 #endif // DC_SHELL_SHELL_H
@@ -21,11 +21,10 @@
 #include "execute.h"
 #include "shell.h"
 
+struct job;
+
 /**
  * Set up the initial state:
- *  - in_redirect_regex  "[ \t\f\v]<.*"
- *  - out_redirect_regex "[ \t\f\v][1^2]?>[>]?.*"
- *  - err_redirect_regex "[ \t\f\v]2>[>]?.*"
  *  - path the PATH environ var separated into directories
  *  - prompt the PS1 environ var or "$" if PS1 not set
  *  - max_line_length the value of _SC_ARG_MAX (see sysconf)
@@ -37,6 +36,29 @@
  */
 int init_state(const struct dc_posix_env *env, struct dc_error *err, void *arg);
 
+/**
+ * Set up the initial state for batch mode (see init_state).
+ * The commands are read in blocks from state->input_string if it is set, otherwise from state->input_fd.
+ * No prompt or exit codes are printed.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param arg the current struct state
+ * @return READ_COMMANDS or INIT_ERROR
+ */
+int init_batch_state(const struct dc_posix_env *env, struct dc_error *err, void *arg);
+
+/**
+ * Switch a state that init_state set up to batch mode, the lines are read from state->input_string if it is set,
+ * otherwise from state->input_fd. Each connection of the server starts here (see run_shell_server).
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param arg the current struct state
+ * @return READ_COMMANDS or ERROR
+ */
+int init_batch_input(const struct dc_posix_env *env, struct dc_error *err, void *arg);
+
 /**
  * Free any dynamically allocated memory in the state and sets variables to NULL, 0 or false.
  *
@@ -61,30 +83,35 @@ int reset_state(const struct dc_posix_env *env, struct dc_error *err,
 
 /**
  * Prompt the user and read the command line (see read_command_line).
+ * The background jobs that have finished are reaped first (see job_table_reap) and reported in interactive mode.
+ * The prompt is only displayed when state->interactive is true, it is only rebuilt when PS1 or the directory change.
  * Sets the state->current_line and current_line_length.
  *
  * @param env the posix environment.
  * @param err the error object
  * @param arg the current struct state
- * @return SEPARATE_COMMANDS
+ * @return SEPARATE_COMMANDS, RESET_STATE (empty line), EXIT (end of input) or ERROR
  */
 int read_commands(const struct dc_posix_env *env, struct dc_error *err,
                   void *arg);
 
 /**
- * Separate the commands. In the current implementation there is only one command.
- * Sets the state->command.
+ * Separate the line in to commands at each '|', ';', "&&", "||" and '&' token (see next_token).
+ * Sets the state->command array and state->command_count, the connector of each command is the token after it.
+ * The line can end with ';' or '&' but not with the others.
+ * A syntax error (e.g. "ls |", "ls >", "&& ls" or an unclosed quote) is reported and the line is skipped.
  *
  * @param env the posix environment.
  * @param err the error object
  * @param arg the current struct state
- * @return PARSE_COMMANDS or SEPARATE_ERROR
+ * @return PARSE_COMMANDS, RESET_STATE or SEPARATE_ERROR
  */
 int separate_commands(const struct dc_posix_env *env, struct dc_error *err,
                       void *arg);
 
 /**
- * Parse the commands (see parse_command)
+ * Parse the commands of the first pipeline on the line (see parse_command).
+ * The pipelines after it are parsed by execute_commands just before they run.
  *
  * @param env the posix environment.
  * @param err the error object
@@ -96,17 +123,36 @@ int parse_commands(const struct dc_posix_env *env, struct dc_error *err,
 
 
 /**
- * Run the command (see execute).
- * If the command->command is cd run builtin_cd
+ * Run the commands of the line in order (see connector), one and-or list at a time.
+ * The pipelines of a list are run in turn, "&&" and "||" short-circuiting on the exit codes,
+ * a list that ends with '&' is started as a job instead (see start_job).
+ * The exit code (of the last pipeline that ran) is only displayed when state->interactive is true.
  *
  * @param env the posix environment.
  * @param err the error object
  * @param arg the current struct state
- * @return EXIT (if command->command is exit), RESET_STATE or EXECUTE_ERROR
+ * @return EXIT (if a command is exit), RESET_STATE or EXECUTE_ERROR
  */
 int execute_commands(const struct dc_posix_env *env, struct dc_error *err,
                      void *arg);
 
+/**
+ * Start the and-or list of the commands first to last as a background job and add it to state->jobs.
+ * A single pipeline is started the same as execute_pipeline would, every command is a program.
+ * A list of pipelines ("a && b"), a pipeline that starts with time or timeout and a builtin on its own ("cd /tmp",
+ * "exit 3") are run by a copy of the shell in a child process, the same as execute_commands runs them.
+ * Either way the job's stdin is /dev/null unless it is redirected, the job is not displayed.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param states the state with the commands and the job table.
+ * @param first the first command of the job.
+ * @param last the last command of the job.
+ * @return the job, or NULL on error.
+ */
+struct job *start_job(const struct dc_posix_env *env, struct dc_error *err, struct state *states, size_t first,
+                      size_t last);
+
 
 /**
  * Handle the exit command (see do_reset_state)
@@ -18,12 +18,21 @@
  *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
  */
 
-#include <regex.h>
+#include "launcher.h"
 #include <stdbool.h>
 #include <stdio.h>
 #include <dc_posix/dc_posix_env.h>
 
+struct arena;
 struct command;
+struct command_cache;
+struct command_hash;
+struct fsm_stats;
+struct history;
+struct job_table;
+struct line_reader;
+struct server_connection;
+struct shell_options;
 
 /*! \struct state
     \brief The current FSM state.
@@ -35,15 +44,32 @@ struct state
   FILE *stdin;                  /** stream to read commands from */
   FILE *stdout;                 /** stream to print the prompt to */
   FILE *stderr;                 /** stream to print error messages to */
-  regex_t *in_redirect_regex;   /**< stdin regex */
-  regex_t *out_redirect_regex;  /**< stdout regex */
-  regex_t *err_redirect_regex;  /**< stderr regex */
+  int input_fd;                 /**< file descriptor to read a script from (batch mode, -1 if none) */
+  const char *input_string;     /**< commands given on the command line (batch mode, NULL if none) */
+  const struct shell_options *options; /**< the settings from the command line/config (NULL for the defaults) */
+  bool interactive;             /**< print the prompt and exit codes (false = batch mode) */
+  enum launcher launcher;       /**< how programs are started */
   char **path;                  /**< PATH environ var broken up */
+  struct command_hash *command_hash; /**< where programs were found on the path (see the hash builtin) */
+  struct command_cache *command_cache; /**< the parsed commands of recent lines (see separate_commands) */
+  bool line_cacheable;          /**< can the commands of current_line be cached (see command_cache_can_cache) */
   char *prompt;                 /**< Prompt to display before a command is entered */
+  char *working_dir;            /**< the current working directory, NULL until it is needed or after cd changes it */
+  char *prompt_line;            /**< "[working_dir] prompt" as it is written, NULL when it has to be rebuilt */
+  size_t prompt_line_length;    /**< the length of prompt_line */
   size_t max_line_length;       /**< the largest possible line */
-  char *current_line;           /**< the line the user most recently entered */
+  struct line_reader *reader;   /**< the reusable buffer that lines are read into */
+  const char *current_line;     /**< the line the user most recently entered, a view into reader (not always '\0' terminated) */
   size_t current_line_length;   /**< the length of the most recently line */
-  struct command *command;      /**< the commands to execute - currently only one */
+  struct arena *arena;          /**< the memory of the current line's commands, reset after each line */
+  struct command *command;      /**< the commands of the line to execute, command_count of them (see connector) */
+  size_t command_count;         /**< the number of commands on the line */
+  struct job_table *jobs;       /**< the pipelines running in the background (see the jobs builtin) */
+  struct history *history;      /**< the lines that were read (see the history builtin), NULL until the first line */
+  int exit_code;                /**< the exit code of the line (the last pipeline that ran) */
+  int last_exit_code;           /**< the exit code of the last pipeline on any line (or of exit), the shell exits with it */
+  struct server_connection *connection; /**< the client the lines are read from (see run_shell_server), NULL if none */
+  struct fsm_stats *stats;      /**< how long each FSM state takes (see the stats builtin), NULL if not kept */
   bool fatal_error;             /**< should the error terminate the shell (true = terminate) */
 };
 
@@ -0,0 +1,126 @@
+#ifndef DC_SHELL_STATS_H
+#define DC_SHELL_STATS_H
+
+/*
+ * This file is part of dc_shell.
+ *
+ *  dc_shell is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "shell.h"
+#include <dc_posix/dc_posix_env.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define HISTOGRAM_SUB_BITS 5                                      /**< 32 sub-buckets per power of two, under 3.2% error */
+#define HISTOGRAM_SUB_COUNT (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_MAX_BITS 40                                     /**< values are clamped to 2^40 ns, about 18 minutes */
+#define HISTOGRAM_BUCKETS ((HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BITS + 2) * (HISTOGRAM_SUB_COUNT / 2))
+#define FSM_STATS_STATES (DESTROY_STATE + 1)
+
+/*! \struct histogram
+    \brief An HDR style histogram of times in nanoseconds.
+
+    The buckets are linear below HISTOGRAM_SUB_COUNT and then split each power of two into HISTOGRAM_SUB_COUNT / 2
+    buckets, so the error is the same relative amount whatever the size of the value.
+*/
+struct histogram
+{
+    uint64_t count;                       /**< the number of values recorded */
+    uint64_t total;                       /**< the sum of the values */
+    uint64_t min;                         /**< the smallest value */
+    uint64_t max;                         /**< the largest value */
+    uint32_t buckets[HISTOGRAM_BUCKETS];  /**< the number of values in each bucket */
+};
+
+/*! \struct fsm_stats
+    \brief The time spent in each FSM state, and in each transition.
+
+    A state is timed from the start to the end of the function that runs when the FSM moves into it.
+*/
+struct fsm_stats
+{
+    const struct dc_fsm_transition *functions;                       /**< the transitions being timed */
+    int from;                                                        /**< the state the FSM came from */
+    int to;                                                          /**< the state the FSM is moving into */
+    struct histogram states[FSM_STATS_STATES];                      /**< the time of each state */
+    struct histogram *transitions[FSM_STATS_STATES][FSM_STATS_STATES]; /**< the time of each from/to pair, NULL until it happens */
+};
+
+/**
+ * Add a value to a histogram.
+ *
+ * @param histogram the histogram.
+ * @param value the value (eg. a time in nanoseconds).
+ */
+void histogram_record(struct histogram *histogram, uint64_t value);
+
+/**
+ * Get the value that a percentage of the recorded values are at or below.
+ * The value is the highest one in its bucket, the same as HdrHistogram reports.
+ *
+ * @param histogram the histogram.
+ * @param percentile the percentage, 0 to 100.
+ * @return the value, or 0 if the histogram is empty.
+ */
+uint64_t histogram_percentile(const struct histogram *histogram, double percentile);
+
+/**
+ * Create the stats with every histogram empty.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @return the stats, or NULL on error.
+ */
+struct fsm_stats *fsm_stats_create(const struct dc_posix_env *env, struct dc_error *err);
+
+/**
+ * Free the stats.
+ *
+ * @param env the posix environment.
+ * @param pstats the stats to free, set to NULL.
+ */
+void fsm_stats_destroy(const struct dc_posix_env *env, struct fsm_stats **pstats);
+
+/**
+ * Record the time of the function of a transition.
+ * A transition is only counted if its histogram can be allocated, the state always is.
+ *
+ * @param env the posix environment.
+ * @param stats the stats.
+ * @param from the state the FSM came from.
+ * @param to the state the FSM moved into.
+ * @param nanoseconds how long the function took.
+ */
+void fsm_stats_record(const struct dc_posix_env *env, struct fsm_stats *stats, int from, int to,
+                      uint64_t nanoseconds);
+
+/**
+ * Display the count, p50, p99 and max of each state and transition that has happened, in microseconds.
+ *
+ * @param stats the stats.
+ * @param stream the stream to display the stats on.
+ */
+void fsm_stats_print(const struct fsm_stats *stats, FILE *stream);
+
+/**
+ * Get the current time of the monotonic clock.
+ *
+ * @return the time in nanoseconds.
+ */
+uint64_t stats_now(void);
+
+#endif // DC_SHELL_STATS_H
@@ -0,0 +1,76 @@
+#ifndef DC_SHELL_USAGE_H
+#define DC_SHELL_USAGE_H
+
+/*
+ * This file is part of dc_shell.
+ *
+ *  dc_shell is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Foobar is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "command.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/resource.h>
+
+/**
+ * Set the usage of a command that was waited for.
+ *
+ * @param usage the usage to set.
+ * @param rusage the resources from wait4.
+ * @param wall the ns from when the command was started until it was waited for.
+ */
+void usage_set(struct command_usage *usage, const struct rusage *rusage, uint64_t wall);
+
+/**
+ * Set the usage of a command that ran in the shell process (a builtin), from getrusage(RUSAGE_SELF) before and
+ * after it. The max_rss is the shell's, it only ever goes up.
+ *
+ * @param usage the usage to set.
+ * @param before the resources of the shell before the command.
+ * @param after the resources of the shell after the command.
+ * @param wall the ns the command took.
+ */
+void usage_set_difference(struct command_usage *usage, const struct rusage *before, const struct rusage *after,
+                          uint64_t wall);
+
+/**
+ * Add the usage of a command to a total (e.g. for a pipeline): the times and switches are added, the max_rss is
+ * the largest. The wall time is not added, the commands run at the same time.
+ *
+ * @param total the total.
+ * @param usage the usage to add.
+ */
+void usage_add(struct command_usage *total, const struct command_usage *usage);
+
+/**
+ * Display a usage for the time prefix:
+ * real 0.105s  user 0.002s  sys 0.003s  maxrss 3840KiB  vcsw 2  ivcsw 0
+ *
+ * @param usage the usage.
+ * @param stream the stream to display it on.
+ */
+void usage_print(const struct command_usage *usage, FILE *stream);
+
+/**
+ * Append a line for a command to the usage log, tab separated:
+ * exit code, real, user and sys seconds, max RSS KiB, voluntary and involuntary switches, the command.
+ *
+ * @param command the command that was waited for.
+ * @param stream the log.
+ */
+void usage_log(const struct command *command, FILE *stream);
+
+#endif // DC_SHELL_USAGE_H
@@ -21,6 +21,8 @@
 #include "shell.h"
 #include "state.h"
 #include <dc_posix/dc_posix_env.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 
 /**
@@ -41,6 +43,15 @@ char *get_prompt(const struct dc_posix_env *env, struct dc_error *err);
  */
 char *get_path(const struct dc_posix_env *env, struct dc_error *err);
 
+/**
+ * Get the file to save the history in: HISTFILE, or ~/.dc_shell_history if it is not set.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @return the file name, or NULL if HISTFILE is empty (or neither it nor HOME are set).
+ */
+char *get_history_file(const struct dc_posix_env *env, struct dc_error *err);
+
 /**
  * Separate a path (eg. PATH environ var) into separate directories.
  * Directories are separated with a ':' character.
@@ -56,12 +67,73 @@ char **parse_path(const struct dc_posix_env *env, struct dc_error *err,
 
 /**
  * Reset the state for the next read, freeing any dynamically allocated memory.
+ * The commands are in state->arena, which is reset in one go.
  *
  * @param env the posix environment.
  * @param err the error object
  */
 void do_reset_state(const struct dc_posix_env *env, struct dc_error *err, struct state *state);
 
+/**
+ * Free the directories of a path (see parse_path) and the array they are in.
+ *
+ * @param env the posix environment.
+ * @param ppath the path to free, set to NULL.
+ */
+void free_path(const struct dc_posix_env *env, char ***ppath);
+
+/**
+ * Forget the working directory and the prompt built from it, they are rebuilt when they are next needed.
+ *
+ * @param env the posix environment.
+ * @param state the state with the working directory and prompt.
+ */
+void clear_working_dir(const struct dc_posix_env *env, struct state *state);
+
+/**
+ * Get the directories of the PATH environment variable, they are separated the first time a program is looked
+ * for (a shell that only runs builtins never does) and again after PATH changes.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param state the state with the path.
+ * @return state->path, or NULL on error.
+ */
+char **get_state_path(const struct dc_posix_env *env, struct dc_error *err, struct state *state);
+
+/**
+ * Get the table of background jobs, it is created the first time a job is started or looked at
+ * (blocking SIGCHLD and opening the signalfd is left until then).
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param state the state with the job table.
+ * @return state->jobs, or NULL on error.
+ */
+struct job_table *get_job_table(const struct dc_posix_env *env, struct dc_error *err, struct state *state);
+
+/**
+ * Get the history, it is created the first time a line is read and keeps the last HISTSIZE lines
+ * (HISTORY_SIZE if it is not set). The last lines of state->options->history_file are loaded in to it,
+ * if the file cannot be opened the history is only kept in memory.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param state the state with the history.
+ * @return state->history, or NULL on error.
+ */
+struct history *get_history(const struct dc_posix_env *env, struct dc_error *err, struct state *state);
+
+/**
+ * Parse a duration the same as timeout(1): a number of seconds, which can have a fraction,
+ * and an optional s, m, h or d suffix.
+ *
+ * @param text the duration.
+ * @param ns set to the duration in nanoseconds.
+ * @return true if text is a duration, false if it is not (ns is not changed).
+ */
+bool parse_duration(const char *text, uint64_t *ns);
+
 /**
  * Display the state values to the given stream.
  *
@@ -0,0 +1,248 @@
+#include "../include/arena.h"
+#include <dc_posix/dc_stdlib.h>
+#include <dc_posix/dc_string.h>
+#include <stdint.h>
+
+//every allocation starts on a boundary that any type can be stored at
+#define ARENA_ALIGNMENT _Alignof(max_align_t)
+#define ALIGN_UP(size) (((size) + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1))
+#define HEADER_SIZE ALIGN_UP(sizeof(struct arena_block))
+
+/**
+ * Allocate a block and put it at the front of the arena.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param arena the arena.
+ * @param size the smallest number of bytes the block has to hold.
+ * @return the block, or NULL if it could not be allocated.
+ */
+static struct arena_block *add_block(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena,
+                                     size_t size);
+
+/**
+ * The start of the memory of a block.
+ *
+ * @param block the block.
+ * @return the first byte after the header.
+ */
+static char *block_data(struct arena_block *block);
+
+struct arena *arena_create(const struct dc_posix_env *env, struct dc_error *err, size_t block_size)
+{
+    struct arena *arena;
+
+    arena = dc_malloc(env, err, sizeof(struct arena));
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    arena->blocks = NULL;
+    arena->block_size = ALIGN_UP(block_size);
+
+    if (add_block(env, err, arena, arena->block_size) == NULL)
+    {
+        dc_free(env, arena, sizeof(struct arena));
+        return NULL;
+    }
+
+    return arena;
+}
+
+void arena_destroy(const struct dc_posix_env *env, struct arena **parena)
+{
+    struct arena *arena;
+    struct arena_block *block;
+
+    arena = *parena;
+    if (arena == NULL)
+    {
+        return;
+    }
+
+    block = arena->blocks;
+    while (block != NULL)
+    {
+        struct arena_block *next;
+
+        next = block->next;
+        dc_free(env, block, HEADER_SIZE + block->size);
+        block = next;
+    }
+
+    dc_free(env, arena, sizeof(struct arena));
+    *parena = NULL;
+}
+
+void arena_reset(const struct dc_posix_env *env, struct arena *arena)
+{
+    struct arena_block *largest;
+    struct arena_block *block;
+
+    largest = arena->blocks;
+    for (block = arena->blocks; block != NULL; block = block->next)
+    {
+        if (block->size > largest->size)
+        {
+            largest = block;
+        }
+    }
+
+    block = arena->blocks;
+    while (block != NULL)
+    {
+        struct arena_block *next;
+
+        next = block->next;
+        if (block != largest)
+        {
+            dc_free(env, block, HEADER_SIZE + block->size);
+        }
+        block = next;
+    }
+
+    arena->blocks = largest;
+    if (largest != NULL)
+    {
+        largest->next = NULL;
+        largest->used = 0;
+    }
+}
+
+void *arena_alloc(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena, size_t size)
+{
+    struct arena_block *block;
+    void *ptr;
+
+    if (arena == NULL)
+    {
+        return dc_malloc(env, err, size);
+    }
+
+    size = ALIGN_UP(size == 0 ? 1 : size);
+    block = arena->blocks;
+
+    if (block == NULL || block->size - block->used < size)
+    {
+        block = add_block(env, err, arena, size);
+        if (block == NULL)
+        {
+            return NULL;
+        }
+    }
+
+    ptr = &block_data(block)[block->used];
+    block->used += size;
+
+    return ptr;
+}
+
+void *arena_calloc(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena, size_t count,
+                   size_t size)
+{
+    void *ptr;
+
+    if (size != 0 && count > SIZE_MAX / size)
+    {
+        DC_ERROR_RAISE_ERRNO(err, ENOMEM);
+        return NULL;
+    }
+
+    ptr = arena_alloc(env, err, arena, count * size);
+    if (ptr != NULL)
+    {
+        dc_memset(env, ptr, 0, count * size);
+    }
+
+    return ptr;
+}
+
+void *arena_realloc(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena, void *ptr,
+                    size_t old_size, size_t new_size)
+{
+    struct arena_block *block;
+    void *grown;
+
+    if (arena == NULL)
+    {
+        return dc_realloc(env, err, ptr, new_size);
+    }
+
+    block = arena->blocks;
+
+    if (ptr != NULL && block != NULL && (char *)ptr >= block_data(block) &&
+        (char *)ptr < &block_data(block)[block->used])
+    {
+        size_t offset;
+
+        offset = (size_t)((char *)ptr - block_data(block));
+
+        //the last allocation of the current block can simply take more of the block
+        if (offset + ALIGN_UP(old_size) == block->used && offset + new_size <= block->size)
+        {
+            block->used = offset + ALIGN_UP(new_size);
+            return ptr;
+        }
+    }
+
+    grown = arena_alloc(env, err, arena, new_size);
+    if (grown != NULL && ptr != NULL)
+    {
+        dc_memcpy(env, grown, ptr, old_size < new_size ? old_size : new_size);
+    }
+
+    return grown;
+}
+
+char *arena_strndup(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena, const char *str,
+                    size_t length)
+{
+    char *copy;
+
+    copy = arena_alloc(env, err, arena, length + 1);
+    if (copy != NULL)
+    {
+        dc_memcpy(env, copy, str, length);
+        copy[length] = '\0';
+    }
+
+    return copy;
+}
+
+static struct arena_block *add_block(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena,
+                                     size_t size)
+{
+    struct arena_block *block;
+    size_t block_size;
+
+    //double each time so a long line needs few blocks, and the block kept by arena_reset fits it next time
+    block_size = arena->blocks == NULL ? arena->block_size : arena->blocks->size * 2;
+    if (block_size < arena->block_size)
+    {
+        block_size = arena->block_size;
+    }
+
+    while (block_size < size)
+    {
+        block_size *= 2;
+    }
+
+    block = dc_malloc(env, err, HEADER_SIZE + block_size);
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    block->size = block_size;
+    block->used = 0;
+    block->next = arena->blocks;
+    arena->blocks = block;
+
+    return block;
+}
+
+static char *block_data(struct arena_block *block)
+{
+    return (char *)block + HEADER_SIZE;
+}
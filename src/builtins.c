@@ -1,14 +1,45 @@
 #include "../include/builtins.h"
+#include "../include/expand.h"
+#include "../include/parallel.h"
+#include "../include/shell.h"
+#include "../include/util.h"
+#include <ctype.h>
+#include <inttypes.h>
+#include <limits.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <dc_posix/dc_string.h>
-#include <dc_posix/dc_wordexp.h>
+#include <dc_posix/dc_stdio.h>
 #include <dc_posix/dc_stdlib.h>
 #include <dc_posix/dc_unistd.h>
+#include <dc_util/filesystem.h>
 
 
 #define COMMAND_ERROR_EXIT_CODE 1
 #define COMMAND_SUCCESS_EXIT_CODE 0
+#define COMMAND_USAGE_EXIT_CODE 2
+#define COMMAND_NOT_FOUND_EXIT_CODE 127
 #define ERR_BUF_LEN 1024
+#define NUMBER_BUF_LEN 32
+
+extern char **environ;
+
+/*! \struct printf_conversion
+    \brief The flags, width and precision of a printf conversion (e.g. %-08.3d).
+*/
+struct printf_conversion
+{
+    bool left;          /**< - pad on the right */
+    bool plus;          /**< + always display the sign */
+    bool space;         /**< ' ' display a space instead of a + */
+    bool alternate;     /**< # 0 before octal, 0x before hex */
+    bool zero;          /**< 0 pad numbers with zeros */
+    size_t width;       /**< the smallest number of characters to display */
+    bool has_precision; /**< was a precision given */
+    size_t precision;   /**< the smallest number of digits, or the most characters of a string */
+};
 
 /**
  * Outputs the error message to stream.
@@ -20,6 +51,408 @@
  */
 static void stream_error(const struct dc_posix_env *env, char* dir, int errNum, FILE *stream);
 
+/**
+ * Find the job for a job spec: %N, %+, %% or % for the current job, or a number.
+ *
+ * @param jobs the job table.
+ * @param spec the job spec.
+ * @param by_pid true if a number is a process id (wait), false if it is a job number (fg).
+ * @return the job, or NULL if there is no such job.
+ */
+static struct job *find_job(const struct job_table *jobs, const char *spec, bool by_pid);
+
+/**
+ * The FSM state to go to after a builtin.
+ *
+ * @param err the error object
+ * @return ERROR if there is an error, otherwise RESET_STATE.
+ */
+static int next_state(const struct dc_error *err);
+
+/**
+ * Open a file that a builtin's output is redirected to, the error is reported if it cannot be opened.
+ *
+ * @param env the posix environment
+ * @param err the error object, reset after the error is reported.
+ * @param file_name the file to open.
+ * @param overwrite true to truncate the file, false to append to it.
+ * @param errstream the stream to print error messages to
+ * @return the stream, or NULL if the file could not be opened.
+ */
+static FILE *open_redirect(const struct dc_posix_env *env, struct dc_error *err, char *file_name, bool overwrite,
+                           FILE *errstream);
+
+/**
+ * Does a command set or unset PATH (e.g. export PATH=/bin).
+ *
+ * @param env the posix environment
+ * @param command the export or unset command.
+ * @return true if one of the arguments is PATH.
+ */
+static bool changes_path(const struct dc_posix_env *env, const struct command *command);
+
+/**
+ * Forget state->path and empty the command hash, the programs that were found on the old path may not be the ones
+ * on the new one.
+ *
+ * @param env the posix environment
+ * @param states the state with the path and command hash.
+ */
+static void path_changed(const struct dc_posix_env *env, struct state *states);
+
+/**
+ * Is the text a valid variable name: a letter or _ followed by letters, digits and _.
+ *
+ * @param text the name.
+ * @param length the length of the name.
+ * @return true if it is valid.
+ */
+static bool valid_name(const char *text, size_t length);
+
+/**
+ * Display a variable as export NAME='value', the value quoted so that it can be read back by the shell.
+ *
+ * @param variable the NAME=value variable.
+ * @param stream the stream to display it on.
+ */
+static void print_export(const char *variable, FILE *stream);
+
+/**
+ * Display an escape sequence of printf (\n, \t, \NNN...).
+ *
+ * @param text the escape, starting at the '\'.
+ * @param stream the stream to display it on.
+ * @param stop set to true for \c, the rest of the output is left out.
+ * @return the number of characters of the escape.
+ */
+static size_t printf_escape(const char *text, FILE *stream, bool *stop);
+
+/**
+ * Display a format of printf once, taking the arguments for its conversions from command->argv.
+ *
+ * @param env the posix environment
+ * @param command the printf command.
+ * @param next the next argument to take, updated as they are taken.
+ * @param outstream the stream to display the output on
+ * @param errstream the stream to print error messages to
+ * @param failed set to true if an argument or conversion was not valid.
+ * @return false if the output has to stop (\c or an invalid conversion).
+ */
+static bool printf_format(const struct dc_posix_env *env, const struct command *command, size_t *next,
+                          FILE *outstream, FILE *errstream, bool *failed);
+
+/**
+ * Convert a printf argument to a number, 'c and "c are the character code of c.
+ *
+ * @param text the argument, NULL if there are no arguments left (0).
+ * @param errstream the stream to print error messages to
+ * @param failed set to true if the argument is not a number.
+ * @return the number.
+ */
+static intmax_t printf_argument(const char *text, FILE *errstream, bool *failed);
+
+/**
+ * Display a number for a %d %i %o %u %x or %X conversion.
+ *
+ * @param stream the stream to display it on.
+ * @param type the conversion character.
+ * @param value the number.
+ * @param conversion the flags, width and precision.
+ */
+static void printf_number(FILE *stream, char type, intmax_t value, const struct printf_conversion *conversion);
+
+/**
+ * Display text padded with spaces to the width of the conversion.
+ *
+ * @param stream the stream to display it on.
+ * @param text the text.
+ * @param length the length of the text.
+ * @param conversion the flags and width.
+ */
+static void printf_padded(FILE *stream, const char *text, size_t length, const struct printf_conversion *conversion);
+
+/**
+ * Display a character a number of times.
+ *
+ * @param stream the stream to display it on.
+ * @param c the character.
+ * @param count the number of times.
+ */
+static void print_repeated(FILE *stream, char c, size_t count);
+
+/**
+ * Can builtin_echo run the command: any option but a single -n (-e, -E, -nE...) is left to the echo program.
+ *
+ * @param env the posix environment
+ * @param command the echo command.
+ * @return true if the builtin can run it.
+ */
+static bool echo_handles(const struct dc_posix_env *env, const struct command *command);
+
+/**
+ * Can builtin_printf run the command: every conversion of the format is one it has (%f, %e, %ld... are not) and
+ * there are no \x \u \U \e or \" escapes.
+ *
+ * @param env the posix environment
+ * @param command the printf command.
+ * @return true if the builtin can run it.
+ */
+static bool printf_handles(const struct dc_posix_env *env, const struct command *command);
+
+/**
+ * Can builtin_test run the command: the expression only has the operators it knows (not -a, -o, -nt...) and no more
+ * than 4 arguments.
+ *
+ * @param env the posix environment
+ * @param command the test or [ command.
+ * @return true if the builtin can run it.
+ */
+static bool test_handles(const struct dc_posix_env *env, const struct command *command);
+
+/**
+ * Is a test expression one that test_expression can evaluate (or report as not valid the same as the program would).
+ *
+ * @param env the posix environment
+ * @param args the arguments of the expression.
+ * @param count the number of arguments.
+ * @return true if test_expression knows every operator in it.
+ */
+static bool test_supported(const struct dc_posix_env *env, char **args, size_t count);
+
+/**
+ * Evaluate a test expression, the meaning of the arguments depends on how many there are (the same as POSIX test).
+ *
+ * @param env the posix environment
+ * @param args the arguments of the expression.
+ * @param count the number of arguments.
+ * @param errstream the stream to print error messages to
+ * @return 0 if the expression is true, 1 if it is false or 2 if it is not valid.
+ */
+static int test_expression(const struct dc_posix_env *env, char **args, size_t count, FILE *errstream);
+
+/**
+ * Is the argument a unary test operator (-e, -f, -z...).
+ *
+ * @param env the posix environment
+ * @param op the argument.
+ * @return true if it is a unary operator.
+ */
+static bool test_is_unary(const struct dc_posix_env *env, const char *op);
+
+/**
+ * Is the argument a binary test operator (=, !=, -eq...).
+ *
+ * @param env the posix environment
+ * @param op the argument.
+ * @return true if it is a binary operator.
+ */
+static bool test_is_binary(const struct dc_posix_env *env, const char *op);
+
+/**
+ * Evaluate a unary test operator.
+ *
+ * @param op the operator (see test_is_unary).
+ * @param operand the file, string or file descriptor.
+ * @param errstream the stream to print error messages to
+ * @return 0 if it is true, 1 if it is false or 2 if the operand is not valid.
+ */
+static int test_unary(const char *op, const char *operand, FILE *errstream);
+
+/**
+ * Evaluate a binary test operator.
+ *
+ * @param env the posix environment
+ * @param left the left operand.
+ * @param op the operator (see test_is_binary).
+ * @param right the right operand.
+ * @param errstream the stream to print error messages to
+ * @return 0 if it is true, 1 if it is false or 2 if an operand is not a valid integer.
+ */
+static int test_binary(const struct dc_posix_env *env, const char *left, const char *op, const char *right,
+                       FILE *errstream);
+
+/**
+ * Convert a test operand to an integer.
+ *
+ * @param text the operand.
+ * @param value set to the integer.
+ * @param errstream the stream to print error messages to
+ * @return true if the operand is an integer.
+ */
+static bool test_integer(const char *text, intmax_t *value, FILE *errstream);
+
+/**
+ * The functions of the builtins table. Each one runs its builtin with the state's streams, path, command hash and
+ * job table (the path and job table are created by the builtins that need them): cd also forgets the cached working
+ * directory when it changes (a directory that cannot be changed to has been reported, it is not an error of the
+ * shell), export and unset forget the path when PATH changes.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param states the state.
+ * @param command the command information
+ * @return RESET_STATE, EXIT (exit) or ERROR
+ */
+static int run_cd(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                  struct command *command);
+static int run_exit(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                    struct command *command);
+static int run_hash(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                    struct command *command);
+static int run_jobs(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                    struct command *command);
+static int run_wait(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                    struct command *command);
+static int run_fg(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                  struct command *command);
+static int run_parallel(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                        struct command *command);
+static int run_echo(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                    struct command *command);
+static int run_printf(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                      struct command *command);
+static int run_pwd(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                   struct command *command);
+static int run_stats(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                     struct command *command);
+static int run_history(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                       struct command *command);
+static int run_true(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                    struct command *command);
+static int run_false(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                     struct command *command);
+static int run_test(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                    struct command *command);
+static int run_export(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                      struct command *command);
+static int run_unset(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                     struct command *command);
+static int run_type(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                    struct command *command);
+
+/**
+ * The builtins, sorted by name (strcmp order) for builtin_find.
+ */
+static const struct builtin builtins[] = {
+    { "[",        run_test,     test_handles },
+    { "cd",       run_cd,       NULL },
+    { "echo",     run_echo,     echo_handles },
+    { "exit",     run_exit,     NULL },
+    { "export",   run_export,   NULL },
+    { "false",    run_false,    NULL },
+    { "fg",       run_fg,       NULL },
+    { "hash",     run_hash,     NULL },
+    { "history",  run_history,  NULL },
+    { "jobs",     run_jobs,     NULL },
+    { "parallel", run_parallel, NULL },
+    { "printf",   run_printf,   printf_handles },
+    { "pwd",      run_pwd,      NULL },
+    { "stats",    run_stats,    NULL },
+    { "test",     run_test,     test_handles },
+    { "true",     run_true,     NULL },
+    { "type",     run_type,     NULL },
+    { "unset",    run_unset,    NULL },
+    { "wait",     run_wait,     NULL },
+};
+
+const struct builtin *builtin_find(const struct dc_posix_env *env, const char *name)
+{
+    size_t low;
+    size_t high;
+
+    low = 0;
+    high = sizeof(builtins) / sizeof(builtins[0]);
+
+    while (low < high)
+    {
+        size_t middle;
+        int compare;
+
+        middle = low + (high - low) / 2;
+        compare = dc_strcmp(env, name, builtins[middle].name);
+        if (compare == 0)
+        {
+            return &builtins[middle];
+        }
+
+        if (compare < 0)
+        {
+            high = middle;
+        }
+        else
+        {
+            low = middle + 1;
+        }
+    }
+
+    return NULL;
+}
+
+bool builtin_handles(const struct dc_posix_env *env, const struct builtin *builtin, const struct command *command)
+{
+    return builtin->handles == NULL || builtin->handles(env, command);
+}
+
+int builtin_run(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                const struct builtin *builtin, struct command *command)
+{
+    FILE *shell_out;
+    FILE *shell_err;
+    FILE *outstream;
+    FILE *errstream;
+    int next;
+
+    shell_out = states->stdout;
+    shell_err = states->stderr;
+    outstream = shell_out;
+    errstream = shell_err;
+
+    //the redirections only last for the builtin, the same as they would for a program
+    if (command->stdout_file != NULL)
+    {
+        outstream = open_redirect(env, err, command->stdout_file, command->stdout_overwrite, shell_err);
+    }
+
+    if (command->stderr_file != NULL && outstream != NULL)
+    {
+        errstream = open_redirect(env, err, command->stderr_file, command->stderr_overwrite, shell_err);
+    }
+
+    if (outstream == NULL || errstream == NULL)
+    {
+        if (outstream != NULL && outstream != shell_out)
+        {
+            dc_fclose(env, err, outstream);
+        }
+
+        command->exit_code = COMMAND_ERROR_EXIT_CODE;
+        return next_state(err);
+    }
+
+    states->stdout = outstream;
+    states->stderr = errstream;
+    next = builtin->function(env, err, states, command);
+    states->stdout = shell_out;
+    states->stderr = shell_err;
+
+    //what the builtin wrote has to be out before a program writes to the same file
+    if (outstream != shell_out)
+    {
+        dc_fclose(env, err, outstream);
+    }
+    else
+    {
+        fflush(outstream);
+    }
+
+    if (errstream != shell_err)
+    {
+        dc_fclose(env, err, errstream);
+    }
+
+    return next == RESET_STATE ? next_state(err) : next;
+}
+
 /**
  * Change the working directory.
  * ~ is converted to the users home directory.
@@ -34,28 +467,24 @@ static void stream_error(const struct dc_posix_env *env, char* dir, int errNum,
 void builtin_cd(const struct dc_posix_env *env, struct dc_error *err,
                 struct command *command, FILE *errstream)
 {
-    char *temp;
     char *path;
-    wordexp_t wd_path;
 
     if(!command->argv[1])
     {
-        //set path to "~/"
-        temp = dc_strdup(env, err, "~/");
-        if(dc_error_has_error(err))
-        {
-            command->exit_code = COMMAND_ERROR_EXIT_CODE;
-        }
+        //no directory is the user's home directory
+        path = expand_string(env, err, "~", EXPAND_TILDE, NULL);
     }
     else
     {
-        temp = dc_strdup(env, err, command->argv[1]);
+        //argv was already expanded by parse_command, ~ has been replaced
+        path = dc_strdup(env, err, command->argv[1]);
     }
 
-    //expand the path to change ~ to the user's home directory
-    dc_wordexp(env, err, temp, &wd_path, 0);
-    path = dc_strdup(env, err, wd_path.we_wordv[0]);
-    dc_free(env, temp, dc_strlen(env, temp) + 1);
+    if(dc_error_has_error(err))
+    {
+        command->exit_code = COMMAND_ERROR_EXIT_CODE;
+        return;
+    }
 
     dc_chdir(env, err, path);
 
@@ -69,23 +498,1641 @@ void builtin_cd(const struct dc_posix_env *env, struct dc_error *err,
     {
         command->exit_code = COMMAND_SUCCESS_EXIT_CODE;
     }
+
+    dc_free(env, path, dc_strlen(env, path) + 1);
 }
 
-static void stream_error(const struct dc_posix_env *env, char* dir, int errNum, FILE *stream)
+/**
+ * Display or change the command hash.
+ * - no arguments displays the hashed commands.
+ * - -r removes all of the hashed commands.
+ * - names are looked up on the path and added to the hash.
+ * The command->exit_code is set to 0 on success or 1 if a name could not be found.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the command information
+ * @param hash the command hash
+ * @param path the directories to search for names
+ * @param outstream the stream to display the hash on
+ * @param errstream the stream to print error messages to
+ */
+void builtin_hash(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                  struct command_hash *hash, char **path, FILE *outstream, FILE *errstream)
 {
-    char message[ERR_BUF_LEN] = {0};
+    command->exit_code = COMMAND_SUCCESS_EXIT_CODE;
 
-    switch (errNum)
+    if (command->argc < 2)
     {
-        case ENOENT:
-            dc_strcpy(env, message, "does not exist");
-            break;
-        case ENOTDIR:
-            dc_strcpy(env, message, "is not a directory");
-            break;
-        default:
-            dc_strerror_r(env, errNum, message, ERR_BUF_LEN);
-            break;
+        command_hash_print(env, hash, outstream);
+        return;
     }
-    fprintf(stream, "%s: %s\n", dir, message);
+
+    for (size_t i = 1; i < command->argc; i++)
+    {
+        if (dc_strcmp(env, command->argv[i], "-r") == 0)
+        {
+            command_hash_clear(env, hash);
+        }
+        else if (dc_strchr(env, command->argv[i], '/') == NULL &&
+                 command_hash_lookup(env, err, hash, command->argv[i], path) == NULL)
+        {
+            if (dc_error_has_error(err))
+            {
+                command->exit_code = COMMAND_ERROR_EXIT_CODE;
+                return;
+            }
+
+            fprintf(errstream, "hash: %s: not found\n", command->argv[i]);
+            command->exit_code = COMMAND_ERROR_EXIT_CODE;
+        }
+    }
+}
+
+/**
+ * Display the background jobs, the ones that are done are removed.
+ * The command->exit_code is set to 0.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the command information
+ * @param jobs the job table
+ * @param outstream the stream to display the jobs on
+ */
+void builtin_jobs(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                  struct job_table *jobs, FILE *outstream)
+{
+    job_table_reap(env, err, jobs);
+    if (dc_error_has_error(err))
+    {
+        command->exit_code = COMMAND_ERROR_EXIT_CODE;
+        return;
+    }
+
+    job_table_print(env, jobs, outstream);
+    command->exit_code = COMMAND_SUCCESS_EXIT_CODE;
+}
+
+/**
+ * Wait for background jobs to finish and remove them.
+ * - no arguments waits for every job, the exit code is 0.
+ * - %N (or %+, %%) waits for job N, a number waits for the job with that process.
+ * The command->exit_code is set to the exit code of the last job, or 127 if it is not a job.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the command information
+ * @param jobs the job table
+ * @param errstream the stream to print error messages to
+ */
+void builtin_wait(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                  struct job_table *jobs, FILE *errstream)
+{
+    command->exit_code = COMMAND_SUCCESS_EXIT_CODE;
+
+    if (command->argc < 2)
+    {
+        while (jobs->jobs != NULL)
+        {
+            job_wait(env, err, jobs->jobs);
+            if (dc_error_has_error(err))
+            {
+                command->exit_code = COMMAND_ERROR_EXIT_CODE;
+                return;
+            }
+
+            job_remove(env, jobs, jobs->jobs);
+        }
+
+        return;
+    }
+
+    for (size_t i = 1; i < command->argc; i++)
+    {
+        struct job *job;
+
+        job = find_job(jobs, command->argv[i], true);
+        if (job == NULL)
+        {
+            if (command->argv[i][0] == '%')
+            {
+                fprintf(errstream, "wait: %s: no such job\n", command->argv[i]);
+            }
+            else
+            {
+                fprintf(errstream, "wait: pid %s is not a child of this shell\n", command->argv[i]);
+            }
+
+            command->exit_code = COMMAND_NOT_FOUND_EXIT_CODE;
+            continue;
+        }
+
+        command->exit_code = job_wait(env, err, job);
+        if (dc_error_has_error(err))
+        {
+            command->exit_code = COMMAND_ERROR_EXIT_CODE;
+            return;
+        }
+
+        job_remove(env, jobs, job);
+    }
+}
+
+/**
+ * Bring a background job to the foreground: display it and wait for it (there is no job control).
+ * - no arguments is the current job.
+ * - %N or N is job N.
+ * The command->exit_code is set to the exit code of the job, or 1 if there is no such job.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the command information
+ * @param jobs the job table
+ * @param outstream the stream to display the job on
+ * @param errstream the stream to print error messages to
+ */
+void builtin_fg(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                struct job_table *jobs, FILE *outstream, FILE *errstream)
+{
+    struct job *job;
+
+    job = find_job(jobs, command->argc < 2 ? "%+" : command->argv[1], false);
+    if (job == NULL)
+    {
+        fprintf(errstream, "fg: %s: no such job\n", command->argc < 2 ? "current" : command->argv[1]);
+        command->exit_code = COMMAND_ERROR_EXIT_CODE;
+        return;
+    }
+
+    //the job may write to the same terminal, the line has to be out first
+    fprintf(outstream, "%s\n", job->line);
+    fflush(outstream);
+
+    command->exit_code = job_wait(env, err, job);
+    if (dc_error_has_error(err))
+    {
+        command->exit_code = COMMAND_ERROR_EXIT_CODE;
+        return;
+    }
+
+    job_remove(env, jobs, job);
+}
+
+/**
+ * Display the arguments separated by spaces and followed by a newline.
+ * - -n as the first argument leaves out the newline.
+ * Escapes are not interpreted (use printf for that).
+ * The command->exit_code is set to 0, or 1 if the output could not be written.
+ *
+ * @param env the posix environment.
+ * @param command the command information
+ * @param outstream the stream to display the arguments on
+ */
+void builtin_echo(const struct dc_posix_env *env, struct command *command, FILE *outstream)
+{
+    size_t first;
+    bool newline;
+
+    first = 1;
+    newline = true;
+
+    if (command->argc > 1 && dc_strcmp(env, command->argv[1], "-n") == 0)
+    {
+        first = 2;
+        newline = false;
+    }
+
+    for (size_t i = first; i < command->argc; i++)
+    {
+        if (i > first)
+        {
+            fputc(' ', outstream);
+        }
+
+        fputs(command->argv[i], outstream);
+    }
+
+    if (newline)
+    {
+        fputc('\n', outstream);
+    }
+
+    command->exit_code = ferror(outstream) ? COMMAND_ERROR_EXIT_CODE : COMMAND_SUCCESS_EXIT_CODE;
+}
+
+/**
+ * Display the arguments according to a format: printf format [arguments].
+ * The format has the escapes \\ \a \b \f \n \r \t \v and \NNN (octal), and the conversions %d %i %o %u %x %X
+ * (numbers, 'c gives the code of c), %c, %s, %b (a string with escapes) and %% with the flags - + space # 0, a width
+ * and a precision ('*' takes them from the arguments). The format is reused while there are arguments left,
+ * a missing argument is "" or 0.
+ * The command->exit_code is set to 0, 1 if an argument is not a number or 2 if there is no format.
+ *
+ * @param env the posix environment.
+ * @param command the command information
+ * @param outstream the stream to display the output on
+ * @param errstream the stream to print error messages to
+ */
+void builtin_printf(const struct dc_posix_env *env, struct command *command, FILE *outstream, FILE *errstream)
+{
+    size_t next;
+    size_t first;
+    bool failed;
+
+    if (command->argc < 2)
+    {
+        fprintf(errstream, "usage: printf format [arguments]\n");
+        command->exit_code = COMMAND_USAGE_EXIT_CODE;
+        return;
+    }
+
+    next = 2;
+    failed = false;
+
+    //the whole format again for each set of arguments, once if it takes none
+    do
+    {
+        first = next;
+        if (!printf_format(env, command, &next, outstream, errstream, &failed))
+        {
+            break;
+        }
+    }
+    while (next < command->argc && next > first);
+
+    command->exit_code = failed ? COMMAND_ERROR_EXIT_CODE : COMMAND_SUCCESS_EXIT_CODE;
+}
+
+/**
+ * Display the working directory.
+ * The command->exit_code is set to 0, or 1 if the working directory cannot be found.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the command information
+ * @param working_dir the cached working directory, it is looked up and cached if it is NULL
+ * @param outstream the stream to display the directory on
+ */
+void builtin_pwd(const struct dc_posix_env *env, struct dc_error *err, struct command *command, char **working_dir,
+                 FILE *outstream)
+{
+    if (*working_dir == NULL)
+    {
+        *working_dir = dc_get_working_dir(env, err);
+        if (dc_error_has_error(err))
+        {
+            command->exit_code = COMMAND_ERROR_EXIT_CODE;
+            return;
+        }
+    }
+
+    fprintf(outstream, "%s\n", *working_dir);
+    command->exit_code = COMMAND_SUCCESS_EXIT_CODE;
+}
+
+/**
+ * Display how long each FSM state and each transition between states has taken: the count, p50, p99 and max.
+ * The command->exit_code is set to 0, or 2 if there are any arguments.
+ *
+ * @param env the posix environment.
+ * @param command the command information
+ * @param stats the times recorded by the FSM
+ * @param outstream the stream to display the times on
+ * @param errstream the stream to print error messages to
+ */
+void builtin_stats(const struct dc_posix_env *env, struct command *command, const struct fsm_stats *stats,
+                   FILE *outstream, FILE *errstream)
+{
+    (void)env;
+
+    if (command->argc > 1)
+    {
+        fprintf(errstream, "usage: stats\n");
+        command->exit_code = COMMAND_USAGE_EXIT_CODE;
+        return;
+    }
+
+    fsm_stats_print(stats, outstream);
+    command->exit_code = COMMAND_SUCCESS_EXIT_CODE;
+}
+
+/**
+ * Display or clear the history.
+ * - no arguments displays every line in the history.
+ * - n displays the last n lines.
+ * - -c forgets the lines in memory, the history file is not changed.
+ * The command->exit_code is set to 0, or 2 if the arguments are not valid.
+ *
+ * @param env the posix environment.
+ * @param command the command information
+ * @param history the lines that were read
+ * @param outstream the stream to display the lines on
+ * @param errstream the stream to print error messages to
+ */
+void builtin_history(const struct dc_posix_env *env, struct command *command, struct history *history,
+                     FILE *outstream, FILE *errstream)
+{
+    size_t last;
+
+    command->exit_code = COMMAND_SUCCESS_EXIT_CODE;
+    last = history->count;
+
+    if (command->argc == 2 && dc_strcmp(env, command->argv[1], "-c") == 0)
+    {
+        history_clear(env, history);
+        return;
+    }
+
+    if (command->argc == 2 && isdigit((unsigned char)command->argv[1][0]))
+    {
+        char *end;
+
+        errno = 0;
+        last = strtoul(command->argv[1], &end, 10);
+        if (errno != 0 || *end != '\0')
+        {
+            fprintf(errstream, "history: %s: numeric argument required\n", command->argv[1]);
+            command->exit_code = COMMAND_USAGE_EXIT_CODE;
+            return;
+        }
+    }
+    else if (command->argc > 1)
+    {
+        fprintf(errstream, "usage: history [-c] [n]\n");
+        command->exit_code = COMMAND_USAGE_EXIT_CODE;
+        return;
+    }
+
+    history_print(history, last, outstream);
+}
+
+/**
+ * Evaluate an expression: test expression or [ expression ].
+ * The expression is chosen by the number of arguments the same as POSIX test: ! negates, ( ) group, the unary
+ * operators are -b -c -d -e -f -g -h -L -n -p -r -s -S -t -u -w -x -z and the binary operators are = != -eq -ne
+ * -lt -le -gt -ge.
+ * The command->exit_code is set to 0 if the expression is true, 1 if it is false or 2 if it is not valid.
+ *
+ * @param env the posix environment.
+ * @param command the command information
+ * @param errstream the stream to print error messages to
+ */
+void builtin_test(const struct dc_posix_env *env, struct command *command, FILE *errstream)
+{
+    size_t count;
+
+    count = command->argc - 1;
+
+    if (dc_strcmp(env, command->command, "[") == 0)
+    {
+        if (count == 0 || dc_strcmp(env, command->argv[count], "]") != 0)
+        {
+            fprintf(errstream, "[: missing `]'\n");
+            command->exit_code = COMMAND_USAGE_EXIT_CODE;
+            return;
+        }
+
+        count--;
+    }
+
+    command->exit_code = test_expression(env, &command->argv[1], count, errstream);
+}
+
+/**
+ * Set environment variables for the shell and the programs it starts: export NAME=value...
+ * - no arguments (or -p) displays every variable as export NAME='value'.
+ * - NAME without a value is left as it is, every variable of the shell is already exported.
+ * The command->exit_code is set to 0, or 1 if a name is not valid.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the command information
+ * @param outstream the stream to display the variables on
+ * @param errstream the stream to print error messages to
+ */
+void builtin_export(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                    FILE *outstream, FILE *errstream)
+{
+    command->exit_code = COMMAND_SUCCESS_EXIT_CODE;
+
+    if (command->argc < 2 || (command->argc == 2 && dc_strcmp(env, command->argv[1], "-p") == 0))
+    {
+        for (char **variable = environ; *variable != NULL; variable++)
+        {
+            print_export(*variable, outstream);
+        }
+
+        return;
+    }
+
+    for (size_t i = 1; i < command->argc; i++)
+    {
+        const char *argument;
+        const char *value;
+        size_t length;
+        char *name;
+
+        argument = command->argv[i];
+        value = dc_strchr(env, argument, '=');
+        length = value == NULL ? dc_strlen(env, argument) : (size_t)(value - argument);
+
+        if (!valid_name(argument, length))
+        {
+            fprintf(errstream, "export: `%s': not a valid identifier\n", argument);
+            command->exit_code = COMMAND_ERROR_EXIT_CODE;
+            continue;
+        }
+
+        if (value == NULL)
+        {
+            continue;
+        }
+
+        name = dc_malloc(env, err, length + 1);
+        if (dc_error_has_error(err))
+        {
+            command->exit_code = COMMAND_ERROR_EXIT_CODE;
+            return;
+        }
+
+        dc_memcpy(env, name, argument, length);
+        name[length] = '\0';
+        dc_setenv(env, err, name, value + 1, 1);
+        dc_free(env, name, length + 1);
+
+        if (dc_error_has_error(err))
+        {
+            command->exit_code = COMMAND_ERROR_EXIT_CODE;
+            return;
+        }
+    }
+}
+
+/**
+ * Remove environment variables: unset [-v] NAME...
+ * The command->exit_code is set to 0, or 1 if a name is not valid.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the command information
+ * @param errstream the stream to print error messages to
+ */
+void builtin_unset(const struct dc_posix_env *env, struct dc_error *err, struct command *command, FILE *errstream)
+{
+    command->exit_code = COMMAND_SUCCESS_EXIT_CODE;
+
+    for (size_t i = 1; i < command->argc; i++)
+    {
+        const char *name;
+
+        name = command->argv[i];
+
+        //there are only variables to unset, no functions
+        if (i == 1 && dc_strcmp(env, name, "-v") == 0)
+        {
+            continue;
+        }
+
+        if (!valid_name(name, dc_strlen(env, name)))
+        {
+            fprintf(errstream, "unset: `%s': not a valid identifier\n", name);
+            command->exit_code = COMMAND_ERROR_EXIT_CODE;
+            continue;
+        }
+
+        dc_unsetenv(env, err, name);
+        if (dc_error_has_error(err))
+        {
+            command->exit_code = COMMAND_ERROR_EXIT_CODE;
+            return;
+        }
+    }
+}
+
+/**
+ * Display how each name would be run: "name is a shell builtin" or "name is /path/to/name".
+ * The programs are looked up in the command hash (see command_hash_lookup).
+ * The command->exit_code is set to 0, or 1 if a name could not be found.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the command information
+ * @param hash the command hash
+ * @param path the directories to search for names
+ * @param outstream the stream to display the names on
+ * @param errstream the stream to print error messages to
+ */
+void builtin_type(const struct dc_posix_env *env, struct dc_error *err, struct command *command,
+                  struct command_hash *hash, char **path, FILE *outstream, FILE *errstream)
+{
+    command->exit_code = COMMAND_SUCCESS_EXIT_CODE;
+
+    for (size_t i = 1; i < command->argc; i++)
+    {
+        const char *name;
+        const char *program;
+
+        name = command->argv[i];
+
+        if (builtin_find(env, name) != NULL)
+        {
+            fprintf(outstream, "%s is a shell builtin\n", name);
+            continue;
+        }
+
+        if (dc_strchr(env, name, '/') != NULL)
+        {
+            program = access(name, X_OK) == 0 ? name : NULL;
+        }
+        else
+        {
+            program = command_hash_lookup(env, err, hash, name, path);
+            if (dc_error_has_error(err))
+            {
+                command->exit_code = COMMAND_ERROR_EXIT_CODE;
+                return;
+            }
+        }
+
+        if (program == NULL)
+        {
+            fprintf(errstream, "type: %s: not found\n", name);
+            command->exit_code = COMMAND_ERROR_EXIT_CODE;
+        }
+        else
+        {
+            fprintf(outstream, "%s is %s\n", name, program);
+        }
+    }
+}
+
+static void stream_error(const struct dc_posix_env *env, char* dir, int errNum, FILE *stream)
+{
+    char message[ERR_BUF_LEN] = {0};
+
+    switch (errNum)
+    {
+        case ENOENT:
+            dc_strcpy(env, message, "does not exist");
+            break;
+        case ENOTDIR:
+            dc_strcpy(env, message, "is not a directory");
+            break;
+        default:
+            dc_strerror_r(env, errNum, message, ERR_BUF_LEN);
+            break;
+    }
+    fprintf(stream, "%s: %s\n", dir, message);
+}
+
+static struct job *find_job(const struct job_table *jobs, const char *spec, bool by_pid)
+{
+    char *end;
+    long number;
+
+    if (spec[0] == '%')
+    {
+        spec++;
+
+        if (spec[0] == '\0' || ((spec[0] == '+' || spec[0] == '%') && spec[1] == '\0'))
+        {
+            return job_find(jobs, 0);
+        }
+
+        by_pid = false;
+    }
+
+    errno = 0;
+    number = strtol(spec, &end, 10);
+    if (errno != 0 || end == spec || *end != '\0' || number <= 0 || number > INT_MAX)
+    {
+        return NULL;
+    }
+
+    if (by_pid)
+    {
+        return job_find_pid(jobs, (pid_t)number);
+    }
+
+    return job_find(jobs, (int)number);
+}
+
+static int next_state(const struct dc_error *err)
+{
+    return dc_error_has_error(err) ? ERROR : RESET_STATE;
+}
+
+static FILE *open_redirect(const struct dc_posix_env *env, struct dc_error *err, char *file_name, bool overwrite,
+                           FILE *errstream)
+{
+    FILE *stream;
+
+    stream = dc_fopen(env, err, file_name, overwrite ? "w" : "a");
+    if (dc_error_has_error(err))
+    {
+        stream_error(env, file_name, err->errno_code, errstream);
+        dc_error_reset(err);
+        return NULL;
+    }
+
+    return stream;
+}
+
+static bool changes_path(const struct dc_posix_env *env, const struct command *command)
+{
+    for (size_t i = 1; i < command->argc; i++)
+    {
+        if (dc_strncmp(env, command->argv[i], "PATH", 4) == 0 &&
+            (command->argv[i][4] == '\0' || command->argv[i][4] == '='))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void path_changed(const struct dc_posix_env *env, struct state *states)
+{
+    //separated again when a program is next run (see get_state_path)
+    free_path(env, &states->path);
+    command_hash_clear(env, states->command_hash);
+}
+
+static bool valid_name(const char *text, size_t length)
+{
+    if (length == 0 || !(isalpha((unsigned char)text[0]) || text[0] == '_'))
+    {
+        return false;
+    }
+
+    for (size_t i = 1; i < length; i++)
+    {
+        if (!(isalnum((unsigned char)text[i]) || text[i] == '_'))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void print_export(const char *variable, FILE *stream)
+{
+    const char *c;
+
+    fputs("export ", stream);
+
+    for (c = variable; *c != '\0' && *c != '='; c++)
+    {
+        fputc(*c, stream);
+    }
+
+    fputs("='", stream);
+
+    if (*c == '=')
+    {
+        for (c++; *c != '\0'; c++)
+        {
+            //a ' cannot be in '...', close the quotes around an escaped one
+            if (*c == '\'')
+            {
+                fputs("'\\''", stream);
+            }
+            else
+            {
+                fputc(*c, stream);
+            }
+        }
+    }
+
+    fputs("'\n", stream);
+}
+
+static size_t printf_escape(const char *text, FILE *stream, bool *stop)
+{
+    size_t length;
+    int value;
+
+    *stop = false;
+
+    switch (text[1])
+    {
+        case '\\':
+            fputc('\\', stream);
+            return 2;
+        case 'a':
+            fputc('\a', stream);
+            return 2;
+        case 'b':
+            fputc('\b', stream);
+            return 2;
+        case 'f':
+            fputc('\f', stream);
+            return 2;
+        case 'n':
+            fputc('\n', stream);
+            return 2;
+        case 'r':
+            fputc('\r', stream);
+            return 2;
+        case 't':
+            fputc('\t', stream);
+            return 2;
+        case 'v':
+            fputc('\v', stream);
+            return 2;
+        case 'c':
+            *stop = true;
+            return 2;
+        case '\0':
+            fputc('\\', stream);
+            return 1;
+        default:
+            break;
+    }
+
+    if (text[1] < '0' || text[1] > '7')
+    {
+        //not an escape, displayed as it is
+        fputc('\\', stream);
+        fputc(text[1], stream);
+        return 2;
+    }
+
+    //\NNN, up to 3 octal digits
+    value = 0;
+    for (length = 1; length < 4 && text[length] >= '0' && text[length] <= '7'; length++)
+    {
+        value = value * 8 + (text[length] - '0');
+    }
+
+    fputc(value & UCHAR_MAX, stream);
+
+    return length;
+}
+
+static bool printf_format(const struct dc_posix_env *env, const struct command *command, size_t *next,
+                          FILE *outstream, FILE *errstream, bool *failed)
+{
+    const char *c;
+
+    c = command->argv[1];
+
+    while (*c != '\0')
+    {
+        struct printf_conversion conversion;
+        const char *argument;
+        char type;
+        bool stop;
+
+        if (*c == '\\')
+        {
+            c += printf_escape(c, outstream, &stop);
+            if (stop)
+            {
+                return false;
+            }
+            continue;
+        }
+
+        if (*c != '%' || c[1] == '%')
+        {
+            fputc(*c, outstream);
+            c += *c == '%' ? 2 : 1;
+            continue;
+        }
+
+        c++;
+        dc_memset(env, &conversion, 0, sizeof(conversion));
+
+        for (; *c != '\0' && dc_strchr(env, "-+ #0", *c) != NULL; c++)
+        {
+            conversion.left = conversion.left || *c == '-';
+            conversion.plus = conversion.plus || *c == '+';
+            conversion.space = conversion.space || *c == ' ';
+            conversion.alternate = conversion.alternate || *c == '#';
+            conversion.zero = conversion.zero || *c == '0';
+        }
+
+        if (*c == '*')
+        {
+            intmax_t width;
+
+            width = printf_argument(*next < command->argc ? command->argv[(*next)++] : NULL, errstream, failed);
+            conversion.left = conversion.left || width < 0;
+            conversion.width = (size_t)(width < 0 ? -width : width);
+            c++;
+        }
+
+        for (; isdigit((unsigned char)*c); c++)
+        {
+            conversion.width = conversion.width * 10 + (size_t)(*c - '0');
+        }
+
+        if (*c == '.')
+        {
+            c++;
+            conversion.has_precision = true;
+
+            if (*c == '*')
+            {
+                intmax_t precision;
+
+                precision = printf_argument(*next < command->argc ? command->argv[(*next)++] : NULL, errstream,
+                                            failed);
+                conversion.has_precision = precision >= 0;
+                conversion.precision = precision < 0 ? 0 : (size_t)precision;
+                c++;
+            }
+
+            for (; isdigit((unsigned char)*c); c++)
+            {
+                conversion.precision = conversion.precision * 10 + (size_t)(*c - '0');
+            }
+        }
+
+        type = *c;
+        if (type == '\0')
+        {
+            fprintf(errstream, "printf: %%: missing conversion\n");
+            *failed = true;
+            return false;
+        }
+
+        c++;
+        argument = NULL;
+        if (dc_strchr(env, "diouxXcsb", type) != NULL && *next < command->argc)
+        {
+            argument = command->argv[(*next)++];
+        }
+
+        switch (type)
+        {
+            case 'd':
+            case 'i':
+            case 'o':
+            case 'u':
+            case 'x':
+            case 'X':
+                printf_number(outstream, type, printf_argument(argument, errstream, failed), &conversion);
+                break;
+            case 'c':
+                argument = argument == NULL ? "" : argument;
+                printf_padded(outstream, argument, argument[0] == '\0' ? 0 : 1, &conversion);
+                break;
+            case 's':
+            {
+                size_t length;
+
+                argument = argument == NULL ? "" : argument;
+                length = dc_strlen(env, argument);
+                if (conversion.has_precision && conversion.precision < length)
+                {
+                    length = conversion.precision;
+                }
+
+                printf_padded(outstream, argument, length, &conversion);
+                break;
+            }
+            case 'b':
+                //the escapes are displayed as they are found, there is no width
+                for (const char *b = argument == NULL ? "" : argument; *b != '\0';)
+                {
+                    if (*b != '\\')
+                    {
+                        fputc(*b++, outstream);
+                        continue;
+                    }
+
+                    b += printf_escape(b, outstream, &stop);
+                    if (stop)
+                    {
+                        return false;
+                    }
+                }
+                break;
+            default:
+                fprintf(errstream, "printf: %%%c: invalid conversion\n", type);
+                *failed = true;
+                return false;
+        }
+    }
+
+    return true;
+}
+
+static intmax_t printf_argument(const char *text, FILE *errstream, bool *failed)
+{
+    intmax_t value;
+    char *end;
+
+    if (text == NULL || text[0] == '\0')
+    {
+        return 0;
+    }
+
+    if (text[0] == '\'' || text[0] == '"')
+    {
+        return (unsigned char)text[1];
+    }
+
+    errno = 0;
+    value = strtoimax(text, &end, 0);
+    if (errno != 0 || *end != '\0')
+    {
+        fprintf(errstream, "printf: %s: invalid number\n", text);
+        *failed = true;
+    }
+
+    return value;
+}
+
+static void printf_number(FILE *stream, char type, intmax_t value, const struct printf_conversion *conversion)
+{
+    char digits[NUMBER_BUF_LEN];
+    const char *sign;
+    const char *prefix;
+    uintmax_t magnitude;
+    size_t digits_length;
+    size_t zeros;
+    size_t length;
+    size_t padding;
+
+    sign = "";
+    prefix = "";
+
+    switch (type)
+    {
+        case 'd':
+        case 'i':
+            magnitude = value < 0 ? (uintmax_t)0 - (uintmax_t)value : (uintmax_t)value;
+            sign = value < 0 ? "-" : conversion->plus ? "+" : conversion->space ? " " : "";
+            snprintf(digits, sizeof(digits), "%ju", magnitude);
+            break;
+        case 'o':
+            magnitude = (uintmax_t)value;
+            prefix = conversion->alternate && magnitude != 0 ? "0" : "";
+            snprintf(digits, sizeof(digits), "%jo", magnitude);
+            break;
+        case 'x':
+            magnitude = (uintmax_t)value;
+            prefix = conversion->alternate && magnitude != 0 ? "0x" : "";
+            snprintf(digits, sizeof(digits), "%jx", magnitude);
+            break;
+        case 'X':
+            magnitude = (uintmax_t)value;
+            prefix = conversion->alternate && magnitude != 0 ? "0X" : "";
+            snprintf(digits, sizeof(digits), "%jX", magnitude);
+            break;
+        default:
+            magnitude = (uintmax_t)value;
+            snprintf(digits, sizeof(digits), "%ju", magnitude);
+            break;
+    }
+
+    //a precision of 0 displays no digits for 0
+    digits_length = conversion->has_precision && conversion->precision == 0 && magnitude == 0 ? 0 : strlen(digits);
+    zeros = conversion->has_precision && conversion->precision > digits_length ?
+            conversion->precision - digits_length : 0;
+
+    //the # of octal only makes sure that there is a leading 0
+    if (type == 'o' && zeros > 0)
+    {
+        prefix = "";
+    }
+
+    length = strlen(sign) + strlen(prefix) + zeros + digits_length;
+    if (conversion->zero && !conversion->left && !conversion->has_precision && conversion->width > length)
+    {
+        zeros += conversion->width - length;
+        length = conversion->width;
+    }
+
+    padding = conversion->width > length ? conversion->width - length : 0;
+
+    if (!conversion->left)
+    {
+        print_repeated(stream, ' ', padding);
+    }
+
+    fputs(sign, stream);
+    fputs(prefix, stream);
+    print_repeated(stream, '0', zeros);
+    fwrite(digits, 1, digits_length, stream);
+
+    if (conversion->left)
+    {
+        print_repeated(stream, ' ', padding);
+    }
+}
+
+static void printf_padded(FILE *stream, const char *text, size_t length, const struct printf_conversion *conversion)
+{
+    size_t padding;
+
+    padding = conversion->width > length ? conversion->width - length : 0;
+
+    if (!conversion->left)
+    {
+        print_repeated(stream, ' ', padding);
+    }
+
+    fwrite(text, 1, length, stream);
+
+    if (conversion->left)
+    {
+        print_repeated(stream, ' ', padding);
+    }
+}
+
+static void print_repeated(FILE *stream, char c, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        fputc(c, stream);
+    }
+}
+
+static bool echo_handles(const struct dc_posix_env *env, const struct command *command)
+{
+    //the same options as GNU echo: --help or --version alone, and words made of n e and E before the text
+    if (command->argc == 2 && (dc_strcmp(env, command->argv[1], "--help") == 0 ||
+                               dc_strcmp(env, command->argv[1], "--version") == 0))
+    {
+        return false;
+    }
+
+    for (size_t i = 1; i < command->argc; i++)
+    {
+        const char *word;
+
+        word = command->argv[i];
+        if (word[0] != '-' || word[1] == '\0' || word[1 + strspn(&word[1], "neE")] != '\0')
+        {
+            break;
+        }
+
+        if (i > 1 || dc_strcmp(env, word, "-n") != 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool printf_handles(const struct dc_posix_env *env, const struct command *command)
+{
+    if (command->argc < 2)
+    {
+        return true;
+    }
+
+    for (const char *c = command->argv[1]; *c != '\0'; c++)
+    {
+        if (*c == '\\')
+        {
+            if (c[1] != '\0' && dc_strchr(env, "xuUe\"", c[1]) != NULL)
+            {
+                return false;
+            }
+
+            c += c[1] != '\0';
+            continue;
+        }
+
+        if (*c != '%')
+        {
+            continue;
+        }
+
+        c++;
+        if (*c == '%')
+        {
+            continue;
+        }
+
+        //the same flags, width and precision that printf_format takes
+        c += strspn(c, "-+ #0");
+        c += *c == '*' ? 1 : strspn(c, "0123456789");
+        if (*c == '.')
+        {
+            c++;
+            c += *c == '*' ? 1 : strspn(c, "0123456789");
+        }
+
+        if (*c == '\0' || dc_strchr(env, "diouxXcsb", *c) == NULL)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool test_handles(const struct dc_posix_env *env, const struct command *command)
+{
+    size_t count;
+
+    count = command->argc - 1;
+
+    if (dc_strcmp(env, command->command, "[") == 0)
+    {
+        //a missing ] is reported by the builtin
+        if (count == 0 || dc_strcmp(env, command->argv[count], "]") != 0)
+        {
+            return true;
+        }
+
+        count--;
+    }
+
+    return test_supported(env, &command->argv[1], count);
+}
+
+static bool test_supported(const struct dc_posix_env *env, char **args, size_t count)
+{
+    //the same choices as test_expression
+    switch (count)
+    {
+        case 0:
+        case 1:
+            return true;
+        case 2:
+            return dc_strcmp(env, args[0], "!") == 0 || test_is_unary(env, args[0]);
+        case 3:
+            if (test_is_binary(env, args[1]))
+            {
+                return true;
+            }
+
+            if (dc_strcmp(env, args[0], "!") == 0)
+            {
+                return test_supported(env, &args[1], 2);
+            }
+
+            return dc_strcmp(env, args[0], "(") == 0 && dc_strcmp(env, args[2], ")") == 0;
+        case 4:
+            if (dc_strcmp(env, args[0], "!") == 0)
+            {
+                return test_supported(env, &args[1], 3);
+            }
+
+            return dc_strcmp(env, args[0], "(") == 0 && dc_strcmp(env, args[3], ")") == 0 &&
+                   test_supported(env, &args[1], 2);
+        default:
+            return false;
+    }
+}
+
+static int test_expression(const struct dc_posix_env *env, char **args, size_t count, FILE *errstream)
+{
+    int result;
+
+    switch (count)
+    {
+        case 0:
+            return COMMAND_ERROR_EXIT_CODE;
+        case 1:
+            return args[0][0] != '\0' ? COMMAND_SUCCESS_EXIT_CODE : COMMAND_ERROR_EXIT_CODE;
+        case 2:
+            if (dc_strcmp(env, args[0], "!") == 0)
+            {
+                result = test_expression(env, &args[1], 1, errstream);
+                break;
+            }
+
+            if (test_is_unary(env, args[0]))
+            {
+                return test_unary(args[0], args[1], errstream);
+            }
+
+            fprintf(errstream, "test: %s: unary operator expected\n", args[0]);
+            return COMMAND_USAGE_EXIT_CODE;
+        case 3:
+            if (test_is_binary(env, args[1]))
+            {
+                return test_binary(env, args[0], args[1], args[2], errstream);
+            }
+
+            if (dc_strcmp(env, args[0], "!") == 0)
+            {
+                result = test_expression(env, &args[1], 2, errstream);
+                break;
+            }
+
+            if (dc_strcmp(env, args[0], "(") == 0 && dc_strcmp(env, args[2], ")") == 0)
+            {
+                return test_expression(env, &args[1], 1, errstream);
+            }
+
+            fprintf(errstream, "test: %s: binary operator expected\n", args[1]);
+            return COMMAND_USAGE_EXIT_CODE;
+        case 4:
+            if (dc_strcmp(env, args[0], "!") == 0)
+            {
+                result = test_expression(env, &args[1], 3, errstream);
+                break;
+            }
+
+            if (dc_strcmp(env, args[0], "(") == 0 && dc_strcmp(env, args[3], ")") == 0)
+            {
+                return test_expression(env, &args[1], 2, errstream);
+            }
+
+            fprintf(errstream, "test: too many arguments\n");
+            return COMMAND_USAGE_EXIT_CODE;
+        default:
+            fprintf(errstream, "test: too many arguments\n");
+            return COMMAND_USAGE_EXIT_CODE;
+    }
+
+    //! only negates an expression that is valid
+    if (result == COMMAND_USAGE_EXIT_CODE)
+    {
+        return result;
+    }
+
+    return result == COMMAND_SUCCESS_EXIT_CODE ? COMMAND_ERROR_EXIT_CODE : COMMAND_SUCCESS_EXIT_CODE;
+}
+
+static bool test_is_unary(const struct dc_posix_env *env, const char *op)
+{
+    return op[0] == '-' && op[1] != '\0' && op[2] == '\0' && dc_strchr(env, "bcdefghLnprsStuwxz", op[1]) != NULL;
+}
+
+static bool test_is_binary(const struct dc_posix_env *env, const char *op)
+{
+    static const char *operators[] = { "=", "!=", "-eq", "-ne", "-lt", "-le", "-gt", "-ge" };
+
+    for (size_t i = 0; i < sizeof(operators) / sizeof(operators[0]); i++)
+    {
+        if (dc_strcmp(env, op, operators[i]) == 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static int test_unary(const char *op, const char *operand, FILE *errstream)
+{
+    struct stat info;
+    bool result;
+
+    switch (op[1])
+    {
+        case 'n':
+            result = operand[0] != '\0';
+            break;
+        case 'z':
+            result = operand[0] == '\0';
+            break;
+        case 'r':
+            result = access(operand, R_OK) == 0;
+            break;
+        case 'w':
+            result = access(operand, W_OK) == 0;
+            break;
+        case 'x':
+            result = access(operand, X_OK) == 0;
+            break;
+        case 'h':
+        case 'L':
+            result = lstat(operand, &info) == 0 && S_ISLNK(info.st_mode);
+            break;
+        case 't':
+        {
+            intmax_t fd;
+
+            if (!test_integer(operand, &fd, errstream))
+            {
+                return COMMAND_USAGE_EXIT_CODE;
+            }
+
+            result = fd >= 0 && fd <= INT_MAX && isatty((int)fd);
+            break;
+        }
+        default:
+            //the rest are about the file the operand names, a missing file is false
+            if (stat(operand, &info) != 0)
+            {
+                return COMMAND_ERROR_EXIT_CODE;
+            }
+
+            switch (op[1])
+            {
+                case 'b':
+                    result = S_ISBLK(info.st_mode);
+                    break;
+                case 'c':
+                    result = S_ISCHR(info.st_mode);
+                    break;
+                case 'd':
+                    result = S_ISDIR(info.st_mode);
+                    break;
+                case 'f':
+                    result = S_ISREG(info.st_mode);
+                    break;
+                case 'g':
+                    result = (info.st_mode & S_ISGID) != 0;
+                    break;
+                case 'p':
+                    result = S_ISFIFO(info.st_mode);
+                    break;
+                case 's':
+                    result = info.st_size > 0;
+                    break;
+                case 'S':
+                    result = S_ISSOCK(info.st_mode);
+                    break;
+                case 'u':
+                    result = (info.st_mode & S_ISUID) != 0;
+                    break;
+                case 'e':
+                default:
+                    result = true;
+                    break;
+            }
+            break;
+    }
+
+    return result ? COMMAND_SUCCESS_EXIT_CODE : COMMAND_ERROR_EXIT_CODE;
+}
+
+static int test_binary(const struct dc_posix_env *env, const char *left, const char *op, const char *right,
+                       FILE *errstream)
+{
+    intmax_t left_value;
+    intmax_t right_value;
+    bool result;
+
+    if (op[0] != '-')
+    {
+        result = (dc_strcmp(env, left, right) == 0) == (op[0] == '=');
+        return result ? COMMAND_SUCCESS_EXIT_CODE : COMMAND_ERROR_EXIT_CODE;
+    }
+
+    if (!test_integer(left, &left_value, errstream) || !test_integer(right, &right_value, errstream))
+    {
+        return COMMAND_USAGE_EXIT_CODE;
+    }
+
+    if (dc_strcmp(env, op, "-eq") == 0)
+    {
+        result = left_value == right_value;
+    }
+    else if (dc_strcmp(env, op, "-ne") == 0)
+    {
+        result = left_value != right_value;
+    }
+    else if (dc_strcmp(env, op, "-lt") == 0)
+    {
+        result = left_value < right_value;
+    }
+    else if (dc_strcmp(env, op, "-le") == 0)
+    {
+        result = left_value <= right_value;
+    }
+    else if (dc_strcmp(env, op, "-gt") == 0)
+    {
+        result = left_value > right_value;
+    }
+    else
+    {
+        result = left_value >= right_value;
+    }
+
+    return result ? COMMAND_SUCCESS_EXIT_CODE : COMMAND_ERROR_EXIT_CODE;
+}
+
+static bool test_integer(const char *text, intmax_t *value, FILE *errstream)
+{
+    char *end;
+
+    errno = 0;
+    *value = strtoimax(text, &end, 10);
+    if (errno != 0 || end == text || *end != '\0')
+    {
+        fprintf(errstream, "test: %s: integer expression expected\n", text);
+        return false;
+    }
+
+    return true;
+}
+
+static int run_cd(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                  struct command *command)
+{
+    builtin_cd(env, err, command, states->stderr);
+    if (command->exit_code == COMMAND_SUCCESS_EXIT_CODE)
+    {
+        clear_working_dir(env, states);
+    }
+    else
+    {
+        //already reported, the line goes on
+        dc_error_reset(err);
+    }
+
+    return RESET_STATE;
+}
+
+static int run_exit(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                    struct command *command)
+{
+    (void)env;
+    (void)err;
+
+    if (command->argc > 2)
+    {
+        fprintf(states->stderr, "exit: too many arguments\n");
+        command->exit_code = COMMAND_ERROR_EXIT_CODE;
+        return RESET_STATE;
+    }
+
+    //without an argument the shell exits with the exit code of the last pipeline
+    if (command->argc == 2)
+    {
+        char *end;
+        long code;
+
+        errno = 0;
+        code = strtol(command->argv[1], &end, 10);
+        if (errno != 0 || end == command->argv[1] || *end != '\0')
+        {
+            fprintf(states->stderr, "exit: %s: numeric argument required\n", command->argv[1]);
+            code = COMMAND_USAGE_EXIT_CODE;
+        }
+
+        //only the low 8 bits of an exit code reach the parent
+        states->last_exit_code = (int)(code & 0xFF);
+    }
+
+    return EXIT;
+}
+
+static int run_hash(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                    struct command *command)
+{
+    if (get_state_path(env, err, states) == NULL)
+    {
+        return next_state(err);
+    }
+
+    builtin_hash(env, err, command, states->command_hash, states->path, states->stdout, states->stderr);
+    return next_state(err);
+}
+
+static int run_jobs(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                    struct command *command)
+{
+    if (get_job_table(env, err, states) == NULL)
+    {
+        return next_state(err);
+    }
+
+    builtin_jobs(env, err, command, states->jobs, states->stdout);
+    return next_state(err);
+}
+
+static int run_wait(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                    struct command *command)
+{
+    if (get_job_table(env, err, states) == NULL)
+    {
+        return next_state(err);
+    }
+
+    builtin_wait(env, err, command, states->jobs, states->stderr);
+    return next_state(err);
+}
+
+static int run_fg(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                  struct command *command)
+{
+    if (get_job_table(env, err, states) == NULL)
+    {
+        return next_state(err);
+    }
+
+    builtin_fg(env, err, command, states->jobs, states->stdout, states->stderr);
+    return next_state(err);
+}
+
+static int run_parallel(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                        struct command *command)
+{
+    if (get_job_table(env, err, states) == NULL)
+    {
+        return next_state(err);
+    }
+
+    builtin_parallel(env, err, states, command);
+    return next_state(err);
+}
+
+static int run_echo(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                    struct command *command)
+{
+    builtin_echo(env, command, states->stdout);
+    return next_state(err);
+}
+
+static int run_printf(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                      struct command *command)
+{
+    builtin_printf(env, command, states->stdout, states->stderr);
+    return next_state(err);
+}
+
+static int run_pwd(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                   struct command *command)
+{
+    builtin_pwd(env, err, command, &states->working_dir, states->stdout);
+    return next_state(err);
+}
+
+static int run_stats(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                     struct command *command)
+{
+    builtin_stats(env, command, states->stats, states->stdout, states->stderr);
+    return next_state(err);
+}
+
+static int run_history(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                       struct command *command)
+{
+    if (get_history(env, err, states) == NULL)
+    {
+        return next_state(err);
+    }
+
+    builtin_history(env, command, states->history, states->stdout, states->stderr);
+    return next_state(err);
+}
+
+static int run_true(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                    struct command *command)
+{
+    (void)env;
+    (void)states;
+
+    command->exit_code = COMMAND_SUCCESS_EXIT_CODE;
+    return next_state(err);
+}
+
+static int run_false(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                     struct command *command)
+{
+    (void)env;
+    (void)states;
+
+    command->exit_code = COMMAND_ERROR_EXIT_CODE;
+    return next_state(err);
+}
+
+static int run_test(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                    struct command *command)
+{
+    builtin_test(env, command, states->stderr);
+    return next_state(err);
+}
+
+static int run_export(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                      struct command *command)
+{
+    builtin_export(env, err, command, states->stdout, states->stderr);
+    if (dc_error_has_no_error(err) && changes_path(env, command))
+    {
+        path_changed(env, states);
+    }
+
+    return next_state(err);
+}
+
+static int run_unset(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                     struct command *command)
+{
+    builtin_unset(env, err, command, states->stderr);
+    if (dc_error_has_no_error(err) && changes_path(env, command))
+    {
+        path_changed(env, states);
+    }
+
+    return next_state(err);
+}
+
+static int run_type(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                    struct command *command)
+{
+    if (get_state_path(env, err, states) == NULL)
+    {
+        return next_state(err);
+    }
+
+    builtin_type(env, err, command, states->command_hash, states->path, states->stdout, states->stderr);
+    return next_state(err);
 }
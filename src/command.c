@@ -2,7 +2,11 @@
 #include <dc_posix/dc_stdlib.h>
 #include <dc_posix/dc_string.h>
 #include <dc_util/strings.h>
-#include <dc_posix/dc_wordexp.h>
+#include "../include/arena.h"
+#include "../include/expand.h"
+#include "../include/lexer.h"
+
+#define INITIAL_WORD_CAPACITY 8
 
 /**
  * Helper function to loop through the argv to free its elements.
@@ -22,159 +26,234 @@ static void free_loops(const struct dc_posix_env *env, size_t *argc, char*** arg
 static void free_char(const struct dc_posix_env *env, char **target);
 
 /**
- * Helper function to find the match for regex.
+ * Helper function to expand a word and append the resulting words to the list.
+ * Plain words are copied as they are, anything else goes through expand_word.
+ *
+ * @param env the posix environment.
+ * @param err the error object.
+ * @param state the current state (for the settings command substitutions run with).
+ * @param exit_code set to the exit code of the last command substitution in the word.
+ * @param arena where the words are allocated, NULL for the heap.
+ * @param token the word to expand.
+ * @param words the list of words, grown as needed.
+ * @param count the number of words in the list.
+ * @param capacity the number of words the list can hold.
+ */
+static void add_words(const struct dc_posix_env *env, struct dc_error *err, const struct state *state,
+                      int *exit_code, struct arena *arena, const struct token *token, char ***words, size_t *count,
+                      size_t *capacity);
+
+/**
+ * Helper function to expand the file name of a redirection.
  *
  * @param env the posix environment.
  * @param err the error object.
- * @param state the current state, to set the fatal_error and access the command line and regex for redirection.
- * @param reg the regex to compare.
- * @param fileNamePt if regex match found, the file name will be saved.
- * @param matches regmatch variable to access the matched string.
- * @param command_stringPt the pointer to the string that regex search is applied.
- * @param overwritePt a pointer to overwrite value. To set true if overwrite regex is found.
+ * @param state the current state (for the settings command substitutions run with).
+ * @param exit_code set to the exit code of the last command substitution in the file name.
+ * @param arena where the file name is allocated, NULL for the heap.
+ * @param token the word after the redirection.
+ * @param fileNamePt set to the expanded file name, replacing an earlier redirection of the same stream.
  */
-static void find_reg_match(const struct dc_posix_env *env, struct dc_error *err, struct state* state, regex_t * reg, char** fileNamePt,
-                           regmatch_t *matches, char **command_stringPt, bool *overwritePt);
+static void set_redirect(const struct dc_posix_env *env, struct dc_error *err, const struct state *state,
+                         int *exit_code, struct arena *arena, const struct token *token, char **fileNamePt);
 
 void parse_command(const struct dc_posix_env *env, struct dc_error *err,
                    struct state *state, struct command *command)
 {
-    //if any out-of memory errors occur
-    // states->fatal_error = true;
-    // "./a.out < in.txt >> out.txt 2>>err.txt"
-
-    regmatch_t matches;
-    char *command_string;
-    wordexp_t exp;
+    // "./a.out < in.txt >> out.txt 2>>err.txt", redirections may come anywhere, even before the command
+    struct lexer lexer;
+    struct token token;
+    char **words;
+    size_t count;
+    size_t capacity;
 
-    command_string = dc_strdup(env, err, command->line);
+    //a command with no words keeps the exit code of its last command substitution, the same as sh
+    command->exit_code = 0;
+    capacity = INITIAL_WORD_CAPACITY;
+    count = 1;  //argv[0] is left NULL, it is set when the program is run
+    words = arena_calloc(env, err, command->arena, capacity, sizeof(char *));
     if (dc_error_has_error(err))
     {
         state->fatal_error = true;
+        return;
     }
-    find_reg_match(env, err, state, state->err_redirect_regex, &command->stderr_file, &matches, &command_string, &command->stderr_overwrite);
-    find_reg_match(env, err, state, state->out_redirect_regex, &command->stdout_file, &matches, &command_string, &command->stdout_overwrite);
-    find_reg_match(env, err, state, state->in_redirect_regex, &command->stdin_file, &matches, &command_string, NULL);
-    dc_wordexp(env, err, command_string, &exp, 0);
-    if (dc_error_has_no_error(err))
+
+    lexer_init(&lexer, command->line, dc_strlen(env, command->line));
+
+    while (dc_error_has_no_error(err) && next_token(&lexer, &token) != TOKEN_END)
     {
-        command->argc = exp.we_wordc;
+        struct token redirect;
 
-        command->argv = dc_calloc(env, err, exp.we_wordc + 2, sizeof (char *));
-        if (dc_error_has_error(err))
+        switch (token.type)
         {
-            state->fatal_error = true;
-        }
-        for (size_t i = 1; i < exp.we_wordc; i++)
-        {
-            command->argv[i] = dc_strdup(env, err, exp.we_wordv[i]);
+            case TOKEN_WORD:
+                add_words(env, err, state, &command->exit_code, command->arena, &token, &words, &count, &capacity);
+                break;
+            case TOKEN_REDIRECT_IN:
+            case TOKEN_REDIRECT_OUT:
+            case TOKEN_REDIRECT_OUT_APPEND:
+            case TOKEN_REDIRECT_ERR:
+            case TOKEN_REDIRECT_ERR_APPEND:
+                redirect = token;
+                if (next_token(&lexer, &token) != TOKEN_WORD)
+                {
+                    DC_ERROR_RAISE_USER(err, "syntax error: missing file name for redirection", EINVAL);
+                    break;
+                }
+
+                if (redirect.type == TOKEN_REDIRECT_IN)
+                {
+                    set_redirect(env, err, state, &command->exit_code, command->arena, &token, &command->stdin_file);
+                }
+                else if (redirect.type == TOKEN_REDIRECT_OUT || redirect.type == TOKEN_REDIRECT_OUT_APPEND)
+                {
+                    set_redirect(env, err, state, &command->exit_code, command->arena, &token, &command->stdout_file);
+                    command->stdout_overwrite = redirect.type == TOKEN_REDIRECT_OUT;
+                }
+                else
+                {
+                    set_redirect(env, err, state, &command->exit_code, command->arena, &token, &command->stderr_file);
+                    command->stderr_overwrite = redirect.type == TOKEN_REDIRECT_ERR;
+                }
+                break;
+            case TOKEN_PIPE:
+            case TOKEN_BACKGROUND:
+            case TOKEN_SEMICOLON:
+            case TOKEN_AND:
+            case TOKEN_OR:
+            case TOKEN_ERROR:
+            case TOKEN_END:
+            default:
+                //separate_commands splits the pipeline and rejects unclosed quotes before the commands are parsed
+                DC_ERROR_RAISE_USER(err, "syntax error", EINVAL);
+                break;
         }
-        command->argv[exp.we_wordc] = NULL;
-        command->command = dc_strdup(env, err, exp.we_wordv[0]);
-        if (dc_error_has_error(err))
+    }
+
+    if (dc_error_has_error(err))
+    {
+        if (err->errno_code == ENOMEM)
         {
             state->fatal_error = true;
         }
+        command->argc = count;
+        command->argv = words;
+        return;
+    }
+
+    //the words may have expanded to nothing, then there is no command to run
+    command->command = words[1];
+    if (command->command != NULL)
+    {
+        dc_memmove(env, &words[1], &words[2], (count - 1) * sizeof(char *));
+        count--;
+    }
+    else
+    {
+        count = 0;
     }
+    command->argc = count;
+    command->argv = words;
+    command->argv[count] = NULL;
 }
 
+static void add_words(const struct dc_posix_env *env, struct dc_error *err, const struct state *state,
+                      int *exit_code, struct arena *arena, const struct token *token, char ***words, size_t *count,
+                      size_t *capacity)
+{
+    if (token->plain)
+    {
+        append_word(env, err, arena, arena_strndup(env, err, arena, token->text, token->length), words, count,
+                    capacity);
+        return;
+    }
+
+    expand_word(env, err, token->text, token->length, EXPAND_ALL, state->options, exit_code, arena, words, count,
+                capacity);
+}
 
-static void find_reg_match(const struct dc_posix_env *env, struct dc_error *err, struct state* state, regex_t * reg, char** fileNamePt,
-                           regmatch_t *matches, char **command_stringPt, bool *overwritePt)
+static void set_redirect(const struct dc_posix_env *env, struct dc_error *err, const struct state *state,
+                         int *exit_code, struct arena *arena, const struct token *token, char **fileNamePt)
 {
-    char *redirection;
-    int matched;
-    char *command_string;
+    char **words;
+    size_t count;
+    size_t capacity;
 
-    command_string = (char *)*command_stringPt;
+    //the last redirection of a stream wins, an earlier one in the arena is simply forgotten
+    if (arena == NULL)
+    {
+        free_char(env, fileNamePt);
+    }
+    *fileNamePt = NULL;
 
-    matched = regexec(reg, command_string, 1 , matches, REG_EXTENDED);
-    if (matched == 0)
+    if (token->plain)
     {
-        char *str;
-        regoff_t length;
-        char *temp;
-        wordexp_t exp;
-
-        length = (*matches).rm_eo - (*matches).rm_so;
-        str = dc_malloc(env, err, (size_t) (length + 1));
-        temp = NULL;
-        if (dc_error_has_error(err))
-        {
-            state->fatal_error = true;
-        }
-        dc_strncpy(env, str, &command_string[(*matches).rm_so], (size_t) length);
-        command_string[(*matches).rm_so] = '\0';
-        str[length] = '\0';
+        *fileNamePt = arena_strndup(env, err, arena, token->text, token->length);
+        return;
+    }
 
-        if ((redirection = dc_strstr(env, str, ">>")) != NULL)
-        {
-            if (overwritePt)
-            {
-//                *overwritePt = true;                //this part was true in the cgreen test case.
-            }
-            temp = dc_strdup(env, err, &redirection[2]);
-            if (dc_error_has_error(err))
-            {
-                state->fatal_error = true;
-            }
-        }
-        else if ((redirection = dc_strstr(env, str, ">")) != NULL)
-        {
-            if (overwritePt)
-            {
-                *overwritePt = true;                //this was true in the testing screen shots.
-            }
-
-            //then there is only 2>
-            temp = dc_strdup(env, err, &redirection[1]);
-            if (dc_error_has_error(err))
-            {
-                state->fatal_error = true;
-            }
-        }
-        else if ((redirection = dc_strstr(env, str, "<")) != NULL)
-        {
-            temp = dc_strdup(env, err, &redirection[1]);
-            if (dc_error_has_error(err))
-            {
-                state->fatal_error = true;
-            }
-        }
-        else
-        {
-            temp = dc_strdup(env, err, str);
-            if (dc_error_has_error(err))
-            {
-                state->fatal_error = true;
-            }
-        }
-        dc_str_trim(env, temp);
-        dc_wordexp(env, err, temp, &exp, 0);
-        *fileNamePt = dc_strdup(env, err, exp.we_wordv[0]);
-        if (dc_error_has_error(err)) {
-            state->fatal_error = true;
-        }
-        dc_free(env, temp, sizeof (temp));
-        dc_free(env, str, sizeof (str));
-        dc_wordfree(env, &exp);
+    words = NULL;
+    count = 0;
+    capacity = 0;
+
+    //the file name is not split, but a pattern has to match exactly one file
+    expand_word(env, err, token->text, token->length, EXPAND_ALL & ~EXPAND_FIELDS, state->options, exit_code, arena,
+                &words, &count, &capacity);
+
+    if (dc_error_has_no_error(err) && count != 1)
+    {
+        DC_ERROR_RAISE_USER(err, "ambiguous redirect", EINVAL);
+    }
+
+    if (dc_error_has_no_error(err))
+    {
+        *fileNamePt = words[0];
+    }
+    else if (arena == NULL)
+    {
+        free_loops(env, &count, &words);
+    }
+
+    if (words != NULL && arena == NULL)
+    {
+        dc_free(env, words, capacity * sizeof(char *));
     }
 }
 
 void destroy_command(const struct dc_posix_env *env, struct command *command)
 {
+    //everything in an arena is freed at once when the arena is reset (see do_reset_state)
+    if (command->arena == NULL)
+    {
+        free_char(env, &command->line);
+        free_char(env, &command->command);
+        if (command->argv != NULL)
+        {
+            size_t argc;
+
+            argc = command->argc;
+            free_loops(env, &command->argc, &command->argv);
+            dc_free(env, command->argv, (argc + 1) * sizeof(char *));
+        }
+        free_char(env, &command->stdin_file);
+        free_char(env, &command->stdout_file);
+        free_char(env, &command->stderr_file);
+    }
 
-    free_char(env, &command->line);
-    free_char(env, &command->command);
-    free_loops(env, &command->argc, &command->argv);
-    dc_free(env, command->argv, command->argc * sizeof(char*) + 1);
+    command->line = NULL;
+    command->command = NULL;
+    command->resolved_path = NULL;
+    command->argc = 0;
     command->argv = NULL;
-    free_char(env, &command->stdin_file);
-    free_char(env, &command->stdout_file);
+    command->stdin_file = NULL;
+    command->stdout_file = NULL;
     command->stdout_overwrite = false;
-    free_char(env, &command->stderr_file);
+    command->stderr_file = NULL;
     command->stderr_overwrite = false;
     command->exit_code = 0;
+    command->started = 0;
+    dc_memset(env, &command->usage, 0, sizeof(struct command_usage));
+    dc_memset(env, &command->limits, 0, sizeof(struct command_limits));
 }
 
 static void free_loops(const struct dc_posix_env *env, size_t *argc, char*** argv)
@@ -194,7 +273,7 @@ static void free_char(const struct dc_posix_env *env, char **target)
 
     if (targetPt)
     {
-        dc_free(env, targetPt, dc_strlen(env, targetPt));
+        dc_free(env, targetPt, dc_strlen(env, targetPt) + 1);
         *target = NULL;
     }
 }
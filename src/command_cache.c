@@ -0,0 +1,376 @@
+#include "../include/command_cache.h"
+#include "../include/arena.h"
+#include <dc_posix/dc_stdlib.h>
+#include <dc_posix/dc_string.h>
+
+#define ENTRY_ARENA_SIZE 512
+
+/**
+ * FNV-1a hash of a line.
+ *
+ * @param line the line (not '\0' terminated).
+ * @param length the length of the line.
+ * @return the hash value.
+ */
+static uint64_t hash_line(const char *line, size_t length);
+
+/**
+ * Find the entry of a line.
+ *
+ * @param env the posix environment.
+ * @param cache the command cache.
+ * @param hash the hash of the line.
+ * @param line the line.
+ * @param length the length of the line.
+ * @return the entry, or NULL if the line is not in the cache.
+ */
+static struct command_cache_entry *find_entry(const struct dc_posix_env *env, const struct command_cache *cache,
+                                              uint64_t hash, const char *line, size_t length);
+
+/**
+ * Copy commands, with their words and file names, in to an arena.
+ * The exit codes and resolved paths are not copied, they belong to a run of the commands.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param arena where the copies are allocated.
+ * @param commands the commands to copy.
+ * @param count the number of commands.
+ * @return the copies, or NULL if they could not be allocated.
+ */
+static struct command *copy_commands(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena,
+                                     const struct command *commands, size_t count);
+
+/**
+ * Copy a string in to an arena, NULL stays NULL.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param arena where the copy is allocated.
+ * @param str the string, or NULL.
+ * @return the copy, or NULL.
+ */
+static char *copy_string(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena, const char *str);
+
+/**
+ * Make an entry the most recently used one.
+ *
+ * @param cache the command cache.
+ * @param entry the entry, not in the list.
+ */
+static void push_newest(struct command_cache *cache, struct command_cache_entry *entry);
+
+/**
+ * Take an entry out of the list of most recently used entries.
+ *
+ * @param cache the command cache.
+ * @param entry the entry, in the list.
+ */
+static void unlink_entry(struct command_cache *cache, struct command_cache_entry *entry);
+
+/**
+ * Remove an entry from the cache and free it.
+ *
+ * @param env the posix environment.
+ * @param cache the command cache.
+ * @param entry the entry to remove.
+ */
+static void remove_entry(const struct dc_posix_env *env, struct command_cache *cache,
+                         struct command_cache_entry *entry);
+
+struct command_cache *command_cache_create(const struct dc_posix_env *env, struct dc_error *err, size_t capacity)
+{
+    struct command_cache *cache;
+
+    cache = dc_calloc(env, err, 1, sizeof(struct command_cache));
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    //twice as many buckets as entries keeps the chains short
+    cache->bucket_count = 1;
+    while (cache->bucket_count < capacity * 2)
+    {
+        cache->bucket_count *= 2;
+    }
+
+    cache->buckets = dc_calloc(env, err, cache->bucket_count, sizeof(struct command_cache_entry *));
+    if (dc_error_has_error(err))
+    {
+        dc_free(env, cache, sizeof(struct command_cache));
+        return NULL;
+    }
+
+    cache->capacity = capacity;
+
+    return cache;
+}
+
+void command_cache_destroy(const struct dc_posix_env *env, struct command_cache **pcache)
+{
+    struct command_cache *cache;
+
+    cache = *pcache;
+    if (cache == NULL)
+    {
+        return;
+    }
+
+    while (cache->oldest != NULL)
+    {
+        remove_entry(env, cache, cache->oldest);
+    }
+
+    dc_free(env, cache->buckets, cache->bucket_count * sizeof(struct command_cache_entry *));
+    dc_free(env, cache, sizeof(struct command_cache));
+    *pcache = NULL;
+}
+
+bool command_cache_can_cache(const char *line, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        switch (line[i])
+        {
+            case '$':
+            case '`':
+            case '~':
+            case '*':
+            case '?':
+            case '[':
+                return false;
+            default:
+                break;
+        }
+    }
+
+    return true;
+}
+
+bool command_cache_get(const struct dc_posix_env *env, struct dc_error *err, struct command_cache *cache,
+                       const char *line, size_t length, struct arena *arena, struct command **commands,
+                       size_t *count)
+{
+    struct command_cache_entry *entry;
+
+    entry = find_entry(env, cache, hash_line(line, length), line, length);
+    if (entry == NULL)
+    {
+        cache->misses++;
+        return false;
+    }
+
+    *commands = copy_commands(env, err, arena, entry->commands, entry->count);
+    if (dc_error_has_error(err))
+    {
+        return false;
+    }
+
+    *count = entry->count;
+    cache->hits++;
+    unlink_entry(cache, entry);
+    push_newest(cache, entry);
+
+    return true;
+}
+
+void command_cache_put(const struct dc_posix_env *env, struct dc_error *err, struct command_cache *cache,
+                       const char *line, size_t length, const struct command *commands, size_t count)
+{
+    struct command_cache_entry *entry;
+    uint64_t hash;
+    size_t bucket;
+
+    hash = hash_line(line, length);
+    if (cache->capacity == 0 || find_entry(env, cache, hash, line, length) != NULL)
+    {
+        return;
+    }
+
+    if (cache->count == cache->capacity)
+    {
+        remove_entry(env, cache, cache->oldest);
+    }
+
+    entry = dc_calloc(env, err, 1, sizeof(struct command_cache_entry));
+    if (dc_error_has_error(err))
+    {
+        return;
+    }
+
+    entry->arena = arena_create(env, err, ENTRY_ARENA_SIZE);
+    if (dc_error_has_no_error(err))
+    {
+        entry->line = arena_strndup(env, err, entry->arena, line, length);
+    }
+
+    if (dc_error_has_no_error(err))
+    {
+        entry->commands = copy_commands(env, err, entry->arena, commands, count);
+    }
+
+    if (dc_error_has_error(err))
+    {
+        arena_destroy(env, &entry->arena);
+        dc_free(env, entry, sizeof(struct command_cache_entry));
+        return;
+    }
+
+    entry->hash = hash;
+    entry->length = length;
+    entry->count = count;
+
+    bucket = (size_t)(hash & (cache->bucket_count - 1));
+    entry->next = cache->buckets[bucket];
+    cache->buckets[bucket] = entry;
+    push_newest(cache, entry);
+    cache->count++;
+}
+
+static uint64_t hash_line(const char *line, size_t length)
+{
+    uint64_t value;
+
+    value = 14695981039346656037ULL;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        value ^= (unsigned char)line[i];
+        value *= 1099511628211ULL;
+    }
+
+    return value;
+}
+
+static struct command_cache_entry *find_entry(const struct dc_posix_env *env, const struct command_cache *cache,
+                                              uint64_t hash, const char *line, size_t length)
+{
+    struct command_cache_entry *entry;
+
+    entry = cache->buckets[hash & (cache->bucket_count - 1)];
+
+    for (; entry != NULL; entry = entry->next)
+    {
+        if (entry->hash == hash && entry->length == length && dc_memcmp(env, entry->line, line, length) == 0)
+        {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+static struct command *copy_commands(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena,
+                                     const struct command *commands, size_t count)
+{
+    struct command *copies;
+
+    copies = arena_calloc(env, err, arena, count, sizeof(struct command));
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < count && dc_error_has_no_error(err); i++)
+    {
+        const struct command *command;
+        struct command *copy;
+
+        command = &commands[i];
+        copy = &copies[i];
+        copy->arena = arena;
+        copy->line = copy_string(env, err, arena, command->line);
+        copy->command = copy_string(env, err, arena, command->command);
+        copy->resolved_path = NULL;
+        copy->stdin_file = copy_string(env, err, arena, command->stdin_file);
+        copy->stdout_file = copy_string(env, err, arena, command->stdout_file);
+        copy->stdout_overwrite = command->stdout_overwrite;
+        copy->stderr_file = copy_string(env, err, arena, command->stderr_file);
+        copy->stderr_overwrite = command->stderr_overwrite;
+        copy->exit_code = 0;
+        copy->connector = command->connector;
+        copy->argc = command->argc;
+
+        //argv[0] is NULL and argv[argc] is NULL, the same as parse_command leaves it
+        copy->argv = arena_calloc(env, err, arena, command->argc + 1, sizeof(char *));
+        for (size_t arg = 1; arg < command->argc && dc_error_has_no_error(err); arg++)
+        {
+            copy->argv[arg] = copy_string(env, err, arena, command->argv[arg]);
+        }
+    }
+
+    return dc_error_has_error(err) ? NULL : copies;
+}
+
+static char *copy_string(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena, const char *str)
+{
+    if (str == NULL || dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    return arena_strndup(env, err, arena, str, dc_strlen(env, str));
+}
+
+static void push_newest(struct command_cache *cache, struct command_cache_entry *entry)
+{
+    entry->newer = NULL;
+    entry->older = cache->newest;
+
+    if (cache->newest != NULL)
+    {
+        cache->newest->newer = entry;
+    }
+
+    cache->newest = entry;
+
+    if (cache->oldest == NULL)
+    {
+        cache->oldest = entry;
+    }
+}
+
+static void unlink_entry(struct command_cache *cache, struct command_cache_entry *entry)
+{
+    if (entry->newer != NULL)
+    {
+        entry->newer->older = entry->older;
+    }
+    else
+    {
+        cache->newest = entry->older;
+    }
+
+    if (entry->older != NULL)
+    {
+        entry->older->newer = entry->newer;
+    }
+    else
+    {
+        cache->oldest = entry->newer;
+    }
+
+    entry->newer = NULL;
+    entry->older = NULL;
+}
+
+static void remove_entry(const struct dc_posix_env *env, struct command_cache *cache,
+                         struct command_cache_entry *entry)
+{
+    struct command_cache_entry **link;
+
+    for (link = &cache->buckets[entry->hash & (cache->bucket_count - 1)]; *link != NULL; link = &(*link)->next)
+    {
+        if (*link == entry)
+        {
+            *link = entry->next;
+            break;
+        }
+    }
+
+    unlink_entry(cache, entry);
+    arena_destroy(env, &entry->arena);
+    dc_free(env, entry, sizeof(struct command_cache_entry));
+    cache->count--;
+}
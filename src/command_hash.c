@@ -0,0 +1,377 @@
+#include "../include/command_hash.h"
+#include <dc_posix/dc_stdlib.h>
+#include <dc_posix/dc_string.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define INITIAL_BUCKET_COUNT 64
+
+/**
+ * FNV-1a hash of a string.
+ *
+ * @param str the string to hash.
+ * @return the hash value.
+ */
+static uint64_t hash_string(const char *str);
+
+/**
+ * Drop every entry if the PATH environ var is not the one the entries were found with.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param hash the command hash.
+ */
+static void check_path_var(const struct dc_posix_env *env, struct dc_error *err, struct command_hash *hash);
+
+/**
+ * Is the directory the entry was found in unchanged since the entry was added.
+ *
+ * @param entry the entry to check.
+ * @return true if the entry can still be used.
+ */
+static bool entry_is_valid(const struct command_hash_entry *entry);
+
+/**
+ * Search the path directories for an executable regular file and add it to the hash.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param hash the command hash.
+ * @param name the command to find.
+ * @param path the directories to search.
+ * @return the new entry or NULL if the command was not found.
+ */
+static struct command_hash_entry *add_entry(const struct dc_posix_env *env, struct dc_error *err,
+                                            struct command_hash *hash, const char *name, char **path);
+
+/**
+ * Double the number of buckets and move the entries in to them.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param hash the command hash.
+ */
+static void grow(const struct dc_posix_env *env, struct dc_error *err, struct command_hash *hash);
+
+/**
+ * Free an entry and its strings.
+ *
+ * @param env the posix environment.
+ * @param entry the entry to free.
+ */
+static void free_entry(const struct dc_posix_env *env, struct command_hash_entry *entry);
+
+struct command_hash *command_hash_create(const struct dc_posix_env *env, struct dc_error *err)
+{
+    struct command_hash *hash;
+
+    hash = dc_calloc(env, err, 1, sizeof(struct command_hash));
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    hash->bucket_count = INITIAL_BUCKET_COUNT;
+    hash->buckets = dc_calloc(env, err, hash->bucket_count, sizeof(struct command_hash_entry *));
+    if (dc_error_has_error(err))
+    {
+        dc_free(env, hash, sizeof(struct command_hash));
+        return NULL;
+    }
+
+    hash->count = 0;
+    hash->path_var = NULL;
+
+    return hash;
+}
+
+void command_hash_destroy(const struct dc_posix_env *env, struct command_hash **phash)
+{
+    struct command_hash *hash;
+
+    hash = *phash;
+    if (hash == NULL)
+    {
+        return;
+    }
+
+    command_hash_clear(env, hash);
+    dc_free(env, hash->buckets, hash->bucket_count * sizeof(struct command_hash_entry *));
+
+    if (hash->path_var != NULL)
+    {
+        dc_free(env, hash->path_var, dc_strlen(env, hash->path_var) + 1);
+    }
+
+    dc_free(env, hash, sizeof(struct command_hash));
+    *phash = NULL;
+}
+
+void command_hash_clear(const struct dc_posix_env *env, struct command_hash *hash)
+{
+    for (size_t i = 0; i < hash->bucket_count; i++)
+    {
+        struct command_hash_entry *entry;
+
+        entry = hash->buckets[i];
+        while (entry != NULL)
+        {
+            struct command_hash_entry *next;
+
+            next = entry->next;
+            free_entry(env, entry);
+            entry = next;
+        }
+
+        hash->buckets[i] = NULL;
+    }
+
+    hash->count = 0;
+}
+
+const char *command_hash_lookup(const struct dc_posix_env *env, struct dc_error *err, struct command_hash *hash,
+                                const char *name, char **path)
+{
+    struct command_hash_entry **link;
+    struct command_hash_entry *entry;
+
+    check_path_var(env, err, hash);
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    link = &hash->buckets[hash_string(name) & (hash->bucket_count - 1)];
+    for (entry = *link; entry != NULL; link = &entry->next, entry = entry->next)
+    {
+        if (dc_strcmp(env, entry->name, name) == 0)
+        {
+            if (entry_is_valid(entry))
+            {
+                entry->hits++;
+                return entry->path;
+            }
+
+            //the directory changed, the command may have moved or been shadowed; search again
+            *link = entry->next;
+            free_entry(env, entry);
+            hash->count--;
+            break;
+        }
+    }
+
+    entry = add_entry(env, err, hash, name, path);
+    if (entry == NULL)
+    {
+        return NULL;
+    }
+
+    entry->hits++;
+
+    return entry->path;
+}
+
+void command_hash_print(const struct dc_posix_env *env, const struct command_hash *hash, FILE *stream)
+{
+    DC_TRACE(env);
+
+    if (hash->count == 0)
+    {
+        fprintf(stream, "hash table empty\n");
+        return;
+    }
+
+    fprintf(stream, "hits\tcommand\n");
+
+    for (size_t i = 0; i < hash->bucket_count; i++)
+    {
+        for (const struct command_hash_entry *entry = hash->buckets[i]; entry != NULL; entry = entry->next)
+        {
+            fprintf(stream, "%4zu\t%s\n", entry->hits, entry->path);
+        }
+    }
+}
+
+static uint64_t hash_string(const char *str)
+{
+    uint64_t value;
+
+    value = 14695981039346656037ULL;
+
+    for (const unsigned char *c = (const unsigned char *)str; *c; c++)
+    {
+        value ^= *c;
+        value *= 1099511628211ULL;
+    }
+
+    return value;
+}
+
+static void check_path_var(const struct dc_posix_env *env, struct dc_error *err, struct command_hash *hash)
+{
+    const char *path_var;
+
+    path_var = dc_getenv(env, "PATH");
+    if (path_var == NULL)
+    {
+        path_var = "";
+    }
+
+    if (hash->path_var != NULL && dc_strcmp(env, hash->path_var, path_var) == 0)
+    {
+        return;
+    }
+
+    command_hash_clear(env, hash);
+
+    if (hash->path_var != NULL)
+    {
+        dc_free(env, hash->path_var, dc_strlen(env, hash->path_var) + 1);
+    }
+
+    hash->path_var = dc_strdup(env, err, path_var);
+}
+
+static bool entry_is_valid(const struct command_hash_entry *entry)
+{
+    struct stat dir_info;
+
+    if (stat(entry->dir, &dir_info) != 0)
+    {
+        return false;
+    }
+
+    return dir_info.st_mtim.tv_sec == entry->dir_mtime.tv_sec && dir_info.st_mtim.tv_nsec == entry->dir_mtime.tv_nsec;
+}
+
+static struct command_hash_entry *add_entry(const struct dc_posix_env *env, struct dc_error *err,
+                                            struct command_hash *hash, const char *name, char **path)
+{
+    struct command_hash_entry *entry;
+    size_t name_length;
+    size_t bucket;
+
+    if (path == NULL)
+    {
+        return NULL;
+    }
+
+    name_length = dc_strlen(env, name);
+
+    for (size_t i = 0; path[i]; i++)
+    {
+        struct stat file_info;
+        struct stat dir_info;
+        size_t dir_length;
+        char *candidate;
+
+        dir_length = dc_strlen(env, path[i]);
+        candidate = dc_malloc(env, err, dir_length + 1 + name_length + 1);
+        if (dc_error_has_error(err))
+        {
+            return NULL;
+        }
+
+        dc_memcpy(env, candidate, path[i], dir_length);
+        candidate[dir_length] = '/';
+        dc_memcpy(env, &candidate[dir_length + 1], name, name_length + 1);
+
+        if (stat(candidate, &file_info) != 0 || !S_ISREG(file_info.st_mode) || access(candidate, X_OK) != 0 ||
+            stat(path[i], &dir_info) != 0)
+        {
+            dc_free(env, candidate, dir_length + 1 + name_length + 1);
+            continue;
+        }
+
+        if (hash->count >= hash->bucket_count)
+        {
+            grow(env, err, hash);
+        }
+
+        entry = dc_calloc(env, err, 1, sizeof(struct command_hash_entry));
+        if (dc_error_has_error(err))
+        {
+            dc_free(env, candidate, dir_length + 1 + name_length + 1);
+            return NULL;
+        }
+
+        entry->name = dc_strdup(env, err, name);
+        entry->dir = dc_strdup(env, err, path[i]);
+        entry->path = candidate;
+        entry->dir_mtime = dir_info.st_mtim;
+        entry->hits = 0;
+
+        if (dc_error_has_error(err))
+        {
+            free_entry(env, entry);
+            return NULL;
+        }
+
+        bucket = hash_string(name) & (hash->bucket_count - 1);
+        entry->next = hash->buckets[bucket];
+        hash->buckets[bucket] = entry;
+        hash->count++;
+
+        return entry;
+    }
+
+    return NULL;
+}
+
+static void grow(const struct dc_posix_env *env, struct dc_error *err, struct command_hash *hash)
+{
+    struct command_hash_entry **buckets;
+    size_t bucket_count;
+
+    bucket_count = hash->bucket_count * 2;
+    buckets = dc_calloc(env, err, bucket_count, sizeof(struct command_hash_entry *));
+    if (dc_error_has_error(err))
+    {
+        //not fatal, the chains just get longer
+        dc_error_reset(err);
+        return;
+    }
+
+    for (size_t i = 0; i < hash->bucket_count; i++)
+    {
+        struct command_hash_entry *entry;
+
+        entry = hash->buckets[i];
+        while (entry != NULL)
+        {
+            struct command_hash_entry *next;
+            size_t bucket;
+
+            next = entry->next;
+            bucket = hash_string(entry->name) & (bucket_count - 1);
+            entry->next = buckets[bucket];
+            buckets[bucket] = entry;
+            entry = next;
+        }
+    }
+
+    dc_free(env, hash->buckets, hash->bucket_count * sizeof(struct command_hash_entry *));
+    hash->buckets = buckets;
+    hash->bucket_count = bucket_count;
+}
+
+static void free_entry(const struct dc_posix_env *env, struct command_hash_entry *entry)
+{
+    if (entry->name != NULL)
+    {
+        dc_free(env, entry->name, dc_strlen(env, entry->name) + 1);
+    }
+
+    if (entry->path != NULL)
+    {
+        dc_free(env, entry->path, dc_strlen(env, entry->path) + 1);
+    }
+
+    if (entry->dir != NULL)
+    {
+        dc_free(env, entry->dir, dc_strlen(env, entry->dir) + 1);
+    }
+
+    dc_free(env, entry, sizeof(struct command_hash_entry));
+}
@@ -0,0 +1,379 @@
+#if defined(__linux__)
+//splice, tee and copy_file_range are Linux extensions, this has to come before any system header
+#define _GNU_SOURCE
+#endif
+
+#include "../include/copy.h"
+#include <dc_posix/dc_stdlib.h>
+#include <dc_posix/dc_string.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define COPY_CHUNK_SIZE (1024 * 1024)
+#define USER_BUFFER_SIZE (64 * 1024)
+#define TEE_FILE_MODE 0666
+
+/**
+ * cat the operands (or stdin when there are none) to stdout.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the cat command.
+ * @return the exit code, 1 if any operand could not be copied.
+ */
+static int run_cat(const struct dc_posix_env *env, struct dc_error *err, const struct command *command);
+
+/**
+ * tee stdin to stdout and the file operand, without the data leaving the kernel.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the tee command.
+ * @return the exit code, or -1 if stdin and stdout are not both pipes.
+ */
+static int run_tee(const struct dc_posix_env *env, struct dc_error *err, const struct command *command);
+
+/**
+ * Copy with splice (use_splice) or copy_file_range until end of file.
+ *
+ * @param err the error object
+ * @param in_fd the descriptor to read.
+ * @param out_fd the descriptor to write.
+ * @param use_splice true to splice (one side must be a pipe), false for copy_file_range (both regular files).
+ * @param total incremented by the number of bytes copied.
+ * @return false if the kernel cannot copy between the descriptors and nothing was copied.
+ */
+static bool kernel_copy(struct dc_error *err, int in_fd, int out_fd, bool use_splice, off_t *total);
+
+/**
+ * Copy with read and write until end of file.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param in_fd the descriptor to read.
+ * @param out_fd the descriptor to write.
+ * @return the number of bytes copied.
+ */
+static off_t user_copy(const struct dc_posix_env *env, struct dc_error *err, int in_fd, int out_fd);
+
+bool is_copy_command(const struct dc_posix_env *env, const struct command *command)
+{
+#if defined(__linux__)
+    if (command->command == NULL)
+    {
+        return false;
+    }
+
+    if (dc_strcmp(env, command->command, "cat") == 0)
+    {
+        //options, and "-" for stdin, are left to the real cat
+        for (size_t i = 1; i < command->argc; i++)
+        {
+            if (command->argv[i][0] == '-')
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    //tee -a would need splice in to an O_APPEND file, which the kernel refuses
+    if (dc_strcmp(env, command->command, "tee") == 0)
+    {
+        return command->argc == 2 && command->argv[1][0] != '-';
+    }
+
+    return false;
+#else
+    DC_TRACE(env);
+    (void)command;
+
+    return false;
+#endif
+}
+
+int run_copy_command(const struct dc_posix_env *env, struct dc_error *err, const struct command *command)
+{
+    if (dc_strcmp(env, command->command, "tee") == 0)
+    {
+        return run_tee(env, err, command);
+    }
+
+    return run_cat(env, err, command);
+}
+
+off_t copy_fd(const struct dc_posix_env *env, struct dc_error *err, int in_fd, int out_fd)
+{
+    struct stat in_info;
+    struct stat out_info;
+    off_t total;
+
+    DC_TRACE(env);
+    total = 0;
+
+    if (fstat(in_fd, &in_info) != 0 || fstat(out_fd, &out_info) != 0)
+    {
+        DC_ERROR_RAISE_ERRNO(err, errno);
+        return 0;
+    }
+
+#if defined(__linux__)
+    if (S_ISREG(in_info.st_mode) && S_ISREG(out_info.st_mode))
+    {
+        if (kernel_copy(err, in_fd, out_fd, false, &total))
+        {
+            return total;
+        }
+    }
+    else if (S_ISFIFO(in_info.st_mode) || S_ISFIFO(out_info.st_mode))
+    {
+        if (kernel_copy(err, in_fd, out_fd, true, &total))
+        {
+            return total;
+        }
+    }
+#endif
+
+    return total + user_copy(env, err, in_fd, out_fd);
+}
+
+static int run_cat(const struct dc_posix_env *env, struct dc_error *err, const struct command *command)
+{
+    int status;
+
+    if (command->argc < 2)
+    {
+        copy_fd(env, err, STDIN_FILENO, STDOUT_FILENO);
+        if (dc_error_has_error(err))
+        {
+            fprintf(stderr, "cat: -: %s\n", strerror(err->errno_code));
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+    status = EXIT_SUCCESS;
+
+    for (size_t i = 1; i < command->argc; i++)
+    {
+        int fd;
+
+        fd = open(command->argv[i], O_RDONLY);
+        if (fd == -1)
+        {
+            fprintf(stderr, "cat: %s: %s\n", command->argv[i], strerror(errno));
+            status = EXIT_FAILURE;
+            continue;
+        }
+
+        copy_fd(env, err, fd, STDOUT_FILENO);
+        if (dc_error_has_error(err))
+        {
+            fprintf(stderr, "cat: %s: %s\n", command->argv[i], strerror(err->errno_code));
+            dc_error_reset(err);
+            status = EXIT_FAILURE;
+        }
+
+        close(fd);
+    }
+
+    return status;
+}
+
+static int run_tee(const struct dc_posix_env *env, struct dc_error *err, const struct command *command)
+{
+#if defined(__linux__)
+    struct stat in_info;
+    struct stat out_info;
+    int status;
+    int fd;
+
+    DC_TRACE(env);
+
+    //tee(2) only works between two pipes, anything else is left to the real tee
+    if (fstat(STDIN_FILENO, &in_info) != 0 || fstat(STDOUT_FILENO, &out_info) != 0 ||
+        !S_ISFIFO(in_info.st_mode) || !S_ISFIFO(out_info.st_mode))
+    {
+        return -1;
+    }
+
+    fd = open(command->argv[1], O_WRONLY | O_CREAT | O_TRUNC, TEE_FILE_MODE);
+    if (fd == -1)
+    {
+        return -1;
+    }
+
+    status = EXIT_SUCCESS;
+
+    for (;;)
+    {
+        ssize_t duplicated;
+
+        //copy the pipe contents to stdout without consuming them, then move the same bytes in to the file
+        duplicated = tee(STDIN_FILENO, STDOUT_FILENO, COPY_CHUNK_SIZE, 0);
+        if (duplicated == -1 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (duplicated <= 0)
+        {
+            if (duplicated == -1)
+            {
+                DC_ERROR_RAISE_ERRNO(err, errno);
+                fprintf(stderr, "tee: %s\n", strerror(errno));
+                status = EXIT_FAILURE;
+            }
+            break;
+        }
+
+        while (duplicated > 0)
+        {
+            ssize_t moved;
+
+            moved = splice(STDIN_FILENO, NULL, fd, NULL, (size_t)duplicated, SPLICE_F_MOVE);
+            if (moved == -1 && errno == EINTR)
+            {
+                continue;
+            }
+
+            if (moved <= 0)
+            {
+                DC_ERROR_RAISE_ERRNO(err, errno);
+                fprintf(stderr, "tee: %s: %s\n", command->argv[1], strerror(errno));
+                close(fd);
+                return EXIT_FAILURE;
+            }
+
+            duplicated -= moved;
+        }
+    }
+
+    close(fd);
+
+    return status;
+#else
+    DC_TRACE(env);
+    (void)err;
+    (void)command;
+
+    return -1;
+#endif
+}
+
+static bool kernel_copy(struct dc_error *err, int in_fd, int out_fd, bool use_splice, off_t *total)
+{
+#if defined(__linux__)
+    for (;;)
+    {
+        ssize_t copied;
+
+        if (use_splice)
+        {
+            copied = splice(in_fd, NULL, out_fd, NULL, COPY_CHUNK_SIZE, SPLICE_F_MOVE | SPLICE_F_MORE);
+        }
+        else
+        {
+            copied = copy_file_range(in_fd, NULL, out_fd, NULL, COPY_CHUNK_SIZE, 0);
+        }
+
+        if (copied == 0)
+        {
+            return true;
+        }
+
+        if (copied == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            //e.g. an O_APPEND output, different file systems or an old kernel: let the caller read/write instead
+            if (*total == 0 &&
+                (errno == EINVAL || errno == EBADF || errno == EXDEV || errno == ENOSYS || errno == EOPNOTSUPP))
+            {
+                return false;
+            }
+
+            DC_ERROR_RAISE_ERRNO(err, errno);
+            return true;
+        }
+
+        *total += copied;
+    }
+#else
+    (void)err;
+    (void)in_fd;
+    (void)out_fd;
+    (void)use_splice;
+    (void)total;
+
+    return false;
+#endif
+}
+
+static off_t user_copy(const struct dc_posix_env *env, struct dc_error *err, int in_fd, int out_fd)
+{
+    char *buffer;
+    off_t total;
+
+    buffer = dc_malloc(env, err, USER_BUFFER_SIZE);
+    if (dc_error_has_error(err))
+    {
+        return 0;
+    }
+
+    total = 0;
+
+    for (;;)
+    {
+        ssize_t nread;
+        ssize_t offset;
+
+        nread = read(in_fd, buffer, USER_BUFFER_SIZE);
+        if (nread == -1 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (nread <= 0)
+        {
+            if (nread == -1)
+            {
+                DC_ERROR_RAISE_ERRNO(err, errno);
+            }
+            break;
+        }
+
+        for (offset = 0; offset < nread;)
+        {
+            ssize_t nwritten;
+
+            nwritten = write(out_fd, &buffer[offset], (size_t)(nread - offset));
+            if (nwritten == -1 && errno == EINTR)
+            {
+                continue;
+            }
+
+            if (nwritten == -1)
+            {
+                DC_ERROR_RAISE_ERRNO(err, errno);
+                dc_free(env, buffer, USER_BUFFER_SIZE);
+                return total;
+            }
+
+            offset += nwritten;
+        }
+
+        total += nread;
+    }
+
+    dc_free(env, buffer, USER_BUFFER_SIZE);
+
+    return total;
+}
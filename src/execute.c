@@ -2,13 +2,40 @@
 // Created by Giwoun Bae on 2022-01-18.
 //
 
+#if defined(__linux__)
+//wait4 is not POSIX, this has to come before any system header
+#define _DEFAULT_SOURCE
+#endif
+
 #include "../include/execute.h"
+#include "../include/copy.h"
+#include "../include/pool.h"
+#include "../include/stats.h"
+#include "../include/usage.h"
 #include <stdio.h>
 #include <dc_posix/dc_stdio.h>
 #include <dc_posix/dc_unistd.h>
 #include <dc_posix/dc_stdlib.h>
 #include <dc_posix/dc_string.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#endif
+
+#define REDIRECT_FILE_MODE 0666
+#define TIMEOUT_EXIT_CODE 124
+#define TIMEOUT_GRACE (2 * UINT64_C(1000000000))
+#define TIMEOUT_POLL_NS (10 * 1000 * 1000)
+
+extern char **environ;
 
 /**
  * Setup any I/O redirections for the process.
@@ -20,12 +47,123 @@
 static void redirect(const struct dc_posix_env* env, struct dc_error* err, struct command* command);
 
 /**
- * Display the error message when a process fails
+ * Convert the error from starting a process in to the exit code for the command.
  *
+ * @param errno_code the errno from exec (or posix_spawn).
+ * @return the exit code, 127 if the program was not found.
+ */
+static int handle_run_error(int errno_code);
+
+/**
+ * Start the command with fork: the redirections and path search are done in the child.
+ *
+ * @param env the posix environment.
  * @param err the err object
- * @return
+ * @param command the command to execute.
+ * @param path the array of PATH directories to search for the program.
+ * @param in_fd the descriptor to use as stdin, -1 to inherit it.
+ * @param out_fd the descriptor to use as stdout, -1 to inherit it.
+ * @return the pid of the child.
  */
-static int handle_run_error(struct dc_error* err);
+static pid_t fork_command(const struct dc_posix_env* env, struct dc_error* err, struct command* command, char** path,
+                          int in_fd, int out_fd);
+
+/**
+ * Start the command with posix_spawn. The redirect files are opened in the parent and
+ * dup'ed on to stdin/stdout/stderr with file actions. Requires the program to have been found already.
+ *
+ * @param env the posix environment.
+ * @param err the err object
+ * @param command the command to execute.
+ * @param program the path of the program to run.
+ * @param in_fd the descriptor to use as stdin, -1 to inherit it.
+ * @param out_fd the descriptor to use as stdout, -1 to inherit it.
+ * @return the pid of the child, or -1 if it could not be started (command->exit_code is set).
+ */
+static pid_t spawn_command(const struct dc_posix_env* env, struct dc_error* err, struct command* command,
+                           const char* program, int in_fd, int out_fd);
+
+/**
+ * Open a redirect file in the parent and add a file action to dup it on to target_fd.
+ *
+ * @param actions the file actions for posix_spawn.
+ * @param file_name the file to open.
+ * @param flags the flags to open the file with.
+ * @param target_fd the descriptor to replace in the child.
+ * @return the open descriptor (to be closed by the parent after the spawn), or -1 and errno is set.
+ */
+static int add_redirect(posix_spawn_file_actions_t* actions, const char* file_name, int flags, int target_fd);
+
+/**
+ * Create a pipe with both ends close-on-exec (pipe2 is not POSIX).
+ *
+ * @param fds set to the read and write ends.
+ * @return 0 on success, -1 and errno is set on failure.
+ */
+static int open_pipe(int fds[2]);
+
+/**
+ * Unblock SIGCHLD in a forked child, the job table blocks it in the shell (see job_table_create)
+ * and the programs that are exec'ed must not inherit that.
+ */
+static void unblock_child_signals(void);
+
+/**
+ * Set the soft resource limits of a forked child before it runs the program.
+ *
+ * @param limits the limits, the ones that are 0 are left as they are.
+ */
+static void set_limits(const struct command_limits *limits);
+
+/**
+ * Set one soft resource limit, it cannot go over the hard limit.
+ *
+ * @param resource the RLIMIT_ resource.
+ * @param value the limit.
+ */
+static void set_limit(int resource, uint64_t value);
+
+/**
+ * Does the command have a resource limit, posix_spawn has no way to set one in the child.
+ *
+ * @param command the command.
+ * @return true if one of the rlimits is set.
+ */
+static bool has_limits(const struct command *command);
+
+/**
+ * Wait until the child has exited or the deadline has passed, the child is not reaped.
+ * At the deadline it is sent SIGTERM, and SIGKILL if it is still running TIMEOUT_GRACE after that.
+ * The child is waited for with a pidfd and a timerfd on Linux, by polling elsewhere (or if they cannot be opened).
+ *
+ * @param env the posix environment.
+ * @param err the err object
+ * @param pid the child.
+ * @param deadline when the child has to be done by (see stats_now).
+ * @return true if the child was killed because it ran past the deadline.
+ */
+static bool wait_deadline(const struct dc_posix_env *env, struct dc_error *err, pid_t pid, uint64_t deadline);
+
+#if defined(__linux__)
+/**
+ * Wait with poll for a pidfd to say the child has exited, or a timerfd to say the deadline has passed.
+ *
+ * @param err the err object
+ * @param pid the child.
+ * @param deadline when the child has to be done by (see stats_now).
+ * @param killed set to true if the child was killed.
+ * @return false if the pidfd or timerfd could not be opened (nothing was waited for).
+ */
+static bool wait_deadline_fd(struct dc_error *err, pid_t pid, uint64_t deadline, bool *killed);
+
+/**
+ * Set a timerfd to go off at a time.
+ *
+ * @param timer the timerfd.
+ * @param when the time (see stats_now).
+ */
+static void set_timer(int timer, uint64_t when);
+#endif
 
 /**
  * Run a process.
@@ -41,46 +179,571 @@ void execute(const struct dc_posix_env *env, struct dc_error *err,
              struct command *command, char **path)
 {
     pid_t pid;
+
+    pid = launch(env, err, command, path, LAUNCHER_FORK, -1, -1);
+
+    if (pid > 0)
+    {
+        wait_for_command(env, err, command, pid);
+    }
+}
+
+pid_t launch(const struct dc_posix_env *env, struct dc_error *err, struct command *command, char **path,
+             enum launcher launcher, int in_fd, int out_fd)
+{
+    const char *program;
+
+    //every word expanded to nothing, there is no program to run (exit_code is the one parse_command left)
+    if (command->command == NULL)
+    {
+        return -1;
+    }
+
+    command->started = stats_now();
+    program = command->resolved_path;
+
+    if (program == NULL && dc_strchr(env, command->command, '/') != NULL)
+    {
+        program = command->command;
+    }
+
+    //a worker only execs, it needs a known program too.
+    if (launcher == LAUNCHER_POOL && program != NULL)
+    {
+        pid_t pid;
+
+        pid = worker_pool_launch(env, err, command, program, in_fd, out_fd);
+        if (pid > 0 || dc_error_has_error(err))
+        {
+            return pid;
+        }
+
+        //no worker was ready
+        launcher = LAUNCHER_SPAWN;
+    }
+
+    //posix_spawn cannot search our path, without a program to run fall back to fork.
+    //posix_spawn cannot set resource limits either, the forked child sets them before it runs the program.
+    //cat and tee are done by the forked child in the kernel, there is no program to spawn for them.
+    if (launcher == LAUNCHER_SPAWN && program != NULL && !has_limits(command) && !is_copy_command(env, command))
+    {
+        return spawn_command(env, err, command, program, in_fd, out_fd);
+    }
+
+    return fork_command(env, err, command, path, in_fd, out_fd);
+}
+
+void start_pipeline(const struct dc_posix_env *env, struct dc_error *err, struct command *commands, size_t count,
+                    char **path, enum launcher launcher, pid_t *pids)
+{
+    int in_fd;
+
+    DC_TRACE(env);
+    in_fd = -1;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        pids[i] = -1;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        int fds[2];
+        int out_fd;
+
+        fds[0] = -1;
+        out_fd = -1;
+
+        if (i + 1 < count)
+        {
+            //close-on-exec so each child only keeps the ends that were dup'ed on to its stdin/stdout
+            if (open_pipe(fds) == -1)
+            {
+                DC_ERROR_RAISE_ERRNO(err, errno);
+                break;
+            }
+
+            out_fd = fds[1];
+        }
+
+        pids[i] = launch(env, err, &commands[i], path, launcher, in_fd, out_fd);
+
+        //the parent must not hold on to the pipe ends or the readers never see end of file
+        if (in_fd != -1)
+        {
+            close(in_fd);
+        }
+
+        if (out_fd != -1)
+        {
+            close(out_fd);
+        }
+
+        in_fd = fds[0];
+
+        if (dc_error_has_error(err))
+        {
+            break;
+        }
+    }
+
+    if (in_fd != -1)
+    {
+        close(in_fd);
+    }
+
+    if (dc_error_has_error(err))
+    {
+        //nobody will wait for a pipeline that is only half started, reap it here so there are no zombies
+        for (size_t i = 0; i < count; i++)
+        {
+            if (pids[i] > 0)
+            {
+                struct dc_error wait_err;
+
+                dc_error_init(&wait_err, NULL);
+                wait_for_command(env, &wait_err, &commands[i], pids[i]);
+                dc_error_reset(&wait_err);
+                pids[i] = -1;
+            }
+        }
+    }
+}
+
+void execute_pipeline(const struct dc_posix_env *env, struct dc_error *err, struct command *commands, size_t count,
+                      char **path, enum launcher launcher)
+{
+    pid_t *pids;
+
+    DC_TRACE(env);
+    pids = dc_calloc(env, err, count, sizeof(pid_t));
+    if (dc_error_has_error(err))
+    {
+        return;
+    }
+
+    start_pipeline(env, err, commands, count, path, launcher, pids);
+
+    //reap everything that was started, even after an error, so there are no zombies
+    for (size_t i = 0; i < count; i++)
+    {
+        if (pids[i] > 0)
+        {
+            struct dc_error wait_err;
+
+            dc_error_init(&wait_err, NULL);
+            wait_for_command(env, dc_error_has_error(err) ? &wait_err : err, &commands[i], pids[i]);
+            dc_error_reset(&wait_err);
+        }
+    }
+
+    dc_free(env, pids, count * sizeof(pid_t));
+}
+
+void wait_for_command(const struct dc_posix_env *env, struct dc_error *err, struct command *command, pid_t pid)
+{
+    struct rusage usage;
+    bool timed_out;
     int status;
 
+    DC_TRACE(env);
+    timed_out = false;
+
+    //a runaway program must not hold up the rest of the script
+    if (command->limits.timeout > 0)
+    {
+        timed_out = wait_deadline(env, err, pid, command->started + command->limits.timeout);
+        if (dc_error_has_error(err))
+        {
+            return;
+        }
+    }
+
+    //the same as waitpid, and the kernel has the child's resources at hand so it costs nothing more
+    if (wait4(pid, &status, 0, &usage) == -1)
+    {
+        DC_ERROR_RAISE_ERRNO(err, errno);
+        return;
+    }
+
+    usage_set(&command->usage, &usage, stats_now() - command->started);
+
+    if (WIFEXITED(status))
+    {
+        int es = WEXITSTATUS(status);
+        command->exit_code = es;
+    }
+
+    //the same as timeout(1), whatever the program did when it was signalled
+    if (timed_out)
+    {
+        command->exit_code = TIMEOUT_EXIT_CODE;
+    }
+
+    if (command->exit_code == 127)
+    {
+        fprintf(stdout, "command: %s not found.\n", command->command);
+    }
+}
+
+static pid_t fork_command(const struct dc_posix_env* env, struct dc_error* err, struct command* command, char** path,
+                          int in_fd, int out_fd)
+{
+    pid_t pid;
+
+    //anything still buffered would be written a second time when the child exits without exec'ing
+    fflush(NULL);
     pid = dc_fork(env, err);
+
+    if (dc_error_has_no_error(err) && pid == 0)
+    {
+        exec_command(env, err, command, path, in_fd, out_fd);
+    }
+
+    return pid;
+}
+
+void exec_command(const struct dc_posix_env *env, struct dc_error *err, struct command *command, char **path,
+                  int in_fd, int out_fd)
+{
+    int status;
+
     status = command->exit_code;
+    unblock_child_signals();
+    set_limits(&command->limits);
+
+    if (in_fd != -1)
+    {
+        dc_dup2(env, err, in_fd, STDIN_FILENO);
+    }
+
+    if (out_fd != -1 && dc_error_has_no_error(err))
+    {
+        dc_dup2(env, err, out_fd, STDOUT_FILENO);
+    }
 
     if (dc_error_has_no_error(err))
     {
-        if (pid == 0)
+        redirect(env, err, command);
+    }
+    if (dc_error_has_error(err))
+    {
+        dc_exit(env, err->err_code);
+    }
+
+    if (is_copy_command(env, command))
+    {
+        //copy straight from the redirected stdin/files to stdout with splice/copy_file_range/tee
+        status = run_copy_command(env, err, command);
+        if (status != -1)
         {
-            redirect(env, err, command);
-            if (dc_error_has_error(err))
-            {
-                dc_exit(env, err->err_code);
-            }
-            //call run() -> this only returns if there is an error calling execv.
-            run(env, err, command, path);
-            //am I calling the execv in this function too? I'm guessing not.
-            if  (dc_error_has_error(err))
+            dc_exit(env, status);
+        }
+
+        status = command->exit_code;
+        dc_error_reset(err);
+    }
+
+    //call run() -> this only returns if there is an error calling execv.
+    run(env, err, command, path);
+    if  (dc_error_has_error(err))
+    {
+        status = handle_run_error(err->errno_code);
+    }
+    dc_exit(env, status);
+}
+
+static pid_t spawn_command(const struct dc_posix_env* env, struct dc_error* err, struct command* command,
+                           const char* program, int in_fd, int out_fd)
+{
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attributes;
+    sigset_t mask;
+    int fds[3];
+    int result;
+    pid_t pid;
+
+    DC_TRACE(env);
+    posix_spawn_file_actions_init(&actions);
+    posix_spawnattr_init(&attributes);
+    fds[0] = -1;
+    fds[1] = -1;
+    fds[2] = -1;
+    pid = -1;
+    result = 0;
+
+    //the program gets the signal mask without the SIGCHLD the job table blocks (see unblock_child_signals)
+    sigprocmask(SIG_BLOCK, NULL, &mask);
+    if (sigismember(&mask, SIGCHLD))
+    {
+        sigdelset(&mask, SIGCHLD);
+        posix_spawnattr_setsigmask(&attributes, &mask);
+        posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGMASK);
+    }
+
+    //the pipe ends first, the file actions run in order so the redirect files replace them
+    if (in_fd != -1)
+    {
+        posix_spawn_file_actions_adddup2(&actions, in_fd, STDIN_FILENO);
+    }
+
+    if (out_fd != -1)
+    {
+        posix_spawn_file_actions_adddup2(&actions, out_fd, STDOUT_FILENO);
+    }
+
+    if (command->stdin_file != NULL)
+    {
+        fds[0] = add_redirect(&actions, command->stdin_file, O_RDONLY, STDIN_FILENO);
+        result = fds[0] == -1 ? errno : 0;
+    }
+
+    if (result == 0 && command->stdout_file != NULL)
+    {
+        fds[1] = add_redirect(&actions, command->stdout_file,
+                              O_WRONLY | O_CREAT | (command->stdout_overwrite ? O_TRUNC : O_APPEND), STDOUT_FILENO);
+        result = fds[1] == -1 ? errno : 0;
+    }
+
+    if (result == 0 && command->stderr_file != NULL)
+    {
+        fds[2] = add_redirect(&actions, command->stderr_file,
+                              O_WRONLY | O_CREAT | (command->stderr_overwrite ? O_TRUNC : O_APPEND), STDERR_FILENO);
+        result = fds[2] == -1 ? errno : 0;
+    }
+
+    if (result != 0)
+    {
+        //the same as a redirect failing in the child of fork_command
+        fprintf(stderr, "%s: %s\n", command->command, strerror(result));
+        command->exit_code = EXIT_FAILURE;
+    }
+    else
+    {
+        //argv[0] is left NULL by parse_command, the child gets the name as typed
+        command->argv[0] = command->command;
+        result = posix_spawn(&pid, program, &actions, &attributes, command->argv, environ);
+        command->argv[0] = NULL;
+
+        if (result != 0)
+        {
+            pid = -1;
+            command->exit_code = handle_run_error(result);
+
+            if (command->exit_code == 127)
             {
-                status = handle_run_error(err);
+                fprintf(stdout, "command: %s not found.\n", command->command);
             }
-            dc_exit(env, status);
         }
-        else
+    }
+
+    for (size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); i++)
+    {
+        if (fds[i] != -1)
         {
-            // Main process
-            waitpid(pid, &status, 0);
+            dc_close(env, err, fds[i]);
+        }
+    }
+
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attributes);
+
+    return pid;
+}
+
+static void unblock_child_signals(void)
+{
+    sigset_t mask;
+
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigprocmask(SIG_UNBLOCK, &mask, NULL);
+}
+
+static void set_limits(const struct command_limits *limits)
+{
+    set_limit(RLIMIT_CPU, limits->cpu);
+    set_limit(RLIMIT_AS, limits->address_space);
+    set_limit(RLIMIT_NOFILE, limits->open_files);
+}
+
+static void set_limit(int resource, uint64_t value)
+{
+    struct rlimit limit;
+
+    if (value == 0 || getrlimit(resource, &limit) == -1)
+    {
+        return;
+    }
+
+    limit.rlim_cur = (rlim_t)value;
+    if (limit.rlim_max != RLIM_INFINITY && limit.rlim_cur > limit.rlim_max)
+    {
+        limit.rlim_cur = limit.rlim_max;
+    }
+
+    setrlimit(resource, &limit);
+}
+
+static bool has_limits(const struct command *command)
+{
+    return command->limits.cpu > 0 || command->limits.address_space > 0 || command->limits.open_files > 0;
+}
+
+static bool wait_deadline(const struct dc_posix_env *env, struct dc_error *err, pid_t pid, uint64_t deadline)
+{
+    bool killed;
+
+    DC_TRACE(env);
+    killed = false;
+
+#if defined(__linux__)
+    if (wait_deadline_fd(err, pid, deadline, &killed))
+    {
+        return killed;
+    }
+#endif
+
+    //WNOWAIT leaves the child for wait_for_command to reap
+    while (true)
+    {
+        struct timespec delay;
+        siginfo_t info;
 
-            if (WIFEXITED(status))
+        info.si_pid = 0;
+        if (waitid(P_PID, (id_t)pid, &info, WEXITED | WNOHANG | WNOWAIT) == -1)
+        {
+            if (errno != EINTR)
             {
-                int es = WEXITSTATUS(status);
-                command->exit_code = es;
+                DC_ERROR_RAISE_ERRNO(err, errno);
+                return killed;
             }
+        }
+        else if (info.si_pid == pid)
+        {
+            return killed;
+        }
 
-            if (command->exit_code == 127)
+        if (stats_now() >= deadline)
+        {
+            kill(pid, killed ? SIGKILL : SIGTERM);
+            killed = true;
+            deadline += TIMEOUT_GRACE;
+        }
+
+        delay.tv_sec = 0;
+        delay.tv_nsec = TIMEOUT_POLL_NS;
+        nanosleep(&delay, NULL);
+    }
+}
+
+#if defined(__linux__)
+static bool wait_deadline_fd(struct dc_error *err, pid_t pid, uint64_t deadline, bool *killed)
+{
+    struct pollfd fds[2];
+    int pid_fd;
+    int timer;
+
+    pid_fd = (int)syscall(SYS_pidfd_open, pid, 0);
+    if (pid_fd == -1)
+    {
+        //older than Linux 5.3
+        return false;
+    }
+
+    timer = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (timer == -1)
+    {
+        close(pid_fd);
+        return false;
+    }
+
+    fds[0].fd = pid_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = timer;
+    fds[1].events = POLLIN;
+    set_timer(timer, deadline);
+
+    while (true)
+    {
+        if (poll(fds, 2, -1) == -1)
+        {
+            if (errno == EINTR)
             {
-                fprintf(stdout, "command: %s not found.\n", command->command);
+                continue;
             }
+
+            DC_ERROR_RAISE_ERRNO(err, errno);
+            break;
+        }
+
+        //the pidfd is readable once the child has exited
+        if (fds[0].revents != 0)
+        {
+            break;
         }
+
+        kill(pid, *killed ? SIGKILL : SIGTERM);
+        *killed = true;
+        deadline += TIMEOUT_GRACE;
+        set_timer(timer, deadline);
+    }
+
+    close(timer);
+    close(pid_fd);
+
+    return true;
+}
+
+static void set_timer(int timer, uint64_t when)
+{
+    struct itimerspec time;
+
+    //stats_now is CLOCK_MONOTONIC, the same clock as the timer
+    time.it_interval.tv_sec = 0;
+    time.it_interval.tv_nsec = 0;
+    time.it_value.tv_sec = (time_t)(when / UINT64_C(1000000000));
+    time.it_value.tv_nsec = (long)(when % UINT64_C(1000000000));
+    timerfd_settime(timer, TFD_TIMER_ABSTIME, &time, NULL);
+}
+#endif
+
+static int add_redirect(posix_spawn_file_actions_t* actions, const char* file_name, int flags, int target_fd)
+{
+    int fd;
+
+    //O_CLOEXEC so the descriptor does not leak in to other children, dup2 clears it on target_fd
+    fd = open(file_name, flags | O_CLOEXEC, REDIRECT_FILE_MODE);
+    if (fd == -1)
+    {
+        return -1;
+    }
+
+    posix_spawn_file_actions_adddup2(actions, fd, target_fd);
+
+    return fd;
+}
+
+static int open_pipe(int fds[2])
+{
+    if (pipe(fds) == -1)
+    {
+        return -1;
+    }
+
+    if (fcntl(fds[0], F_SETFD, FD_CLOEXEC) == -1 || fcntl(fds[1], F_SETFD, FD_CLOEXEC) == -1)
+    {
+        int saved_errno;
+
+        saved_errno = errno;
+        close(fds[0]);
+        close(fds[1]);
+        errno = saved_errno;
+
+        return -1;
     }
+
+    return 0;
 }
 
 static void redirect(const struct dc_posix_env* env, struct dc_error* err, struct command* command)
@@ -183,14 +846,18 @@ static void redirect(const struct dc_posix_env* env, struct dc_error* err, struc
  */
 static void run(const struct dc_posix_env* env, struct dc_error* err, const struct command* command, char** path)
 {
-    char *cmd;
     char path_buf[1024] = {0};
 
+    //the name as typed, the same as posix_spawn gets (see spawn_command), whichever file is run
+    command->argv[0] = command->command;
 
-    if (dc_strchr(env, command->command, '/') != NULL)
+    if (command->resolved_path != NULL)
+    {
+        //already found by the parent (see command_hash_lookup), no need to walk the path
+        dc_execv(env, err, command->resolved_path, command->argv);
+    }
+    else if (dc_strchr(env, command->command, '/') != NULL)
     {
-        //set command.argv[0] to command.command
-        command->argv[0] = dc_strdup(env, err, command->command);
         dc_execv(env, err, command->command, command->argv);
     }
     else
@@ -203,12 +870,9 @@ static void run(const struct dc_posix_env* env, struct dc_error* err, const stru
 
         for (size_t i = 0; path[i]; i++)
         {
-            //set cmd to path[i]/command.command
+            //try path[i]/command.command
             sprintf(path_buf, "%s/%s", path[i], command->command);
-            cmd = dc_strdup(env, err, path_buf);
-            command->argv[0] = cmd;
-            //call execve for the cmd
-            dc_execv(env, err, cmd, command->argv);
+            dc_execv(env, err, path_buf, command->argv);
             if (dc_error_has_error(err))
             {
                 if (err->errno_code != ENOENT)
@@ -222,11 +886,11 @@ static void run(const struct dc_posix_env* env, struct dc_error* err, const stru
     }
 }
 
-static int handle_run_error(struct dc_error* err)
+static int handle_run_error(int errno_code)
 {
     int ex_code;
 
-    switch(err->errno_code) {
+    switch(errno_code) {
         case E2BIG:
             ex_code = 1;
             break;
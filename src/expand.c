@@ -0,0 +1,876 @@
+#include "../include/expand.h"
+#include "../include/arena.h"
+#include "../include/lexer.h"
+#include "../include/shell.h"
+#include <ctype.h>
+#include <dc_posix/dc_stdlib.h>
+#include <dc_posix/dc_string.h>
+#include <dc_posix/dc_unistd.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <pwd.h>
+#include <stdio.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define INITIAL_WORD_CAPACITY 8
+#define INITIAL_BUFFER_CAPACITY 64
+#define READ_SIZE 4096
+#define DEFAULT_IFS " \t\n"
+
+/*! \struct buffer
+    \brief A growable string.
+*/
+struct buffer
+{
+    char *data;      /**< the characters, room is always kept for a '\0' */
+    size_t length;   /**< the number of characters */
+    size_t capacity; /**< the size of data */
+};
+
+/*! \struct expander
+    \brief The expansion of one word, and the field that is being built.
+*/
+struct expander
+{
+    int flags;                           /**< the expansions to do */
+    const struct shell_options *options; /**< the settings to run command substitutions with */
+    int *exit_code;                      /**< set to the exit code of the last command substitution, may be NULL */
+    const char *ifs;                     /**< the characters the fields are split on */
+    struct arena *arena;                 /**< where the words are allocated, NULL for the heap */
+    struct buffer text;                  /**< the current field with the quotes removed */
+    struct buffer pattern;               /**< the current field with the quoted pattern characters escaped */
+    bool has_pattern;                    /**< the current field has an unquoted * ? or [ */
+    bool has_field;                      /**< the current field is a word even if it is empty (it had quotes) */
+    char ***words;                       /**< the list the words are added to */
+    size_t *count;                       /**< the number of words in the list */
+    size_t *capacity;                    /**< the number of words the list can hold */
+    size_t added;                        /**< the number of words added to the list */
+};
+
+/**
+ * Make room in a buffer for more characters and the '\0'.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param buffer the buffer to grow.
+ * @param extra the number of characters that will be added.
+ */
+static void reserve(const struct dc_posix_env *env, struct dc_error *err, struct buffer *buffer, size_t extra);
+
+/**
+ * Add a character to the current field.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param expander the expansion.
+ * @param c the character.
+ * @param quoted true if the character was quoted, so it is never a pattern character.
+ */
+static void add_char(const struct dc_posix_env *env, struct dc_error *err, struct expander *expander, char c,
+                     bool quoted);
+
+/**
+ * Add the value of an expansion to the current field, unquoted values are split on IFS.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param expander the expansion.
+ * @param value the value (not '\0' terminated).
+ * @param length the length of the value.
+ * @param quoted true if the expansion was inside "".
+ */
+static void add_value(const struct dc_posix_env *env, struct dc_error *err, struct expander *expander,
+                      const char *value, size_t length, bool quoted);
+
+/**
+ * Finish the current field: add it, or the paths it matches, to the word list and start a new one.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param expander the expansion.
+ */
+static void end_field(const struct dc_posix_env *env, struct dc_error *err, struct expander *expander);
+
+/**
+ * Expand a word in to the word list.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param expander the expansion.
+ * @param text the word.
+ * @param length the length of the word.
+ */
+static void expand_text(const struct dc_posix_env *env, struct dc_error *err, struct expander *expander,
+                        const char *text, size_t length);
+
+/**
+ * Expand the inside of "", where only $, ` and \ are special.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param expander the expansion.
+ * @param text the word.
+ * @param end the position of the closing ".
+ * @param position the position after the opening ".
+ */
+static void expand_double_quoted(const struct dc_posix_env *env, struct dc_error *err, struct expander *expander,
+                                 const char *text, size_t end, size_t position);
+
+/**
+ * Replace ~ or ~user at the start of a word with the home directory.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param expander the expansion.
+ * @param text the word, starting with ~.
+ * @param length the length of the word.
+ * @return the number of characters replaced, 0 if the ~ is left as it is.
+ */
+static size_t expand_tilde(const struct dc_posix_env *env, struct dc_error *err, struct expander *expander,
+                           const char *text, size_t length);
+
+/**
+ * Expand $NAME, ${NAME}, $$ or $(commands).
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param expander the expansion.
+ * @param text the word.
+ * @param length where the expansion has to end (the end of the word or the closing ").
+ * @param position the position of the $.
+ * @param quoted true if the $ is inside "".
+ * @return the position after the expansion.
+ */
+static size_t expand_dollar(const struct dc_posix_env *env, struct dc_error *err, struct expander *expander,
+                            const char *text, size_t length, size_t position, bool quoted);
+
+/**
+ * Expand `commands`.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param expander the expansion.
+ * @param text the word.
+ * @param length where the expansion has to end (the end of the word or the closing ").
+ * @param position the position of the opening `.
+ * @param quoted true if the ` is inside "".
+ * @return the position after the closing `.
+ */
+static size_t expand_backquote(const struct dc_posix_env *env, struct dc_error *err, struct expander *expander,
+                               const char *text, size_t length, size_t position, bool quoted);
+
+/**
+ * Run the commands of a command substitution and add their output, without the trailing newlines.
+ * Their exit code is kept in the expander so the caller can report a failed substitution.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param expander the expansion.
+ * @param commands the commands (not '\0' terminated).
+ * @param length the length of the commands.
+ * @param quoted true if the substitution is inside "".
+ */
+static void expand_command(const struct dc_posix_env *env, struct dc_error *err, struct expander *expander,
+                           const char *commands, size_t length, bool quoted);
+
+/**
+ * Run commands in a child dc_shell (a subshell) and collect what they write to stdout.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param options the settings to run the commands with.
+ * @param commands the commands (not '\0' terminated).
+ * @param length the length of the commands.
+ * @param output set to what the commands wrote, data is NULL if nothing was read, else freed by the caller.
+ * @return the exit code of the commands, 128 + the signal if they were killed.
+ */
+static int run_substitution(const struct dc_posix_env *env, struct dc_error *err,
+                            const struct shell_options *options, const char *commands, size_t length,
+                            struct buffer *output);
+
+/**
+ * Is the text a variable name (a letter or _ followed by letters, digits and _).
+ *
+ * @param text the text.
+ * @param length the length of the text.
+ * @return true if it is a name.
+ */
+static bool is_name(const char *text, size_t length);
+
+size_t expand_word(const struct dc_posix_env *env, struct dc_error *err, const char *text, size_t length, int flags,
+                   const struct shell_options *options, int *exit_code, struct arena *arena, char ***words,
+                   size_t *count, size_t *capacity)
+{
+    struct expander expander;
+
+    expander.flags = flags;
+    expander.options = options;
+    expander.exit_code = exit_code;
+    expander.ifs = NULL;
+    expander.arena = arena;
+    expander.text.data = NULL;
+    expander.text.length = 0;
+    expander.text.capacity = 0;
+    expander.pattern = expander.text;
+    expander.has_pattern = false;
+    expander.has_field = false;
+    expander.words = words;
+    expander.count = count;
+    expander.capacity = capacity;
+    expander.added = 0;
+
+    if (flags & EXPAND_FIELDS)
+    {
+        expander.ifs = dc_getenv(env, "IFS");
+        if (expander.ifs == NULL)
+        {
+            expander.ifs = DEFAULT_IFS;
+        }
+    }
+
+    expand_text(env, err, &expander, text, length);
+    if (dc_error_has_no_error(err))
+    {
+        end_field(env, err, &expander);
+    }
+
+    if (expander.text.data != NULL)
+    {
+        dc_free(env, expander.text.data, expander.text.capacity);
+    }
+
+    if (expander.pattern.data != NULL)
+    {
+        dc_free(env, expander.pattern.data, expander.pattern.capacity);
+    }
+
+    return expander.added;
+}
+
+char *expand_string(const struct dc_posix_env *env, struct dc_error *err, const char *text, int flags,
+                    const struct shell_options *options)
+{
+    char **words;
+    size_t count;
+    size_t capacity;
+    char *word;
+
+    words = NULL;
+    count = 0;
+    capacity = 0;
+    word = NULL;
+
+    expand_word(env, err, text, dc_strlen(env, text), flags & ~(EXPAND_FIELDS | EXPAND_GLOB), options, NULL, NULL,
+                &words, &count, &capacity);
+
+    if (dc_error_has_error(err))
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            dc_free(env, words[i], dc_strlen(env, words[i]) + 1);
+        }
+    }
+    else if (count == 0)
+    {
+        //an unquoted expansion that was empty
+        word = dc_strdup(env, err, "");
+    }
+    else
+    {
+        //without splitting or globbing there is never more than one word
+        word = words[0];
+    }
+
+    if (words != NULL)
+    {
+        dc_free(env, words, capacity * sizeof(char *));
+    }
+
+    return word;
+}
+
+void append_word(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena, char *word,
+                 char ***words, size_t *count, size_t *capacity)
+{
+    if (word == NULL)
+    {
+        return;
+    }
+
+    //+ 1 to keep room for the NULL at the end
+    if (*count + 2 > *capacity)
+    {
+        char **grown;
+        size_t new_capacity;
+
+        new_capacity = *capacity == 0 ? INITIAL_WORD_CAPACITY : *capacity * 2;
+        grown = arena_realloc(env, err, arena, *words, *capacity * sizeof(char *), new_capacity * sizeof(char *));
+        if (dc_error_has_error(err))
+        {
+            if (arena == NULL)
+            {
+                dc_free(env, word, dc_strlen(env, word) + 1);
+            }
+            return;
+        }
+
+        *words = grown;
+        *capacity = new_capacity;
+    }
+
+    (*words)[(*count)++] = word;
+    (*words)[*count] = NULL;
+}
+
+static void reserve(const struct dc_posix_env *env, struct dc_error *err, struct buffer *buffer, size_t extra)
+{
+    char *grown;
+    size_t new_capacity;
+
+    if (buffer->length + extra + 1 <= buffer->capacity)
+    {
+        return;
+    }
+
+    new_capacity = buffer->capacity == 0 ? INITIAL_BUFFER_CAPACITY : buffer->capacity;
+    while (buffer->length + extra + 1 > new_capacity)
+    {
+        new_capacity *= 2;
+    }
+
+    grown = dc_realloc(env, err, buffer->data, new_capacity);
+    if (dc_error_has_error(err))
+    {
+        return;
+    }
+
+    buffer->data = grown;
+    buffer->capacity = new_capacity;
+}
+
+static void add_char(const struct dc_posix_env *env, struct dc_error *err, struct expander *expander, char c,
+                     bool quoted)
+{
+    bool special;
+
+    special = c == '*' || c == '?' || c == '[';
+
+    reserve(env, err, &expander->text, 1);
+    reserve(env, err, &expander->pattern, 2);
+    if (dc_error_has_error(err))
+    {
+        return;
+    }
+
+    expander->text.data[expander->text.length++] = c;
+
+    //glob has to see a quoted "*" as \*
+    if (quoted && (special || c == '\\'))
+    {
+        expander->pattern.data[expander->pattern.length++] = '\\';
+    }
+    else if (special)
+    {
+        expander->has_pattern = true;
+    }
+
+    expander->pattern.data[expander->pattern.length++] = c;
+    expander->has_field = true;
+}
+
+static void add_value(const struct dc_posix_env *env, struct dc_error *err, struct expander *expander,
+                      const char *value, size_t length, bool quoted)
+{
+    for (size_t i = 0; i < length && dc_error_has_no_error(err); i++)
+    {
+        if (!quoted && expander->ifs != NULL && value[i] != '\0' && dc_strchr(env, expander->ifs, value[i]) != NULL)
+        {
+            end_field(env, err, expander);
+        }
+        else
+        {
+            add_char(env, err, expander, value[i], quoted);
+        }
+    }
+}
+
+static void end_field(const struct dc_posix_env *env, struct dc_error *err, struct expander *expander)
+{
+    size_t before;
+
+    if (!expander->has_field)
+    {
+        return;
+    }
+
+    before = *expander->count;
+
+    if (expander->has_pattern && (expander->flags & EXPAND_GLOB))
+    {
+        glob_t matches;
+
+        expander->pattern.data[expander->pattern.length] = '\0';
+
+        if (glob(expander->pattern.data, 0, NULL, &matches) == 0)
+        {
+            for (size_t i = 0; i < matches.gl_pathc && dc_error_has_no_error(err); i++)
+            {
+                append_word(env, err, expander->arena,
+                            arena_strndup(env, err, expander->arena, matches.gl_pathv[i],
+                                          dc_strlen(env, matches.gl_pathv[i])),
+                            expander->words, expander->count, expander->capacity);
+            }
+
+            globfree(&matches);
+        }
+    }
+
+    //a pattern that matched nothing is left as it is
+    if (*expander->count == before && dc_error_has_no_error(err))
+    {
+        append_word(env, err, expander->arena,
+                    arena_strndup(env, err, expander->arena, expander->text.data, expander->text.length),
+                    expander->words, expander->count, expander->capacity);
+    }
+
+    expander->added += *expander->count - before;
+    expander->text.length = 0;
+    expander->pattern.length = 0;
+    expander->has_pattern = false;
+    expander->has_field = false;
+}
+
+static void expand_text(const struct dc_posix_env *env, struct dc_error *err, struct expander *expander,
+                        const char *text, size_t length)
+{
+    size_t position;
+
+    position = 0;
+
+    if ((expander->flags & EXPAND_TILDE) && length > 0 && text[0] == '~')
+    {
+        position = expand_tilde(env, err, expander, text, length);
+    }
+
+    while (position < length && dc_error_has_no_error(err))
+    {
+        size_t end;
+
+        switch (text[position])
+        {
+            case '\\':
+                if (position + 1 < length)
+                {
+                    add_char(env, err, expander, text[position + 1], true);
+                }
+                position += 2;
+                break;
+            case '\'':
+                expander->has_field = true;
+                for (end = position + 1; end < length && text[end] != '\''; end++)
+                {
+                    add_char(env, err, expander, text[end], true);
+                }
+                position = end + 1;
+                break;
+            case '"':
+                expander->has_field = true;
+                end = scan_substitution(text, length, position + 1, '"');
+                expand_double_quoted(env, err, expander, text, end, position + 1);
+                position = end + 1;
+                break;
+            case '$':
+                position = expand_dollar(env, err, expander, text, length, position, false);
+                break;
+            case '`':
+                position = expand_backquote(env, err, expander, text, length, position, false);
+                break;
+            default:
+                add_char(env, err, expander, text[position], false);
+                position++;
+                break;
+        }
+    }
+}
+
+static void expand_double_quoted(const struct dc_posix_env *env, struct dc_error *err, struct expander *expander,
+                                 const char *text, size_t end, size_t position)
+{
+    while (position < end && dc_error_has_no_error(err))
+    {
+        char c;
+
+        c = text[position];
+
+        //inside "" a \ only quotes $ ` " \ and newline
+        if (c == '\\' && position + 1 < end && dc_strchr(env, "$`\"\\\n", text[position + 1]) != NULL)
+        {
+            if (text[position + 1] != '\n')
+            {
+                add_char(env, err, expander, text[position + 1], true);
+            }
+            position += 2;
+        }
+        else if (c == '$')
+        {
+            position = expand_dollar(env, err, expander, text, end, position, true);
+        }
+        else if (c == '`')
+        {
+            position = expand_backquote(env, err, expander, text, end, position, true);
+        }
+        else
+        {
+            add_char(env, err, expander, c, true);
+            position++;
+        }
+    }
+}
+
+static size_t expand_tilde(const struct dc_posix_env *env, struct dc_error *err, struct expander *expander,
+                           const char *text, size_t length)
+{
+    const char *home;
+    struct passwd *user;
+    size_t end;
+
+    for (end = 1; end < length && text[end] != '/'; end++)
+    {
+        //a tilde prefix with anything quoted or expanded in it is left as it is
+        if (text[end] == '\\' || text[end] == '\'' || text[end] == '"' || text[end] == '$' || text[end] == '`')
+        {
+            return 0;
+        }
+    }
+
+    if (end == 1)
+    {
+        home = dc_getenv(env, "HOME");
+        if (home == NULL)
+        {
+            user = getpwuid(getuid());
+            home = user == NULL ? NULL : user->pw_dir;
+        }
+    }
+    else
+    {
+        char *name;
+
+        name = dc_strndup(env, err, &text[1], end - 1);
+        if (dc_error_has_error(err))
+        {
+            return 0;
+        }
+
+        user = getpwnam(name);
+        home = user == NULL ? NULL : user->pw_dir;
+        dc_free(env, name, end);
+    }
+
+    //~nosuchuser is left as it is
+    if (home == NULL)
+    {
+        return 0;
+    }
+
+    //the home directory is not split or globbed
+    add_value(env, err, expander, home, dc_strlen(env, home), true);
+    expander->has_field = true;
+
+    return end;
+}
+
+static size_t expand_dollar(const struct dc_posix_env *env, struct dc_error *err, struct expander *expander,
+                            const char *text, size_t length, size_t position, bool quoted)
+{
+    char pid[32];
+    const char *value;
+    size_t next;
+    size_t close;
+    size_t end;
+
+    next = position + 1;
+
+    if (next < length && text[next] == '(')
+    {
+        close = scan_substitution(text, length, next + 1, ')');
+        if (close >= length)
+        {
+            DC_ERROR_RAISE_USER(err, "syntax error: unterminated command substitution", EINVAL);
+            return length;
+        }
+
+        if (expander->flags & EXPAND_COMMANDS)
+        {
+            expand_command(env, err, expander, &text[next + 1], close - next - 1, quoted);
+        }
+        else
+        {
+            add_value(env, err, expander, &text[position], close + 1 - position, true);
+        }
+
+        return close + 1;
+    }
+
+    if (next < length && text[next] == '{')
+    {
+        close = scan_substitution(text, length, next + 1, '}');
+        if (close >= length || !is_name(&text[next + 1], close - next - 1))
+        {
+            DC_ERROR_RAISE_USER(err, "bad substitution", EINVAL);
+            return length;
+        }
+
+        next++;
+        end = close + 1;
+    }
+    else if (next < length && text[next] == '$')
+    {
+        close = next;
+        end = next + 1;
+    }
+    else if (next < length && (isalpha((unsigned char)text[next]) || text[next] == '_'))
+    {
+        for (close = next; close < length && (isalnum((unsigned char)text[close]) || text[close] == '_'); close++)
+        {
+        }
+
+        end = close;
+    }
+    else
+    {
+        //a $ on its own, or before something that is not a name, is just a $
+        add_char(env, err, expander, '$', quoted);
+        return next;
+    }
+
+    if (!(expander->flags & EXPAND_PARAMETERS))
+    {
+        add_value(env, err, expander, &text[position], end - position, true);
+        return end;
+    }
+
+    if (text[next] == '$')
+    {
+        snprintf(pid, sizeof(pid), "%ld", (long)getpid());
+        value = pid;
+    }
+    else
+    {
+        char *name;
+
+        name = dc_strndup(env, err, &text[next], close - next);
+        if (dc_error_has_error(err))
+        {
+            return length;
+        }
+
+        value = dc_getenv(env, name);
+        dc_free(env, name, close - next + 1);
+    }
+
+    if (value != NULL)
+    {
+        add_value(env, err, expander, value, dc_strlen(env, value), quoted);
+    }
+
+    return end;
+}
+
+static size_t expand_backquote(const struct dc_posix_env *env, struct dc_error *err, struct expander *expander,
+                               const char *text, size_t length, size_t position, bool quoted)
+{
+    char *commands;
+    size_t close;
+    size_t count;
+
+    close = scan_substitution(text, length, position + 1, '`');
+    if (close >= length)
+    {
+        DC_ERROR_RAISE_USER(err, "syntax error: unterminated command substitution", EINVAL);
+        return length;
+    }
+
+    if (!(expander->flags & EXPAND_COMMANDS))
+    {
+        add_value(env, err, expander, &text[position], close + 1 - position, true);
+        return close + 1;
+    }
+
+    commands = dc_malloc(env, err, close - position);
+    if (dc_error_has_error(err))
+    {
+        return length;
+    }
+
+    count = 0;
+
+    //inside `` a \ only quotes $ ` and \ .
+    for (size_t i = position + 1; i < close; i++)
+    {
+        if (text[i] == '\\' && i + 1 < close && (text[i + 1] == '$' || text[i + 1] == '`' || text[i + 1] == '\\'))
+        {
+            i++;
+        }
+
+        commands[count++] = text[i];
+    }
+
+    expand_command(env, err, expander, commands, count, quoted);
+    dc_free(env, commands, close - position);
+
+    return close + 1;
+}
+
+static void expand_command(const struct dc_posix_env *env, struct dc_error *err, struct expander *expander,
+                           const char *commands, size_t length, bool quoted)
+{
+    struct buffer output;
+    int exit_code;
+
+    exit_code = run_substitution(env, err, expander->options, commands, length, &output);
+    if (expander->exit_code != NULL && dc_error_has_no_error(err))
+    {
+        *expander->exit_code = exit_code;
+    }
+
+    if (output.data == NULL)
+    {
+        return;
+    }
+
+    while (output.length > 0 && output.data[output.length - 1] == '\n')
+    {
+        output.length--;
+    }
+
+    add_value(env, err, expander, output.data, output.length, quoted);
+    dc_free(env, output.data, output.capacity);
+}
+
+static int run_substitution(const struct dc_posix_env *env, struct dc_error *err,
+                            const struct shell_options *options, const char *commands, size_t length,
+                            struct buffer *output)
+{
+    struct buffer buffer;
+    char *script;
+    int fds[2];
+    pid_t pid;
+    int status;
+
+    output->data = NULL;
+    output->length = 0;
+    output->capacity = 0;
+
+    script = dc_strndup(env, err, commands, length);
+    if (dc_error_has_error(err))
+    {
+        return EXIT_FAILURE;
+    }
+
+    //close-on-exec so the programs the child runs only have the end that is on their stdout
+    if (pipe(fds) == -1 || fcntl(fds[0], F_SETFD, FD_CLOEXEC) == -1 || fcntl(fds[1], F_SETFD, FD_CLOEXEC) == -1)
+    {
+        DC_ERROR_RAISE_ERRNO(err, errno);
+        dc_free(env, script, length + 1);
+        return EXIT_FAILURE;
+    }
+
+    //anything buffered would otherwise be written by the child as well
+    fflush(NULL);
+    pid = dc_fork(env, err);
+
+    if (pid == 0)
+    {
+        close(fds[0]);
+        dc_dup2(env, err, fds[1], STDOUT_FILENO);
+        close(fds[1]);
+
+        //a subshell: the same FSM as the parent runs the commands on its copy of the shell
+        status = run_shell_batch(env, err, -1, script, stdout, stderr, options);
+        fflush(NULL);
+        dc_exit(env, status);
+    }
+
+    close(fds[1]);
+    dc_free(env, script, length + 1);
+
+    if (dc_error_has_error(err))
+    {
+        close(fds[0]);
+        return EXIT_FAILURE;
+    }
+
+    buffer.data = NULL;
+    buffer.length = 0;
+    buffer.capacity = 0;
+
+    for (;;)
+    {
+        ssize_t nread;
+
+        reserve(env, err, &buffer, READ_SIZE);
+        if (dc_error_has_error(err))
+        {
+            break;
+        }
+
+        nread = read(fds[0], &buffer.data[buffer.length], READ_SIZE);
+        if (nread == -1 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (nread <= 0)
+        {
+            break;
+        }
+
+        buffer.length += (size_t)nread;
+    }
+
+    close(fds[0]);
+
+    status = 0;
+    while (waitpid(pid, &status, 0) == -1 && errno == EINTR)
+    {
+    }
+
+    if (dc_error_has_error(err))
+    {
+        if (buffer.data != NULL)
+        {
+            dc_free(env, buffer.data, buffer.capacity);
+        }
+        return EXIT_FAILURE;
+    }
+
+    *output = buffer;
+
+    //the same as the exit code of a pipeline (see jobs.c)
+    if (WIFSIGNALED(status))
+    {
+        return 128 + WTERMSIG(status);
+    }
+
+    return WEXITSTATUS(status);
+}
+
+static bool is_name(const char *text, size_t length)
+{
+    if (length == 0 || !(isalpha((unsigned char)text[0]) || text[0] == '_'))
+    {
+        return false;
+    }
+
+    for (size_t i = 1; i < length; i++)
+    {
+        if (!(isalnum((unsigned char)text[i]) || text[i] == '_'))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,393 @@
+#include "../include/history.h"
+#include "../include/stats.h"
+#include <dc_posix/dc_fcntl.h>
+#include <dc_posix/dc_stdlib.h>
+#include <dc_posix/dc_string.h>
+#include <dc_posix/dc_unistd.h>
+#include <inttypes.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define HISTORY_BUFFER_SIZE 4096
+#define HISTORY_FLUSH_INTERVAL (30 * UINT64_C(1000000000))
+
+/**
+ * Find the lines that fit in the history at the end of the mapped file and add them as entries.
+ *
+ * @param env the posix environment.
+ * @param history the history, empty, with the file mapped.
+ */
+static void load_lines(const struct dc_posix_env *env, struct history *history);
+
+/**
+ * Put a line in the ring, in place of the oldest one if it is full.
+ *
+ * @param env the posix environment.
+ * @param history the history.
+ * @param line the line.
+ * @param length the length of the line.
+ * @param owned was the line allocated for the entry.
+ */
+static void push_entry(const struct dc_posix_env *env, struct history *history, char *line, size_t length,
+                       bool owned);
+
+/**
+ * Free the line of an entry if it was allocated for it.
+ *
+ * @param env the posix environment.
+ * @param entry the entry.
+ */
+static void free_entry(const struct dc_posix_env *env, struct history_entry *entry);
+
+/**
+ * Write all of a buffer to a file, retrying short writes.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param fd the file.
+ * @param buffer the bytes to write.
+ * @param length the number of bytes.
+ */
+static void write_all(const struct dc_posix_env *env, struct dc_error *err, int fd, const char *buffer,
+                      size_t length);
+
+struct history *history_create(const struct dc_posix_env *env, struct dc_error *err, size_t capacity)
+{
+    struct history *history;
+
+    history = dc_calloc(env, err, 1, sizeof(struct history));
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    history->fd = -1;
+    history->capacity = capacity;
+    history->number = 1;
+
+    if (capacity > 0)
+    {
+        history->entries = dc_calloc(env, err, capacity, sizeof(struct history_entry));
+        if (dc_error_has_error(err))
+        {
+            dc_free(env, history, sizeof(struct history));
+            return NULL;
+        }
+    }
+
+    return history;
+}
+
+void history_open(const struct dc_posix_env *env, struct dc_error *err, struct history *history, const char *path)
+{
+    struct stat status;
+    int fd;
+
+    //one descriptor to map the file and then to append to it
+    fd = dc_open(env, err, path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (dc_error_has_error(err))
+    {
+        return;
+    }
+
+    if (fstat(fd, &status) == -1)
+    {
+        DC_ERROR_RAISE_ERRNO(err, errno);
+        close(fd);
+        return;
+    }
+
+    if (status.st_size > 0 && history->capacity > 0)
+    {
+        void *mapped;
+
+        mapped = mmap(NULL, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED)
+        {
+            DC_ERROR_RAISE_ERRNO(err, errno);
+            close(fd);
+            return;
+        }
+
+        history->mapped = mapped;
+        history->mapped_length = (size_t)status.st_size;
+        load_lines(env, history);
+    }
+
+    history->pending = dc_malloc(env, err, HISTORY_BUFFER_SIZE);
+    if (dc_error_has_error(err))
+    {
+        close(fd);
+        return;
+    }
+
+    history->fd = fd;
+    history->last_flush = stats_now();
+}
+
+void history_destroy(const struct dc_posix_env *env, struct history **phistory)
+{
+    struct history *history;
+
+    history = *phistory;
+    if (history == NULL)
+    {
+        return;
+    }
+
+    if (history->fd != -1)
+    {
+        struct dc_error flush_err;
+
+        //nobody is left to report the error to
+        dc_error_init(&flush_err, NULL);
+        history_flush(env, &flush_err, history);
+        dc_error_reset(&flush_err);
+        close(history->fd);
+    }
+
+    history_clear(env, history);
+
+    if (history->entries != NULL)
+    {
+        dc_free(env, history->entries, history->capacity * sizeof(struct history_entry));
+    }
+
+    if (history->pending != NULL)
+    {
+        dc_free(env, history->pending, HISTORY_BUFFER_SIZE);
+    }
+
+    if (history->mapped != NULL)
+    {
+        munmap(history->mapped, history->mapped_length);
+    }
+
+    dc_free(env, history, sizeof(struct history));
+    *phistory = NULL;
+}
+
+void history_add(const struct dc_posix_env *env, struct dc_error *err, struct history *history, const char *line,
+                 size_t length)
+{
+    char *copy;
+
+    if (history->capacity > 0)
+    {
+        copy = dc_malloc(env, err, length == 0 ? 1 : length);
+        if (dc_error_has_error(err))
+        {
+            return;
+        }
+
+        dc_memcpy(env, copy, line, length);
+        push_entry(env, history, copy, length, true);
+    }
+
+    if (history->fd == -1)
+    {
+        return;
+    }
+
+    if (history->pending_length + length + 1 > HISTORY_BUFFER_SIZE)
+    {
+        history_flush(env, err, history);
+        if (dc_error_has_error(err))
+        {
+            return;
+        }
+    }
+
+    if (length + 1 > HISTORY_BUFFER_SIZE)
+    {
+        //too long for the buffer, it goes straight to the file
+        write_all(env, err, history->fd, line, length);
+        if (dc_error_has_no_error(err))
+        {
+            write_all(env, err, history->fd, "\n", 1);
+        }
+        return;
+    }
+
+    dc_memcpy(env, &history->pending[history->pending_length], line, length);
+    history->pending[history->pending_length + length] = '\n';
+    history->pending_length += length + 1;
+
+    if (stats_now() - history->last_flush >= HISTORY_FLUSH_INTERVAL)
+    {
+        history_flush(env, err, history);
+    }
+}
+
+void history_flush(const struct dc_posix_env *env, struct dc_error *err, struct history *history)
+{
+    if (history->fd == -1)
+    {
+        return;
+    }
+
+    if (history->pending_length > 0)
+    {
+        write_all(env, err, history->fd, history->pending, history->pending_length);
+
+        //the lines are dropped even if they could not be written, the next flush would fail the same way
+        history->pending_length = 0;
+    }
+
+    history->last_flush = stats_now();
+}
+
+const struct history_entry *history_get(const struct history *history, size_t index)
+{
+    if (index >= history->count)
+    {
+        return NULL;
+    }
+
+    return &history->entries[(history->oldest + index) % history->capacity];
+}
+
+void history_clear(const struct dc_posix_env *env, struct history *history)
+{
+    for (size_t i = 0; i < history->count; i++)
+    {
+        free_entry(env, &history->entries[(history->oldest + i) % history->capacity]);
+    }
+
+    history->count = 0;
+    history->oldest = 0;
+    history->number = 1;
+}
+
+void history_print(const struct history *history, size_t last, FILE *stream)
+{
+    size_t first;
+
+    first = last < history->count ? history->count - last : 0;
+
+    for (size_t i = first; i < history->count; i++)
+    {
+        const struct history_entry *entry;
+
+        entry = history_get(history, i);
+        fprintf(stream, "%5zu  %.*s\n", history->number + i, (int)entry->length, entry->line);
+    }
+}
+
+static void load_lines(const struct dc_posix_env *env, struct history *history)
+{
+    char *start;
+    char *end;
+    char *line;
+    size_t count;
+
+    start = history->mapped;
+    end = &history->mapped[history->mapped_length];
+    line = end;
+    count = 0;
+
+    //back from the end until there are enough lines, the rest of the file is never looked at (or paged in)
+    while (line > start && count < history->capacity)
+    {
+        char *line_end;
+
+        line_end = line;
+        while (line > start && line[-1] != '\n')
+        {
+            line--;
+        }
+
+        if (line < line_end)
+        {
+            count++;
+        }
+
+        if (line > start && count < history->capacity)
+        {
+            //the '\n' at the end of the line before
+            line--;
+        }
+    }
+
+    //and forwards again to fill the ring oldest first, blank lines are skipped
+    while (line < end)
+    {
+        char *newline;
+
+        newline = dc_memchr(env, line, '\n', (size_t)(end - line));
+        if (newline == NULL)
+        {
+            //a file that was not written by the shell may not end with a '\n'
+            newline = end;
+        }
+
+        if (newline > line)
+        {
+            push_entry(env, history, line, (size_t)(newline - line), false);
+        }
+
+        if (newline == end)
+        {
+            break;
+        }
+
+        line = newline + 1;
+    }
+}
+
+static void push_entry(const struct dc_posix_env *env, struct history *history, char *line, size_t length,
+                       bool owned)
+{
+    struct history_entry *entry;
+
+    if (history->count == history->capacity)
+    {
+        entry = &history->entries[history->oldest];
+        free_entry(env, entry);
+        history->oldest = (history->oldest + 1) % history->capacity;
+        history->number++;
+    }
+    else
+    {
+        entry = &history->entries[(history->oldest + history->count) % history->capacity];
+        history->count++;
+    }
+
+    entry->line = line;
+    entry->length = length;
+    entry->owned = owned;
+}
+
+static void free_entry(const struct dc_posix_env *env, struct history_entry *entry)
+{
+    if (entry->owned)
+    {
+        dc_free(env, entry->line, entry->length == 0 ? 1 : entry->length);
+    }
+
+    entry->line = NULL;
+    entry->length = 0;
+    entry->owned = false;
+}
+
+static void write_all(const struct dc_posix_env *env, struct dc_error *err, int fd, const char *buffer,
+                      size_t length)
+{
+    size_t written;
+
+    written = 0;
+
+    while (written < length)
+    {
+        ssize_t count;
+
+        count = dc_write(env, err, fd, &buffer[written], length - written);
+        if (dc_error_has_error(err))
+        {
+            return;
+        }
+
+        written += (size_t)count;
+    }
+}
@@ -1,26 +1,479 @@
 #include "../include/input.h"
+#include <ctype.h>
 #include <stdio.h>
 #include <dc_posix/dc_string.h>
-#include <dc_util/strings.h>
 #include <dc_posix/dc_stdio.h>
+#include <dc_posix/dc_unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
-char *read_command_line(const struct dc_posix_env *env, struct dc_error *err,
-                        FILE *stream, size_t *line_size)
+#define INITIAL_LINE_CAPACITY 256
+#define BLOCK_SIZE (64 * 1024)
+
+/**
+ * Allocate a line reader with an empty buffer.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param source where the lines come from.
+ * @param capacity the initial size of the buffer.
+ * @param max_line_length the largest line that will be accepted.
+ * @return the line reader, or NULL if it could not be allocated.
+ */
+static struct line_reader *create_reader(const struct dc_posix_env *env, struct dc_error *err,
+                                         enum line_source source, size_t capacity, size_t max_line_length);
+
+/**
+ * Read a line from a stream with getline.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param reader the line reader that owns the buffer.
+ * @param stream the stream to read from.
+ * @param line_size set to the length of the line.
+ * @return the line, or NULL on error.
+ */
+static const char *read_stream_line(const struct dc_posix_env *env, struct dc_error *err, struct line_reader *reader,
+                                    FILE *stream, size_t *line_size);
+
+/**
+ * Hand out the next line from the block buffer, reading another block when no complete line is buffered.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param reader the line reader that owns the buffer.
+ * @param line_size set to the length of the line.
+ * @return the line, or NULL on error.
+ */
+static const char *read_block_line(const struct dc_posix_env *env, struct dc_error *err, struct line_reader *reader,
+                                   size_t *line_size);
+
+/**
+ * Hand out the next line from the mapping without copying or modifying it.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param reader the line reader that owns the mapping.
+ * @param line_size set to the length of the line.
+ * @return the line (not '\0' terminated), or NULL on error.
+ */
+static const char *read_map_line(const struct dc_posix_env *env, struct dc_error *err, struct line_reader *reader,
+                                 size_t *line_size);
+
+/**
+ * Map a regular file read-only in to the reader.
+ *
+ * @param err the error object
+ * @param reader the line reader to set the mapping of.
+ * @param fd the file to map.
+ * @param size the size of the file.
+ */
+static void map_file(struct dc_error *err, struct line_reader *reader, int fd, size_t size);
+
+/**
+ * Move the unread bytes to the front of the buffer and read the next block after them.
+ * The buffer is grown when it is full of a single partial line.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param reader the line reader that owns the buffer.
+ */
+static void fill_block(const struct dc_posix_env *env, struct dc_error *err, struct line_reader *reader);
+
+/**
+ * Throw away the rest of a line that is too long for the buffer, up to and including its newline (or the end of
+ * the input), so the next read starts on the next line.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param reader the line reader that owns the buffer.
+ */
+static void discard_line(const struct dc_posix_env *env, struct dc_error *err, struct line_reader *reader);
+
+/**
+ * Find the leading and trailing whitespace of a line without moving or modifying it.
+ *
+ * @param line the line to trim.
+ * @param length the length of the line, set to the trimmed length.
+ * @return the offset of the first non-whitespace character of line.
+ */
+static size_t trim_view(const char *line, size_t *length);
+
+struct line_reader *line_reader_create(const struct dc_posix_env *env, struct dc_error *err, size_t max_line_length)
+{
+    return create_reader(env, err, LINE_SOURCE_STREAM, INITIAL_LINE_CAPACITY, max_line_length);
+}
+
+struct line_reader *line_reader_create_fd(const struct dc_posix_env *env, struct dc_error *err, int fd,
+                                          size_t max_line_length)
+{
+    struct line_reader *reader;
+    struct stat file_info;
+
+    if (fstat(fd, &file_info) == 0 && S_ISREG(file_info.st_mode) && file_info.st_size > 0)
+    {
+        reader = create_reader(env, err, LINE_SOURCE_MAP, 1, max_line_length);
+        if (reader != NULL)
+        {
+            map_file(err, reader, fd, (size_t)file_info.st_size);
+            if (dc_error_has_error(err))
+            {
+                line_reader_destroy(env, &reader);
+            }
+        }
+
+        return reader;
+    }
+
+    reader = create_reader(env, err, LINE_SOURCE_FD, BLOCK_SIZE, max_line_length);
+    if (reader != NULL)
+    {
+        reader->fd = fd;
+    }
+
+    return reader;
+}
+
+struct line_reader *line_reader_create_string(const struct dc_posix_env *env, struct dc_error *err, const char *str,
+                                              size_t max_line_length)
 {
-    char * buffer;
-    size_t size;
+    struct line_reader *reader;
+    size_t length;
 
-    size = *line_size;
-    buffer = dc_calloc(env, err, size, sizeof (char));
-    if (dc_error_has_error(err)) {
-        dc_exit(env, errno);
+    length = dc_strlen(env, str);
+    reader = create_reader(env, err, LINE_SOURCE_STRING, length + 1, max_line_length);
+    if (reader != NULL)
+    {
+        dc_memcpy(env, reader->buffer, str, length + 1);
+        reader->end = length;
+        reader->eof = true;
     }
-    dc_getline(env, err, &buffer, line_size, stream);
-    if (dc_error_has_error(err)) {
-        dc_exit(env, errno);
+
+    return reader;
+}
+
+static struct line_reader *create_reader(const struct dc_posix_env *env, struct dc_error *err,
+                                         enum line_source source, size_t capacity, size_t max_line_length)
+{
+    struct line_reader *reader;
+
+    reader = dc_calloc(env, err, 1, sizeof(struct line_reader));
+    if (dc_error_has_error(err))
+    {
+        return NULL;
     }
-    dc_str_trim(env, buffer);
-    *line_size = dc_strlen(env, buffer);
 
-    return buffer;
+    reader->capacity = capacity;
+    reader->buffer = dc_malloc(env, err, reader->capacity);
+    if (dc_error_has_error(err))
+    {
+        dc_free(env, reader, sizeof(struct line_reader));
+        return NULL;
+    }
+    reader->buffer[0] = '\0';
+    reader->mapping = NULL;
+    reader->source = source;
+    reader->fd = -1;
+    reader->start = 0;
+    reader->end = 0;
+    reader->max_line_length = max_line_length;
+    reader->eof = false;
+
+    return reader;
+}
+
+void line_reader_destroy(const struct dc_posix_env *env, struct line_reader **preader)
+{
+    struct line_reader *reader;
+
+    reader = *preader;
+    if (reader == NULL)
+    {
+        return;
+    }
+
+    if (reader->mapping != NULL)
+    {
+        munmap(reader->mapping, reader->end);
+    }
+
+    dc_free(env, reader->buffer, reader->capacity);
+    dc_free(env, reader, sizeof(struct line_reader));
+    *preader = NULL;
+}
+
+bool line_reader_done(const struct line_reader *reader)
+{
+    //start and end stay 0 for LINE_SOURCE_STREAM, it has nothing buffered once getline reaches the end
+    return reader->eof && reader->start >= reader->end;
+}
+
+const char *read_command_line(const struct dc_posix_env *env, struct dc_error *err, struct line_reader *reader,
+                              FILE *stream, size_t *line_size)
+{
+    switch (reader->source)
+    {
+        case LINE_SOURCE_STREAM:
+            return read_stream_line(env, err, reader, stream, line_size);
+        case LINE_SOURCE_MAP:
+            return read_map_line(env, err, reader, line_size);
+        case LINE_SOURCE_FD:
+        case LINE_SOURCE_STRING:
+        default:
+            return read_block_line(env, err, reader, line_size);
+    }
+}
+
+static const char *read_stream_line(const struct dc_posix_env *env, struct dc_error *err, struct line_reader *reader,
+                                    FILE *stream, size_t *line_size)
+{
+    ssize_t nread;
+    size_t length;
+    size_t offset;
+
+    //getline grows reader->buffer when the line does not fit, otherwise the buffer is reused as is.
+    nread = dc_getline(env, err, &reader->buffer, &reader->capacity, stream);
+    if (dc_error_has_error(err))
+    {
+        *line_size = 0;
+        return NULL;
+    }
+
+    if (nread < 0)
+    {
+        reader->eof = true;
+        reader->buffer[0] = '\0';
+        *line_size = 0;
+        return reader->buffer;
+    }
+
+    length = dc_strlen(env, reader->buffer);
+    if (length > reader->max_line_length)
+    {
+        DC_ERROR_RAISE_ERRNO(err, E2BIG);
+        *line_size = 0;
+        return NULL;
+    }
+
+    *line_size = length;
+    offset = trim_view(reader->buffer, line_size);
+    reader->buffer[offset + *line_size] = '\0';
+
+    return &reader->buffer[offset];
+}
+
+static const char *read_block_line(const struct dc_posix_env *env, struct dc_error *err, struct line_reader *reader,
+                                   size_t *line_size)
+{
+    char *line;
+    char *newline;
+    size_t offset;
+
+    *line_size = 0;
+
+    for (;;)
+    {
+        line = &reader->buffer[reader->start];
+        newline = dc_memchr(env, line, '\n', reader->end - reader->start);
+
+        if (newline != NULL)
+        {
+            *newline = '\0';
+            *line_size = (size_t)(newline - line);
+            reader->start += *line_size + 1;
+            break;
+        }
+
+        if (reader->eof)
+        {
+            //the last line may not end with a newline, fill_block always leaves room for the '\0'
+            reader->buffer[reader->end] = '\0';
+            *line_size = reader->end - reader->start;
+            reader->start = reader->end;
+            break;
+        }
+
+        fill_block(env, err, reader);
+        if (dc_error_has_error(err))
+        {
+            return NULL;
+        }
+    }
+
+    if (*line_size > reader->max_line_length)
+    {
+        DC_ERROR_RAISE_ERRNO(err, E2BIG);
+        *line_size = 0;
+        return NULL;
+    }
+
+    offset = trim_view(line, line_size);
+    line[offset + *line_size] = '\0';
+
+    return &line[offset];
+}
+
+static const char *read_map_line(const struct dc_posix_env *env, struct dc_error *err, struct line_reader *reader,
+                                 size_t *line_size)
+{
+    const char *mapping;
+    const char *line;
+    const char *newline;
+
+    mapping = reader->mapping;
+    line = &mapping[reader->start];
+
+    if (reader->start >= reader->end)
+    {
+        reader->eof = true;
+        *line_size = 0;
+        return line;
+    }
+
+    newline = dc_memchr(env, line, '\n', reader->end - reader->start);
+    if (newline != NULL)
+    {
+        *line_size = (size_t)(newline - line);
+        reader->start += *line_size + 1;
+    }
+    else
+    {
+        *line_size = reader->end - reader->start;
+        reader->start = reader->end;
+    }
+
+    if (*line_size > reader->max_line_length)
+    {
+        DC_ERROR_RAISE_ERRNO(err, E2BIG);
+        *line_size = 0;
+        return NULL;
+    }
+
+    return &line[trim_view(line, line_size)];
+}
+
+static void map_file(struct dc_error *err, struct line_reader *reader, int fd, size_t size)
+{
+    void *mapping;
+
+    mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED)
+    {
+        DC_ERROR_RAISE_ERRNO(err, errno);
+        return;
+    }
+
+    //the lines are walked once from start to end, let the kernel read ahead and drop pages behind us
+    posix_madvise(mapping, size, POSIX_MADV_SEQUENTIAL);
+    reader->mapping = mapping;
+    reader->start = 0;
+    reader->end = size;
+}
+
+static void fill_block(const struct dc_posix_env *env, struct dc_error *err, struct line_reader *reader)
+{
+    ssize_t nread;
+
+    if (reader->start > 0)
+    {
+        dc_memmove(env, reader->buffer, &reader->buffer[reader->start], reader->end - reader->start);
+        reader->end -= reader->start;
+        reader->start = 0;
+    }
+
+    if (reader->end + 1 >= reader->capacity)
+    {
+        char *buffer;
+
+        if (reader->capacity > reader->max_line_length)
+        {
+            //otherwise the same partial line is still buffered for the next read and fails again
+            discard_line(env, err, reader);
+            if (dc_error_has_no_error(err))
+            {
+                DC_ERROR_RAISE_ERRNO(err, E2BIG);
+            }
+            return;
+        }
+
+        buffer = dc_realloc(env, err, reader->buffer, reader->capacity * 2);
+        if (dc_error_has_error(err))
+        {
+            return;
+        }
+        reader->buffer = buffer;
+        reader->capacity *= 2;
+    }
+
+    nread = dc_read(env, err, reader->fd, &reader->buffer[reader->end], reader->capacity - reader->end - 1);
+    if (dc_error_has_error(err))
+    {
+        return;
+    }
+
+    if (nread == 0)
+    {
+        reader->eof = true;
+    }
+    else
+    {
+        reader->end += (size_t)nread;
+    }
+}
+
+static void discard_line(const struct dc_posix_env *env, struct dc_error *err, struct line_reader *reader)
+{
+    //the buffer only holds the start of the line, there is no newline in it
+    reader->start = 0;
+    reader->end = 0;
+
+    while (!reader->eof)
+    {
+        const char *newline;
+        ssize_t nread;
+
+        nread = dc_read(env, err, reader->fd, reader->buffer, reader->capacity - 1);
+        if (dc_error_has_error(err))
+        {
+            return;
+        }
+
+        if (nread == 0)
+        {
+            reader->eof = true;
+            return;
+        }
+
+        newline = dc_memchr(env, reader->buffer, '\n', (size_t)nread);
+        if (newline != NULL)
+        {
+            //keep what follows the newline, it is the start of the next line
+            reader->start = (size_t)(newline - reader->buffer) + 1;
+            reader->end = (size_t)nread;
+            return;
+        }
+    }
+}
+
+static size_t trim_view(const char *line, size_t *length)
+{
+    size_t start;
+    size_t end;
+
+    start = 0;
+    end = *length;
+
+    while (start < end && isspace((unsigned char)line[start]))
+    {
+        start++;
+    }
+
+    while (end > start && isspace((unsigned char)line[end - 1]))
+    {
+        end--;
+    }
+
+    *length = end - start;
+
+    return start;
 }
@@ -0,0 +1,475 @@
+#include "../include/jobs.h"
+#include <dc_posix/dc_stdlib.h>
+#include <dc_posix/dc_string.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/signalfd.h>
+#endif
+
+#define JOB_STATUS_LENGTH 32
+
+/**
+ * Has a SIGCHLD arrived since the last check. The queued signals are read so the next check starts over.
+ *
+ * @param table the job table.
+ * @return true if a child may have finished (always true without a signalfd).
+ */
+static bool child_signalled(const struct job_table *table);
+
+/**
+ * Record that a process of a job has finished.
+ *
+ * @param job the job.
+ * @param index the index of the process in the job.
+ * @param status the status from waitpid.
+ */
+static void job_reaped(struct job *job, size_t index, int status);
+
+/**
+ * Display a job: [id]+  Running/Done/Exit N  line.
+ *
+ * @param table the job table.
+ * @param job the job to display.
+ * @param stream the stream to display the job on.
+ */
+static void print_job(const struct job_table *table, const struct job *job, FILE *stream);
+
+/**
+ * Free a job and its line and processes.
+ *
+ * @param env the posix environment.
+ * @param job the job to free.
+ */
+static void free_job(const struct dc_posix_env *env, struct job *job);
+
+struct job_table *job_table_create(const struct dc_posix_env *env, struct dc_error *err)
+{
+    struct job_table *table;
+
+    table = dc_calloc(env, err, 1, sizeof(struct job_table));
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    table->jobs = NULL;
+    table->current = NULL;
+    table->signal_fd = -1;
+
+#if defined(__linux__)
+    {
+        sigset_t mask;
+
+        //SIGCHLD is discarded unless it is blocked, blocked it stays pending until the signalfd is read
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGCHLD);
+
+        if (sigprocmask(SIG_BLOCK, &mask, &table->old_mask) == 0)
+        {
+            table->signal_fd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+            if (table->signal_fd == -1)
+            {
+                //every job is polled instead
+                sigprocmask(SIG_SETMASK, &table->old_mask, NULL);
+            }
+        }
+    }
+#endif
+
+    return table;
+}
+
+void job_table_destroy(const struct dc_posix_env *env, struct job_table **ptable)
+{
+    struct job_table *table;
+
+    table = *ptable;
+    if (table == NULL)
+    {
+        return;
+    }
+
+    while (table->jobs != NULL)
+    {
+        struct job *next;
+
+        next = table->jobs->next;
+        free_job(env, table->jobs);
+        table->jobs = next;
+    }
+
+    if (table->signal_fd != -1)
+    {
+        close(table->signal_fd);
+        sigprocmask(SIG_SETMASK, &table->old_mask, NULL);
+    }
+
+    dc_free(env, table, sizeof(struct job_table));
+    *ptable = NULL;
+}
+
+struct job *job_add(const struct dc_posix_env *env, struct dc_error *err, struct job_table *table, const char *line,
+                    size_t length, const pid_t *pids, size_t count, int exit_code)
+{
+    struct job *job;
+    struct job **link;
+    int id;
+
+    job = dc_calloc(env, err, 1, sizeof(struct job));
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    job->line = dc_malloc(env, err, length + 1);
+    if (dc_error_has_no_error(err))
+    {
+        job->processes = dc_calloc(env, err, count, sizeof(struct job_process));
+    }
+
+    if (dc_error_has_error(err))
+    {
+        free_job(env, job);
+        return NULL;
+    }
+
+    dc_memcpy(env, job->line, line, length);
+    job->line[length] = '\0';
+    job->count = count;
+    job->running = 0;
+    job->exit_code = exit_code;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        job->processes[i].pid = pids[i];
+        job->processes[i].running = pids[i] > 0;
+
+        if (job->processes[i].running)
+        {
+            job->running++;
+        }
+    }
+
+    //the next number after the highest one in use, the same as sh
+    id = 1;
+    for (link = &table->jobs; *link != NULL; link = &(*link)->next)
+    {
+        id = (*link)->id + 1;
+    }
+
+    job->id = id;
+    job->next = NULL;
+    *link = job;
+    table->current = job;
+
+    return job;
+}
+
+struct job *job_find(const struct job_table *table, int id)
+{
+    if (id == 0)
+    {
+        return table->current;
+    }
+
+    for (struct job *job = table->jobs; job != NULL; job = job->next)
+    {
+        if (job->id == id)
+        {
+            return job;
+        }
+    }
+
+    return NULL;
+}
+
+struct job *job_find_pid(const struct job_table *table, pid_t pid)
+{
+    for (struct job *job = table->jobs; job != NULL; job = job->next)
+    {
+        for (size_t i = 0; i < job->count; i++)
+        {
+            if (job->processes[i].pid == pid)
+            {
+                return job;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+void job_table_reap(const struct dc_posix_env *env, struct dc_error *err, struct job_table *table)
+{
+    DC_TRACE(env);
+
+    if (table->jobs == NULL || !child_signalled(table))
+    {
+        return;
+    }
+
+    for (struct job *job = table->jobs; job != NULL; job = job->next)
+    {
+        for (size_t i = 0; i < job->count && job->running > 0; i++)
+        {
+            pid_t pid;
+            int status;
+
+            if (!job->processes[i].running)
+            {
+                continue;
+            }
+
+            pid = waitpid(job->processes[i].pid, &status, WNOHANG);
+            if (pid == job->processes[i].pid)
+            {
+                job_reaped(job, i, status);
+            }
+            else if (pid == -1 && errno == ECHILD)
+            {
+                //already waited for somewhere else, the exit code is lost
+                job->processes[i].running = false;
+                job->running--;
+            }
+            else if (pid == -1 && errno != EINTR)
+            {
+                DC_ERROR_RAISE_ERRNO(err, errno);
+                return;
+            }
+        }
+    }
+}
+
+void job_table_wait_child(const struct dc_posix_env *env, struct dc_error *err, const struct job_table *table)
+{
+    siginfo_t info;
+
+    DC_TRACE(env);
+
+#if defined(__linux__)
+    if (table->signal_fd != -1)
+    {
+        struct pollfd signal_poll;
+
+        //the signal stays queued until job_table_reap reads it
+        signal_poll.fd = table->signal_fd;
+        signal_poll.events = POLLIN;
+
+        while (poll(&signal_poll, 1, -1) == -1)
+        {
+            if (errno != EINTR)
+            {
+                DC_ERROR_RAISE_ERRNO(err, errno);
+                return;
+            }
+        }
+
+        return;
+    }
+#else
+    (void)table;
+#endif
+
+    //WNOWAIT leaves the zombie for job_table_reap, every other child of the shell is waited for as it runs
+    while (waitid(P_ALL, 0, &info, WEXITED | WNOWAIT) == -1)
+    {
+        if (errno == ECHILD)
+        {
+            return;
+        }
+
+        if (errno != EINTR)
+        {
+            DC_ERROR_RAISE_ERRNO(err, errno);
+            return;
+        }
+    }
+}
+
+int job_wait(const struct dc_posix_env *env, struct dc_error *err, struct job *job)
+{
+    DC_TRACE(env);
+
+    for (size_t i = 0; i < job->count && job->running > 0; i++)
+    {
+        int status;
+
+        if (!job->processes[i].running)
+        {
+            continue;
+        }
+
+        while (waitpid(job->processes[i].pid, &status, 0) == -1)
+        {
+            if (errno == ECHILD)
+            {
+                job->processes[i].running = false;
+                job->running--;
+                break;
+            }
+
+            if (errno != EINTR)
+            {
+                DC_ERROR_RAISE_ERRNO(err, errno);
+                return job->exit_code;
+            }
+        }
+
+        if (job->processes[i].running)
+        {
+            job_reaped(job, i, status);
+        }
+    }
+
+    return job->exit_code;
+}
+
+void job_remove(const struct dc_posix_env *env, struct job_table *table, struct job *job)
+{
+    struct job **link;
+
+    for (link = &table->jobs; *link != NULL; link = &(*link)->next)
+    {
+        if (*link == job)
+        {
+            *link = job->next;
+            break;
+        }
+    }
+
+    if (table->current == job)
+    {
+        //the most recent job that is left
+        table->current = table->jobs;
+        while (table->current != NULL && table->current->next != NULL)
+        {
+            table->current = table->current->next;
+        }
+    }
+
+    free_job(env, job);
+}
+
+void job_table_print(const struct dc_posix_env *env, struct job_table *table, FILE *stream)
+{
+    struct job *job;
+
+    job = table->jobs;
+    while (job != NULL)
+    {
+        struct job *next;
+
+        next = job->next;
+        print_job(table, job, stream);
+
+        if (job->running == 0)
+        {
+            job_remove(env, table, job);
+        }
+
+        job = next;
+    }
+}
+
+void job_table_notify(const struct dc_posix_env *env, struct job_table *table, FILE *stream)
+{
+    struct job *job;
+
+    job = table->jobs;
+    while (job != NULL)
+    {
+        struct job *next;
+
+        next = job->next;
+
+        if (job->running == 0)
+        {
+            print_job(table, job, stream);
+            job_remove(env, table, job);
+        }
+
+        job = next;
+    }
+}
+
+static bool child_signalled(const struct job_table *table)
+{
+#if defined(__linux__)
+    if (table->signal_fd != -1)
+    {
+        struct signalfd_siginfo info;
+        bool signalled;
+
+        signalled = false;
+
+        //standard signals are not queued, there is at most one but read until it is empty anyway
+        while (read(table->signal_fd, &info, sizeof(info)) == (ssize_t)sizeof(info))
+        {
+            signalled = true;
+        }
+
+        return signalled;
+    }
+#else
+    (void)table;
+#endif
+
+    return true;
+}
+
+static void job_reaped(struct job *job, size_t index, int status)
+{
+    job->processes[index].running = false;
+    job->running--;
+
+    //the exit code of a pipeline is the exit code of the last command
+    if (index + 1 == job->count)
+    {
+        if (WIFEXITED(status))
+        {
+            job->exit_code = WEXITSTATUS(status);
+        }
+        else if (WIFSIGNALED(status))
+        {
+            job->exit_code = 128 + WTERMSIG(status);
+        }
+    }
+}
+
+static void print_job(const struct job_table *table, const struct job *job, FILE *stream)
+{
+    char status[JOB_STATUS_LENGTH];
+
+    if (job->running > 0)
+    {
+        snprintf(status, sizeof(status), "Running");
+    }
+    else if (job->exit_code == 0)
+    {
+        snprintf(status, sizeof(status), "Done");
+    }
+    else
+    {
+        snprintf(status, sizeof(status), "Exit %d", job->exit_code);
+    }
+
+    fprintf(stream, "[%d]%c  %-24s%s\n", job->id, job == table->current ? '+' : ' ', status, job->line);
+}
+
+static void free_job(const struct dc_posix_env *env, struct job *job)
+{
+    if (job->line != NULL)
+    {
+        dc_free(env, job->line, dc_strlen(env, job->line) + 1);
+    }
+
+    if (job->processes != NULL)
+    {
+        dc_free(env, job->processes, job->count * sizeof(struct job_process));
+    }
+
+    dc_free(env, job, sizeof(struct job));
+}
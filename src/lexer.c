@@ -0,0 +1,300 @@
+#include "../include/lexer.h"
+
+/**
+ * Does the character end an unquoted word.
+ *
+ * @param c the character.
+ * @return true for whitespace and the operator characters.
+ */
+static bool is_word_end(char c);
+
+/**
+ * Scan a word, including any quoted parts, from lexer->position.
+ *
+ * @param lexer the lexer.
+ * @param token set to the word, or a TOKEN_ERROR if a quote is not closed.
+ */
+static void scan_word(struct lexer *lexer, struct token *token);
+
+void lexer_init(struct lexer *lexer, const char *line, size_t length)
+{
+    lexer->line = line;
+    lexer->length = length;
+    lexer->position = 0;
+}
+
+enum token_type next_token(struct lexer *lexer, struct token *token)
+{
+    const char *line;
+    size_t position;
+
+    line = lexer->line;
+    position = lexer->position;
+
+    while (position < lexer->length && (line[position] == ' ' || line[position] == '\t' || line[position] == '\n' ||
+                                        line[position] == '\r' || line[position] == '\f' || line[position] == '\v'))
+    {
+        position++;
+    }
+
+    //a comment (or a "#!" line at the top of a script) runs to the end of the line
+    if (position < lexer->length && line[position] == '#')
+    {
+        position = lexer->length;
+    }
+
+    token->text = &line[position];
+    token->length = 1;
+    token->plain = false;
+    lexer->position = position;
+
+    if (position >= lexer->length)
+    {
+        token->type = TOKEN_END;
+        token->length = 0;
+        return token->type;
+    }
+
+    switch (line[position])
+    {
+        case '|':
+        case '&':
+            //|| and && are one token, not two
+            if (position + 1 < lexer->length && line[position + 1] == line[position])
+            {
+                token->type = line[position] == '|' ? TOKEN_OR : TOKEN_AND;
+                token->length = 2;
+                lexer->position += token->length;
+                return token->type;
+            }
+
+            token->type = line[position] == '|' ? TOKEN_PIPE : TOKEN_BACKGROUND;
+            lexer->position += token->length;
+            return token->type;
+        case ';':
+            token->type = TOKEN_SEMICOLON;
+            lexer->position += token->length;
+            return token->type;
+        case '<':
+            token->type = TOKEN_REDIRECT_IN;
+            break;
+        case '>':
+            token->type = TOKEN_REDIRECT_OUT;
+            break;
+        case '1':
+        case '2':
+            if (position + 1 < lexer->length && line[position + 1] == '>')
+            {
+                token->type = line[position] == '1' ? TOKEN_REDIRECT_OUT : TOKEN_REDIRECT_ERR;
+                token->length = 2;
+                break;
+            }
+            scan_word(lexer, token);
+            return token->type;
+        default:
+            scan_word(lexer, token);
+            return token->type;
+    }
+
+    //>> appends
+    if (token->type != TOKEN_REDIRECT_IN &&
+        position + token->length < lexer->length && line[position + token->length] == '>')
+    {
+        token->type = token->type == TOKEN_REDIRECT_ERR ? TOKEN_REDIRECT_ERR_APPEND : TOKEN_REDIRECT_OUT_APPEND;
+        token->length++;
+    }
+
+    lexer->position += token->length;
+
+    return token->type;
+}
+
+size_t scan_substitution(const char *line, size_t length, size_t position, char end)
+{
+    size_t depth;
+
+    depth = 0;
+
+    while (position < length)
+    {
+        char c;
+
+        c = line[position];
+
+        if (c == end && depth == 0)
+        {
+            return position;
+        }
+
+        if (c == '\\')
+        {
+            position += 2;
+            continue;
+        }
+
+        if (end == '"')
+        {
+            //only $( ${ and ` start something inside "", the rest is text
+            if (c == '$' && position + 1 < length && (line[position + 1] == '(' || line[position + 1] == '{'))
+            {
+                position = scan_substitution(line, length, position + 2, line[position + 1] == '(' ? ')' : '}');
+            }
+            else if (c == '`')
+            {
+                position = scan_substitution(line, length, position + 1, '`');
+            }
+            position++;
+            continue;
+        }
+
+        if (end == '`')
+        {
+            position++;
+            continue;
+        }
+
+        switch (c)
+        {
+            case '\'':
+                while (++position < length && line[position] != '\'')
+                {
+                }
+                break;
+            case '"':
+            case '`':
+                position = scan_substitution(line, length, position + 1, c);
+                break;
+            case '(':
+            case '{':
+                if (c == (end == ')' ? '(' : '{'))
+                {
+                    depth++;
+                }
+                break;
+            case ')':
+            case '}':
+                if (c == end)
+                {
+                    depth--;
+                }
+                break;
+            default:
+                break;
+        }
+
+        position++;
+    }
+
+    return length;
+}
+
+bool is_redirect_token(enum token_type type)
+{
+    return type == TOKEN_REDIRECT_IN || type == TOKEN_REDIRECT_OUT || type == TOKEN_REDIRECT_OUT_APPEND ||
+           type == TOKEN_REDIRECT_ERR || type == TOKEN_REDIRECT_ERR_APPEND;
+}
+
+static bool is_word_end(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v' || c == '|' || c == '&' ||
+           c == ';' || c == '<' || c == '>';
+}
+
+static void scan_word(struct lexer *lexer, struct token *token)
+{
+    const char *line;
+    size_t position;
+    bool plain;
+
+    line = lexer->line;
+    position = lexer->position;
+    plain = true;
+
+    while (position < lexer->length && !is_word_end(line[position]))
+    {
+        char quote;
+
+        switch (line[position])
+        {
+            case '\\':
+                //the escaped character is part of the word whatever it is
+                plain = false;
+                position += position + 1 < lexer->length ? 2 : 1;
+                continue;
+            case '`':
+                plain = false;
+                position = scan_substitution(line, lexer->length, position + 1, '`');
+                if (position >= lexer->length)
+                {
+                    token->type = TOKEN_ERROR;
+                    token->length = position - lexer->position;
+                    lexer->position = position;
+                    return;
+                }
+
+                position++;
+                continue;
+            case '$':
+                plain = false;
+                if (position + 1 < lexer->length && (line[position + 1] == '(' || line[position + 1] == '{'))
+                {
+                    //the command or parameter name is part of the word, even with spaces, '|' or '>' in it
+                    position = scan_substitution(line, lexer->length, position + 2,
+                                                 line[position + 1] == '(' ? ')' : '}');
+                    if (position >= lexer->length)
+                    {
+                        token->type = TOKEN_ERROR;
+                        token->length = position - lexer->position;
+                        lexer->position = position;
+                        return;
+                    }
+                }
+                break;
+            case '\'':
+            case '"':
+                plain = false;
+                quote = line[position];
+                position++;
+
+                if (quote == '"')
+                {
+                    position = scan_substitution(line, lexer->length, position, '"');
+                }
+                else
+                {
+                    //nothing is special inside ''
+                    while (position < lexer->length && line[position] != quote)
+                    {
+                        position++;
+                    }
+                }
+
+                if (position >= lexer->length)
+                {
+                    token->type = TOKEN_ERROR;
+                    token->length = position - lexer->position;
+                    lexer->position = position;
+                    return;
+                }
+
+                position++;
+                continue;
+            //expanded by the word expansion
+            case '*':
+            case '?':
+            case '[':
+            case '~':
+                plain = false;
+                break;
+            default:
+                break;
+        }
+
+        position++;
+    }
+
+    token->type = TOKEN_WORD;
+    token->length = position - lexer->position;
+    token->plain = plain;
+    lexer->position = position;
+}
@@ -15,20 +15,39 @@
  *  along with dc_shell.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include "pool.h"
+#include "profile.h"
 #include "shell.h"
+#include "util.h"
 #include <dc_application/command_line.h>
 #include <dc_application/config.h>
 #include <dc_application/options.h>
 #include <dc_posix/dc_stdlib.h>
 #include <dc_posix/dc_string.h>
+#include <dc_posix/dc_fcntl.h>
+#include <dc_posix/dc_stdio.h>
+#include <dc_posix/dc_unistd.h>
 #include <getopt.h>
 
 struct application_settings
 {
-    struct dc_opt_settings  opts;
-    struct dc_setting_bool *verbose;
+    struct dc_opt_settings    opts;
+    struct dc_setting_bool   *verbose;
+    struct dc_setting_string *command;
+    struct dc_setting_bool   *use_fork;
+    struct dc_setting_string *profile;
+    struct dc_setting_string *usage_log;
+    struct dc_setting_string *timeout;
+    struct dc_setting_uint16 *cpu_limit;
+    struct dc_setting_uint16 *memory_limit;
+    struct dc_setting_uint16 *files_limit;
+    struct dc_setting_string *listen;
+    struct dc_setting_uint16 *workers;
 };
 
+static int    app_argc;
+static char **app_argv;
+
 static struct dc_application_settings *create_settings(const struct dc_posix_env *env, struct dc_error *err);
 
 static int
@@ -36,6 +55,10 @@ destroy_settings(const struct dc_posix_env *env, struct dc_error *err, struct dc
 
 static int run(const struct dc_posix_env *env, struct dc_error *err, struct dc_application_settings *settings);
 
+static void write_profile(const struct dc_posix_env *env, struct dc_error *err, const char *path);
+
+static bool is_chrome_trace(const struct dc_posix_env *env, const char *path);
+
 int        main(int argc, char *argv[])
 {
     dc_posix_tracer               tracer;
@@ -45,10 +68,13 @@ int        main(int argc, char *argv[])
     struct dc_application_info *info;
     int                         ret_val;
 
-    tracer   = NULL;
+    // does nothing unless --profile starts it
+    tracer   = profile_tracer;
     // tracer   = dc_posix_default_tracer;
     reporter = NULL;
     // reporter = dc_error_default_error_reporter;
+    app_argc = argc;
+    app_argv = argv;
     dc_posix_env_init(&env, tracer);
     dc_error_init(&err, reporter);
     info    = dc_application_info_create(&env, &err, "dcshell");
@@ -72,6 +98,7 @@ int        main(int argc, char *argv[])
 static struct dc_application_settings *create_settings(const struct dc_posix_env *env, struct dc_error *err)
 {
     static bool                  default_verbose = false;
+    static bool                  default_use_fork = false;
     struct application_settings *settings;
 
     DC_TRACE(env);
@@ -84,6 +111,16 @@ static struct dc_application_settings *create_settings(const struct dc_posix_env
 
     settings->opts.parent.config_path = dc_setting_path_create(env, err);
     settings->verbose                 = dc_setting_bool_create(env, err);
+    settings->command                 = dc_setting_string_create(env, err);
+    settings->use_fork                = dc_setting_bool_create(env, err);
+    settings->profile                 = dc_setting_string_create(env, err);
+    settings->usage_log               = dc_setting_string_create(env, err);
+    settings->timeout                 = dc_setting_string_create(env, err);
+    settings->cpu_limit               = dc_setting_uint16_create(env, err);
+    settings->memory_limit            = dc_setting_uint16_create(env, err);
+    settings->files_limit             = dc_setting_uint16_create(env, err);
+    settings->listen                  = dc_setting_string_create(env, err);
+    settings->workers                 = dc_setting_uint16_create(env, err);
 
     struct options opts[]             = {
         {(struct dc_setting *)settings->opts.parent.config_path,
@@ -106,6 +143,106 @@ static struct dc_application_settings *create_settings(const struct dc_posix_env
          "verbose",
          dc_flag_from_config,
          &default_verbose},
+        {(struct dc_setting *)settings->command,
+         dc_options_set_string,
+         "command",
+         required_argument,
+         'C',
+         "COMMAND",
+         dc_string_from_string,
+         "command",
+         dc_string_from_config,
+         NULL},
+        {(struct dc_setting *)settings->use_fork,
+         dc_options_set_bool,
+         "fork",
+         no_argument,
+         'f',
+         "FORK",
+         dc_flag_from_string,
+         "fork",
+         dc_flag_from_config,
+         &default_use_fork},
+        {(struct dc_setting *)settings->profile,
+         dc_options_set_string,
+         "profile",
+         required_argument,
+         'p',
+         "PROFILE",
+         dc_string_from_string,
+         "profile",
+         dc_string_from_config,
+         NULL},
+        {(struct dc_setting *)settings->usage_log,
+         dc_options_set_string,
+         "usage",
+         required_argument,
+         'u',
+         "USAGE",
+         dc_string_from_string,
+         "usage",
+         dc_string_from_config,
+         NULL},
+        {(struct dc_setting *)settings->timeout,
+         dc_options_set_string,
+         "timeout",
+         required_argument,
+         't',
+         "TIMEOUT",
+         dc_string_from_string,
+         "timeout",
+         dc_string_from_config,
+         NULL},
+        {(struct dc_setting *)settings->cpu_limit,
+         dc_options_set_uint16,
+         "cpu-limit",
+         required_argument,
+         'T',
+         "CPU_LIMIT",
+         dc_uint16_from_string,
+         "cpu-limit",
+         dc_uint16_from_config,
+         NULL},
+        {(struct dc_setting *)settings->memory_limit,
+         dc_options_set_uint16,
+         "memory-limit",
+         required_argument,
+         'M',
+         "MEMORY_LIMIT",
+         dc_uint16_from_string,
+         "memory-limit",
+         dc_uint16_from_config,
+         NULL},
+        {(struct dc_setting *)settings->files_limit,
+         dc_options_set_uint16,
+         "files-limit",
+         required_argument,
+         'N',
+         "FILES_LIMIT",
+         dc_uint16_from_string,
+         "files-limit",
+         dc_uint16_from_config,
+         NULL},
+        {(struct dc_setting *)settings->listen,
+         dc_options_set_string,
+         "listen",
+         required_argument,
+         'l',
+         "LISTEN",
+         dc_string_from_string,
+         "listen",
+         dc_string_from_config,
+         NULL},
+        {(struct dc_setting *)settings->workers,
+         dc_options_set_uint16,
+         "workers",
+         required_argument,
+         'w',
+         "WORKERS",
+         dc_uint16_from_string,
+         "workers",
+         dc_uint16_from_config,
+         NULL},
     };
 
     // note the trick here - we use calloc and add 1 to ensure the last line is all 0/NULL
@@ -113,7 +250,7 @@ static struct dc_application_settings *create_settings(const struct dc_posix_env
     settings->opts.opts_size  = sizeof(struct options);
     settings->opts.opts       = dc_calloc(env, err, settings->opts.opts_count, settings->opts.opts_size);
     dc_memcpy(env, settings->opts.opts, opts, sizeof(opts));
-    settings->opts.flags      = "c:v:";
+    settings->opts.flags      = "c:v:C:fp:u:t:T:M:N:l:w:";
     settings->opts.env_prefix = "DC_SHELL_";
 
     return (struct dc_application_settings *)settings;
@@ -128,6 +265,16 @@ static int destroy_settings(const struct dc_posix_env               *env,
     DC_TRACE(env);
     app_settings = (struct application_settings *)*psettings;
     dc_setting_bool_destroy(env, &app_settings->verbose);
+    dc_setting_string_destroy(env, &app_settings->command);
+    dc_setting_bool_destroy(env, &app_settings->use_fork);
+    dc_setting_string_destroy(env, &app_settings->profile);
+    dc_setting_string_destroy(env, &app_settings->usage_log);
+    dc_setting_string_destroy(env, &app_settings->timeout);
+    dc_setting_uint16_destroy(env, &app_settings->cpu_limit);
+    dc_setting_uint16_destroy(env, &app_settings->memory_limit);
+    dc_setting_uint16_destroy(env, &app_settings->files_limit);
+    dc_setting_string_destroy(env, &app_settings->listen);
+    dc_setting_uint16_destroy(env, &app_settings->workers);
     dc_free(env, app_settings->opts.opts, app_settings->opts.opts_count);
     dc_free(env, *psettings, sizeof(struct application_settings));
 
@@ -139,14 +286,191 @@ static int destroy_settings(const struct dc_posix_env               *env,
     return 0;
 }
 
-static int run(const struct dc_posix_env                              *env,
-               struct dc_error                                        *err,
-               __attribute__((unused)) struct dc_application_settings *settings)
+static int run(const struct dc_posix_env        *env,
+               struct dc_error                  *err,
+               struct dc_application_settings   *settings)
 {
-    int ret_val;
+    struct application_settings *app_settings;
+    struct shell_options         options;
+    const char                  *command;
+    const char                  *profile;
+    const char                  *usage_log;
+    const char                  *timeout;
+    const char                  *listen;
+    char                        *history_file;
+    uint16_t                     workers;
+    int                          ret_val;
 
     DC_TRACE(env);
-    ret_val = run_shell(env, err, stdin, stdout, stderr);
+    app_settings = (struct application_settings *)settings;
+    command      = dc_setting_string_get(env, app_settings->command);
+    profile      = dc_setting_string_get(env, app_settings->profile);
+    usage_log    = dc_setting_string_get(env, app_settings->usage_log);
+    timeout      = dc_setting_string_get(env, app_settings->timeout);
+    listen       = dc_setting_string_get(env, app_settings->listen);
+    workers      = dc_setting_uint16_get(env, app_settings->workers);
+
+    // --timeout DURATION, --cpu-limit SECONDS, --memory-limit MIB and --files-limit N apply to every program started
+    dc_memset(env, &options.limits, 0, sizeof(options.limits));
+    if(timeout != NULL && !parse_duration(timeout, &options.limits.timeout))
+    {
+        fprintf(stderr, "%s: invalid duration\n", timeout);
+        return EXIT_FAILURE;
+    }
+
+    options.limits.cpu           = dc_setting_uint16_get(env, app_settings->cpu_limit);
+    options.limits.address_space = (uint64_t)dc_setting_uint16_get(env, app_settings->memory_limit) * 1024 * 1024;
+    options.limits.open_files    = dc_setting_uint16_get(env, app_settings->files_limit);
+
+    // --usage FILE appends a line for each command with the time, CPU, memory and context switches it used
+    options.usage_log = NULL;
+    if(usage_log != NULL)
+    {
+        options.usage_log = dc_fopen(env, err, usage_log, "a");
+
+        if(dc_error_has_error(err))
+        {
+            fprintf(stderr, "%s: %s\n", usage_log, err->message);
+            return EXIT_FAILURE;
+        }
+
+        // a line at a time, a forked copy of the shell must not inherit half a buffer to write again
+        setvbuf(options.usage_log, NULL, _IOLBF, 0);
+    }
+
+    // --profile FILE counts and times the dc_* calls, a FILE ending in .json is a Chrome trace of every call
+    if(profile != NULL)
+    {
+        profile_start(is_chrome_trace(env, profile));
+    }
+
+    // posix_spawn is the default, --fork goes back to fork/exec (for platforms where spawn is not faster)
+    options.launcher = dc_setting_bool_get(env, app_settings->use_fork) ? LAUNCHER_FORK : LAUNCHER_SPAWN;
+
+    // --workers N keeps N processes forked ahead of time that only have to exec the next program
+    if(workers > 0)
+    {
+        if(worker_pool_start(env, err, workers))
+        {
+            options.launcher = LAUNCHER_POOL;
+        }
+        else
+        {
+            fprintf(stderr, "workers: %s\n", err->message);
+            dc_error_reset(err);
+        }
+    }
+
+    // --verbose displays how long each FSM state took (the same as the stats builtin) on exit
+    options.verbose = dc_setting_bool_get(env, app_settings->verbose);
+    options.history_file = NULL;
+    history_file = NULL;
+
+    // --listen SOCKET serves command lines over a Unix domain socket until it is killed
+    // batch mode for -C, a script file (the first non-option argument) or commands piped in on stdin
+    if(listen != NULL)
+    {
+        ret_val = run_shell_server(env, err, listen, stderr, &options);
+    }
+    else if(command != NULL)
+    {
+        ret_val = run_shell_batch(env, err, -1, command, stdout, stderr, &options);
+    }
+    else if(optind < app_argc)
+    {
+        int fd;
+
+        fd = dc_open(env, err, app_argv[optind], O_RDONLY);
+
+        if(dc_error_has_error(err))
+        {
+            fprintf(stderr, "%s: %s\n", app_argv[optind], err->message);
+            ret_val = EXIT_FAILURE;
+        }
+        else
+        {
+            ret_val = run_shell_batch(env, err, fd, NULL, stdout, stderr, &options);
+            dc_close(env, err, fd);
+        }
+    }
+    else if(!isatty(STDIN_FILENO))
+    {
+        ret_val = run_shell_batch(env, err, STDIN_FILENO, NULL, stdout, stderr, &options);
+    }
+    else
+    {
+        // only the lines typed at the terminal are saved, in HISTFILE (~/.dc_shell_history if it is not set)
+        history_file = get_history_file(env, err);
+        options.history_file = history_file;
+        ret_val = run_shell(env, err, stdin, stdout, stderr, &options);
+    }
+
+    if(history_file != NULL)
+    {
+        dc_free(env, history_file, dc_strlen(env, history_file) + 1);
+    }
+
+    worker_pool_stop(env);
+
+    if(options.usage_log != NULL)
+    {
+        dc_fclose(env, err, options.usage_log);
+    }
+
+    if(profile != NULL)
+    {
+        write_profile(env, err, profile);
+    }
 
     return ret_val;
 }
+
+static void write_profile(const struct dc_posix_env *env, struct dc_error *err, const char *path)
+{
+    FILE *stream;
+
+    // nothing after this is counted
+    profile_stop();
+
+    if(dc_strcmp(env, path, "-") == 0)
+    {
+        stream = stderr;
+    }
+    else
+    {
+        dc_error_reset(err);
+        stream = dc_fopen(env, err, path, "w");
+
+        if(dc_error_has_error(err))
+        {
+            fprintf(stderr, "%s: %s\n", path, err->message);
+            profile_reset();
+            return;
+        }
+    }
+
+    if(is_chrome_trace(env, path))
+    {
+        profile_print_trace(stream);
+    }
+    else
+    {
+        profile_print_report(stream);
+    }
+
+    if(stream != stderr)
+    {
+        dc_fclose(env, err, stream);
+    }
+
+    profile_reset();
+}
+
+static bool is_chrome_trace(const struct dc_posix_env *env, const char *path)
+{
+    size_t length;
+
+    length = dc_strlen(env, path);
+
+    return length > 5 && dc_strcmp(env, &path[length - 5], ".json") == 0;
+}
@@ -0,0 +1,470 @@
+#include "../include/parallel.h"
+#include "../include/arena.h"
+#include "../include/command.h"
+#include "../include/input.h"
+#include "../include/jobs.h"
+#include "../include/shell_impl.h"
+#include <dc_posix/dc_stdlib.h>
+#include <dc_posix/dc_string.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define LINE_ARENA_SIZE 4096
+#define SYNTAX_ERROR_EXIT_CODE 2
+
+/*! \struct parallel_line
+    \brief A line of the input, kept until its result has been displayed.
+*/
+struct parallel_line
+{
+    char *line;      /**< the command line */
+    int exit_code;   /**< the exit code of the line, once it is done */
+    bool done;       /**< has the line finished */
+};
+
+/*! \struct parallel_slot
+    \brief A line that is running.
+*/
+struct parallel_slot
+{
+    struct job *job; /**< the pipeline of the line, in the shell's job table */
+    size_t index;    /**< the index of the line in the input */
+};
+
+/*! \struct parallel
+    \brief The lines of a parallel command and the ones that are running.
+*/
+struct parallel
+{
+    struct parallel_line *lines; /**< every line read so far */
+    size_t count;                /**< the number of lines read */
+    size_t capacity;             /**< the number of lines that fit in lines */
+    size_t displayed;            /**< the lines before this one have been displayed */
+    struct parallel_slot *slots; /**< the lines that are running */
+    size_t running;              /**< the number of slots in use */
+    size_t max_running;          /**< the most lines that can run at once (-j) */
+    bool failed;                 /**< did any line not exit with 0 */
+};
+
+/**
+ * Parse the arguments: [-j N] [file].
+ *
+ * @param env the posix environment.
+ * @param command the parallel command.
+ * @param errstream the stream to print error messages to.
+ * @param max_running set to N.
+ * @param file set to the file, NULL for stdin.
+ * @return true if the arguments are valid.
+ */
+static bool parse_arguments(const struct dc_posix_env *env, const struct command *command, FILE *errstream,
+                            size_t *max_running, const char **file);
+
+/**
+ * Add a line to the ones that have been read.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param parallel the lines.
+ * @param line the line (not '\0' terminated).
+ * @param length the length of the line.
+ */
+static void add_line(const struct dc_posix_env *env, struct dc_error *err, struct parallel *parallel,
+                     const char *line, size_t length);
+
+/**
+ * Separate, parse and start the last line that was read (see separate_commands and parse_commands).
+ * A line that cannot be parsed is done straight away with exit code 2.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param states the state, with the line arena in place of its own.
+ * @param parallel the lines.
+ */
+static void start_line(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                       struct parallel *parallel);
+
+/**
+ * Move the lines whose jobs have finished out of the slots.
+ *
+ * @param env the posix environment.
+ * @param states the state with the job table.
+ * @param parallel the lines.
+ * @return the number of lines that finished.
+ */
+static size_t collect_lines(const struct dc_posix_env *env, struct state *states, struct parallel *parallel);
+
+/**
+ * Display the finished lines that all of the lines before them have finished too.
+ *
+ * @param env the posix environment.
+ * @param parallel the lines.
+ * @param stream the stream to display the lines on.
+ */
+static void display_lines(const struct dc_posix_env *env, struct parallel *parallel, FILE *stream);
+
+void builtin_parallel(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                      struct command *command)
+{
+    struct command *commands;
+    size_t command_count;
+    const char *current_line;
+    size_t current_line_length;
+    struct arena *arena;
+    struct arena *line_arena;
+    struct parallel parallel;
+    struct line_reader *reader;
+    const char *file;
+    int fd;
+    bool eof;
+
+    if (!parse_arguments(env, command, states->stderr, &parallel.max_running, &file))
+    {
+        command->exit_code = EXIT_FAILURE;
+        return;
+    }
+
+    fd = STDIN_FILENO;
+    if (file != NULL || command->stdin_file != NULL)
+    {
+        fd = open(file != NULL ? file : command->stdin_file, O_RDONLY | O_CLOEXEC);
+        if (fd == -1)
+        {
+            fprintf(states->stderr, "parallel: %s: %s\n", file != NULL ? file : command->stdin_file,
+                    strerror(errno));
+            command->exit_code = EXIT_FAILURE;
+            return;
+        }
+    }
+
+    parallel.lines = NULL;
+    parallel.count = 0;
+    parallel.capacity = 0;
+    parallel.displayed = 0;
+    parallel.running = 0;
+    parallel.failed = false;
+    parallel.slots = dc_calloc(env, err, parallel.max_running, sizeof(struct parallel_slot));
+    reader = NULL;
+    line_arena = NULL;
+
+    if (dc_error_has_no_error(err))
+    {
+        reader = line_reader_create_fd(env, err, fd, states->max_line_length);
+    }
+
+    if (dc_error_has_no_error(err))
+    {
+        line_arena = arena_create(env, err, LINE_ARENA_SIZE);
+    }
+
+    if (dc_error_has_error(err))
+    {
+        states->fatal_error = err->errno_code == ENOMEM;
+        dc_free(env, parallel.slots, parallel.max_running * sizeof(struct parallel_slot));
+        line_reader_destroy(env, &reader);
+        if (fd != STDIN_FILENO)
+        {
+            close(fd);
+        }
+        return;
+    }
+
+    //the lines are run through the same separate/parse path as the prompt, in an arena of their own
+    commands = states->command;
+    command_count = states->command_count;
+    current_line = states->current_line;
+    current_line_length = states->current_line_length;
+    arena = states->arena;
+    states->arena = line_arena;
+    eof = false;
+
+    while (!eof || parallel.running > 0)
+    {
+        while (!eof && parallel.running < parallel.max_running)
+        {
+            const char *line;
+            size_t length;
+
+            line = read_command_line(env, err, reader, NULL, &length);
+            if (dc_error_has_error(err))
+            {
+                fprintf(states->stderr, "parallel: %s\n", err->message);
+                dc_error_reset(err);
+                parallel.failed = true;
+                eof = true;
+                break;
+            }
+
+            if (length == 0)
+            {
+                eof = line_reader_done(reader);
+                continue;
+            }
+
+            add_line(env, err, &parallel, line, length);
+            if (dc_error_has_no_error(err))
+            {
+                start_line(env, err, states, &parallel);
+            }
+
+            if (dc_error_has_error(err))
+            {
+                eof = true;
+                break;
+            }
+        }
+
+        if (collect_lines(env, states, &parallel) == 0 && parallel.running > 0 && dc_error_has_no_error(err))
+        {
+            job_table_wait_child(env, err, states->jobs);
+            job_table_reap(env, err, states->jobs);
+        }
+
+        display_lines(env, &parallel, states->stdout);
+
+        if (dc_error_has_error(err))
+        {
+            break;
+        }
+    }
+
+    //after an error the lines that are still running are waited for so nothing is left behind
+    for (size_t i = 0; i < parallel.running; i++)
+    {
+        struct dc_error wait_err;
+
+        dc_error_init(&wait_err, NULL);
+        job_wait(env, &wait_err, parallel.slots[i].job);
+        job_remove(env, states->jobs, parallel.slots[i].job);
+        dc_error_reset(&wait_err);
+    }
+
+    for (size_t i = parallel.displayed; i < parallel.count; i++)
+    {
+        dc_free(env, parallel.lines[i].line, dc_strlen(env, parallel.lines[i].line) + 1);
+    }
+
+    arena_destroy(env, &line_arena);
+    states->arena = arena;
+    states->command = commands;
+    states->command_count = command_count;
+    states->current_line = current_line;
+    states->current_line_length = current_line_length;
+
+    dc_free(env, parallel.lines, parallel.capacity * sizeof(struct parallel_line));
+    dc_free(env, parallel.slots, parallel.max_running * sizeof(struct parallel_slot));
+    line_reader_destroy(env, &reader);
+
+    if (fd != STDIN_FILENO)
+    {
+        close(fd);
+    }
+
+    command->exit_code = parallel.failed || dc_error_has_error(err) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static bool parse_arguments(const struct dc_posix_env *env, const struct command *command, FILE *errstream,
+                            size_t *max_running, const char **file)
+{
+    long processors;
+    bool has_file;
+
+    processors = sysconf(_SC_NPROCESSORS_ONLN);
+    *max_running = processors > 0 ? (size_t)processors : 1;
+    *file = NULL;
+    has_file = false;
+
+    for (size_t i = 1; i < command->argc; i++)
+    {
+        const char *arg;
+
+        arg = command->argv[i];
+
+        if (arg[0] == '-' && arg[1] == 'j')
+        {
+            const char *count;
+            char *end;
+            long value;
+
+            count = arg[2] != '\0' ? &arg[2] : command->argv[++i];
+            if (count == NULL)
+            {
+                fprintf(errstream, "parallel: -j: missing job count\n");
+                return false;
+            }
+
+            errno = 0;
+            value = strtol(count, &end, 10);
+            if (errno != 0 || end == count || *end != '\0' || value <= 0 || value > INT_MAX)
+            {
+                fprintf(errstream, "parallel: %s: invalid job count\n", count);
+                return false;
+            }
+
+            *max_running = (size_t)value;
+        }
+        else if (!has_file && (arg[0] != '-' || arg[1] == '\0'))
+        {
+            //"-" is stdin
+            *file = dc_strcmp(env, arg, "-") == 0 ? NULL : arg;
+            has_file = true;
+        }
+        else
+        {
+            fprintf(errstream, "usage: parallel [-j jobs] [file]\n");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void add_line(const struct dc_posix_env *env, struct dc_error *err, struct parallel *parallel,
+                     const char *line, size_t length)
+{
+    struct parallel_line *entry;
+
+    if (parallel->count == parallel->capacity)
+    {
+        struct parallel_line *lines;
+        size_t capacity;
+
+        capacity = parallel->capacity == 0 ? 64 : parallel->capacity * 2;
+        lines = dc_realloc(env, err, parallel->lines, capacity * sizeof(struct parallel_line));
+        if (dc_error_has_error(err))
+        {
+            return;
+        }
+
+        parallel->lines = lines;
+        parallel->capacity = capacity;
+    }
+
+    entry = &parallel->lines[parallel->count];
+    entry->line = dc_malloc(env, err, length + 1);
+    if (dc_error_has_error(err))
+    {
+        return;
+    }
+
+    dc_memcpy(env, entry->line, line, length);
+    entry->line[length] = '\0';
+    entry->exit_code = 0;
+    entry->done = false;
+    parallel->count++;
+}
+
+static void start_line(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                       struct parallel *parallel)
+{
+    struct parallel_line *entry;
+    struct job *job;
+    int next_state;
+
+    entry = &parallel->lines[parallel->count - 1];
+    states->current_line = entry->line;
+    states->current_line_length = dc_strlen(env, entry->line);
+    states->command = NULL;
+    states->command_count = 0;
+    job = NULL;
+
+    next_state = separate_commands(env, err, states);
+    if (next_state == PARSE_COMMANDS)
+    {
+        next_state = parse_commands(env, err, states);
+    }
+
+    if (next_state != EXECUTE_COMMANDS)
+    {
+        //separate_commands has already displayed a syntax error
+        if (dc_error_has_error(err))
+        {
+            fprintf(states->stderr, "parallel: %s\n", err->message);
+            dc_error_reset(err);
+        }
+
+        entry->exit_code = SYNTAX_ERROR_EXIT_CODE;
+        entry->done = true;
+        parallel->failed = true;
+    }
+    else
+    {
+        //the whole line is one job, a line with "&&", "||" or ';' (or a builtin) is run by a copy of the shell
+        job = start_job(env, err, states, 0, states->command_count - 1);
+    }
+
+    for (size_t i = 0; i < states->command_count; i++)
+    {
+        destroy_command(env, &states->command[i]);
+    }
+
+    states->command = NULL;
+    states->command_count = 0;
+    arena_reset(env, states->arena);
+
+    if (job != NULL)
+    {
+        parallel->slots[parallel->running].job = job;
+        parallel->slots[parallel->running].index = parallel->count - 1;
+        parallel->running++;
+    }
+}
+
+static size_t collect_lines(const struct dc_posix_env *env, struct state *states, struct parallel *parallel)
+{
+    size_t finished;
+    size_t i;
+
+    finished = 0;
+    i = 0;
+
+    while (i < parallel->running)
+    {
+        struct parallel_slot *slot;
+        struct parallel_line *entry;
+
+        slot = &parallel->slots[i];
+        if (slot->job->running > 0)
+        {
+            i++;
+            continue;
+        }
+
+        entry = &parallel->lines[slot->index];
+        entry->exit_code = slot->job->exit_code;
+        entry->done = true;
+        parallel->failed = parallel->failed || entry->exit_code != 0;
+        job_remove(env, states->jobs, slot->job);
+
+        //the order of the slots does not matter, the last one fills the gap
+        parallel->running--;
+        parallel->slots[i] = parallel->slots[parallel->running];
+        finished++;
+    }
+
+    return finished;
+}
+
+static void display_lines(const struct dc_posix_env *env, struct parallel *parallel, FILE *stream)
+{
+    size_t first;
+
+    first = parallel->displayed;
+
+    while (parallel->displayed < parallel->count && parallel->lines[parallel->displayed].done)
+    {
+        struct parallel_line *entry;
+
+        entry = &parallel->lines[parallel->displayed];
+        fprintf(stream, "%d\t%s\n", entry->exit_code, entry->line);
+        dc_free(env, entry->line, dc_strlen(env, entry->line) + 1);
+        entry->line = NULL;
+        parallel->displayed++;
+    }
+
+    if (parallel->displayed != first)
+    {
+        fflush(stream);
+    }
+}
@@ -0,0 +1,873 @@
+#if defined(__linux__)
+//CLONE_PARENT, MSG_CMSG_CLOEXEC and environ, this has to come before any system header
+#define _GNU_SOURCE
+#endif
+
+#include "../include/pool.h"
+#include "../include/execute.h"
+#include <dc_posix/dc_stdlib.h>
+#include <dc_posix/dc_string.h>
+#include <dc_posix/dc_unistd.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sched.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#endif
+
+#if defined(__linux__)
+
+#define REQUEST_IN_FD 0x01
+#define REQUEST_OUT_FD 0x02
+#define REQUEST_STDOUT_OVERWRITE 0x04
+#define REQUEST_STDERR_OVERWRITE 0x08
+#define NO_STRING UINT32_MAX
+#define INITIAL_REQUEST_CAPACITY 4096
+#define WORKING_DIR_SIZE 4096
+#define ZYGOTE_READ_SIZE 64
+
+/*! \struct pool_worker
+    \brief A worker waiting for a program to run.
+*/
+struct pool_worker
+{
+    pid_t pid; /**< the worker, a child of the shell */
+    int fd;    /**< the socket the request is sent on */
+};
+
+/*! \struct worker_pool
+    \brief The workers and the zygote that makes them.
+*/
+struct worker_pool
+{
+    struct pool_worker *workers; /**< the idle workers, the last one is used first */
+    size_t count;                /**< the number of idle workers */
+    size_t size;                 /**< the number of workers to keep ready */
+    size_t pending;              /**< the workers asked for that the zygote has not sent yet */
+    pid_t owner;                 /**< the process that started the pool */
+    pid_t zygote;                /**< the process that makes the workers */
+    int zygote_fd;               /**< the socket to the zygote */
+    char *request;               /**< the request being built, reused for every request */
+    size_t capacity;             /**< the size of request */
+    size_t length;               /**< the length of the request being built */
+};
+
+static struct worker_pool pool;
+
+/**
+ * The zygote: make a worker for each byte read from the socket and send its pid and socket back,
+ * until the socket is closed.
+ *
+ * @param env the posix environment.
+ * @param fd the socket to the shell.
+ */
+static void run_zygote(const struct dc_posix_env *env, int fd);
+
+/**
+ * Clone a worker that is a child of the shell (the parent of the zygote).
+ *
+ * @param env the posix environment.
+ * @param zygote_fd the socket of the zygote, closed in the worker.
+ * @param worker set to the pid of the worker and the socket to send its request on.
+ * @return false if the worker could not be made.
+ */
+static bool start_worker(const struct dc_posix_env *env, int zygote_fd, struct pool_worker *worker);
+
+/**
+ * A worker: wait for one request and run it (see exec_command). Exits if the socket is closed first.
+ *
+ * @param env the posix environment.
+ * @param fd the socket the request comes on.
+ */
+static void run_worker(const struct dc_posix_env *env, int fd);
+
+/**
+ * Receive the workers the zygote has made.
+ *
+ * @param wait wait for all of the workers asked for, otherwise only take the ones that are ready.
+ */
+static void collect_workers(bool wait);
+
+/**
+ * Ask the zygote for another worker.
+ */
+static void ask_for_worker(void);
+
+/**
+ * Build the request for a worker in pool.request.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param command the command to run.
+ * @param program the path of the program.
+ * @param working_dir the directory to run the program in.
+ * @param flags REQUEST_IN_FD and REQUEST_OUT_FD for the descriptors sent with the request.
+ */
+static void build_request(const struct dc_posix_env *env, struct dc_error *err, const struct command *command,
+                          const char *program, const char *working_dir, uint8_t flags);
+
+/**
+ * Add bytes to pool.request, growing it if it is full.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param data the bytes to add.
+ * @param length the number of bytes.
+ */
+static void put(const struct dc_posix_env *env, struct dc_error *err, const void *data, size_t length);
+
+/**
+ * Add a string to pool.request: its length, then the string and its '\0'.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param string the string, NULL is sent as NO_STRING.
+ */
+static void put_string(const struct dc_posix_env *env, struct dc_error *err, const char *string);
+
+/**
+ * Take bytes from a request.
+ *
+ * @param cursor the next byte of the request, moved past the bytes.
+ * @param end the end of the request.
+ * @param data where to copy the bytes.
+ * @param length the number of bytes.
+ * @return false if the request is too short.
+ */
+static bool take(char **cursor, const char *end, void *data, size_t length);
+
+/**
+ * Take a string from a request (see put_string), it is left in place.
+ *
+ * @param cursor the next byte of the request, moved past the string.
+ * @param end the end of the request.
+ * @param string set to the string, or NULL.
+ * @return false if the request is too short.
+ */
+static bool take_string(char **cursor, const char *end, char **string);
+
+/**
+ * Send bytes with descriptors (SCM_RIGHTS) on a socket.
+ *
+ * @param fd the socket.
+ * @param data the bytes.
+ * @param length the number of bytes.
+ * @param fds the descriptors to send with the first byte.
+ * @param count the number of descriptors.
+ * @return false if the other end is gone.
+ */
+static bool send_fds(int fd, const void *data, size_t length, const int *fds, size_t count);
+
+/**
+ * Receive bytes and the descriptors sent with them (see send_fds), the descriptors are close on exec.
+ *
+ * @param fd the socket.
+ * @param data where to put the bytes.
+ * @param length the number of bytes.
+ * @param fds where to put the descriptors.
+ * @param count the number of descriptors there is room for, set to the number received.
+ * @param flags MSG_DONTWAIT to not wait for the first byte.
+ * @return false if the socket was closed, or nothing is ready with MSG_DONTWAIT.
+ */
+static bool receive_fds(int fd, void *data, size_t length, int *fds, size_t *count, int flags);
+
+/**
+ * Read all of the bytes, waiting for them.
+ *
+ * @param fd the descriptor to read.
+ * @param data where to put the bytes.
+ * @param length the number of bytes.
+ * @return false if the descriptor was closed first.
+ */
+static bool read_all(int fd, void *data, size_t length);
+
+bool worker_pool_start(const struct dc_posix_env *env, struct dc_error *err, size_t size)
+{
+    int fds[2];
+    pid_t pid;
+
+    if (pool.workers != NULL || size == 0)
+    {
+        return false;
+    }
+
+    pool.workers = dc_calloc(env, err, size, sizeof(struct pool_worker));
+    if (dc_error_has_no_error(err))
+    {
+        pool.request = dc_malloc(env, err, INITIAL_REQUEST_CAPACITY);
+    }
+
+    if (dc_error_has_no_error(err) && socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) == -1)
+    {
+        DC_ERROR_RAISE_ERRNO(err, errno);
+    }
+
+    if (dc_error_has_error(err))
+    {
+        worker_pool_stop(env);
+        return false;
+    }
+
+    //the zygote is forked while the shell is small, the workers are cloned from it
+    fflush(NULL);
+    pid = dc_fork(env, err);
+    if (dc_error_has_error(err))
+    {
+        close(fds[0]);
+        close(fds[1]);
+        worker_pool_stop(env);
+        return false;
+    }
+
+    if (pid == 0)
+    {
+        close(fds[0]);
+        run_zygote(env, fds[1]);
+    }
+
+    close(fds[1]);
+    pool.capacity = INITIAL_REQUEST_CAPACITY;
+    pool.size = size;
+    pool.count = 0;
+    pool.pending = 0;
+    pool.owner = getpid();
+    pool.zygote = pid;
+    pool.zygote_fd = fds[0];
+
+    for (size_t i = 0; i < size; i++)
+    {
+        ask_for_worker();
+    }
+
+    //the first commands do not have to fall back to spawn while the workers are made
+    collect_workers(true);
+
+    return true;
+}
+
+pid_t worker_pool_launch(const struct dc_posix_env *env, struct dc_error *err, const struct command *command,
+                         const char *program, int in_fd, int out_fd)
+{
+    struct pool_worker worker;
+    char working_dir[WORKING_DIR_SIZE];
+    int fds[2];
+    size_t count;
+    uint8_t flags;
+    bool sent;
+
+    DC_TRACE(env);
+
+    //a forked copy of the shell (eg. a job) cannot wait for the workers, they are not its children
+    if (pool.workers == NULL || pool.owner != getpid())
+    {
+        return -1;
+    }
+
+    //waiting for the zygote would cost more than spawning, an exhausted pool falls back to spawn
+    collect_workers(false);
+    if (pool.count == 0 || getcwd(working_dir, sizeof(working_dir)) == NULL)
+    {
+        return -1;
+    }
+
+    count = 0;
+    flags = 0;
+    if (in_fd != -1)
+    {
+        fds[count++] = in_fd;
+        flags |= REQUEST_IN_FD;
+    }
+
+    if (out_fd != -1)
+    {
+        fds[count++] = out_fd;
+        flags |= REQUEST_OUT_FD;
+    }
+
+    build_request(env, err, command, program, working_dir, flags);
+    if (dc_error_has_error(err))
+    {
+        return -1;
+    }
+
+    pool.count--;
+    worker = pool.workers[pool.count];
+    sent = send_fds(worker.fd, pool.request, pool.length, fds, count);
+    close(worker.fd);
+
+    //the replacement is made while the program runs
+    ask_for_worker();
+
+    if (!sent)
+    {
+        //the worker is gone (eg. killed), reap it and start the program another way
+        waitpid(worker.pid, NULL, 0);
+        return -1;
+    }
+
+    return worker.pid;
+}
+
+void worker_pool_stop(const struct dc_posix_env *env)
+{
+    bool owner;
+
+    owner = pool.owner == getpid();
+
+    if (pool.zygote > 0)
+    {
+        if (owner)
+        {
+            collect_workers(true);
+        }
+
+        close(pool.zygote_fd);
+        if (owner)
+        {
+            waitpid(pool.zygote, NULL, 0);
+        }
+    }
+
+    for (size_t i = 0; i < pool.count; i++)
+    {
+        //the worker exits when it reads the end of its socket
+        close(pool.workers[i].fd);
+        if (owner)
+        {
+            waitpid(pool.workers[i].pid, NULL, 0);
+        }
+    }
+
+    if (pool.workers != NULL)
+    {
+        dc_free(env, pool.workers, pool.size * sizeof(struct pool_worker));
+    }
+
+    if (pool.request != NULL)
+    {
+        dc_free(env, pool.request, pool.capacity);
+    }
+
+    dc_memset(env, &pool, 0, sizeof(pool));
+}
+
+static void run_zygote(const struct dc_posix_env *env, int fd)
+{
+    char wanted[ZYGOTE_READ_SIZE];
+    ssize_t nread;
+
+    while ((nread = read(fd, wanted, sizeof(wanted))) != 0)
+    {
+        if (nread == -1 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (nread == -1)
+        {
+            break;
+        }
+
+        for (ssize_t i = 0; i < nread; i++)
+        {
+            struct pool_worker worker;
+
+            if (!start_worker(env, fd, &worker))
+            {
+                worker.pid = -1;
+                worker.fd = -1;
+            }
+
+            send_fds(fd, &worker.pid, sizeof(worker.pid), &worker.fd, worker.fd == -1 ? 0 : 1);
+            if (worker.fd != -1)
+            {
+                close(worker.fd);
+            }
+        }
+    }
+
+    _exit(EXIT_SUCCESS);
+}
+
+static bool start_worker(const struct dc_posix_env *env, int zygote_fd, struct pool_worker *worker)
+{
+    int fds[2];
+    long pid;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) == -1)
+    {
+        return false;
+    }
+
+    //like fork, except the worker is a sibling of the zygote, the shell waits for it like any other child
+    pid = syscall(SYS_clone, CLONE_PARENT | SIGCHLD, 0, NULL, NULL, 0);
+    if (pid == 0)
+    {
+        close(zygote_fd);
+        close(fds[0]);
+        run_worker(env, fds[1]);
+    }
+
+    close(fds[1]);
+
+    if (pid == -1)
+    {
+        close(fds[0]);
+        return false;
+    }
+
+    worker->pid = (pid_t)pid;
+    worker->fd = fds[0];
+
+    return true;
+}
+
+static void run_worker(const struct dc_posix_env *env, int fd)
+{
+    struct command command;
+    struct dc_error err;
+    uint32_t size;
+    uint32_t argc;
+    uint32_t envc;
+    uint64_t limits[3];
+    uint8_t flags;
+    char *request;
+    char *cursor;
+    char *program;
+    char *working_dir;
+    char **envp;
+    int fds[2];
+    size_t count;
+    bool valid;
+
+    dc_error_init(&err, NULL);
+    count = 2;
+
+    //the shell stopped the pool
+    if (!receive_fds(fd, &size, sizeof(size), fds, &count, 0))
+    {
+        _exit(EXIT_SUCCESS);
+    }
+
+    request = dc_malloc(env, &err, size);
+    if (dc_error_has_error(&err) || !read_all(fd, request, size))
+    {
+        _exit(EXIT_FAILURE);
+    }
+
+    close(fd);
+    dc_memset(env, &command, 0, sizeof(command));
+    cursor = request;
+    envp = NULL;
+
+    valid = take(&cursor, &request[size], &flags, sizeof(flags)) &&
+            take(&cursor, &request[size], limits, sizeof(limits)) &&
+            take_string(&cursor, &request[size], &command.command) &&
+            take_string(&cursor, &request[size], &program) &&
+            take_string(&cursor, &request[size], &working_dir) &&
+            take_string(&cursor, &request[size], &command.stdin_file) &&
+            take_string(&cursor, &request[size], &command.stdout_file) &&
+            take_string(&cursor, &request[size], &command.stderr_file) &&
+            take(&cursor, &request[size], &argc, sizeof(argc));
+
+    if (valid)
+    {
+        //argv[0] is NULL, it is set by exec_command
+        command.argc = argc;
+        command.argv = dc_calloc(env, &err, (size_t)argc + 2, sizeof(char *));
+        for (size_t i = 1; valid && dc_error_has_no_error(&err) && i < argc; i++)
+        {
+            valid = take_string(&cursor, &request[size], &command.argv[i]);
+        }
+    }
+
+    if (valid && dc_error_has_no_error(&err))
+    {
+        valid = take(&cursor, &request[size], &envc, sizeof(envc));
+        envp = dc_calloc(env, &err, (size_t)envc + 1, sizeof(char *));
+        for (size_t i = 0; valid && dc_error_has_no_error(&err) && i < envc; i++)
+        {
+            valid = take_string(&cursor, &request[size], &envp[i]);
+        }
+    }
+
+    if (!valid || dc_error_has_error(&err) || command.command == NULL || program == NULL ||
+        working_dir == NULL)
+    {
+        _exit(EXIT_FAILURE);
+    }
+
+    //the environment and directory of the shell now, not when the worker was made
+    if (chdir(working_dir) == -1)
+    {
+        fprintf(stderr, "%s: %s\n", working_dir, strerror(errno));
+        _exit(EXIT_FAILURE);
+    }
+
+    environ = envp;
+    command.resolved_path = program;
+    command.stdout_overwrite = (flags & REQUEST_STDOUT_OVERWRITE) != 0;
+    command.stderr_overwrite = (flags & REQUEST_STDERR_OVERWRITE) != 0;
+    command.limits.cpu = limits[0];
+    command.limits.address_space = limits[1];
+    command.limits.open_files = limits[2];
+
+    //the worker is already a child of the shell, it does cat and tee in the kernel the same as a fork would
+    exec_command(env, &err, &command, NULL, (flags & REQUEST_IN_FD) != 0 ? fds[0] : -1,
+                 (flags & REQUEST_OUT_FD) != 0 ? fds[(flags & REQUEST_IN_FD) != 0 ? 1 : 0] : -1);
+}
+
+static void collect_workers(bool wait)
+{
+    while (pool.pending > 0)
+    {
+        pid_t pid;
+        int fd;
+        size_t count;
+
+        count = 1;
+        if (!receive_fds(pool.zygote_fd, &pid, sizeof(pid), &fd, &count, wait ? 0 : MSG_DONTWAIT))
+        {
+            break;
+        }
+
+        pool.pending--;
+
+        if (pid > 0 && count == 1)
+        {
+            pool.workers[pool.count].pid = pid;
+            pool.workers[pool.count].fd = fd;
+            pool.count++;
+        }
+    }
+}
+
+static void ask_for_worker(void)
+{
+    if (pool.count + pool.pending < pool.size && send(pool.zygote_fd, "w", 1, MSG_NOSIGNAL) == 1)
+    {
+        pool.pending++;
+    }
+}
+
+static void build_request(const struct dc_posix_env *env, struct dc_error *err, const struct command *command,
+                          const char *program, const char *working_dir, uint8_t flags)
+{
+    uint64_t limits[3];
+    uint32_t size;
+    uint32_t argc;
+    uint32_t envc;
+
+    if (command->stdout_overwrite)
+    {
+        flags |= REQUEST_STDOUT_OVERWRITE;
+    }
+
+    if (command->stderr_overwrite)
+    {
+        flags |= REQUEST_STDERR_OVERWRITE;
+    }
+
+    //the timeout is kept by the shell (see wait_for_command)
+    limits[0] = command->limits.cpu;
+    limits[1] = command->limits.address_space;
+    limits[2] = command->limits.open_files;
+
+    //the size goes first, it is filled in at the end
+    pool.length = 0;
+    size = 0;
+    put(env, err, &size, sizeof(size));
+    put(env, err, &flags, sizeof(flags));
+    put(env, err, limits, sizeof(limits));
+    put_string(env, err, command->command);
+    put_string(env, err, program);
+    put_string(env, err, working_dir);
+    put_string(env, err, command->stdin_file);
+    put_string(env, err, command->stdout_file);
+    put_string(env, err, command->stderr_file);
+
+    argc = (uint32_t)command->argc;
+    put(env, err, &argc, sizeof(argc));
+    for (size_t i = 1; i < command->argc; i++)
+    {
+        put_string(env, err, command->argv[i]);
+    }
+
+    envc = 0;
+    while (environ[envc] != NULL)
+    {
+        envc++;
+    }
+
+    put(env, err, &envc, sizeof(envc));
+    for (size_t i = 0; i < envc; i++)
+    {
+        put_string(env, err, environ[i]);
+    }
+
+    if (dc_error_has_no_error(err))
+    {
+        size = (uint32_t)(pool.length - sizeof(size));
+        dc_memcpy(env, pool.request, &size, sizeof(size));
+    }
+}
+
+static void put(const struct dc_posix_env *env, struct dc_error *err, const void *data, size_t length)
+{
+    if (dc_error_has_error(err))
+    {
+        return;
+    }
+
+    if (pool.length + length > pool.capacity)
+    {
+        size_t capacity;
+        char *request;
+
+        capacity = pool.capacity * 2;
+        while (pool.length + length > capacity)
+        {
+            capacity *= 2;
+        }
+
+        request = dc_realloc(env, err, pool.request, capacity);
+        if (dc_error_has_error(err))
+        {
+            return;
+        }
+
+        pool.request = request;
+        pool.capacity = capacity;
+    }
+
+    dc_memcpy(env, &pool.request[pool.length], data, length);
+    pool.length += length;
+}
+
+static void put_string(const struct dc_posix_env *env, struct dc_error *err, const char *string)
+{
+    uint32_t length;
+
+    if (string == NULL)
+    {
+        length = NO_STRING;
+        put(env, err, &length, sizeof(length));
+        return;
+    }
+
+    length = (uint32_t)dc_strlen(env, string);
+    put(env, err, &length, sizeof(length));
+    put(env, err, string, (size_t)length + 1);
+}
+
+static bool take(char **cursor, const char *end, void *data, size_t length)
+{
+    if ((size_t)(end - *cursor) < length)
+    {
+        return false;
+    }
+
+    memcpy(data, *cursor, length);
+    *cursor += length;
+
+    return true;
+}
+
+static bool take_string(char **cursor, const char *end, char **string)
+{
+    uint32_t length;
+
+    if (!take(cursor, end, &length, sizeof(length)))
+    {
+        return false;
+    }
+
+    if (length == NO_STRING)
+    {
+        *string = NULL;
+        return true;
+    }
+
+    if ((size_t)(end - *cursor) <= length)
+    {
+        return false;
+    }
+
+    *string = *cursor;
+    *cursor += (size_t)length + 1;
+
+    return true;
+}
+
+static bool send_fds(int fd, const void *data, size_t length, const int *fds, size_t count)
+{
+    union
+    {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(2 * sizeof(int))];
+    } control;
+    struct msghdr message;
+    struct iovec vector;
+    const char *position;
+    ssize_t nsent;
+
+    memset(&message, 0, sizeof(message));
+    position = data;
+    vector.iov_base = (void *)(uintptr_t)position;
+    vector.iov_len = length;
+    message.msg_iov = &vector;
+    message.msg_iovlen = 1;
+
+    if (count > 0)
+    {
+        struct cmsghdr *header;
+
+        memset(&control, 0, sizeof(control));
+        message.msg_control = control.buffer;
+        message.msg_controllen = CMSG_SPACE(count * sizeof(int));
+        header = CMSG_FIRSTHDR(&message);
+        header->cmsg_level = SOL_SOCKET;
+        header->cmsg_type = SCM_RIGHTS;
+        header->cmsg_len = CMSG_LEN(count * sizeof(int));
+        memcpy(CMSG_DATA(header), fds, count * sizeof(int));
+    }
+
+    do
+    {
+        nsent = sendmsg(fd, &message, MSG_NOSIGNAL);
+    }
+    while (nsent == -1 && errno == EINTR);
+
+    //the descriptors went with the first byte, the rest is plain data
+    while (nsent != -1 && (size_t)nsent < length)
+    {
+        ssize_t more;
+
+        position += nsent;
+        length -= (size_t)nsent;
+        more = send(fd, position, length, MSG_NOSIGNAL);
+        if (more == -1 && errno == EINTR)
+        {
+            more = 0;
+        }
+
+        nsent = more;
+    }
+
+    return nsent != -1;
+}
+
+static bool receive_fds(int fd, void *data, size_t length, int *fds, size_t *count, int flags)
+{
+    union
+    {
+        struct cmsghdr header;
+        char buffer[CMSG_SPACE(2 * sizeof(int))];
+    } control;
+    struct msghdr message;
+    struct iovec vector;
+    struct cmsghdr *header;
+    ssize_t nread;
+    size_t wanted;
+
+    memset(&message, 0, sizeof(message));
+    vector.iov_base = data;
+    vector.iov_len = length;
+    message.msg_iov = &vector;
+    message.msg_iovlen = 1;
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+    wanted = *count;
+    *count = 0;
+
+    do
+    {
+        nread = recvmsg(fd, &message, flags | MSG_CMSG_CLOEXEC);
+    }
+    while (nread == -1 && errno == EINTR);
+
+    if (nread <= 0)
+    {
+        return false;
+    }
+
+    for (header = CMSG_FIRSTHDR(&message); header != NULL; header = CMSG_NXTHDR(&message, header))
+    {
+        if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS)
+        {
+            size_t received;
+
+            received = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            memcpy(fds, CMSG_DATA(header), (received < wanted ? received : wanted) * sizeof(int));
+            *count = received < wanted ? received : wanted;
+        }
+    }
+
+    return read_all(fd, (char *)data + nread, length - (size_t)nread);
+}
+
+static bool read_all(int fd, void *data, size_t length)
+{
+    char *position;
+
+    position = data;
+    while (length > 0)
+    {
+        ssize_t nread;
+
+        nread = read(fd, position, length);
+        if (nread == -1 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (nread <= 0)
+        {
+            return false;
+        }
+
+        position += nread;
+        length -= (size_t)nread;
+    }
+
+    return true;
+}
+
+#else
+
+bool worker_pool_start(const struct dc_posix_env *env, struct dc_error *err, size_t size)
+{
+    (void)env;
+    (void)size;
+
+    //without CLONE_PARENT a worker would not be a child of the shell
+    DC_ERROR_RAISE_ERRNO(err, ENOSYS);
+
+    return false;
+}
+
+pid_t worker_pool_launch(const struct dc_posix_env *env, struct dc_error *err, const struct command *command,
+                         const char *program, int in_fd, int out_fd)
+{
+    (void)env;
+    (void)err;
+    (void)command;
+    (void)program;
+    (void)in_fd;
+    (void)out_fd;
+
+    return -1;
+}
+
+void worker_pool_stop(const struct dc_posix_env *env)
+{
+    (void)env;
+}
+
+#endif
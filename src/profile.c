@@ -0,0 +1,286 @@
+#include "../include/profile.h"
+#include "../include/stats.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define PROFILE_FUNCTIONS 1024
+#define PROFILE_MAX_EVENTS (1024 * 1024)
+#define PROFILE_FIRST_EVENTS 4096
+#define NANOSECONDS_PER_MICROSECOND 1000.0
+#define NANOSECONDS_PER_MILLISECOND 1000000.0
+
+/*! \struct profile_function
+    \brief The calls to one traced function.
+*/
+struct profile_function
+{
+    const char *name;         /**< the function name, __func__ of the function so the pointer is the key */
+    uint64_t calls;           /**< the number of calls */
+    uint64_t nanoseconds;     /**< the total time of the calls */
+};
+
+/*! \struct profile_event
+    \brief One call, for the Chrome trace.
+*/
+struct profile_event
+{
+    const char *name;         /**< the function name */
+    uint64_t start;           /**< when the call started, nanoseconds since profile_start */
+    uint64_t nanoseconds;     /**< how long the call took */
+};
+
+/*! \struct profile
+    \brief Everything that has been traced since profile_start.
+*/
+struct profile
+{
+    bool running;                                         /**< is the tracer counting */
+    bool keep_events;                                     /**< is every call kept in events */
+    uint64_t start;                                       /**< when profile_start was called */
+    struct profile_function functions[PROFILE_FUNCTIONS]; /**< the functions, hashed by the name pointer */
+    size_t function_count;                                /**< the number of functions in use */
+    struct profile_function *current;                     /**< the function that is running, NULL if none */
+    uint64_t current_start;                               /**< when current started */
+    struct profile_event *events;                         /**< the calls, in the order they started */
+    size_t event_count;                                   /**< the number of calls in events */
+    size_t event_capacity;                                /**< the number of calls events can hold */
+    size_t dropped_events;                                /**< the calls there was no room for */
+};
+
+/**
+ * The profile, the tracer has nowhere else to keep it.
+ */
+static struct profile profile;
+
+/**
+ * Finish the current call: add its time to the function and keep it as an event.
+ * The memory is from malloc, the dc_* functions would call the tracer again.
+ *
+ * @param now the time the call ended.
+ */
+static void end_call(uint64_t now);
+
+/**
+ * Find the entry of a function, adding it if it is new.
+ *
+ * @param name the function name.
+ * @return the entry, or NULL if the table is full.
+ */
+static struct profile_function *find_function(const char *name);
+
+/**
+ * Compare two functions for qsort, the one with the most time first.
+ *
+ * @param a a struct profile_function **.
+ * @param b a struct profile_function **.
+ * @return < 0, 0 or > 0 the same as strcmp.
+ */
+static int compare_functions(const void *a, const void *b);
+
+bool profile_start(bool keep_events)
+{
+    if (profile.running)
+    {
+        return false;
+    }
+
+    profile_reset();
+    profile.running = true;
+    profile.keep_events = keep_events;
+    profile.start = stats_now();
+
+    return true;
+}
+
+void profile_tracer(const struct dc_posix_env *env, const char *file_name, const char *function_name,
+                    size_t line_number)
+{
+    uint64_t now;
+
+    (void)env;
+    (void)file_name;
+    (void)line_number;
+
+    if (!profile.running)
+    {
+        return;
+    }
+
+    now = stats_now();
+    end_call(now);
+    profile.current = find_function(function_name);
+
+    if (profile.current != NULL)
+    {
+        profile.current->calls++;
+    }
+
+    //the bookkeeping is not part of the call
+    profile.current_start = stats_now();
+}
+
+void profile_stop(void)
+{
+    if (!profile.running)
+    {
+        return;
+    }
+
+    end_call(stats_now());
+    profile.current = NULL;
+    profile.running = false;
+}
+
+void profile_print_report(FILE *stream)
+{
+    const struct profile_function *sorted[PROFILE_FUNCTIONS];
+    uint64_t total;
+    size_t count;
+
+    count = 0;
+    total = 0;
+
+    for (size_t i = 0; i < PROFILE_FUNCTIONS; i++)
+    {
+        if (profile.functions[i].name != NULL)
+        {
+            sorted[count] = &profile.functions[i];
+            total += profile.functions[i].nanoseconds;
+            count++;
+        }
+    }
+
+    qsort(sorted, count, sizeof(sorted[0]), compare_functions);
+
+    fprintf(stream, "%-32s %10s %12s %10s %7s\n", "function", "calls", "total(ms)", "avg(us)", "%");
+
+    for (size_t i = 0; i < count; i++)
+    {
+        double nanoseconds;
+
+        nanoseconds = (double)sorted[i]->nanoseconds;
+        fprintf(stream, "%-32s %10lu %12.3f %10.2f %6.1f%%\n", sorted[i]->name, (unsigned long)sorted[i]->calls,
+                nanoseconds / NANOSECONDS_PER_MILLISECOND,
+                nanoseconds / NANOSECONDS_PER_MICROSECOND / (double)sorted[i]->calls,
+                total == 0 ? 0.0 : nanoseconds * 100.0 / (double)total);
+    }
+}
+
+void profile_print_trace(FILE *stream)
+{
+    long pid;
+
+    pid = (long)getpid();
+    fprintf(stream, "{\"traceEvents\":[");
+
+    for (size_t i = 0; i < profile.event_count; i++)
+    {
+        const struct profile_event *event;
+
+        event = &profile.events[i];
+        fprintf(stream,
+                "%s\n{\"name\":\"%s\",\"cat\":\"dc_posix\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%ld,\"tid\":%ld}",
+                i == 0 ? "" : ",", event->name, (double)event->start / NANOSECONDS_PER_MICROSECOND,
+                (double)event->nanoseconds / NANOSECONDS_PER_MICROSECOND, pid, pid);
+    }
+
+    fprintf(stream, "\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped_events\":%lu}}\n",
+            (unsigned long)profile.dropped_events);
+}
+
+void profile_reset(void)
+{
+    free(profile.events);
+    profile = (struct profile){0};
+}
+
+static void end_call(uint64_t now)
+{
+    struct profile_event *event;
+
+    if (profile.current == NULL)
+    {
+        return;
+    }
+
+    profile.current->nanoseconds += now - profile.current_start;
+
+    if (!profile.keep_events)
+    {
+        return;
+    }
+
+    if (profile.event_count == profile.event_capacity)
+    {
+        struct profile_event *events;
+        size_t capacity;
+
+        capacity = profile.event_capacity == 0 ? PROFILE_FIRST_EVENTS : profile.event_capacity * 2;
+        events = NULL;
+
+        if (capacity <= PROFILE_MAX_EVENTS)
+        {
+            events = realloc(profile.events, capacity * sizeof(struct profile_event));
+        }
+
+        if (events == NULL)
+        {
+            profile.dropped_events++;
+            return;
+        }
+
+        profile.events = events;
+        profile.event_capacity = capacity;
+    }
+
+    event = &profile.events[profile.event_count];
+    event->name = profile.current->name;
+    event->start = profile.current_start - profile.start;
+    event->nanoseconds = now - profile.current_start;
+    profile.event_count++;
+}
+
+static struct profile_function *find_function(const char *name)
+{
+    size_t index;
+
+    //the names are __func__, each function has its own
+    index = ((size_t)(uintptr_t)name >> 3) % PROFILE_FUNCTIONS;
+
+    for (size_t probe = 0; probe < PROFILE_FUNCTIONS; probe++)
+    {
+        struct profile_function *function;
+
+        function = &profile.functions[(index + probe) % PROFILE_FUNCTIONS];
+        if (function->name == name)
+        {
+            return function;
+        }
+
+        if (function->name == NULL)
+        {
+            function->name = name;
+            profile.function_count++;
+            return function;
+        }
+    }
+
+    return NULL;
+}
+
+static int compare_functions(const void *a, const void *b)
+{
+    const struct profile_function *left;
+    const struct profile_function *right;
+
+    left = *(const struct profile_function *const *)a;
+    right = *(const struct profile_function *const *)b;
+
+    if (left->nanoseconds != right->nanoseconds)
+    {
+        return left->nanoseconds > right->nanoseconds ? -1 : 1;
+    }
+
+    return left->calls > right->calls ? -1 : left->calls < right->calls;
+}
@@ -0,0 +1,358 @@
+#include "../include/server.h"
+#include <arpa/inet.h>
+#include <dc_posix/dc_stdlib.h>
+#include <dc_posix/dc_string.h>
+#include <dc_posix/dc_unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define SERVER_BACKLOG 64
+#define CAPTURE_BUFFER_SIZE (64 * 1024)
+#define FRAME_HEADER_SIZE 5
+
+/**
+ * Open a file that the output of a line is captured in, it is not in the file system.
+ *
+ * @param err the error object
+ * @return the file, open for reading and writing, or -1 on error.
+ */
+static int open_capture(struct dc_error *err);
+
+/**
+ * Put a file on a descriptor (eg. STDOUT_FILENO) and close the file.
+ *
+ * @param err the error object
+ * @param fd the file.
+ * @param target the descriptor to put it on.
+ */
+static void move_fd(struct dc_error *err, int fd, int target);
+
+/**
+ * Send what was captured on a descriptor as frames, and empty it for the next line.
+ *
+ * @param err the error object
+ * @param connection the connection.
+ * @param type the type of the frames.
+ * @param fd the descriptor with the captured output.
+ */
+static void send_capture(struct dc_error *err, struct server_connection *connection, enum frame_type type, int fd);
+
+/**
+ * Send one frame.
+ *
+ * @param err the error object
+ * @param fd the socket.
+ * @param type the type of the frame.
+ * @param payload the payload.
+ * @param length the length of the payload.
+ */
+static void send_frame(struct dc_error *err, int fd, enum frame_type type, const void *payload, size_t length);
+
+/**
+ * Send all of a buffer. A client that went away is an error instead of SIGPIPE.
+ *
+ * @param err the error object
+ * @param fd the socket.
+ * @param data the buffer.
+ * @param length the length of the buffer.
+ */
+static void send_all(struct dc_error *err, int fd, const void *data, size_t length);
+
+int server_listen(const struct dc_posix_env *env, struct dc_error *err, const char *path)
+{
+    struct sockaddr_un address;
+    struct stat file_info;
+    int fd;
+
+    DC_TRACE(env);
+
+    if (dc_strlen(env, path) >= sizeof(address.sun_path))
+    {
+        DC_ERROR_RAISE_ERRNO(err, ENAMETOOLONG);
+        return -1;
+    }
+
+    dc_memset(env, &address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    dc_strcpy(env, address.sun_path, path);
+
+    if (lstat(path, &file_info) == 0 && S_ISSOCK(file_info.st_mode))
+    {
+        unlink(path);
+    }
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1)
+    {
+        DC_ERROR_RAISE_ERRNO(err, errno);
+        return -1;
+    }
+
+    if (fcntl(fd, F_SETFD, FD_CLOEXEC) == -1 ||
+        bind(fd, (struct sockaddr *)&address, sizeof(address)) == -1 ||
+        listen(fd, SERVER_BACKLOG) == -1)
+    {
+        DC_ERROR_RAISE_ERRNO(err, errno);
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+int server_accept(const struct dc_posix_env *env, struct dc_error *err, int listen_fd)
+{
+    int fd;
+
+    DC_TRACE(env);
+
+    //the connection processes are only reaped here, at most the ones that finished since the last client linger
+    while (waitpid(-1, NULL, WNOHANG) > 0)
+    {
+    }
+
+    do
+    {
+        fd = accept(listen_fd, NULL, NULL);
+    }
+    while (fd == -1 && (errno == EINTR || errno == ECONNABORTED));
+
+    if (fd == -1)
+    {
+        DC_ERROR_RAISE_ERRNO(err, errno);
+        return -1;
+    }
+
+    if (fcntl(fd, F_SETFD, FD_CLOEXEC) == -1)
+    {
+        DC_ERROR_RAISE_ERRNO(err, errno);
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+struct server_connection *server_connection_create(const struct dc_posix_env *env, struct dc_error *err, int fd)
+{
+    struct server_connection *connection;
+    int null_fd;
+
+    connection = dc_calloc(env, err, 1, sizeof(struct server_connection));
+    if (dc_error_has_error(err))
+    {
+        close(fd);
+        return NULL;
+    }
+
+    connection->fd = fd;
+    connection->capacity = CAPTURE_BUFFER_SIZE;
+    connection->buffer = dc_malloc(env, err, connection->capacity);
+    if (dc_error_has_error(err))
+    {
+        server_connection_destroy(env, &connection);
+        return NULL;
+    }
+
+    //the programs must not read the command lines meant for the shell
+    null_fd = open("/dev/null", O_RDONLY);
+    if (null_fd == -1)
+    {
+        DC_ERROR_RAISE_ERRNO(err, errno);
+    }
+    else
+    {
+        move_fd(err, null_fd, STDIN_FILENO);
+    }
+
+    if (dc_error_has_no_error(err))
+    {
+        move_fd(err, open_capture(err), STDOUT_FILENO);
+    }
+
+    if (dc_error_has_no_error(err))
+    {
+        move_fd(err, open_capture(err), STDERR_FILENO);
+    }
+
+    if (dc_error_has_error(err))
+    {
+        server_connection_destroy(env, &connection);
+        return NULL;
+    }
+
+    return connection;
+}
+
+void server_connection_reply(const struct dc_posix_env *env, struct dc_error *err,
+                             struct server_connection *connection, int exit_code)
+{
+    uint32_t code;
+
+    DC_TRACE(env);
+
+    //what the builtins wrote is still in the streams
+    fflush(stdout);
+    fflush(stderr);
+
+    send_capture(err, connection, FRAME_STDOUT, STDOUT_FILENO);
+    if (dc_error_has_no_error(err))
+    {
+        send_capture(err, connection, FRAME_STDERR, STDERR_FILENO);
+    }
+
+    if (dc_error_has_no_error(err))
+    {
+        code = htonl((uint32_t)exit_code);
+        send_frame(err, connection->fd, FRAME_EXIT, &code, sizeof(code));
+    }
+}
+
+void server_connection_destroy(const struct dc_posix_env *env, struct server_connection **pconnection)
+{
+    struct server_connection *connection;
+
+    connection = *pconnection;
+    if (connection == NULL)
+    {
+        return;
+    }
+
+    if (connection->buffer != NULL)
+    {
+        dc_free(env, connection->buffer, connection->capacity);
+    }
+
+    close(connection->fd);
+    dc_free(env, connection, sizeof(struct server_connection));
+    *pconnection = NULL;
+}
+
+static int open_capture(struct dc_error *err)
+{
+    FILE *file;
+    int fd;
+
+    //tmpfile is unlinked as soon as it is created, only the descriptor is kept
+    file = tmpfile();
+    if (file == NULL)
+    {
+        DC_ERROR_RAISE_ERRNO(err, errno);
+        return -1;
+    }
+
+    fd = dup(fileno(file));
+    if (fd == -1)
+    {
+        DC_ERROR_RAISE_ERRNO(err, errno);
+    }
+
+    fclose(file);
+
+    return fd;
+}
+
+static void move_fd(struct dc_error *err, int fd, int target)
+{
+    if (dup2(fd, target) == -1)
+    {
+        DC_ERROR_RAISE_ERRNO(err, errno);
+    }
+
+    close(fd);
+}
+
+static void send_capture(struct dc_error *err, struct server_connection *connection, enum frame_type type, int fd)
+{
+    off_t offset;
+
+    offset = 0;
+
+    while (true)
+    {
+        ssize_t nread;
+
+        nread = pread(fd, connection->buffer, connection->capacity, offset);
+        if (nread == -1 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (nread == -1)
+        {
+            DC_ERROR_RAISE_ERRNO(err, errno);
+            return;
+        }
+
+        if (nread == 0)
+        {
+            break;
+        }
+
+        send_frame(err, connection->fd, type, connection->buffer, (size_t)nread);
+        if (dc_error_has_error(err))
+        {
+            return;
+        }
+
+        offset += nread;
+    }
+
+    //the offset is shared with every program that inherited the descriptor, they all start over at 0
+    if (offset > 0 && (ftruncate(fd, 0) == -1 || lseek(fd, 0, SEEK_SET) == -1))
+    {
+        DC_ERROR_RAISE_ERRNO(err, errno);
+    }
+}
+
+static void send_frame(struct dc_error *err, int fd, enum frame_type type, const void *payload, size_t length)
+{
+    unsigned char header[FRAME_HEADER_SIZE];
+    uint32_t size;
+
+    size = htonl((uint32_t)length);
+    header[0] = (unsigned char)type;
+    memcpy(&header[1], &size, sizeof(size));
+
+    send_all(err, fd, header, sizeof(header));
+    if (dc_error_has_no_error(err))
+    {
+        send_all(err, fd, payload, length);
+    }
+}
+
+static void send_all(struct dc_error *err, int fd, const void *data, size_t length)
+{
+    const char *position;
+
+    position = data;
+
+    while (length > 0)
+    {
+        ssize_t nwritten;
+
+        nwritten = send(fd, position, length, MSG_NOSIGNAL);
+        if (nwritten == -1 && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (nwritten == -1)
+        {
+            DC_ERROR_RAISE_ERRNO(err, errno);
+            return;
+        }
+
+        position += nwritten;
+        length -= (size_t)nwritten;
+    }
+}
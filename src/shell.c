@@ -1,20 +1,274 @@
 #include "../include/shell.h"
+#include "../include/server.h"
+#include "../include/stats.h"
+#include "../include/util.h"
+#include <dc_posix/dc_stdlib.h>
+#include <dc_posix/dc_unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
 #include <../include/shell_impl.h>
 
-int run_shell(const struct dc_posix_env *env, struct dc_error *error, FILE *in, FILE *out, FILE *err)
+#define TRANSITION_COUNT 21
+
+/**
+ * Set up the initial interactive state and apply the options (see init_state).
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param arg the current struct state
+ * @return READ_COMMANDS or INIT_ERROR
+ */
+static int init_interactive(const struct dc_posix_env *env, struct dc_error *err, void *arg);
+
+/**
+ * Set up the initial batch state and apply the options (see init_batch_state).
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param arg the current struct state
+ * @return READ_COMMANDS or INIT_ERROR
+ */
+static int init_batch(const struct dc_posix_env *env, struct dc_error *err, void *arg);
+
+/**
+ * Copy the state->options over the defaults set by init_state.
+ *
+ * @param states the state.
+ */
+static void apply_options(struct state *states);
+
+/**
+ * Run the function of the transition the FSM is making and record how long it took in state->stats.
+ * dc_fsm_run does not say which transition it is making, it is always the one to the state the last function returned.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param arg the current struct state
+ * @return the next state, from the function of the transition.
+ */
+static int timed_perform(const struct dc_posix_env *env, struct dc_error *err, void *arg);
+
+/**
+ * Run the shell FSM over the state.
+ *
+ * @param env the posix environment.
+ * @param error the error object
+ * @param states the state, with the streams and input already set.
+ * @param init the function that sets up the initial state (init_interactive or init_batch).
+ * @return the exit code of the last pipeline that ran (or the argument of exit), or an error from the FSM.
+ */
+static int run_fsm(const struct dc_posix_env *env, struct dc_error *error, struct state *states,
+                   int (*init)(const struct dc_posix_env *env, struct dc_error *err, void *arg));
+
+/**
+ * Serve a client in the process forked for it: the FSM runs on a copy of the server's state,
+ * starting at reading the lines from the socket (see init_batch_input).
+ *
+ * @param env the posix environment.
+ * @param error the error object
+ * @param states the copy of the server's state.
+ * @param fd the connected socket.
+ * @return the exit code from the shell.
+ */
+static int serve_connection(const struct dc_posix_env *env, struct dc_error *error, struct state *states, int fd);
+
+int run_shell(const struct dc_posix_env *env, struct dc_error *error, FILE *in, FILE *out, FILE *err,
+              const struct shell_options *options)
+{
+    struct state states;
+
+    states.stdin = in;
+    states.stdout = out;
+    states.stderr = err;
+    states.input_fd = -1;
+    states.input_string = NULL;
+    states.options = options;
+
+    return run_fsm(env, error, &states, init_interactive);
+}
+
+int run_shell_batch(const struct dc_posix_env *env, struct dc_error *error, int in_fd, const char *commands,
+                    FILE *out, FILE *err, const struct shell_options *options)
+{
+    struct state states;
+
+    states.stdin = NULL;
+    states.stdout = out;
+    states.stderr = err;
+    states.input_fd = in_fd;
+    states.input_string = commands;
+    states.options = options;
+
+    return run_fsm(env, error, &states, init_batch);
+}
+
+int run_shell_server(const struct dc_posix_env *env, struct dc_error *error, const char *path, FILE *err,
+                     const struct shell_options *options)
+{
+    struct state states;
+    int listen_fd;
+
+    //stdout and stderr of each connection process are captured and sent to its client
+    states.stdin = NULL;
+    states.stdout = stdout;
+    states.stderr = stderr;
+    states.input_fd = -1;
+    states.input_string = NULL;
+    states.options = options;
+
+    //what every client needs is done once, each connection process starts with a copy of it
+    if (init_state(env, error, &states) != READ_COMMANDS)
+    {
+        fprintf(err, "%s\n", error->message);
+        return EXIT_FAILURE;
+    }
+
+    apply_options(&states);
+    get_state_path(env, error, &states);
+    dc_error_reset(error);
+
+    listen_fd = server_listen(env, error, path);
+
+    while (dc_error_has_no_error(error))
+    {
+        int fd;
+        pid_t pid;
+
+        fd = server_accept(env, error, listen_fd);
+        if (dc_error_has_error(error))
+        {
+            break;
+        }
+
+        //anything still buffered would be written a second time by the child
+        fflush(NULL);
+        pid = dc_fork(env, error);
+
+        if (pid == 0)
+        {
+            close(listen_fd);
+            dc_exit(env, serve_connection(env, error, &states, fd));
+        }
+
+        close(fd);
+
+        if (dc_error_has_error(error))
+        {
+            //eg. EAGAIN, only this client is turned away
+            fprintf(err, "%s: %s\n", path, error->message);
+            dc_error_reset(error);
+        }
+    }
+
+    fprintf(err, "%s: %s\n", path, error->message);
+    if (listen_fd != -1)
+    {
+        close(listen_fd);
+    }
+
+    destroy_state(env, error, &states);
+
+    return EXIT_FAILURE;
+}
+
+static int serve_connection(const struct dc_posix_env *env, struct dc_error *error, struct state *states, int fd)
+{
+    int ret_val;
+
+    states->connection = server_connection_create(env, error, fd);
+    if (dc_error_has_error(error))
+    {
+        return EXIT_FAILURE;
+    }
+
+    states->input_fd = fd;
+    ret_val = run_fsm(env, error, states, init_batch_input);
+    server_connection_destroy(env, &states->connection);
+
+    return ret_val;
+}
+
+static int init_interactive(const struct dc_posix_env *env, struct dc_error *err, void *arg)
+{
+    int next_state;
+
+    next_state = init_state(env, err, arg);
+    apply_options((struct state *)arg);
+
+    return next_state;
+}
+
+static int init_batch(const struct dc_posix_env *env, struct dc_error *err, void *arg)
+{
+    int next_state;
+
+    next_state = init_batch_state(env, err, arg);
+    apply_options((struct state *)arg);
+
+    return next_state;
+}
+
+static void apply_options(struct state *states)
+{
+    if (states->options == NULL)
+    {
+        return;
+    }
+
+    states->launcher = states->options->launcher;
+}
+
+static int timed_perform(const struct dc_posix_env *env, struct dc_error *err, void *arg)
+{
+    struct state *states;
+    struct fsm_stats *stats;
+    int from;
+    int to;
+
+    states = (struct state *)arg;
+    stats = states->stats;
+    from = stats->from;
+    to = stats->to;
+
+    for (const struct dc_fsm_transition *transition = stats->functions; transition->perform != NULL; transition++)
+    {
+        if (transition->from_id == from && transition->to_id == to)
+        {
+            uint64_t start;
+            int next_state;
+
+            start = stats_now();
+            next_state = transition->perform(env, err, arg);
+            fsm_stats_record(env, stats, from, to, stats_now() - start);
+
+            stats->from = to;
+            stats->to = next_state;
+
+            return next_state;
+        }
+    }
+
+    return DC_FSM_EXIT;
+}
+
+static int run_fsm(const struct dc_posix_env *env, struct dc_error *error, struct state *states,
+                   int (*init)(const struct dc_posix_env *env, struct dc_error *err, void *arg))
 {
     int ret_val;
     struct dc_fsm_info *fsm_info;
-    static struct dc_fsm_transition transitions[] = {
-            {DC_FSM_INIT,       INIT_STATE,         init_state},
+    struct dc_fsm_transition timed_transitions[TRANSITION_COUNT];
+    struct dc_fsm_transition transitions[TRANSITION_COUNT] = {
+            {DC_FSM_INIT,       INIT_STATE,         init},
             {INIT_STATE,        READ_COMMANDS,      read_commands},
             {INIT_STATE,        ERROR,              handle_error},
             {READ_COMMANDS,     RESET_STATE,        reset_state},
             {READ_COMMANDS,     SEPARATE_COMMANDS,  separate_commands},
+            {READ_COMMANDS,     EXIT,               do_exit},
             {READ_COMMANDS,     ERROR,              handle_error},
             {SEPARATE_COMMANDS, PARSE_COMMANDS,     parse_commands},
+            {SEPARATE_COMMANDS, EXECUTE_COMMANDS,   execute_commands},
+            {SEPARATE_COMMANDS, RESET_STATE,        reset_state},
             {SEPARATE_COMMANDS, ERROR,              handle_error},
             {PARSE_COMMANDS,    EXECUTE_COMMANDS,   execute_commands},
             {PARSE_COMMANDS,    ERROR,              handle_error},
@@ -29,21 +283,48 @@ int run_shell(const struct dc_posix_env *env, struct dc_error *error, FILE *in,
     };
 
     ret_val = EXIT_SUCCESS;
+
+    //every function goes through timed_perform, which looks up the real one
+    states->stats = fsm_stats_create(env, error);
+    if (dc_error_has_error(error))
+    {
+        return EXIT_FAILURE;
+    }
+
+    states->stats->functions = transitions;
+    for (size_t i = 0; i < TRANSITION_COUNT; i++)
+    {
+        timed_transitions[i] = transitions[i];
+        if (transitions[i].perform != NULL)
+        {
+            timed_transitions[i].perform = timed_perform;
+        }
+    }
+
     fsm_info = dc_fsm_info_create(env, error, "SHELL");
 
     if (dc_error_has_no_error(error))
     {
-        struct state states;
         int from_state;
         int to_state;
 
-        states.stdin = in;
-        states.stdout = out;
-        states.stderr = err;
-        ret_val = dc_fsm_run(env, error, fsm_info, &from_state, &to_state, &states, transitions);
+        ret_val = dc_fsm_run(env, error, fsm_info, &from_state, &to_state, states, timed_transitions);
         dc_fsm_info_destroy(env, &fsm_info);
+
+        //a script fails if its last command did (or exit says it does)
+        if (ret_val == EXIT_SUCCESS)
+        {
+            ret_val = states->last_exit_code;
+        }
     }
 
+    if (states->options != NULL && states->options->verbose)
+    {
+        fsm_stats_print(states->stats, states->stderr);
+    }
+
+    fsm_stats_destroy(env, &states->stats);
+
     return ret_val;
 
 }
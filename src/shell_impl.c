@@ -1,31 +1,261 @@
 #include <dc_posix/dc_stdlib.h>
+#include <sys/resource.h>
 #include <unistd.h>
 #include <dc_posix/dc_string.h>
+#include <dc_posix/dc_fcntl.h>
+#include <dc_posix/dc_unistd.h>
 #include <stdlib.h>
 #include "../include/util.h"
 #include "../include/input.h"
 #include <dc_posix/dc_posix_env.h>
 #include <dc_util/filesystem.h>
 #include <builtins.h>
+#include "../include/arena.h"
+#include "../include/history.h"
+#include "../include/jobs.h"
+#include "../include/command_cache.h"
+#include "../include/command_hash.h"
+#include "../include/lexer.h"
+#include "../include/server.h"
+#include "../include/stats.h"
+#include "../include/usage.h"
 #include "../include/shell_impl.h"
 
+#define COMMAND_ARENA_SIZE 4096
+#define COMMAND_CACHE_SIZE 64
+#define SYNTAX_ERROR_EXIT_CODE 2
+
+/**
+ * Report a syntax error in the command line.
+ *
+ * @param states the state with the stderr stream.
+ * @param token the token the error was found at.
+ * @return RESET_STATE, the line is skipped.
+ */
+static int syntax_error(struct state *states, const struct token *token);
+
 /**
- * Free all the individual paths.
+ * Add a command to the state->command array, growing it when it is full.
  *
  * @param env the posix environment.
- * @param arg the current struct state
+ * @param err the error object
+ * @param states the state to add the command to.
+ * @param capacity the number of commands the array can hold.
+ * @param line the start of the command in the current line.
+ * @param length the length of the command.
+ */
+static void add_command(const struct dc_posix_env *env, struct dc_error *err, struct state *states, size_t *capacity,
+                        const char *line, size_t length);
+
+/**
+ * Copy part of the current line in to a new command and clear the rest of its fields.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param arena where the command's memory is allocated, NULL for the heap.
+ * @param command the command to set up.
+ * @param line the start of the command in the current line.
+ * @param length the length of the command.
+ */
+static void init_command(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena,
+                         struct command *command, const char *line, size_t length);
+
+/**
+ * Find the programs for a command on the path using the command hash (only for commands without a '/').
+ * The path is separated the first time a program is run (see get_state_path). The path that is found is copied in to
+ * the command's arena, a later lookup for the next command of the pipeline can free the hash entry.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param states the state with the command hash and path.
+ * @param command the command to set the resolved_path of.
+ */
+static void resolve_command(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                            struct command *command);
+
+/**
+ * The connector that an operator token gives the command before it.
+ *
+ * @param type the token that ended the command.
+ * @return the connector.
+ */
+static enum connector token_connector(enum token_type type);
+
+/**
+ * Find the last command of the pipeline that starts at a command (the commands joined by '|').
+ *
+ * @param states the state with the commands.
+ * @param first the first command of the pipeline.
+ * @return the index of the last command of the pipeline.
+ */
+static size_t pipeline_end(const struct state *states, size_t first);
+
+/**
+ * Find the last command of the and-or list that starts at a command (the pipelines joined by "&&" and "||").
+ *
+ * @param states the state with the commands.
+ * @param first the first command of the list.
+ * @return the index of the last command of the list.
+ */
+static size_t list_end(const struct state *states, size_t first);
+
+/**
+ * Run the pipelines of the commands first to last in turn. After "&&" the next pipeline only runs if the exit code
+ * is 0, after "||" only if it is not, any other connector runs it regardless. A pipeline that is skipped keeps the
+ * exit code of the one before it. The pipelines after the first one on the line are parsed just before they run,
+ * so their expansions see what the ones before them did (e.g. "cd /tmp && ls *").
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param states the state with the commands.
+ * @param first the first command to run.
+ * @param last the last command to run.
+ * @param exit_code set to the exit code of the last pipeline that ran.
+ * @return EXIT (if a command is exit), RESET_STATE or ERROR
+ */
+static int execute_list(const struct dc_posix_env *env, struct dc_error *err, struct state *states, size_t first,
+                        size_t last, int *exit_code);
+
+/**
+ * Run a single pipeline (see run_pipeline_commands).
+ * A pipeline that starts with "time" has the word removed and the resources it used displayed on stderr after it,
+ * each command is added to the state->options->usage_log if there is one (see usage_log).
+ * The programs are started with the state->options->limits, "timeout DURATION" before the command replaces the
+ * timeout of the options.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param states the state with the path, command hash and job table.
+ * @param commands the commands of the pipeline.
+ * @param count the number of commands in the pipeline.
+ * @return EXIT (if the command is exit), RESET_STATE or ERROR
+ */
+static int execute_pipeline_commands(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                                     struct command *commands, size_t count);
+
+/**
+ * Run a single pipeline: one builtin or program (see launch), or the programs of a pipeline (see execute_pipeline).
+ * A single command that is a builtin (see builtin_find) is run in the shell process, with no fork.
+ * Otherwise the programs are looked up in the command hash before they are started.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param states the state with the path, command hash and job table.
+ * @param commands the commands of the pipeline.
+ * @param count the number of commands in the pipeline.
+ * @param measure set the usage of a builtin as well (a program's is always set).
+ * @return EXIT (if the command is exit), RESET_STATE or ERROR
+ */
+static int run_pipeline_commands(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                                 struct command *commands, size_t count, bool measure);
+
+/**
+ * Run a builtin and set the command->usage from the shell's resources before and after it.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param states the state.
+ * @param builtin the builtin.
+ * @param command the command.
+ * @return the next state from the builtin.
+ */
+static int measure_builtin(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                           const struct builtin *builtin, struct command *command);
+
+/**
+ * Remove a leading "time" from a command, the same as sh it is not a program but a prefix of the pipeline.
+ *
+ * @param env the posix environment.
+ * @param command the first command of the pipeline.
+ * @return true if the command started with time.
+ */
+static bool strip_time(const struct dc_posix_env *env, struct command *command);
+
+/**
+ * Remove a leading "timeout DURATION" from a command, the program is sent SIGTERM if it runs past the duration
+ * (see wait_for_command). A timeout with anything else (e.g. timeout -s KILL 5 ...) is left for the timeout program.
+ *
+ * @param env the posix environment.
+ * @param command the first command of the pipeline.
+ * @param timeout set to the duration in ns if the command started with timeout.
+ * @return true if the command started with timeout.
+ */
+static bool strip_timeout(const struct dc_posix_env *env, struct command *command, uint64_t *timeout);
+
+/**
+ * Does the command start with a prefix of the pipeline (see strip_time and strip_timeout).
+ *
+ * @param env the posix environment.
+ * @param command the first command of the pipeline, parsed.
+ * @return true if the command is time or timeout.
+ */
+static bool has_prefix(const struct dc_posix_env *env, const struct command *command);
+
+/**
+ * Does a job have to be run by a forked copy of the shell instead of being started as a pipeline of programs:
+ * it is a list, it starts with time or timeout, or it is a builtin on its own (in a pipeline a builtin is a program).
+ *
+ * @param env the posix environment.
+ * @param states the state with the commands, the first one parsed.
+ * @param first the first command of the job.
+ * @param last the last command of the job.
+ * @return true if the job needs a copy of the shell.
+ */
+static bool needs_shell(const struct dc_posix_env *env, const struct state *states, size_t first, size_t last);
+
+/**
+ * Make the first argument of a command the command, the same as if the command word was not there.
+ *
+ * @param env the posix environment.
+ * @param command the command.
+ */
+static void shift_command(const struct dc_posix_env *env, struct command *command);
+
+/**
+ * Set the limits of the commands of a pipeline from state->options->limits.
+ *
+ * @param states the state with the options.
+ * @param commands the commands of the pipeline.
+ * @param count the number of commands in the pipeline.
+ * @param timeout the timeout of each program in ns, 0 for none.
+ */
+static void set_command_limits(const struct state *states, struct command *commands, size_t count, uint64_t timeout);
+
+/**
+ * Build the text of a job from its commands and their connectors, ending with " &".
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param states the state with the commands and the arena.
+ * @param first the first command of the job.
+ * @param last the last command of the job.
+ * @param length set to the length of the text.
+ * @return the text, allocated from the state->arena.
+ */
+static char *job_text(const struct dc_posix_env *env, struct dc_error *err, struct state *states, size_t first,
+                      size_t last, size_t *length);
+
+/**
+ * Rebuild state->prompt_line if PS1 or the working directory changed since it was built.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param states the state with the prompt.
  */
-static void free_paths(const struct dc_posix_env *env, char ***pPath);
+static void update_prompt_line(const struct dc_posix_env *env, struct dc_error *err, struct state *states);
 
-#define IN_REDIRECT_REGEX "[ \t\f\v]<.*"
-#define OUT_REDIRECT_REGEX "[ \t\f\v][1^2]?>[>]?.*"
-#define ERR_REDIRECT_REGEX "[ \t\f\v]2>[>]?.*"
+/**
+ * Send the output and exit code of the line to the client when the shell is serving a connection
+ * (see server_connection_reply). A client that went away finds out at the next read.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param states the state with the connection and the exit code.
+ */
+static void reply_line(const struct dc_posix_env *env, struct dc_error *err, struct state *states);
 
 /**
  * Set up the initial state:
- *  - in_redirect_regex  "[ \t\f\v]<.*"
- *  - out_redirect_regex "[ \t\f\v][1^2]?>[>]?.*"
- *  - err_redirect_regex "[ \t\f\v]2>[>]?.*"
  *  - path the PATH env var seaprated into directories
  *  - prompt the PS1 env var or "$" if PS1 not set
  *  - max_line_length the value of _SC_ARG_MAX (see sysconf)
@@ -38,136 +268,141 @@ static void free_paths(const struct dc_posix_env *env, char ***pPath);
 int init_state(const struct dc_posix_env *env, struct dc_error *err, void *arg)
 {
     struct state *states;
-    int return_value_regex;
-    //get the PATH environment variables
-    char *path;
-    char **path_array;
-    regex_t regIn;
-    regex_t regOut;
-    regex_t regErr;
 
     states = (struct state*) arg;
 
-    return_value_regex = regcomp(&regIn, IN_REDIRECT_REGEX, REG_EXTENDED);
-    states->in_redirect_regex = (regex_t *)dc_calloc(env, err, 1, sizeof(regIn));
-    dc_memcpy(env, states->in_redirect_regex, &regIn, sizeof(regIn));
-    if (return_value_regex != 0)
-    {
-        states->fatal_error = true;
-        return ERROR;
-    }
-
-    return_value_regex = regcomp(&regOut, OUT_REDIRECT_REGEX, REG_EXTENDED);
-    states->out_redirect_regex = (regex_t *)dc_calloc(env, err, 1, sizeof(regOut));
-    dc_memcpy(env, states->out_redirect_regex, &regOut, sizeof(regOut));
-    if (return_value_regex != 0)
-    {
-        states->fatal_error = true;
-        return ERROR;
-    }
-
-    return_value_regex = regcomp(&regErr, ERR_REDIRECT_REGEX, REG_EXTENDED);
-    states->err_redirect_regex = (regex_t *)dc_calloc(env, err, 1, sizeof(regErr));
-    dc_memcpy(env, states->err_redirect_regex, &regErr, sizeof(regErr));
-    if (return_value_regex != 0)
+    //the PATH, the job table and the history are left until they are needed (see get_state_path, get_job_table and
+    //get_history)
+    states->path = NULL;
+    states->jobs = NULL;
+    states->history = NULL;
+    states->command_hash = command_hash_create(env, err);
+    states->command_cache = command_cache_create(env, err, COMMAND_CACHE_SIZE);
+    states->line_cacheable = false;
+    states->arena = arena_create(env, err, COMMAND_ARENA_SIZE);
+    if (dc_error_has_error(err))
     {
         states->fatal_error = true;
         return ERROR;
     }
 
-    path = get_path(env, err);
-    path_array = parse_path(env, err, path);
-    states->path = path_array; //already dynamically allocated.
-
     //get the PS1 environment variables
     states->prompt = get_prompt(env, err);
+    states->working_dir = NULL;
+    states->prompt_line = NULL;
+    states->prompt_line_length = 0;
 
     //all other variables to zero
     states->fatal_error = false;
     states->max_line_length = (size_t) sysconf(_SC_ARG_MAX);
+    states->reader = line_reader_create(env, err, states->max_line_length);
+    if (dc_error_has_error(err))
+    {
+        states->fatal_error = true;
+        return ERROR;
+    }
+    states->interactive = true;
+    states->launcher = LAUNCHER_SPAWN;
     states->current_line = NULL;
     states->current_line_length = 0;
     states->command = NULL;
+    states->command_count = 0;
+    states->exit_code = EXIT_SUCCESS;
+    states->last_exit_code = EXIT_SUCCESS;
+    states->connection = NULL;
 
     return READ_COMMANDS;
 }
 
 /**
- * Free any dynamically allocated memory in the state.
+ * Set up the initial state for batch mode (see init_state).
+ * The commands are read in blocks from state->input_string if it is set, otherwise from state->input_fd.
+ * No prompt or exit codes are printed.
  *
  * @param env the posix environment.
  * @param err the error object
  * @param arg the current struct state
- * @return DC_FSM_EXIT
+ * @return READ_COMMANDS or INIT_ERROR
  */
-int destroy_state(const struct dc_posix_env *env, struct dc_error *err,
-                  void *arg)
+int init_batch_state(const struct dc_posix_env *env, struct dc_error *err, void *arg)
+{
+    int next_state;
+
+    next_state = init_state(env, err, arg);
+    if (next_state != READ_COMMANDS)
+    {
+        return next_state;
+    }
+
+    return init_batch_input(env, err, arg);
+}
+
+/**
+ * Switch a state that init_state set up to batch mode, the lines are read from state->input_string if it is set,
+ * otherwise from state->input_fd. Each connection of the server starts here (see run_shell_server).
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param arg the current struct state
+ * @return READ_COMMANDS or ERROR
+ */
+int init_batch_input(const struct dc_posix_env *env, struct dc_error *err, void *arg)
 {
     struct state *states;
-    size_t regex_size;
+
     states = (struct state*) arg;
+    line_reader_destroy(env, &states->reader);
 
-    if (states->in_redirect_regex != NULL)
+    if (states->input_string != NULL)
     {
-        regex_size = sizeof(*states->in_redirect_regex);
-        regfree(states->in_redirect_regex);
-        dc_free(env, states->in_redirect_regex, regex_size);
-        states->in_redirect_regex = NULL;
+        states->reader = line_reader_create_string(env, err, states->input_string, states->max_line_length);
     }
-
-    if (states->out_redirect_regex != NULL)
+    else
     {
-        regex_size = sizeof(*states->out_redirect_regex);
-        regfree(states->out_redirect_regex);
-        dc_free(env, states->out_redirect_regex, regex_size);
-        states->out_redirect_regex = NULL;
+        states->reader = line_reader_create_fd(env, err, states->input_fd, states->max_line_length);
     }
 
-    if (states->err_redirect_regex != NULL)
+    if (dc_error_has_error(err))
     {
-        regex_size = sizeof(*states->err_redirect_regex);
-        regfree(states->err_redirect_regex);
-        dc_free(env, states->err_redirect_regex, regex_size);
-        states->err_redirect_regex = NULL;
+        states->fatal_error = true;
+        return ERROR;
     }
 
-    dc_free(env, states->prompt, dc_strlen(env, states->prompt) + 1);
-    states->prompt = NULL;
-
-    free_paths(env, &states->path);
-
-    do_reset_state(env, err, states);
-    states->max_line_length = 0;
+    states->interactive = false;
 
-    return DC_FSM_EXIT;
+    return READ_COMMANDS;
 }
 
 /**
- * Free each char * in the array of paths
+ * Free any dynamically allocated memory in the state.
  *
- * @param env the posix environment
+ * @param env the posix environment.
  * @param err the error object
- * @param paths pointer to the first element of the array of path
+ * @param arg the current struct state
+ * @return DC_FSM_EXIT
  */
-static void free_paths(const struct dc_posix_env *env, char ***pPath)
+int destroy_state(const struct dc_posix_env *env, struct dc_error *err,
+                  void *arg)
 {
-    char ** paths;
-    //it was strduped and last one has null byte
-    //each element has char* strduped.
-    size_t i;
+    struct state *states;
+    states = (struct state*) arg;
+
+    dc_free(env, states->prompt, dc_strlen(env, states->prompt) + 1);
+    states->prompt = NULL;
+    clear_working_dir(env, states);
 
-    i = 0;
-    paths = (char **)*pPath;
+    free_path(env, &states->path);
+    command_hash_destroy(env, &states->command_hash);
+    command_cache_destroy(env, &states->command_cache);
+    job_table_destroy(env, &states->jobs);
+    history_destroy(env, &states->history);
 
-    while (!paths[i])
-    {
-        dc_free(env, paths[i], dc_strlen(env, paths[i]) + 1);
-        paths[i] = NULL;
+    do_reset_state(env, err, states);
+    arena_destroy(env, &states->arena);
+    line_reader_destroy(env, &states->reader);
+    states->max_line_length = 0;
 
-        i++;
-    }
-    dc_free(env, *pPath, sizeof(char*));
-    *pPath = NULL;
+    return DC_FSM_EXIT;
 }
 
 /**
@@ -185,88 +420,150 @@ int reset_state(const struct dc_posix_env *env, struct dc_error *err,
     struct state *states;
 
     states = (struct state*) arg;
+    reply_line(env, err, states);
     do_reset_state(env, err, states);
     return READ_COMMANDS;
 }
 
 /**
  * Prompt the user and read the command line (see read_command_line).
- * Sets the state->current_line and current_line_length.
+ * The background jobs that have finished are reaped first (see job_table_reap) and reported in interactive mode.
+ * The prompt is only displayed when state->interactive is true, it is only rebuilt when PS1 or the directory change.
+ * Sets the state->current_line and current_line_length, in interactive mode a line that is not empty is added to the
+ * history.
  *
  * @param env the posix environment.
  * @param err the error object
  * @param arg the current struct state
- * @return SEPARATE_COMMANDS
+ * @return SEPARATE_COMMANDS, RESET_STATE (empty line), EXIT (end of input) or ERROR
  */
 int read_commands(const struct dc_posix_env *env, struct dc_error *err,
                   void *arg)
 {
     struct state* states;
-    char * current_working_dir;
-    char * current_prompt;
     size_t line_len;
-    char * cur_line;
+    const char * cur_line;
 
     states = (struct state*) arg;
 
-    current_working_dir = dc_get_working_dir(env, err);
-    if (dc_error_has_error(err))
+    //the background jobs that finished while the last line ran
+    if (states->jobs != NULL)
     {
-        states->fatal_error = true;
-        return ERROR;
+        job_table_reap(env, err, states->jobs);
+        if (dc_error_has_error(err))
+        {
+            states->fatal_error = true;
+            return ERROR;
+        }
     }
 
-    current_prompt = dc_malloc(env, err, 1 + dc_strlen(env, current_working_dir) + 1 + 2 + dc_strlen(env, states->prompt));
-    if (dc_error_has_error(err))
+    if (states->interactive)
     {
-        states->fatal_error = true;
-        return ERROR;
+        if (states->jobs != NULL)
+        {
+            job_table_notify(env, states->jobs, states->stdout);
+        }
+
+        update_prompt_line(env, err, states);
+        if (dc_error_has_error(err))
+        {
+            states->fatal_error = true;
+            return ERROR;
+        }
+
+        //one write for the whole prompt instead of formatting it every line
+        fwrite(states->prompt_line, 1, states->prompt_line_length, states->stdout);
+        fflush(states->stdout);
     }
-    sprintf(current_prompt, "[%s] %s", current_working_dir, states->prompt);
-    fprintf(states->stdout, "%s", current_prompt);
 
-    //read input from state.stdin in to state.current_line
-    line_len = states->max_line_length;
-    cur_line = read_command_line(env, err, states->stdin, &line_len);
+    //read input from state.stdin in to the reader, state.current_line is a view into its buffer
+    cur_line = read_command_line(env, err, states->reader, states->stdin, &line_len);
     if (dc_error_has_error(err))
     {
-        states->fatal_error = true;
+        //a line that is too long is not a reason to stop the shell
+        states->fatal_error = err->errno_code != E2BIG;
         return ERROR;
     }
 
-    states->current_line = dc_strdup(env, err, cur_line);
+    states->current_line = cur_line;
     states->current_line_length = line_len;
-    if (dc_error_has_error(err))
+
+    //a blank line is skipped, the shell only stops once the whole input has been read
+    if (line_len == 0)
+    {
+        if (line_reader_done(states->reader))
+        {
+            return EXIT;
+        }
+
+        return RESET_STATE;
+    }
+
+    //a script is not typed, its lines are not copied in to the history
+    if (states->interactive)
+    {
+        get_history(env, err, states);
+        if (dc_error_has_no_error(err))
+        {
+            history_add(env, err, states->history, cur_line, line_len);
+        }
+    }
+
+    if (dc_error_has_error(err) && err->errno_code == ENOMEM)
     {
         states->fatal_error = true;
         return ERROR;
     }
 
-    if (line_len == 0)
+    if (dc_error_has_error(err))
     {
-        return RESET_STATE;
+        //the line still runs if it could not be written to the history file
+        fprintf(states->stderr, "history: %s\n", err->message);
+        dc_error_reset(err);
     }
 
     return SEPARATE_COMMANDS;
 }
 
 /**
- * Separate the commands. In the current implementation there is only one command.
- * Sets the state->command.
+ * Separate the line in to commands at each '|', ';', "&&", "||" and '&' token (see next_token).
+ * Sets the state->command array and state->command_count, the connector of each command is the token after it.
+ * The line can end with ';' or '&' but not with the others.
+ * A syntax error (e.g. "ls |", "ls >", "&& ls" or an unclosed quote) is reported and the line is skipped.
+ * A line that was parsed before and can be cached (see command_cache_can_cache) is copied from state->command_cache
+ * instead, it goes straight to execute_commands.
  *
  * @param env the posix environment.
  * @param err the error object
  * @param arg the current struct state
- * @return PARSE_COMMANDS or SEPARATE_ERROR
+ * @return PARSE_COMMANDS, EXECUTE_COMMANDS (a cached line), RESET_STATE or SEPARATE_ERROR
  */
 int separate_commands(const struct dc_posix_env *env, struct dc_error *err,
                       void *arg)
 {
     struct state* states;
+    struct lexer lexer;
+    struct token token;
+    const char *start;
+    const char *end;
+    size_t capacity;
+    bool has_word;
 
     states = (struct state*) arg;
+    states->command = NULL;
+    states->command_count = 0;
+    capacity = 0;
+    start = NULL;
+    end = NULL;
+    has_word = false;
+    states->line_cacheable = command_cache_can_cache(states->current_line, states->current_line_length);
 
-    states->command = dc_calloc(env, err, 1, sizeof(struct command));
+    if (states->line_cacheable && command_cache_get(env, err, states->command_cache, states->current_line,
+                                                    states->current_line_length, states->arena, &states->command,
+                                                    &states->command_count))
+    {
+        return EXECUTE_COMMANDS;
+    }
 
     if (dc_error_has_error(err))
     {
@@ -274,22 +571,182 @@ int separate_commands(const struct dc_posix_env *env, struct dc_error *err,
         return ERROR;
     }
 
-    states->command->line  = dc_strdup(env, err, states->current_line);
-    states->command->stdin_file = NULL;
-    states->command->stdout_file = NULL;
-    states->command->stderr_file = NULL;
-    states->command->stdout_overwrite = false;
-    states->command->stderr_overwrite = false;
-    states->command->argc = 0;
-    states->command->argv = NULL;
-    states->command->command = NULL;
-    states->command->exit_code = EXIT_SUCCESS;
+    lexer_init(&lexer, states->current_line, states->current_line_length);
+
+    do
+    {
+        next_token(&lexer, &token);
+
+        switch (token.type)
+        {
+            case TOKEN_WORD:
+                has_word = true;
+                start = start == NULL ? token.text : start;
+                end = &token.text[token.length];
+                break;
+            case TOKEN_REDIRECT_IN:
+            case TOKEN_REDIRECT_OUT:
+            case TOKEN_REDIRECT_OUT_APPEND:
+            case TOKEN_REDIRECT_ERR:
+            case TOKEN_REDIRECT_ERR_APPEND:
+                start = start == NULL ? token.text : start;
+                if (next_token(&lexer, &token) != TOKEN_WORD)
+                {
+                    return syntax_error(states, &token);
+                }
+                end = &token.text[token.length];
+                break;
+            case TOKEN_ERROR:
+                fprintf(states->stderr, "syntax error: unterminated quote\n");
+                return RESET_STATE;
+            case TOKEN_PIPE:
+            case TOKEN_BACKGROUND:
+            case TOKEN_SEMICOLON:
+            case TOKEN_AND:
+            case TOKEN_OR:
+            case TOKEN_END:
+            default:
+                //nothing but a comment, the same as an empty line
+                if (token.type == TOKEN_END && states->command_count == 0 && start == NULL)
+                {
+                    return RESET_STATE;
+                }
+
+                if (!has_word)
+                {
+                    enum connector previous;
+
+                    //"ls;" and "ls &" are complete, "ls |", "ls &&" and "ls ; ;" are not
+                    previous = states->command_count == 0 ? CONNECTOR_PIPE :
+                               states->command[states->command_count - 1].connector;
+                    if (token.type == TOKEN_END && (previous == CONNECTOR_SEQUENCE || previous == CONNECTOR_BACKGROUND))
+                    {
+                        break;
+                    }
+
+                    return syntax_error(states, &token);
+                }
+
+                add_command(env, err, states, &capacity, start, (size_t)(end - start));
+                if (dc_error_has_error(err))
+                {
+                    states->fatal_error = true;
+                    return ERROR;
+                }
+
+                states->command[states->command_count - 1].connector = token_connector(token.type);
+                start = NULL;
+                has_word = false;
+                break;
+        }
+    }
+    while (token.type != TOKEN_END);
 
     return PARSE_COMMANDS;
 }
 
+static int syntax_error(struct state *states, const struct token *token)
+{
+    states->exit_code = SYNTAX_ERROR_EXIT_CODE;
+    states->last_exit_code = SYNTAX_ERROR_EXIT_CODE;
+
+    if (token->type == TOKEN_END)
+    {
+        fprintf(states->stderr, "syntax error near unexpected token `newline'\n");
+    }
+    else
+    {
+        fprintf(states->stderr, "syntax error near unexpected token `%.*s'\n", (int)token->length, token->text);
+    }
+
+    return RESET_STATE;
+}
+
+static enum connector token_connector(enum token_type type)
+{
+    switch (type)
+    {
+        case TOKEN_PIPE:
+            return CONNECTOR_PIPE;
+        case TOKEN_SEMICOLON:
+            return CONNECTOR_SEQUENCE;
+        case TOKEN_AND:
+            return CONNECTOR_AND;
+        case TOKEN_OR:
+            return CONNECTOR_OR;
+        case TOKEN_BACKGROUND:
+            return CONNECTOR_BACKGROUND;
+        case TOKEN_END:
+        case TOKEN_WORD:
+        case TOKEN_REDIRECT_IN:
+        case TOKEN_REDIRECT_OUT:
+        case TOKEN_REDIRECT_OUT_APPEND:
+        case TOKEN_REDIRECT_ERR:
+        case TOKEN_REDIRECT_ERR_APPEND:
+        case TOKEN_ERROR:
+        default:
+            return CONNECTOR_END;
+    }
+}
+
+static void add_command(const struct dc_posix_env *env, struct dc_error *err, struct state *states, size_t *capacity,
+                        const char *line, size_t length)
+{
+    if (states->command_count == *capacity)
+    {
+        struct command *commands;
+        size_t new_capacity;
+
+        //almost every line is a single command
+        new_capacity = *capacity == 0 ? 1 : *capacity * 2;
+        commands = arena_realloc(env, err, states->arena, states->command, *capacity * sizeof(struct command),
+                                 new_capacity * sizeof(struct command));
+        if (dc_error_has_error(err))
+        {
+            return;
+        }
+
+        states->command = commands;
+        *capacity = new_capacity;
+    }
+
+    init_command(env, err, states->arena, &states->command[states->command_count], line, length);
+    if (dc_error_has_no_error(err))
+    {
+        states->command_count++;
+    }
+}
+
+static void init_command(const struct dc_posix_env *env, struct dc_error *err, struct arena *arena,
+                         struct command *command, const char *line, size_t length)
+{
+    //the only copy of the line, current_line may be a read-only view that is not '\0' terminated
+    command->line = arena_strndup(env, err, arena, line, length);
+    if (dc_error_has_error(err))
+    {
+        return;
+    }
+    command->arena = arena;
+    command->stdin_file = NULL;
+    command->stdout_file = NULL;
+    command->stderr_file = NULL;
+    command->stdout_overwrite = false;
+    command->stderr_overwrite = false;
+    command->argc = 0;
+    command->argv = NULL;
+    command->command = NULL;
+    command->resolved_path = NULL;
+    command->exit_code = EXIT_SUCCESS;
+    command->connector = CONNECTOR_END;
+    command->started = 0;
+    dc_memset(env, &command->usage, 0, sizeof(struct command_usage));
+    dc_memset(env, &command->limits, 0, sizeof(struct command_limits));
+}
+
 /**
- * Parse the commands (see parse_command)
+ * Parse the commands of the first pipeline on the line (see parse_command).
+ * The pipelines after it are parsed by execute_commands just before they run, unless the line can be cached:
+ * then they are all parsed now and added to state->command_cache.
  *
  * @param env the posix environment.
  * @param err the error object
@@ -300,65 +757,699 @@ int parse_commands(const struct dc_posix_env *env, struct dc_error *err,
                    void *arg)
 {
     struct state* states;
+    size_t last;
 
     states = (struct state*) arg;
 
-    parse_command(env, err, states, states->command);
-    if (dc_error_has_error(err))
+    if (states->command_count == 0)
     {
-        return ERROR;
+        return EXECUTE_COMMANDS;
     }
-    return EXECUTE_COMMANDS;
-}
+
+    last = states->line_cacheable ? states->command_count - 1 : pipeline_end(states, 0);
+
+    for (size_t i = 0; i <= last; i++)
+    {
+        parse_command(env, err, states, &states->command[i]);
+        if (dc_error_has_error(err))
+        {
+            return ERROR;
+        }
+    }
+
+    if (states->line_cacheable)
+    {
+        command_cache_put(env, err, states->command_cache, states->current_line, states->current_line_length,
+                          states->command, states->command_count);
+        if (dc_error_has_error(err))
+        {
+            //the line still runs, it is just not cached
+            dc_error_reset(err);
+        }
+    }
+
+    return EXECUTE_COMMANDS;
+}
 
 
 /**
- * Run the command (see execute).
- * If the command->command is cd run builtin_cd
+ * Run the commands of the line in order (see connector), one and-or list at a time.
+ * The pipelines of a list are run in turn, "&&" and "||" short-circuiting on the exit codes,
+ * a list that ends with '&' is started as a job instead (see start_job).
+ * The exit code (of the last pipeline that ran) is only displayed when state->interactive is true.
  *
  * @param env the posix environment.
  * @param err the error object
  * @param arg the current struct state
- * @return EXIT (if command->command is exit), RESET_STATE or EXECUTE_ERROR
+ * @return EXIT (if a command is exit), RESET_STATE or EXECUTE_ERROR
  */
 int execute_commands(const struct dc_posix_env *env, struct dc_error *err,
                      void *arg)
 {
     struct state *states;
-    const char * cd_command;
-    const char * exit_command;
+    int exit_code;
+    size_t first;
 
     states = (struct state *)arg;
+    exit_code = EXIT_SUCCESS;
+    first = 0;
+
+    while (first < states->command_count)
+    {
+        size_t last;
 
-    cd_command = "cd";
-    exit_command = "exit";
+        last = list_end(states, first);
 
-    if (dc_strcmp(env, states->command->command, cd_command) == 0)
+        if (states->command[last].connector == CONNECTOR_BACKGROUND)
+        {
+            struct job *job;
+
+            job = start_job(env, err, states, first, last);
+            if (dc_error_has_error(err))
+            {
+                return ERROR;
+            }
+
+            if (states->interactive)
+            {
+                fprintf(states->stdout, "[%d] %d\n", job->id, (int)job->processes[job->count - 1].pid);
+            }
+
+            //the line itself succeeds, the job's exit code is for wait and fg
+            exit_code = EXIT_SUCCESS;
+            states->last_exit_code = EXIT_SUCCESS;
+        }
+        else
+        {
+            int next_state;
+
+            next_state = execute_list(env, err, states, first, last, &exit_code);
+            if (next_state != RESET_STATE)
+            {
+                return next_state;
+            }
+        }
+
+        first = last + 1;
+    }
+
+    states->exit_code = exit_code;
+    if (states->interactive)
     {
-        builtin_cd(env, err, states->command, states->stderr);
+        fprintf(states->stdout, "%d\n", exit_code);
     }
-    else if (dc_strcmp(env, states->command->command, exit_command) == 0)
+
+    //the programs on the next line write straight to the descriptor, what the builtins wrote has to be out first
+    fflush(states->stdout);
+
+    if (states->fatal_error)
     {
-        return EXIT;
+        return ERROR;
+    }
+    return RESET_STATE;
+}
+
+/**
+ * Start the and-or list of the commands first to last as a background job and add it to state->jobs.
+ * A single pipeline is started the same as execute_pipeline would, every command is a program.
+ * A list of pipelines ("a && b"), or a pipeline that starts with time or timeout (the shell has to wait for it to
+ * report the time or to enforce the timeout), is run by a copy of the shell in a child process, the same as
+ * execute_commands runs it.
+ * Either way the job's stdin is /dev/null unless it is redirected, the job is not displayed.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param states the state with the commands and the job table.
+ * @param first the first command of the job.
+ * @param last the last command of the job.
+ * @return the job, or NULL on error.
+ */
+struct job *start_job(const struct dc_posix_env *env, struct dc_error *err, struct state *states, size_t first,
+                      size_t last)
+{
+    char *text;
+    size_t length;
+    size_t count;
+    pid_t *pids;
+    pid_t pid;
+    int exit_code;
+
+    text = job_text(env, err, states, first, last, &length);
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    //the first pipeline (or the whole line if it can be cached) was parsed by parse_commands
+    if (states->command[first].argv == NULL)
+    {
+        parse_command(env, err, states, &states->command[first]);
+        if (dc_error_has_error(err))
+        {
+            return NULL;
+        }
+    }
+
+    if (!needs_shell(env, states, first, last))
+    {
+        struct command *commands;
+
+        commands = &states->command[first];
+        count = last - first + 1;
+
+        for (size_t i = 0; i < count; i++)
+        {
+            //the first pipeline (or the whole line if it can be cached) was parsed by parse_commands
+            if (commands[i].argv == NULL)
+            {
+                parse_command(env, err, states, &commands[i]);
+            }
+
+            if (dc_error_has_no_error(err))
+            {
+                resolve_command(env, err, states, &commands[i]);
+            }
+
+            if (dc_error_has_error(err))
+            {
+                return NULL;
+            }
+        }
+
+        //without job control a job must not read from the terminal the shell is reading from (the same as sh)
+        if (commands[0].stdin_file == NULL)
+        {
+            commands[0].stdin_file = arena_strndup(env, err, commands[0].arena, "/dev/null",
+                                                   dc_strlen(env, "/dev/null"));
+        }
+
+        //the job table reaps a job whenever it finishes, there is nothing to enforce a timeout from
+        set_command_limits(states, commands, count, 0);
+
+        pids = arena_calloc(env, err, states->arena, count, sizeof(pid_t));
+        if (dc_error_has_error(err))
+        {
+            return NULL;
+        }
+
+        start_pipeline(env, err, commands, count, states->path, states->launcher, pids);
+        if (dc_error_has_error(err))
+        {
+            return NULL;
+        }
+
+        //the exit code of a command that could not be started is already set
+        exit_code = commands[count - 1].exit_code;
     }
     else
     {
-        execute(env, err, states->command, states->path);
+        //anything still buffered would be written a second time by the child
+        fflush(NULL);
+        pid = dc_fork(env, err);
         if (dc_error_has_error(err))
         {
-            return ERROR;
+            return NULL;
+        }
+
+        if (pid == 0)
+        {
+            int fd;
+
+            exit_code = EXIT_FAILURE;
+            fd = dc_open(env, err, "/dev/null", O_RDONLY);
+            if (dc_error_has_no_error(err))
+            {
+                dc_dup2(env, err, fd, STDIN_FILENO);
+                dc_close(env, err, fd);
+            }
+
+            //exit in the job exits the copy of the shell with its code
+            if (dc_error_has_no_error(err) && execute_list(env, err, states, first, last, &exit_code) == EXIT)
+            {
+                exit_code = states->last_exit_code;
+            }
+
+            if (dc_error_has_error(err))
+            {
+                fprintf(states->stderr, "internal error (%d) %s: \"%s\"\n", err->errno_code, err->message, text);
+                exit_code = EXIT_FAILURE;
+            }
+
+            fflush(NULL);
+            dc_exit(env, exit_code);
         }
+
+        pids = &pid;
+        count = 1;
+        exit_code = EXIT_SUCCESS;
     }
 
-    fprintf(states->stdout, "%d\n", states->command->exit_code);
+    if (get_job_table(env, err, states) == NULL)
+    {
+        return NULL;
+    }
 
-    if (states->fatal_error)
+    return job_add(env, err, states->jobs, text, length, pids, count, exit_code);
+}
+
+static size_t pipeline_end(const struct state *states, size_t first)
+{
+    size_t last;
+
+    last = first;
+    while (last + 1 < states->command_count && states->command[last].connector == CONNECTOR_PIPE)
     {
-        return ERROR;
+        last++;
+    }
+
+    return last;
+}
+
+static size_t list_end(const struct state *states, size_t first)
+{
+    size_t last;
+
+    last = pipeline_end(states, first);
+    while (last + 1 < states->command_count &&
+           (states->command[last].connector == CONNECTOR_AND || states->command[last].connector == CONNECTOR_OR))
+    {
+        last = pipeline_end(states, last + 1);
+    }
+
+    return last;
+}
+
+static int execute_list(const struct dc_posix_env *env, struct dc_error *err, struct state *states, size_t first,
+                        size_t last, int *exit_code)
+{
+    size_t start;
+    bool run;
+
+    start = first;
+    run = true;
+
+    while (start <= last)
+    {
+        size_t end;
+        enum connector connector;
+
+        end = pipeline_end(states, start);
+
+        if (run)
+        {
+            int next_state;
+
+            //the first pipeline (or the whole line if it can be cached) was parsed by parse_commands
+            for (size_t i = start; i <= end && states->command[i].argv == NULL; i++)
+            {
+                parse_command(env, err, states, &states->command[i]);
+                if (dc_error_has_error(err))
+                {
+                    return ERROR;
+                }
+            }
+
+            next_state = execute_pipeline_commands(env, err, states, &states->command[start], end - start + 1);
+            if (next_state != RESET_STATE)
+            {
+                return next_state;
+            }
+
+            *exit_code = states->command[end].exit_code;
+
+            //exit without an argument exits with this, even from later on the same line
+            states->last_exit_code = *exit_code;
+        }
+
+        connector = states->command[end].connector;
+        if (connector == CONNECTOR_AND)
+        {
+            run = *exit_code == EXIT_SUCCESS;
+        }
+        else if (connector == CONNECTOR_OR)
+        {
+            run = *exit_code != EXIT_SUCCESS;
+        }
+        else
+        {
+            run = true;
+        }
+
+        start = end + 1;
+    }
+
+    return RESET_STATE;
+}
+
+static int execute_pipeline_commands(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                                     struct command *commands, size_t count)
+{
+    struct command_usage total;
+    FILE *log;
+    uint64_t started;
+    uint64_t timeout;
+    bool timed;
+    int next_state;
+
+    timed = strip_time(env, commands);
+    timeout = states->options != NULL ? states->options->limits.timeout : 0;
+    strip_timeout(env, commands, &timeout);
+    set_command_limits(states, commands, count, timeout);
+    log = states->options != NULL ? states->options->usage_log : NULL;
+
+    if (!timed && log == NULL)
+    {
+        return run_pipeline_commands(env, err, states, commands, count, false);
+    }
+
+    started = stats_now();
+    next_state = run_pipeline_commands(env, err, states, commands, count, true);
+    if (next_state == ERROR)
+    {
+        return next_state;
+    }
+
+    dc_memset(env, &total, 0, sizeof(struct command_usage));
+
+    for (size_t i = 0; i < count; i++)
+    {
+        //a command that was not started (e.g. not found) has nothing to log
+        if (log != NULL && commands[i].started != 0)
+        {
+            usage_log(&commands[i], log);
+        }
+
+        usage_add(&total, &commands[i].usage);
+    }
+
+    if (timed)
+    {
+        total.wall = stats_now() - started;
+        usage_print(&total, states->stderr);
+    }
+
+    return next_state;
+}
+
+static int run_pipeline_commands(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                                 struct command *commands, size_t count, bool measure)
+{
+    if (count > 1)
+    {
+        //builtins are not special in a pipeline, every stage is a program in its own process
+        for (size_t i = 0; i < count; i++)
+        {
+            resolve_command(env, err, states, &commands[i]);
+            if (dc_error_has_error(err))
+            {
+                return ERROR;
+            }
+        }
+
+        execute_pipeline(env, err, commands, count, states->path, states->launcher);
+        if (dc_error_has_error(err))
+        {
+            return ERROR;
+        }
+    }
+    else if (commands->command == NULL)
+    {
+        //every word expanded to nothing (e.g. "$UNSET"), there is nothing to run,
+        //the exit code is the one parse_command left (that of a failed "$(false)")
+        return RESET_STATE;
+    }
+    else
+    {
+        const struct builtin *builtin;
+        pid_t pid;
+
+        //a builtin that cannot run the command (e.g. echo -e) leaves it to the program of the same name
+        builtin = builtin_find(env, commands->command);
+        if (builtin != NULL && builtin_handles(env, builtin, commands))
+        {
+            return measure ? measure_builtin(env, err, states, builtin, commands) :
+                             builtin_run(env, err, states, builtin, commands);
+        }
+
+        resolve_command(env, err, states, commands);
+        if (dc_error_has_error(err))
+        {
+            return ERROR;
+        }
+
+        pid = launch(env, err, commands, states->path, states->launcher, -1, -1);
+        if (dc_error_has_error(err))
+        {
+            return ERROR;
+        }
+
+        if (pid > 0)
+        {
+            wait_for_command(env, err, commands, pid);
+            if (dc_error_has_error(err))
+            {
+                return ERROR;
+            }
+        }
     }
+
     return RESET_STATE;
 }
 
+static int measure_builtin(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                           const struct builtin *builtin, struct command *command)
+{
+    struct rusage before;
+    struct rusage after;
+    int next_state;
+
+    getrusage(RUSAGE_SELF, &before);
+    command->started = stats_now();
+    next_state = builtin_run(env, err, states, builtin, command);
+    getrusage(RUSAGE_SELF, &after);
+    usage_set_difference(&command->usage, &before, &after, stats_now() - command->started);
+
+    return next_state;
+}
+
+static bool strip_time(const struct dc_posix_env *env, struct command *command)
+{
+    if (command->command == NULL || dc_strcmp(env, command->command, "time") != 0)
+    {
+        return false;
+    }
+
+    shift_command(env, command);
+
+    return true;
+}
+
+static bool strip_timeout(const struct dc_posix_env *env, struct command *command, uint64_t *timeout)
+{
+    if (command->command == NULL || dc_strcmp(env, command->command, "timeout") != 0 || command->argc < 3 ||
+        !parse_duration(command->argv[1], timeout))
+    {
+        return false;
+    }
+
+    shift_command(env, command);
+    shift_command(env, command);
+
+    return true;
+}
+
+static bool has_prefix(const struct dc_posix_env *env, const struct command *command)
+{
+    return command->command != NULL &&
+           (dc_strcmp(env, command->command, "time") == 0 || dc_strcmp(env, command->command, "timeout") == 0);
+}
+
+static bool needs_shell(const struct dc_posix_env *env, const struct state *states, size_t first, size_t last)
+{
+    const struct command *command;
+    const struct builtin *builtin;
+
+    command = &states->command[first];
+    if (pipeline_end(states, first) != last || has_prefix(env, command))
+    {
+        return true;
+    }
+
+    if (first != last || command->command == NULL)
+    {
+        return false;
+    }
+
+    builtin = builtin_find(env, command->command);
+
+    return builtin != NULL && builtin_handles(env, builtin, command);
+}
+
+static void shift_command(const struct dc_posix_env *env, struct command *command)
+{
+    //argv[0] is NULL, the first argument is the command to run
+    command->command = command->argv[1];
+    if (command->command != NULL)
+    {
+        dc_memmove(env, &command->argv[1], &command->argv[2], (command->argc - 1) * sizeof(char *));
+        command->argc--;
+    }
+    else
+    {
+        command->argc = 0;
+    }
+}
+
+static void set_command_limits(const struct state *states, struct command *commands, size_t count, uint64_t timeout)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (states->options != NULL)
+        {
+            commands[i].limits = states->options->limits;
+        }
+
+        commands[i].limits.timeout = timeout;
+    }
+}
+
+static char *job_text(const struct dc_posix_env *env, struct dc_error *err, struct state *states, size_t first,
+                      size_t last, size_t *length)
+{
+    static const char *separators[] = { "", " | ", "; ", " && ", " || ", " & " };
+    char *text;
+    size_t position;
+
+    *length = dc_strlen(env, " &");
+    for (size_t i = first; i <= last; i++)
+    {
+        *length += dc_strlen(env, states->command[i].line);
+        if (i < last)
+        {
+            *length += dc_strlen(env, separators[states->command[i].connector]);
+        }
+    }
+
+    text = arena_calloc(env, err, states->arena, *length + 1, 1);
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    position = 0;
+    for (size_t i = first; i <= last; i++)
+    {
+        const char *separator;
+        size_t line_length;
+
+        separator = i < last ? separators[states->command[i].connector] : " &";
+        line_length = dc_strlen(env, states->command[i].line);
+        dc_memcpy(env, &text[position], states->command[i].line, line_length);
+        position += line_length;
+        dc_memcpy(env, &text[position], separator, dc_strlen(env, separator));
+        position += dc_strlen(env, separator);
+    }
+
+    return text;
+}
+
+static void reply_line(const struct dc_posix_env *env, struct dc_error *err, struct state *states)
+{
+    if (states->connection == NULL)
+    {
+        return;
+    }
+
+    //anything left from the line (eg. after handle_error) is not about the reply
+    dc_error_reset(err);
+    server_connection_reply(env, err, states->connection, states->exit_code);
+    dc_error_reset(err);
+}
+
+static void update_prompt_line(const struct dc_posix_env *env, struct dc_error *err, struct state *states)
+{
+    const char *ps1;
+    size_t working_dir_length;
+    size_t prompt_length;
+
+    ps1 = dc_getenv(env, "PS1");
+    if (ps1 == NULL)
+    {
+        ps1 = "$ ";
+    }
+
+    if (dc_strcmp(env, ps1, states->prompt) != 0)
+    {
+        char *prompt;
+
+        prompt = dc_strdup(env, err, ps1);
+        if (dc_error_has_error(err))
+        {
+            return;
+        }
+
+        dc_free(env, states->prompt, dc_strlen(env, states->prompt) + 1);
+        states->prompt = prompt;
+
+        if (states->prompt_line != NULL)
+        {
+            dc_free(env, states->prompt_line, states->prompt_line_length + 1);
+            states->prompt_line = NULL;
+        }
+    }
+
+    if (states->prompt_line != NULL)
+    {
+        return;
+    }
+
+    if (states->working_dir == NULL)
+    {
+        states->working_dir = dc_get_working_dir(env, err);
+        if (dc_error_has_error(err))
+        {
+            return;
+        }
+    }
+
+    working_dir_length = dc_strlen(env, states->working_dir);
+    prompt_length = dc_strlen(env, states->prompt);
+
+    // [current working directory] prompt
+    states->prompt_line_length = 1 + working_dir_length + 2 + prompt_length;
+    states->prompt_line = dc_malloc(env, err, states->prompt_line_length + 1);
+    if (dc_error_has_error(err))
+    {
+        return;
+    }
+
+    states->prompt_line[0] = '[';
+    dc_memcpy(env, &states->prompt_line[1], states->working_dir, working_dir_length);
+    dc_memcpy(env, &states->prompt_line[1 + working_dir_length], "] ", 2);
+    dc_memcpy(env, &states->prompt_line[1 + working_dir_length + 2], states->prompt, prompt_length + 1);
+}
+
+static void resolve_command(const struct dc_posix_env *env, struct dc_error *err, struct state *states,
+                            struct command *command)
+{
+    //every program that is run is resolved first, this is where the path is separated if it has not been yet
+    if (get_state_path(env, err, states) == NULL)
+    {
+        return;
+    }
+
+    //find the program here, once, instead of trying execv on every path directory in the child
+    if (command->command != NULL && dc_strchr(env, command->command, '/') == NULL)
+    {
+        const char *program;
+
+        //the entry is only valid until the next lookup, which may drop the whole table (a directory changed)
+        program = command_hash_lookup(env, err, states->command_hash, command->command, states->path);
+        command->resolved_path = program == NULL ? NULL :
+                                 arena_strndup(env, err, command->arena, program, dc_strlen(env, program));
+    }
+}
+
 
 /**
  * Handle the exit command (see do_reset_state)
@@ -373,6 +1464,13 @@ int do_exit(const struct dc_posix_env *env, struct dc_error *err, void *arg)
     struct state *states;
 
     states = (struct state *)arg;
+
+    //the end of the input is not a line, exit is
+    if (states->current_line_length > 0)
+    {
+        reply_line(env, err, states);
+    }
+
     do_reset_state(env, err, states);
 
     return DESTROY_STATE;
@@ -398,9 +1496,12 @@ int handle_error(const struct dc_posix_env *env, struct dc_error *err,
     }
     else
     {
-        fprintf(states->stderr, "internal error (%d) %s: \"%s\"\n", err->errno_code, err->message, states->current_line);
+        fprintf(states->stderr, "internal error (%d) %s: \"%.*s\"\n", err->errno_code, err->message,
+                (int)states->current_line_length, states->current_line);
     }
 
+    states->exit_code = EXIT_FAILURE;
+    states->last_exit_code = EXIT_FAILURE;
     if(states->fatal_error)
     {
         return DESTROY_STATE;
@@ -0,0 +1,281 @@
+#include "../include/stats.h"
+#include <dc_posix/dc_stdlib.h>
+#include <time.h>
+
+#define NANOSECONDS_PER_SECOND 1000000000
+#define NANOSECONDS_PER_MICROSECOND 1000.0
+
+/**
+ * Get the bucket a value goes in.
+ *
+ * @param value the value.
+ * @return the index of the bucket.
+ */
+static size_t bucket_index(uint64_t value);
+
+/**
+ * Get the highest value that goes in a bucket.
+ *
+ * @param index the index of the bucket.
+ * @return the value.
+ */
+static uint64_t bucket_value(size_t index);
+
+/**
+ * Display one line of the stats: the name, count, p50, p99 and max.
+ *
+ * @param stream the stream to display the line on.
+ * @param name the state or transition.
+ * @param histogram the times.
+ */
+static void print_histogram(FILE *stream, const char *name, const struct histogram *histogram);
+
+/**
+ * Get the name of a state.
+ *
+ * @param state the state.
+ * @return the name, "?" for an unknown state.
+ */
+static const char *state_name(int state);
+
+void histogram_record(struct histogram *histogram, uint64_t value)
+{
+    if (value >= (UINT64_C(1) << HISTOGRAM_MAX_BITS))
+    {
+        value = (UINT64_C(1) << HISTOGRAM_MAX_BITS) - 1;
+    }
+
+    if (histogram->count == 0 || value < histogram->min)
+    {
+        histogram->min = value;
+    }
+
+    if (value > histogram->max)
+    {
+        histogram->max = value;
+    }
+
+    histogram->count++;
+    histogram->total += value;
+    histogram->buckets[bucket_index(value)]++;
+}
+
+uint64_t histogram_percentile(const struct histogram *histogram, double percentile)
+{
+    double rank;
+    uint64_t wanted;
+    uint64_t seen;
+
+    if (histogram->count == 0)
+    {
+        return 0;
+    }
+
+    //the rank of the value, rounded up so p100 is the last one and p0 the first
+    rank = (percentile / 100.0) * (double)histogram->count;
+    wanted = (uint64_t)rank;
+    if ((double)wanted < rank || wanted < 1)
+    {
+        wanted++;
+    }
+
+    seen = 0;
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+    {
+        seen += histogram->buckets[i];
+        if (seen >= wanted)
+        {
+            uint64_t value;
+
+            //the bucket is wider than the values that are really in it
+            value = bucket_value(i);
+            return value > histogram->max ? histogram->max : value;
+        }
+    }
+
+    return histogram->max;
+}
+
+struct fsm_stats *fsm_stats_create(const struct dc_posix_env *env, struct dc_error *err)
+{
+    struct fsm_stats *stats;
+
+    stats = dc_calloc(env, err, 1, sizeof(struct fsm_stats));
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    stats->from = DC_FSM_INIT;
+    stats->to = INIT_STATE;
+
+    return stats;
+}
+
+void fsm_stats_destroy(const struct dc_posix_env *env, struct fsm_stats **pstats)
+{
+    struct fsm_stats *stats;
+
+    stats = *pstats;
+    if (stats == NULL)
+    {
+        return;
+    }
+
+    for (size_t from = 0; from < FSM_STATS_STATES; from++)
+    {
+        for (size_t to = 0; to < FSM_STATS_STATES; to++)
+        {
+            if (stats->transitions[from][to] != NULL)
+            {
+                dc_free(env, stats->transitions[from][to], sizeof(struct histogram));
+            }
+        }
+    }
+
+    dc_free(env, stats, sizeof(struct fsm_stats));
+    *pstats = NULL;
+}
+
+void fsm_stats_record(const struct dc_posix_env *env, struct fsm_stats *stats, int from, int to,
+                      uint64_t nanoseconds)
+{
+    struct histogram **transition;
+
+    if (from < 0 || from >= FSM_STATS_STATES || to < 0 || to >= FSM_STATS_STATES)
+    {
+        return;
+    }
+
+    histogram_record(&stats->states[to], nanoseconds);
+
+    transition = &stats->transitions[from][to];
+    if (*transition == NULL)
+    {
+        struct dc_error err;
+
+        //the stats are not worth failing a command over, the transition is left out
+        dc_error_init(&err, NULL);
+        *transition = dc_calloc(env, &err, 1, sizeof(struct histogram));
+        dc_error_reset(&err);
+
+        if (*transition == NULL)
+        {
+            return;
+        }
+    }
+
+    histogram_record(*transition, nanoseconds);
+}
+
+void fsm_stats_print(const struct fsm_stats *stats, FILE *stream)
+{
+    fprintf(stream, "%-36s %10s %10s %10s %10s\n", "state", "count", "p50(us)", "p99(us)", "max(us)");
+
+    for (int state = INIT_STATE; state < FSM_STATS_STATES; state++)
+    {
+        if (stats->states[state].count > 0)
+        {
+            print_histogram(stream, state_name(state), &stats->states[state]);
+        }
+    }
+
+    fprintf(stream, "%-36s %10s %10s %10s %10s\n", "transition", "count", "p50(us)", "p99(us)", "max(us)");
+
+    for (int from = 0; from < FSM_STATS_STATES; from++)
+    {
+        for (int to = 0; to < FSM_STATS_STATES; to++)
+        {
+            const struct histogram *transition;
+
+            transition = stats->transitions[from][to];
+            if (transition != NULL && transition->count > 0)
+            {
+                char name[64];
+
+                snprintf(name, sizeof(name), "%s -> %s", state_name(from), state_name(to));
+                print_histogram(stream, name, transition);
+            }
+        }
+    }
+}
+
+uint64_t stats_now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * NANOSECONDS_PER_SECOND + (uint64_t)now.tv_nsec;
+}
+
+static size_t bucket_index(uint64_t value)
+{
+    size_t shift;
+
+    if (value < HISTOGRAM_SUB_COUNT)
+    {
+        return (size_t)value;
+    }
+
+    //the top HISTOGRAM_SUB_BITS bits of the value pick the bucket within its power of two
+    shift = 0;
+    while ((value >> shift) >= HISTOGRAM_SUB_COUNT)
+    {
+        shift++;
+    }
+
+    return shift * (HISTOGRAM_SUB_COUNT / 2) + (size_t)(value >> shift);
+}
+
+static uint64_t bucket_value(size_t index)
+{
+    size_t shift;
+    uint64_t sub_bucket;
+
+    if (index < HISTOGRAM_SUB_COUNT)
+    {
+        return index;
+    }
+
+    shift = index / (HISTOGRAM_SUB_COUNT / 2) - 1;
+    sub_bucket = index - shift * (HISTOGRAM_SUB_COUNT / 2);
+
+    return ((sub_bucket + 1) << shift) - 1;
+}
+
+static void print_histogram(FILE *stream, const char *name, const struct histogram *histogram)
+{
+    uint64_t p50;
+    uint64_t p99;
+
+    p50 = histogram_percentile(histogram, 50.0);
+    p99 = histogram_percentile(histogram, 99.0);
+    fprintf(stream, "%-36s %10lu %10.1f %10.1f %10.1f\n", name, (unsigned long)histogram->count,
+            (double)p50 / NANOSECONDS_PER_MICROSECOND, (double)p99 / NANOSECONDS_PER_MICROSECOND,
+            (double)histogram->max / NANOSECONDS_PER_MICROSECOND);
+}
+
+static const char *state_name(int state)
+{
+    static const char *names[FSM_STATS_STATES] = {
+            "DC_FSM_INIT",
+            "DC_FSM_EXIT",
+            "INIT_STATE",
+            "READ_COMMANDS",
+            "SEPARATE_COMMANDS",
+            "PARSE_COMMANDS",
+            "EXECUTE_COMMANDS",
+            "EXIT",
+            "RESET_STATE",
+            "ERROR",
+            "DESTROY_STATE",
+    };
+
+    if (state < 0 || state >= FSM_STATS_STATES)
+    {
+        return "?";
+    }
+
+    return names[state];
+}
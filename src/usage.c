@@ -0,0 +1,65 @@
+#include "../include/usage.h"
+
+#define NS_PER_SECOND 1000000000.0
+
+/**
+ * Convert a time from getrusage/wait4 to ns.
+ *
+ * @param time the time.
+ * @return the ns.
+ */
+static uint64_t timeval_ns(const struct timeval *time);
+
+void usage_set(struct command_usage *usage, const struct rusage *rusage, uint64_t wall)
+{
+    usage->wall = wall;
+    usage->user = timeval_ns(&rusage->ru_utime);
+    usage->system = timeval_ns(&rusage->ru_stime);
+    usage->max_rss = rusage->ru_maxrss;
+    usage->voluntary_switches = rusage->ru_nvcsw;
+    usage->involuntary_switches = rusage->ru_nivcsw;
+}
+
+void usage_set_difference(struct command_usage *usage, const struct rusage *before, const struct rusage *after,
+                          uint64_t wall)
+{
+    usage->wall = wall;
+    usage->user = timeval_ns(&after->ru_utime) - timeval_ns(&before->ru_utime);
+    usage->system = timeval_ns(&after->ru_stime) - timeval_ns(&before->ru_stime);
+    usage->max_rss = after->ru_maxrss;
+    usage->voluntary_switches = after->ru_nvcsw - before->ru_nvcsw;
+    usage->involuntary_switches = after->ru_nivcsw - before->ru_nivcsw;
+}
+
+void usage_add(struct command_usage *total, const struct command_usage *usage)
+{
+    total->user += usage->user;
+    total->system += usage->system;
+    total->max_rss = usage->max_rss > total->max_rss ? usage->max_rss : total->max_rss;
+    total->voluntary_switches += usage->voluntary_switches;
+    total->involuntary_switches += usage->involuntary_switches;
+}
+
+void usage_print(const struct command_usage *usage, FILE *stream)
+{
+    fprintf(stream, "real %.3fs  user %.3fs  sys %.3fs  maxrss %ldKiB  vcsw %ld  ivcsw %ld\n",
+            (double)usage->wall / NS_PER_SECOND, (double)usage->user / NS_PER_SECOND,
+            (double)usage->system / NS_PER_SECOND, usage->max_rss, usage->voluntary_switches,
+            usage->involuntary_switches);
+}
+
+void usage_log(const struct command *command, FILE *stream)
+{
+    const struct command_usage *usage;
+
+    usage = &command->usage;
+    fprintf(stream, "%d\t%.6f\t%.6f\t%.6f\t%ld\t%ld\t%ld\t%s\n", command->exit_code,
+            (double)usage->wall / NS_PER_SECOND, (double)usage->user / NS_PER_SECOND,
+            (double)usage->system / NS_PER_SECOND, usage->max_rss, usage->voluntary_switches,
+            usage->involuntary_switches, command->line);
+}
+
+static uint64_t timeval_ns(const struct timeval *time)
+{
+    return (uint64_t)time->tv_sec * UINT64_C(1000000000) + (uint64_t)time->tv_usec * UINT64_C(1000);
+}
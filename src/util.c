@@ -1,20 +1,18 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <dc_posix/dc_string.h>
 #include <dc_posix/dc_stdlib.h>
-#include <dc_posix/dc_wordexp.h>
-#include <wordexp.h>
 #include "../include/state.h"
 #include "../include/util.h"
+#include "../include/arena.h"
 #include "../include/command.h"
+#include "../include/expand.h"
+#include "../include/history.h"
+#include "../include/jobs.h"
 
-/**
- * Free char pointers if not NULL.
- *
- * @param env the posix environment.
- * @param target the char pointer to be freed.
- */
-static void free_char(const struct dc_posix_env *env, char **target);
+#define HISTORY_SIZE 1000
+#define HISTORY_FILE_NAME ".dc_shell_history"
 
 /**
  * Get the prompt to use.
@@ -69,6 +67,44 @@ char *get_path(const struct dc_posix_env *env, struct dc_error *err)
     return path;
 }
 
+/**
+ * Get the file to save the history in: HISTFILE, or ~/.dc_shell_history if it is not set.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @return the file name, or NULL if HISTFILE is empty (or neither it nor HOME are set).
+ */
+char *get_history_file(const struct dc_posix_env *env, struct dc_error *err)
+{
+    const char *value;
+    const char *home;
+    char *file;
+    size_t length;
+
+    value = dc_getenv(env, "HISTFILE");
+    if (value != NULL)
+    {
+        return value[0] == '\0' ? NULL : dc_strdup(env, err, value);
+    }
+
+    home = dc_getenv(env, "HOME");
+    if (home == NULL || home[0] == '\0')
+    {
+        return NULL;
+    }
+
+    length = dc_strlen(env, home) + 1 + sizeof(HISTORY_FILE_NAME);
+    file = dc_malloc(env, err, length);
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    snprintf(file, length, "%s/%s", home, HISTORY_FILE_NAME);
+
+    return file;
+}
+
 /**
  * Separate a path (eg. PATH env var) into separate directories.
  * Directories are separated with a ':' character.
@@ -89,7 +125,6 @@ char **parse_path(const struct dc_posix_env *env, struct dc_error *err,
     char *tempFr;
     char *tempNumFr;
     char *numFr;
-    wordexp_t exp;
 
     temp = strdup(path_str);
     tempFr = temp;
@@ -113,12 +148,11 @@ char **parse_path(const struct dc_posix_env *env, struct dc_error *err,
 
     while((token = dc_strtok_r(env, temp, ":", &temp)) != NULL)
     {
-        dc_wordexp(env, err, token, &exp, 0);
+        list[index] = expand_string(env, err, token, EXPAND_TILDE, NULL);
         if (dc_error_has_error(err))
         {
             dc_exit(env, errno);
         }
-        list[index] = dc_strdup(env, err, exp.we_wordv[0]);
         index++;
     }
     dc_free(env, tempFr, dc_strlen(env, path_str) + 1);
@@ -129,23 +163,238 @@ char **parse_path(const struct dc_posix_env *env, struct dc_error *err,
 
 /**
  * Reset the state for the next read, freeing any dynamically allocated memory.
+ * The commands are in state->arena, which is reset in one go.
  *
  * @param env the posix environment.
  * @param err the error object
  */
 void do_reset_state(const struct dc_posix_env *env, struct dc_error *err, struct state *state)
 {
+    //current_line is a view into state->reader, the buffer is kept for the next read
     state->current_line_length = 0;
-    free_char(env, &(state->current_line));
+    state->current_line = NULL;
     if (state->command)
     {
-        destroy_command(env, state->command);
+        for (size_t i = 0; i < state->command_count; i++)
+        {
+            destroy_command(env, &state->command[i]);
+        }
+
+        //with an arena the array is in it along with everything the commands point to
+        if (state->arena == NULL)
+        {
+            dc_free(env, state->command, state->command_count * sizeof(struct command));
+        }
         state->command = NULL;
     }
+
+    if (state->arena != NULL)
+    {
+        arena_reset(env, state->arena);
+    }
+    state->command_count = 0;
+    state->exit_code = EXIT_SUCCESS;
     state->fatal_error = false;
     dc_error_reset(err);
 }
 
+/**
+ * Free the directories of a path (see parse_path) and the array they are in.
+ *
+ * @param env the posix environment.
+ * @param ppath the path to free, set to NULL.
+ */
+void free_path(const struct dc_posix_env *env, char ***ppath)
+{
+    char **path;
+    size_t i;
+
+    path = *ppath;
+    if (path == NULL)
+    {
+        return;
+    }
+
+    for (i = 0; path[i] != NULL; i++)
+    {
+        dc_free(env, path[i], dc_strlen(env, path[i]) + 1);
+    }
+
+    dc_free(env, path, (i + 1) * sizeof(char *));
+    *ppath = NULL;
+}
+
+/**
+ * Forget the working directory and the prompt built from it, they are rebuilt when they are next needed.
+ *
+ * @param env the posix environment.
+ * @param state the state with the working directory and prompt.
+ */
+void clear_working_dir(const struct dc_posix_env *env, struct state *state)
+{
+    if (state->working_dir != NULL)
+    {
+        dc_free(env, state->working_dir, dc_strlen(env, state->working_dir) + 1);
+        state->working_dir = NULL;
+    }
+
+    if (state->prompt_line != NULL)
+    {
+        dc_free(env, state->prompt_line, state->prompt_line_length + 1);
+        state->prompt_line = NULL;
+    }
+
+    state->prompt_line_length = 0;
+}
+
+/**
+ * Get the directories of the PATH environment variable, they are separated the first time a program is looked
+ * for (a shell that only runs builtins never does) and again after PATH changes.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param state the state with the path.
+ * @return state->path, or NULL on error.
+ */
+char **get_state_path(const struct dc_posix_env *env, struct dc_error *err, struct state *state)
+{
+    char *path;
+
+    if (state->path != NULL)
+    {
+        return state->path;
+    }
+
+    path = get_path(env, err);
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    state->path = parse_path(env, err, path == NULL ? "" : path);
+    if (path != NULL)
+    {
+        dc_free(env, path, dc_strlen(env, path) + 1);
+    }
+
+    return state->path;
+}
+
+/**
+ * Get the table of background jobs, it is created the first time a job is started or looked at
+ * (blocking SIGCHLD and opening the signalfd is left until then).
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param state the state with the job table.
+ * @return state->jobs, or NULL on error.
+ */
+struct job_table *get_job_table(const struct dc_posix_env *env, struct dc_error *err, struct state *state)
+{
+    if (state->jobs == NULL)
+    {
+        state->jobs = job_table_create(env, err);
+    }
+
+    return state->jobs;
+}
+
+/**
+ * Get the history, it is created the first time a line is read and keeps the last HISTSIZE lines
+ * (HISTORY_SIZE if it is not set). The last lines of state->options->history_file are loaded in to it,
+ * if the file cannot be opened the history is only kept in memory.
+ *
+ * @param env the posix environment.
+ * @param err the error object
+ * @param state the state with the history.
+ * @return state->history, or NULL on error.
+ */
+struct history *get_history(const struct dc_posix_env *env, struct dc_error *err, struct state *state)
+{
+    const char *size;
+    size_t capacity;
+
+    if (state->history != NULL)
+    {
+        return state->history;
+    }
+
+    size = dc_getenv(env, "HISTSIZE");
+    capacity = HISTORY_SIZE;
+
+    if (size != NULL && size[0] >= '0' && size[0] <= '9')
+    {
+        capacity = strtoul(size, NULL, 10);
+    }
+
+    state->history = history_create(env, err, capacity);
+    if (dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    if (state->options != NULL && state->options->history_file != NULL)
+    {
+        history_open(env, err, state->history, state->options->history_file);
+        if (dc_error_has_error(err))
+        {
+            //not being able to save the lines is no reason not to run them
+            dc_error_reset(err);
+        }
+    }
+
+    return state->history;
+}
+
+/**
+ * Parse a duration the same as timeout(1): a number of seconds, which can have a fraction,
+ * and an optional s, m, h or d suffix.
+ *
+ * @param text the duration.
+ * @param ns set to the duration in nanoseconds.
+ * @return true if text is a duration, false if it is not (ns is not changed).
+ */
+bool parse_duration(const char *text, uint64_t *ns)
+{
+    char *end;
+    double seconds;
+
+    //strtod would take a sign, hex, inf and nan
+    if (text[0] < '0' || text[0] > '9')
+    {
+        return false;
+    }
+
+    seconds = strtod(text, &end);
+    switch (*end)
+    {
+        case 'd':
+            seconds *= 24;
+            //fall through
+        case 'h':
+            seconds *= 60;
+            //fall through
+        case 'm':
+            seconds *= 60;
+            //fall through
+        case 's':
+            end++;
+            break;
+        default:
+            break;
+    }
+
+    //more than UINT64_MAX ns, about 584 years
+    if (*end != '\0' || seconds >= 1.8e10)
+    {
+        return false;
+    }
+
+    *ns = (uint64_t)(seconds * 1e9);
+
+    return true;
+}
+
 /**
  * Display the state values to the given stream.
  *
@@ -182,12 +431,13 @@ char *state_to_string(const struct dc_posix_env *env,  struct dc_error *err, con
         length += dc_strlen(env, ", fatal_error = ");
 
         //need to know how many bytes from the actual size.
-        length += dc_strlen(env, state->current_line);
+        length += state->current_line_length;
         length += 1; // for fatal error
 
         //need to dynamically allocate memory.
         str = dc_malloc(env, err, length + 1); // +1 for null byte.
-        sprintf(str, "current_line = \"%s\", fatal_error = %s", state->current_line, state->fatal_error? "1": "0");
+        sprintf(str, "current_line = \"%.*s\", fatal_error = %s", (int)state->current_line_length, state->current_line,
+                state->fatal_error? "1": "0");
     }
     else
     {
@@ -206,12 +456,3 @@ char *state_to_string(const struct dc_posix_env *env,  struct dc_error *err, con
      return str;
 }
 
-
-static void free_char(const struct dc_posix_env *env, char **target)
-{
-    if (target != NULL)
-    {
-        dc_free(env, *target, dc_strlen(env, (const char *) target));
-        *target = NULL;
-    }
-}
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include "tests.h"
+#include "arena.h"
+#include <stdint.h>
+#include <string.h>
+
+Describe(arena);
+
+static struct dc_posix_env environ;
+static struct dc_error error;
+
+BeforeEach(arena)
+{
+    dc_posix_env_init(&environ, NULL);
+    dc_error_init(&error, NULL);
+}
+
+AfterEach(arena)
+{
+    dc_error_reset(&error);
+}
+
+Ensure(arena, alloc)
+{
+    struct arena *arena;
+    char *first;
+    char *second;
+    double *numbers;
+
+    arena = arena_create(&environ, &error, 64);
+    assert_that(arena, is_not_null);
+
+    first = arena_strndup(&environ, &error, arena, "hello world", 5);
+    assert_that(first, is_equal_to_string("hello"));
+    second = arena_strndup(&environ, &error, arena, "dc_shell", 8);
+    assert_that(second, is_equal_to_string("dc_shell"));
+    assert_that(first, is_equal_to_string("hello"));
+
+    numbers = arena_calloc(&environ, &error, arena, 4, sizeof(double));
+    assert_that((uintptr_t)numbers % _Alignof(max_align_t), is_equal_to(0));
+    assert_that(numbers[3] == 0.0, is_true);
+
+    // bigger than the block, a new block is added and the old memory stays valid
+    assert_that(arena_alloc(&environ, &error, arena, 1000), is_not_null);
+    assert_that(arena->blocks->size, is_greater_than(999));
+    assert_that(arena->blocks->next, is_not_null);
+    assert_that(second, is_equal_to_string("dc_shell"));
+    assert_false(dc_error_has_error(&error));
+
+    arena_destroy(&environ, &arena);
+    assert_that(arena, is_null);
+}
+
+Ensure(arena, realloc)
+{
+    struct arena *arena;
+    char *str;
+    char *grown;
+    char *other;
+
+    arena = arena_create(&environ, &error, 256);
+
+    // the last allocation grows in place
+    str = arena_strndup(&environ, &error, arena, "abc", 3);
+    grown = arena_realloc(&environ, &error, arena, str, 4, 32);
+    assert_that(grown, is_equal_to(str));
+    assert_that(grown, is_equal_to_string("abc"));
+
+    // anything else is copied
+    other = arena_strndup(&environ, &error, arena, "xyz", 3);
+    grown = arena_realloc(&environ, &error, arena, str, 32, 64);
+    assert_that(grown, is_not_equal_to(str));
+    assert_that(grown, is_equal_to_string("abc"));
+    assert_that(other, is_equal_to_string("xyz"));
+
+    grown = arena_realloc(&environ, &error, arena, NULL, 0, 16);
+    assert_that(grown, is_not_null);
+
+    arena_destroy(&environ, &arena);
+}
+
+Ensure(arena, reset)
+{
+    struct arena *arena;
+    size_t largest;
+
+    arena = arena_create(&environ, &error, 64);
+    arena_alloc(&environ, &error, arena, 32);
+    arena_alloc(&environ, &error, arena, 100);
+    arena_alloc(&environ, &error, arena, 500);
+    largest = arena->blocks->size;
+
+    // only the largest block is kept
+    arena_reset(&environ, arena);
+    assert_that(arena->blocks->next, is_null);
+    assert_that(arena->blocks->used, is_equal_to(0));
+    assert_that(arena->blocks->size, is_equal_to(largest));
+
+    // the next block is twice as big and holds everything, once it is kept nothing more is added
+    arena_alloc(&environ, &error, arena, 32);
+    arena_alloc(&environ, &error, arena, 100);
+    arena_alloc(&environ, &error, arena, 500);
+    arena_reset(&environ, arena);
+    assert_that(arena->blocks->size, is_equal_to(largest * 2));
+
+    arena_alloc(&environ, &error, arena, 32);
+    arena_alloc(&environ, &error, arena, 100);
+    arena_alloc(&environ, &error, arena, 500);
+    assert_that(arena->blocks->next, is_null);
+
+    arena_destroy(&environ, &arena);
+}
+
+Ensure(arena, heap)
+{
+    char *str;
+
+    // without an arena the memory comes from the heap
+    str = arena_strndup(&environ, &error, NULL, "heap", 4);
+    assert_that(str, is_equal_to_string("heap"));
+    str = arena_realloc(&environ, &error, NULL, str, 5, 64);
+    assert_that(str, is_equal_to_string("heap"));
+    free(str);
+}
+
+TestSuite *arena_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, arena, alloc);
+    add_test_with_context(suite, arena, realloc);
+    add_test_with_context(suite, arena, reset);
+    add_test_with_context(suite, arena, heap);
+
+    return suite;
+}
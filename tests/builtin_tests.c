@@ -7,6 +7,8 @@
 #include <unistd.h>
 
 static void test_builtin_cd(const char *line, const char *cmd, size_t argc, char **argv, const char *expected_dir, const char *expected_message);
+static void set_arguments(struct command *command, const char **arguments);
+static void clear_arguments(struct command *command);
 
 Describe(builtin);
 
@@ -100,12 +102,244 @@ static void test_builtin_cd(const char *line, const char *cmd, size_t argc, char
     destroy_command(&environ, &command);
 }
 
+Ensure(builtin, builtin_hash)
+{
+    struct command command;
+    struct command_hash *hash;
+    char **path;
+    char out[1024];
+    char message[1024];
+    FILE *out_file;
+    FILE *err_file;
+
+    path = dc_strs_to_array(&environ, &error, 3, "/usr/bin", "/bin", NULL);
+    hash = command_hash_create(&environ, &error);
+    memset(out, 0, sizeof(out));
+    memset(message, 0, sizeof(message));
+    out_file = fmemopen(out, sizeof(out), "w");
+    err_file = fmemopen(message, sizeof(message), "w");
+
+    memset(&command, 0, sizeof(struct command));
+    command.argc = 3;
+    command.argv = dc_strs_to_array(&environ, &error, 4, NULL, "ls", "asdasdasdfddfgsdfgasderdfdsf", NULL);
+    builtin_hash(&environ, &error, &command, hash, path, out_file, err_file);
+    fflush(err_file);
+    assert_that(command.exit_code, is_equal_to(1));
+    assert_that(message, is_equal_to_string("hash: asdasdasdfddfgsdfgasderdfdsf: not found\n"));
+    assert_that(hash->count, is_equal_to(1));
+
+    dc_strs_destroy_array(&environ, 4, command.argv);
+    free(command.argv);
+    command.argc = 2;
+    command.argv = dc_strs_to_array(&environ, &error, 3, NULL, "-r", NULL);
+    builtin_hash(&environ, &error, &command, hash, path, out_file, err_file);
+    assert_that(command.exit_code, is_equal_to(0));
+    assert_that(hash->count, is_equal_to(0));
+
+    command.argc = 1;
+    builtin_hash(&environ, &error, &command, hash, path, out_file, err_file);
+    fflush(out_file);
+    assert_that(out, is_equal_to_string("hash table empty\n"));
+
+    dc_strs_destroy_array(&environ, 3, command.argv);
+    free(command.argv);
+    fclose(out_file);
+    fclose(err_file);
+    command_hash_destroy(&environ, &hash);
+    dc_strs_destroy_array(&environ, 3, path);
+    free(path);
+}
+
+Ensure(builtin, builtin_echo)
+{
+    struct command command;
+    const char *hello[] = { "echo", "hello", "world", NULL };
+    const char *no_newline[] = { "echo", "-n", "a", NULL };
+    const char *empty[] = { "echo", NULL };
+    char out[1024];
+    FILE *out_file;
+
+    memset(&command, 0, sizeof(command));
+    memset(out, 0, sizeof(out));
+    out_file = fmemopen(out, sizeof(out), "w");
+
+    set_arguments(&command, hello);
+    builtin_echo(&environ, &command, out_file);
+    assert_that(command.exit_code, is_equal_to(0));
+    set_arguments(&command, no_newline);
+    builtin_echo(&environ, &command, out_file);
+    set_arguments(&command, empty);
+    builtin_echo(&environ, &command, out_file);
+    fflush(out_file);
+    assert_that(out, is_equal_to_string("hello world\na\n"));
+
+    fclose(out_file);
+    clear_arguments(&command);
+}
+
+Ensure(builtin, builtin_printf)
+{
+    struct command command;
+    const char *reused[] = { "printf", "%s=%03d %-3s|%x %c%%\\n", "a", "5", "b", "255", "zed", "c", "-2", NULL };
+    const char *widths[] = { "printf", "[%*d|%.*s|%+d|%#o|%#X|%.0d]", "4", "7", "2", "abc", "3", "8", "255", "0", NULL };
+    const char *escapes[] = { "printf", "%b\\101\\t", "x\\ny\\cz", NULL };
+    const char *invalid[] = { "printf", "%d", "x1", NULL };
+    const char *usage[] = { "printf", NULL };
+    char out[1024];
+    char message[1024];
+    FILE *out_file;
+    FILE *err_file;
+
+    memset(&command, 0, sizeof(command));
+    memset(out, 0, sizeof(out));
+    memset(message, 0, sizeof(message));
+    out_file = fmemopen(out, sizeof(out), "w");
+    err_file = fmemopen(message, sizeof(message), "w");
+
+    // the format is reused until the arguments run out, the missing ones are "" and 0
+    set_arguments(&command, reused);
+    builtin_printf(&environ, &command, out_file, err_file);
+    assert_that(command.exit_code, is_equal_to(0));
+    set_arguments(&command, widths);
+    builtin_printf(&environ, &command, out_file, err_file);
+    set_arguments(&command, escapes);
+    builtin_printf(&environ, &command, out_file, err_file);
+    fflush(out_file);
+    assert_that(out, is_equal_to_string("a=005 b  |ff z%\nc=-02    |0 %\n[   7|ab|+3|010|0XFF|]x\ny"));
+
+    set_arguments(&command, invalid);
+    builtin_printf(&environ, &command, out_file, err_file);
+    assert_that(command.exit_code, is_equal_to(1));
+    set_arguments(&command, usage);
+    builtin_printf(&environ, &command, out_file, err_file);
+    assert_that(command.exit_code, is_equal_to(2));
+    fflush(err_file);
+    assert_that(message, is_equal_to_string("printf: x1: invalid number\nusage: printf format [arguments]\n"));
+
+    fclose(out_file);
+    fclose(err_file);
+    clear_arguments(&command);
+}
+
+Ensure(builtin, builtin_test)
+{
+    struct command command;
+    const char *none[] = { "test", NULL };
+    const char *string[] = { "test", "abc", NULL };
+    const char *empty[] = { "test", "-z", "", NULL };
+    const char *directory[] = { "test", "-d", "/", NULL };
+    const char *missing[] = { "test", "!", "-e", "/does/not/exist", NULL };
+    const char *compare[] = { "[", "1", "-ge", "2", "]", NULL };
+    const char *group[] = { "[", "(", "x", ")", "]", NULL };
+    const char *unclosed[] = { "[", "a", NULL };
+    const char *integer[] = { "test", "a", "-eq", "1", NULL };
+    const char *unary[] = { "test", "a", "b", NULL };
+    const char **expressions[] = { none, string, empty, directory, missing, compare, group, unclosed, integer, unary };
+    int expected[] = { 1, 0, 0, 0, 0, 1, 0, 2, 2, 2 };
+    char message[1024];
+    FILE *err_file;
+
+    memset(&command, 0, sizeof(command));
+    memset(message, 0, sizeof(message));
+    err_file = fmemopen(message, sizeof(message), "w");
+
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++)
+    {
+        set_arguments(&command, expressions[i]);
+        builtin_test(&environ, &command, err_file);
+        assert_that(command.exit_code, is_equal_to(expected[i]));
+    }
+
+    fflush(err_file);
+    assert_that(message, is_equal_to_string("[: missing `]'\n"
+                                            "test: a: integer expression expected\n"
+                                            "test: a: unary operator expected\n"));
+    fclose(err_file);
+    clear_arguments(&command);
+}
+
+Ensure(builtin, builtin_find)
+{
+    assert_that(builtin_find(&environ, "["), is_not_null);
+    assert_that(builtin_find(&environ, "cd")->name, is_equal_to_string("cd"));
+    assert_that(builtin_find(&environ, "wait")->name, is_equal_to_string("wait"));
+    assert_that(builtin_find(&environ, "ls"), is_null);
+    assert_that(builtin_find(&environ, ""), is_null);
+}
+
+Ensure(builtin, builtin_handles)
+{
+    struct command command;
+    const char *echo_n[] = { "echo", "-n", "-x", NULL };
+    const char *echo_e[] = { "echo", "-e", "a\\tb", NULL };
+    const char *echo_n_n[] = { "echo", "-n", "-n", NULL };
+    const char *printf_d[] = { "printf", "%-5.*d%%\\n", "2", "3", NULL };
+    const char *printf_f[] = { "printf", "%.2f", "1.5", NULL };
+    const char *printf_hex[] = { "printf", "\\x41", NULL };
+    const char *test_not[] = { "[", "!", "-z", "a", "]", NULL };
+    const char *test_and[] = { "test", "-n", "a", "-a", "-n", "b", NULL };
+    const char *test_newer[] = { "test", "a", "-nt", "b", NULL };
+    const char **commands[] = { echo_n, echo_e, echo_n_n, printf_d, printf_f, printf_hex, test_not, test_and,
+                                test_newer };
+    bool expected[] = { true, false, false, true, false, false, true, false, false };
+
+    memset(&command, 0, sizeof(command));
+
+    // the builtins leave what they do not know to the programs
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++)
+    {
+        set_arguments(&command, commands[i]);
+        assert_that(builtin_handles(&environ, builtin_find(&environ, command.command), &command),
+                    is_equal_to(expected[i]));
+    }
+
+    assert_true(builtin_handles(&environ, builtin_find(&environ, "cd"), &command));
+    clear_arguments(&command);
+}
+
+static void set_arguments(struct command *command, const char **arguments)
+{
+    clear_arguments(command);
+
+    while (arguments[command->argc] != NULL)
+    {
+        command->argc++;
+    }
+
+    command->argv = calloc(command->argc + 1, sizeof(char *));
+    for (size_t i = 0; i < command->argc; i++)
+    {
+        command->argv[i] = strdup(arguments[i]);
+    }
+    command->command = command->argv[0];
+}
+
+static void clear_arguments(struct command *command)
+{
+    if (command->argv != NULL)
+    {
+        for (size_t i = 0; i < command->argc; i++)
+        {
+            free(command->argv[i]);
+        }
+        free(command->argv);
+    }
+
+    memset(command, 0, sizeof(struct command));
+}
+
 TestSuite *builtin_tests(void)
 {
     TestSuite *suite;
 
     suite = create_test_suite();
     add_test_with_context(suite, builtin, builtin_cd);
+    add_test_with_context(suite, builtin, builtin_hash);
+    add_test_with_context(suite, builtin, builtin_echo);
+    add_test_with_context(suite, builtin, builtin_printf);
+    add_test_with_context(suite, builtin, builtin_test);
+    add_test_with_context(suite, builtin, builtin_find);
+    add_test_with_context(suite, builtin, builtin_handles);
 
     return suite;
 }
@@ -0,0 +1,151 @@
+#include "tests.h"
+#include "arena.h"
+#include "command_cache.h"
+
+static void init_test_command(struct command *command, char *name, char **argv, size_t argc,
+                              enum connector connector);
+
+Describe(command_cache);
+
+static struct dc_posix_env environ;
+static struct dc_error error;
+
+BeforeEach(command_cache)
+{
+    dc_posix_env_init(&environ, NULL);
+    dc_error_init(&error, NULL);
+}
+
+AfterEach(command_cache)
+{
+    dc_error_reset(&error);
+}
+
+Ensure(command_cache, can_cache)
+{
+    assert_true(command_cache_can_cache("ls -l | wc -l", 13));
+    assert_true(command_cache_can_cache("echo 'a b' > out; true && false", 32));
+    assert_false(command_cache_can_cache("echo $HOME", 10));
+    assert_false(command_cache_can_cache("echo '$HOME'", 12));
+    assert_false(command_cache_can_cache("echo `pwd`", 10));
+    assert_false(command_cache_can_cache("cd ~", 4));
+    assert_false(command_cache_can_cache("ls *.c", 6));
+    assert_false(command_cache_can_cache("ls a?", 5));
+    assert_false(command_cache_can_cache("ls [ab]", 7));
+
+    // only the length given is looked at
+    assert_true(command_cache_can_cache("ls $HOME", 3));
+}
+
+Ensure(command_cache, put_and_get)
+{
+    struct command_cache *cache;
+    struct arena *arena;
+    struct command commands[2];
+    struct command *found;
+    char ls[] = "ls";
+    char wc[] = "wc";
+    char option[] = "-l";
+    char out[] = "out";
+    char *ls_argv[] = {NULL, option, NULL};
+    char *wc_argv[] = {NULL, NULL};
+    size_t count;
+
+    cache = command_cache_create(&environ, &error, 4);
+    assert_that(cache, is_not_null);
+    arena = arena_create(&environ, &error, 256);
+
+    init_test_command(&commands[0], ls, ls_argv, 2, CONNECTOR_PIPE);
+    commands[0].stdout_file = out;
+    commands[0].stdout_overwrite = true;
+    commands[0].exit_code = 3;
+    init_test_command(&commands[1], wc, wc_argv, 1, CONNECTOR_END);
+
+    assert_false(command_cache_get(&environ, &error, cache, "ls -l > out | wc", 16, arena, &found, &count));
+    command_cache_put(&environ, &error, cache, "ls -l > out | wc", 16, commands, 2);
+    assert_false(dc_error_has_error(&error));
+    assert_that(cache->count, is_equal_to(1));
+
+    // the cache has copies, the commands it was given can change
+    option[1] = 'a';
+    assert_true(command_cache_get(&environ, &error, cache, "ls -l > out | wc", 16, arena, &found, &count));
+    assert_that(count, is_equal_to(2));
+    assert_that(found[0].arena, is_equal_to(arena));
+    assert_that(found[0].line, is_equal_to_string("ls"));
+    assert_that(found[0].command, is_equal_to_string("ls"));
+    assert_that(found[0].argc, is_equal_to(2));
+    assert_that(found[0].argv[0], is_null);
+    assert_that(found[0].argv[1], is_equal_to_string("-l"));
+    assert_that(found[0].argv[2], is_null);
+    assert_that(found[0].stdout_file, is_equal_to_string("out"));
+    assert_true(found[0].stdout_overwrite);
+    assert_that(found[0].stdin_file, is_null);
+    assert_that(found[0].exit_code, is_equal_to(0));
+    assert_that(found[0].connector, is_equal_to(CONNECTOR_PIPE));
+    assert_that(found[1].command, is_equal_to_string("wc"));
+    assert_that(found[1].argv[1], is_null);
+    assert_that(found[1].connector, is_equal_to(CONNECTOR_END));
+    assert_that(cache->hits, is_equal_to(1));
+    assert_that(cache->misses, is_equal_to(1));
+
+    // the same text only, not a prefix of it
+    assert_false(command_cache_get(&environ, &error, cache, "ls -l > out", 11, arena, &found, &count));
+
+    command_cache_destroy(&environ, &cache);
+    assert_that(cache, is_null);
+    arena_destroy(&environ, &arena);
+}
+
+Ensure(command_cache, least_recently_used)
+{
+    struct command_cache *cache;
+    struct arena *arena;
+    struct command command;
+    struct command *found;
+    char name[] = "a";
+    char *argv[] = {NULL, NULL};
+    size_t count;
+
+    cache = command_cache_create(&environ, &error, 2);
+    arena = arena_create(&environ, &error, 256);
+    init_test_command(&command, name, argv, 1, CONNECTOR_END);
+
+    command_cache_put(&environ, &error, cache, "a", 1, &command, 1);
+    command_cache_put(&environ, &error, cache, "b", 1, &command, 1);
+    assert_true(command_cache_get(&environ, &error, cache, "a", 1, arena, &found, &count));
+
+    // b is the least recently used, it is the one dropped
+    command_cache_put(&environ, &error, cache, "c", 1, &command, 1);
+    assert_that(cache->count, is_equal_to(2));
+    assert_true(command_cache_get(&environ, &error, cache, "a", 1, arena, &found, &count));
+    assert_false(command_cache_get(&environ, &error, cache, "b", 1, arena, &found, &count));
+    assert_true(command_cache_get(&environ, &error, cache, "c", 1, arena, &found, &count));
+    assert_that(cache->oldest->line, is_equal_to_string("a"));
+    assert_that(cache->newest->line, is_equal_to_string("c"));
+
+    command_cache_destroy(&environ, &cache);
+    arena_destroy(&environ, &arena);
+}
+
+static void init_test_command(struct command *command, char *name, char **argv, size_t argc,
+                              enum connector connector)
+{
+    memset(command, 0, sizeof(struct command));
+    command->line = name;
+    command->command = name;
+    command->argv = argv;
+    command->argc = argc;
+    command->connector = connector;
+}
+
+TestSuite *command_cache_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, command_cache, can_cache);
+    add_test_with_context(suite, command_cache, put_and_get);
+    add_test_with_context(suite, command_cache, least_recently_used);
+
+    return suite;
+}
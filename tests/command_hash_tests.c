@@ -0,0 +1,126 @@
+#include "tests.h"
+#include "command_hash.h"
+#include <dc_util/strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+Describe(command_hash);
+
+static struct dc_posix_env environ;
+static struct dc_error error;
+
+BeforeEach(command_hash)
+{
+    dc_posix_env_init(&environ, NULL);
+    dc_error_init(&error, NULL);
+}
+
+AfterEach(command_hash)
+{
+    dc_error_reset(&error);
+}
+
+Ensure(command_hash, lookup)
+{
+    struct command_hash *hash;
+    char **path;
+    const char *found;
+
+    path = dc_strs_to_array(&environ, &error, 4, "/does/not/exist", "/usr/bin", "/bin", NULL);
+    hash = command_hash_create(&environ, &error);
+    assert_that(hash, is_not_null);
+    assert_that(hash->count, is_equal_to(0));
+
+    found = command_hash_lookup(&environ, &error, hash, "ls", path);
+    assert_false(dc_error_has_error(&error));
+    assert_that(found, is_not_null);
+    assert_that(access(found, X_OK), is_equal_to(0));
+    assert_that(hash->count, is_equal_to(1));
+
+    assert_that(command_hash_lookup(&environ, &error, hash, "ls", path), is_equal_to_string(found));
+    assert_that(hash->count, is_equal_to(1));
+
+    assert_that(command_hash_lookup(&environ, &error, hash, "asdasdasdfddfgsdfgasderdfdsf", path), is_null);
+    assert_that(hash->count, is_equal_to(1));
+
+    command_hash_clear(&environ, hash);
+    assert_that(hash->count, is_equal_to(0));
+
+    command_hash_destroy(&environ, &hash);
+    assert_that(hash, is_null);
+    dc_strs_destroy_array(&environ, 4, path);
+    free(path);
+}
+
+Ensure(command_hash, invalidated_by_directory_change)
+{
+    struct command_hash *hash;
+    char **path;
+    char dir[32];
+    char program[64];
+    char shadow[64];
+    FILE *file;
+
+    strcpy(dir, "/tmp/hashXXXXXX");
+    mkdtemp(dir);
+    sprintf(program, "%s/prog", dir);
+    file = fopen(program, "w");
+    fclose(file);
+    chmod(program, 0700);
+
+    path = dc_strs_to_array(&environ, &error, 2, dir, NULL);
+    hash = command_hash_create(&environ, &error);
+    assert_that(command_hash_lookup(&environ, &error, hash, "prog", path), is_equal_to_string(program));
+
+    // removing the program changes the directory, so the entry must not be used again
+    unlink(program);
+    assert_that(command_hash_lookup(&environ, &error, hash, "prog", path), is_null);
+    assert_that(hash->count, is_equal_to(0));
+
+    sprintf(shadow, "%s/prog", dir);
+    file = fopen(shadow, "w");
+    fclose(file);
+    chmod(shadow, 0700);
+    assert_that(command_hash_lookup(&environ, &error, hash, "prog", path), is_equal_to_string(shadow));
+
+    unlink(shadow);
+    rmdir(dir);
+    command_hash_destroy(&environ, &hash);
+    dc_strs_destroy_array(&environ, 2, path);
+    free(path);
+}
+
+Ensure(command_hash, invalidated_by_path_change)
+{
+    struct command_hash *hash;
+    char **path;
+    char *old_path;
+
+    old_path = strdup(getenv("PATH"));
+    path = dc_strs_to_array(&environ, &error, 3, "/usr/bin", "/bin", NULL);
+    hash = command_hash_create(&environ, &error);
+    command_hash_lookup(&environ, &error, hash, "ls", path);
+    assert_that(hash->count, is_equal_to(1));
+
+    setenv("PATH", "/bin", true);
+    command_hash_lookup(&environ, &error, hash, "asdasdasdfddfgsdfgasderdfdsf", path);
+    assert_that(hash->count, is_equal_to(0));
+
+    setenv("PATH", old_path, true);
+    free(old_path);
+    command_hash_destroy(&environ, &hash);
+    dc_strs_destroy_array(&environ, 3, path);
+    free(path);
+}
+
+TestSuite *command_hash_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, command_hash, lookup);
+    add_test_with_context(suite, command_hash, invalidated_by_directory_change);
+    add_test_with_context(suite, command_hash, invalidated_by_path_change);
+
+    return suite;
+}
@@ -4,6 +4,7 @@
 #include <dc_util/path.h>
 #include <dc_util/strings.h>
 #include "command.h"
+#include "arena.h"
 
 static void test_parse_command(const char *expected_line,
                                const char *expected_command,
@@ -180,6 +181,32 @@ Ensure(command, parse_command)
     dc_strs_destroy_array(&environ, 5, argv);
     free(argv);
 
+    argv = dc_strs_to_array(&environ, &error, 3, NULL, "-l", NULL);
+    test_parse_command("< in.txt 2>err.txt ls >out.txt -l",
+                       "ls",
+                       2,
+                       argv,
+                       "in.txt",
+                       "out.txt",
+                       true,
+                       "err.txt",
+                       true);
+    dc_strs_destroy_array(&environ, 3, argv);
+    free(argv);
+
+    argv = dc_strs_to_array(&environ, &error, 4, NULL, "a b", "c|d>e", NULL);
+    test_parse_command("echo 'a b' \"c|d>e\" 1>out.txt",
+                       "echo",
+                       3,
+                       argv,
+                       NULL,
+                       "out.txt",
+                       true,
+                       NULL,
+                       false);
+    dc_strs_destroy_array(&environ, 4, argv);
+    free(argv);
+
     /*
     argv = dc_strs_to_array(&environ, &error, 5, NULL, "/User/ds/hello", "evil", "world", NULL);
     test_parse_command("foo ~/hello ~/def/evil \"world rocks\"",
@@ -215,9 +242,13 @@ static void test_parse_command(const char *expected_line,
     state.stdin = NULL;
     state.stdout = NULL;
     state.stderr = NULL;
+    state.options = NULL;
     init_state(&environ, &error, &state);
-    state.command = calloc(1, sizeof(struct command));
-    state.command->line = strdup(expected_line);
+    // the same as separate_commands, the command and everything parsed in to it are in the state's arena
+    state.command = arena_calloc(&environ, &error, state.arena, 1, sizeof(struct command));
+    state.command_count = 1;
+    state.command->arena = state.arena;
+    state.command->line = arena_strndup(&environ, &error, state.arena, expected_line, strlen(expected_line));
     parse_command(&environ, &error, &state, state.command);
     assert_that(state.command->line, is_equal_to_string(expected_line));
     assert_that(state.command->command, is_equal_to_string(expected_command));
@@ -274,6 +305,7 @@ static void test_destroy_command(const char *expected_line)
     state.stdin = NULL;
     state.stdout = NULL;
     state.stderr = NULL;
+    state.options = NULL;
     init_state(&environ, &error, &state);
     state.command = calloc(1, sizeof(struct command));
     state.command->line = strdup(expected_line);
@@ -285,6 +317,8 @@ static void test_destroy_command(const char *expected_line)
     assert_that(state.command->stdin_file, is_null);
     assert_that(state.command->stdout_file, is_null);
     assert_that(state.command->stderr_file, is_null);
+    free(state.command);
+    state.command = NULL;
     destroy_state(&environ, &error, &state);
 }
 
@@ -0,0 +1,180 @@
+#include "tests.h"
+#include "copy.h"
+#include <dc_util/strings.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static void test_is_copy_command(const char *cmd, size_t argc, char **argv, bool expected);
+static void test_copy_fd(const char *data, int out_flags);
+static int create_file(const char *data, char *template);
+
+Describe(copy);
+
+static struct dc_posix_env environ;
+static struct dc_error error;
+
+BeforeEach(copy)
+{
+    dc_posix_env_init(&environ, NULL);
+    dc_error_init(&error, NULL);
+}
+
+AfterEach(copy)
+{
+    dc_error_reset(&error);
+}
+
+Ensure(copy, is_copy_command)
+{
+#if defined(__linux__)
+    test_is_copy_command("cat", 1, dc_strs_to_array(&environ, &error, 2, NULL, NULL), true);
+    test_is_copy_command("cat", 3, dc_strs_to_array(&environ, &error, 4, NULL, "a", "b", NULL), true);
+    test_is_copy_command("tee", 2, dc_strs_to_array(&environ, &error, 3, NULL, "a", NULL), true);
+#endif
+    test_is_copy_command("cat", 2, dc_strs_to_array(&environ, &error, 3, NULL, "-n", NULL), false);
+    test_is_copy_command("cat", 3, dc_strs_to_array(&environ, &error, 4, NULL, "a", "-", NULL), false);
+    test_is_copy_command("tee", 1, dc_strs_to_array(&environ, &error, 2, NULL, NULL), false);
+    test_is_copy_command("tee", 3, dc_strs_to_array(&environ, &error, 4, NULL, "-a", "a", NULL), false);
+    test_is_copy_command("tee", 3, dc_strs_to_array(&environ, &error, 4, NULL, "a", "b", NULL), false);
+    test_is_copy_command("ls", 1, dc_strs_to_array(&environ, &error, 2, NULL, NULL), false);
+    test_is_copy_command("/bin/cat", 1, dc_strs_to_array(&environ, &error, 2, NULL, NULL), false);
+}
+
+static void test_is_copy_command(const char *cmd, size_t argc, char **argv, bool expected)
+{
+    struct command command;
+
+    memset(&command, 0, sizeof(struct command));
+    command.command = strdup(cmd);
+    command.argc = argc;
+    command.argv = argv;
+
+    assert_that(is_copy_command(&environ, &command), is_equal_to(expected));
+
+    destroy_command(&environ, &command);
+}
+
+Ensure(copy, file_to_file)
+{
+    test_copy_fd("hello\nworld\n", O_TRUNC);
+    test_copy_fd("", O_TRUNC);
+    // the kernel will not copy in to an O_APPEND file, read/write is used instead
+    test_copy_fd("hello\nworld\n", O_APPEND);
+}
+
+static void test_copy_fd(const char *data, int out_flags)
+{
+    char in_template[16];
+    char out_template[16];
+    char buf[1024];
+    int in_fd;
+    int out_fd;
+    off_t copied;
+    ssize_t nread;
+
+    strcpy(in_template, "/tmp/fileXXXXXX");
+    strcpy(out_template, "/tmp/fileXXXXXX");
+    in_fd = create_file(data, in_template);
+    out_fd = create_file("", out_template);
+    close(out_fd);
+    out_fd = open(out_template, O_WRONLY | out_flags);
+
+    copied = copy_fd(&environ, &error, in_fd, out_fd);
+    assert_false(dc_error_has_error(&error));
+    assert_that(copied, is_equal_to(strlen(data)));
+    close(out_fd);
+
+    memset(buf, 0, sizeof(buf));
+    out_fd = open(out_template, O_RDONLY);
+    nread = read(out_fd, buf, sizeof(buf));
+    assert_that(nread, is_equal_to(strlen(data)));
+    assert_that(buf, is_equal_to_string(data));
+
+    close(in_fd);
+    close(out_fd);
+    unlink(in_template);
+    unlink(out_template);
+}
+
+Ensure(copy, file_to_pipe)
+{
+    char template[16];
+    char buf[1024];
+    const char *data;
+    int fds[2];
+    int in_fd;
+    off_t copied;
+    ssize_t nread;
+
+    data = "some data\nfor the pipe\n";
+    strcpy(template, "/tmp/fileXXXXXX");
+    in_fd = create_file(data, template);
+    pipe(fds);
+
+    copied = copy_fd(&environ, &error, in_fd, fds[1]);
+    assert_false(dc_error_has_error(&error));
+    assert_that(copied, is_equal_to(strlen(data)));
+    close(fds[1]);
+
+    memset(buf, 0, sizeof(buf));
+    nread = read(fds[0], buf, sizeof(buf));
+    assert_that(nread, is_equal_to(strlen(data)));
+    assert_that(buf, is_equal_to_string(data));
+
+    close(fds[0]);
+    close(in_fd);
+    unlink(template);
+}
+
+Ensure(copy, pipe_to_file)
+{
+    char template[16];
+    char buf[1024];
+    const char *data;
+    int fds[2];
+    int out_fd;
+    off_t copied;
+
+    data = "from a pipe\n";
+    strcpy(template, "/tmp/fileXXXXXX");
+    out_fd = create_file("", template);
+    pipe(fds);
+    write(fds[1], data, strlen(data));
+    close(fds[1]);
+
+    copied = copy_fd(&environ, &error, fds[0], out_fd);
+    assert_false(dc_error_has_error(&error));
+    assert_that(copied, is_equal_to(strlen(data)));
+
+    memset(buf, 0, sizeof(buf));
+    pread(out_fd, buf, sizeof(buf), 0);
+    assert_that(buf, is_equal_to_string(data));
+
+    close(fds[0]);
+    close(out_fd);
+    unlink(template);
+}
+
+static int create_file(const char *data, char *template)
+{
+    int fd;
+
+    fd = mkstemp(template);
+    write(fd, data, strlen(data));
+    lseek(fd, 0, SEEK_SET);
+
+    return fd;
+}
+
+TestSuite *copy_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, copy, is_copy_command);
+    add_test_with_context(suite, copy, file_to_file);
+    add_test_with_context(suite, copy, file_to_pipe);
+    add_test_with_context(suite, copy, pipe_to_file);
+
+    return suite;
+}
@@ -1,11 +1,16 @@
 #include "tests.h"
 #include "../include/execute.h"
+#include "../include/pool.h"
 #include <dc_util/strings.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
+static int run_limited(const char *cmd, size_t argc, char **argv, const struct command_limits *limits, uint64_t *wall);
 static void test_execute(const char *cmd, size_t argc, char **argv, char **path, bool check_exit_code, int expected_exit_code, const char *out_file_name, const char *err_file_name);
+static void test_launch(const char *cmd, const char *resolved_path, size_t argc, char **argv, char **path, int expected_exit_code, const char *out_file_name, const char *err_file_name);
 static void check_redirection(const char *file_name);
+static void test_argv0(enum launcher launcher, const char *resolved_path, char **path);
+static void test_copy_command(enum launcher launcher);
 
 Describe(execute);
 
@@ -61,6 +66,244 @@ Ensure(execute, execute)
     free(path);
 }
 
+Ensure(execute, launch_spawn)
+{
+    char **path;
+    char **argv;
+    char template[16];
+
+    path = dc_strs_to_array(&environ, &error, 3, "/bin", "/usr/bin", NULL);
+
+    argv = dc_strs_to_array(&environ, &error, 2, NULL, NULL);
+    strcpy(template, "/tmp/fileXXXXXX");
+    test_launch("pwd", "/bin/pwd", 1, argv, path, 0, template, NULL);
+
+    argv = dc_strs_to_array(&environ, &error, 3, NULL, "asdasdasdfddfgsdfgasderdfdsf", NULL);
+    strcpy(template, "/tmp/fileXXXXXX");
+    test_launch("ls", "/bin/ls", 2, argv, path, 2, NULL, template);
+
+    // not resolved, falls back to fork and the path search in the child
+    argv = dc_strs_to_array(&environ, &error, 2, NULL, NULL);
+    test_launch("ls", NULL, 1, argv, path, 0, NULL, NULL);
+
+    dc_strs_destroy_array(&environ, 3, path);
+    free(path);
+
+    path = dc_strs_to_array(&environ, &error, 1, NULL);
+
+    argv = dc_strs_to_array(&environ, &error, 2, NULL, NULL);
+    test_launch("asdasdasdfddfgsdfgasderdfdsf", NULL, 1, argv, path, 127, NULL, NULL);
+
+    dc_strs_destroy_array(&environ, 1, path);
+    free(path);
+}
+
+Ensure(execute, argv0)
+{
+    char **path;
+
+    // every launcher gives the program the name as typed, however it was found
+    path = dc_strs_to_array(&environ, &error, 3, "/bin", "/usr/bin", NULL);
+    test_argv0(LAUNCHER_SPAWN, "/usr/bin/head", path);
+    test_argv0(LAUNCHER_FORK, "/usr/bin/head", path);
+    test_argv0(LAUNCHER_FORK, NULL, path);
+    dc_strs_destroy_array(&environ, 3, path);
+    free(path);
+}
+
+Ensure(execute, copy_command)
+{
+    // cat is copied in the kernel whatever the launcher, the program it resolved to is not run
+    test_copy_command(LAUNCHER_SPAWN);
+    test_copy_command(LAUNCHER_FORK);
+    assert_true(worker_pool_start(&environ, &error, 1));
+    test_copy_command(LAUNCHER_POOL);
+    worker_pool_stop(&environ);
+}
+
+Ensure(execute, limits)
+{
+    struct command_limits limits;
+    uint64_t wall;
+
+    // SIGTERM at the deadline, the exit code is the same as timeout(1)
+    memset(&limits, 0, sizeof(limits));
+    limits.timeout = 200 * 1000 * 1000;
+    assert_that(run_limited("/bin/sleep", 2, dc_strs_to_array(&environ, &error, 3, NULL, "5", NULL), &limits, &wall),
+                is_equal_to(124));
+    assert_that(wall, is_less_than(2000 * 1000 * 1000ULL));
+
+    // SIGKILL after the grace period for a program that ignores SIGTERM
+    limits.timeout = 100 * 1000 * 1000;
+    assert_that(run_limited("/bin/sh", 3, dc_strs_to_array(&environ, &error, 4, NULL, "-c",
+                                                           "trap '' TERM; sleep 5", NULL), &limits, &wall),
+                is_equal_to(124));
+    assert_that(wall, is_less_than(4000 * 1000 * 1000ULL));
+
+    // a program that finishes in time keeps its exit code
+    limits.timeout = 5000 * 1000 * 1000ULL;
+    assert_that(run_limited("/bin/sh", 3, dc_strs_to_array(&environ, &error, 4, NULL, "-c", "exit 3", NULL),
+                            &limits, &wall), is_equal_to(3));
+
+    // the resource limits are set in the child
+    memset(&limits, 0, sizeof(limits));
+    limits.open_files = 17;
+    limits.cpu = 60;
+    assert_that(run_limited("/bin/sh", 3, dc_strs_to_array(&environ, &error, 4, NULL, "-c",
+                                                           "test $(ulimit -n) = 17 && test $(ulimit -t) = 60", NULL),
+                            &limits, &wall), is_equal_to(0));
+}
+
+static int run_limited(const char *cmd, size_t argc, char **argv, const struct command_limits *limits, uint64_t *wall)
+{
+    struct command command;
+    pid_t pid;
+    int exit_code;
+
+    memset(&command, 0, sizeof(struct command));
+    command.command = strdup(cmd);
+    command.resolved_path = cmd;
+    command.argc = argc;
+    command.argv = argv;
+    command.limits = *limits;
+
+    pid = launch(&environ, &error, &command, NULL, LAUNCHER_SPAWN, -1, -1);
+    assert_that(pid, is_greater_than(0));
+    wait_for_command(&environ, &error, &command, pid);
+    assert_false(dc_error_has_error(&error));
+
+    exit_code = command.exit_code;
+    *wall = command.usage.wall;
+    destroy_command(&environ, &command);
+
+    return exit_code;
+}
+
+static void test_launch(const char *cmd, const char *resolved_path, size_t argc, char **argv, char **path, int expected_exit_code, const char *out_file_name, const char *err_file_name)
+{
+    struct command command;
+    pid_t pid;
+
+    memset(&command, 0, sizeof(struct command));
+    command.command = strdup(cmd);
+    command.resolved_path = resolved_path;
+    command.argc = argc;
+    command.argv = argv;
+
+    if(out_file_name)
+    {
+        command.stdout_file = strdup(out_file_name);
+    }
+
+    if(err_file_name)
+    {
+        command.stderr_file = strdup(err_file_name);
+    }
+
+    pid = launch(&environ, &error, &command, path, LAUNCHER_SPAWN, -1, -1);
+    assert_false(dc_error_has_error(&error));
+    assert_that(pid, is_greater_than(0));
+
+    wait_for_command(&environ, &error, &command, pid);
+    assert_that(command.exit_code, is_equal_to(expected_exit_code));
+
+    // the resources the child used come back with the exit code
+    assert_that(command.started, is_not_equal_to(0));
+    assert_that(command.usage.wall, is_greater_than(0));
+    assert_that(command.usage.max_rss, is_greater_than(0));
+
+    check_redirection(out_file_name);
+    check_redirection(err_file_name);
+
+    destroy_command(&environ, &command);
+    dc_error_reset(&error);
+}
+
+static void test_argv0(enum launcher launcher, const char *resolved_path, char **path)
+{
+    struct command command;
+    char template[] = "/tmp/argv0XXXXXX";
+    char name[] = "head";
+    char option[] = "-c";
+    char count[] = "5";
+    char file[] = "/proc/self/cmdline";
+    char *argv[5];
+    char buffer[16];
+    ssize_t nread;
+    pid_t pid;
+    int fd;
+
+    fd = mkstemp(template);
+    memset(&command, 0, sizeof(struct command));
+    argv[0] = NULL;
+    argv[1] = option;
+    argv[2] = count;
+    argv[3] = file;
+    argv[4] = NULL;
+    command.command = name;
+    command.resolved_path = resolved_path;
+    command.argc = 4;
+    command.argv = argv;
+    command.stdout_file = template;
+    command.stdout_overwrite = true;
+
+    pid = launch(&environ, &error, &command, path, launcher, -1, -1);
+    assert_that(pid, is_greater_than(0));
+    wait_for_command(&environ, &error, &command, pid);
+    assert_that(command.exit_code, is_equal_to(0));
+
+    nread = read(fd, buffer, sizeof(buffer));
+    assert_that(nread, is_equal_to(5));
+    assert_that(buffer, is_equal_to_string("head"));
+
+    close(fd);
+    unlink(template);
+}
+
+static void test_copy_command(enum launcher launcher)
+{
+    struct command command;
+    char in_template[] = "/tmp/copyXXXXXX";
+    char out_template[] = "/tmp/copyXXXXXX";
+    char name[] = "cat";
+    char *argv[3];
+    char buffer[16];
+    ssize_t nread;
+    pid_t pid;
+    int in_fd;
+    int out_fd;
+
+    in_fd = mkstemp(in_template);
+    write(in_fd, "copied\n", 7);
+    close(in_fd);
+    out_fd = mkstemp(out_template);
+
+    memset(&command, 0, sizeof(struct command));
+    argv[0] = NULL;
+    argv[1] = in_template;
+    argv[2] = NULL;
+    command.command = name;
+    command.resolved_path = "/bin/false";
+    command.argc = 2;
+    command.argv = argv;
+    command.stdout_file = out_template;
+    command.stdout_overwrite = true;
+
+    pid = launch(&environ, &error, &command, NULL, launcher, -1, -1);
+    assert_that(pid, is_greater_than(0));
+    wait_for_command(&environ, &error, &command, pid);
+    assert_that(command.exit_code, is_equal_to(0));
+
+    memset(buffer, 0, sizeof(buffer));
+    nread = read(out_fd, buffer, sizeof(buffer));
+    assert_that(nread, is_equal_to(7));
+    assert_that(buffer, is_equal_to_string("copied\n"));
+
+    close(out_fd);
+    unlink(in_template);
+    unlink(out_template);
+}
+
 static void test_execute(const char *cmd, size_t argc, char **argv, char **path, bool check_exit_code, int expected_exit_code, const char *out_file_name, const char *err_file_name)
 {
     struct command command;
@@ -114,6 +357,10 @@ TestSuite *execute_tests(void)
 
     suite = create_test_suite();
     add_test_with_context(suite, execute, execute);
+    add_test_with_context(suite, execute, launch_spawn);
+    add_test_with_context(suite, execute, argv0);
+    add_test_with_context(suite, execute, copy_command);
+    add_test_with_context(suite, execute, limits);
 
     return suite;
 }
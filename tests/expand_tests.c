@@ -0,0 +1,201 @@
+#include "tests.h"
+#include "expand.h"
+#include <dc_util/strings.h>
+#include <string.h>
+#include <unistd.h>
+
+static void test_expand_word(const char *word, int flags, size_t expected_count, char **expected_words);
+
+Describe(expand);
+
+static struct dc_posix_env environ;
+static struct dc_error error;
+
+BeforeEach(expand)
+{
+    dc_posix_env_init(&environ, NULL);
+    dc_error_init(&error, NULL);
+    setenv("DC_SHELL_ONE", "one", true);
+    setenv("DC_SHELL_TWO", " a  b ", true);
+    setenv("DC_SHELL_EMPTY", "", true);
+    unsetenv("DC_SHELL_UNSET");
+}
+
+AfterEach(expand)
+{
+    dc_error_reset(&error);
+}
+
+Ensure(expand, quotes)
+{
+    test_expand_word("abc", EXPAND_ALL, 1, dc_strs_to_array(&environ, &error, 2, "abc", NULL));
+    test_expand_word("'a b'\"c d\"", EXPAND_ALL, 1, dc_strs_to_array(&environ, &error, 2, "a bc d", NULL));
+    test_expand_word("a\\ b\\'", EXPAND_ALL, 1, dc_strs_to_array(&environ, &error, 2, "a b'", NULL));
+    test_expand_word("\"\\$x\\\\\\y\"", EXPAND_ALL, 1, dc_strs_to_array(&environ, &error, 2, "$x\\\\y", NULL));
+    test_expand_word("'$DC_SHELL_ONE'", EXPAND_ALL, 1, dc_strs_to_array(&environ, &error, 2, "$DC_SHELL_ONE", NULL));
+    test_expand_word("''", EXPAND_ALL, 1, dc_strs_to_array(&environ, &error, 2, "", NULL));
+}
+
+Ensure(expand, parameters)
+{
+    test_expand_word("$DC_SHELL_ONE", EXPAND_ALL, 1, dc_strs_to_array(&environ, &error, 2, "one", NULL));
+    test_expand_word("x${DC_SHELL_ONE}x", EXPAND_ALL, 1, dc_strs_to_array(&environ, &error, 2, "xonex", NULL));
+    test_expand_word("$DC_SHELL_ONE.c", EXPAND_ALL, 1, dc_strs_to_array(&environ, &error, 2, "one.c", NULL));
+    test_expand_word("$DC_SHELL_TWO", EXPAND_ALL, 2, dc_strs_to_array(&environ, &error, 3, "a", "b", NULL));
+    test_expand_word("\"$DC_SHELL_TWO\"", EXPAND_ALL, 1, dc_strs_to_array(&environ, &error, 2, " a  b ", NULL));
+    test_expand_word("$DC_SHELL_TWO", EXPAND_ALL & ~EXPAND_FIELDS, 1, dc_strs_to_array(&environ, &error, 2, " a  b ", NULL));
+    test_expand_word("$DC_SHELL_EMPTY", EXPAND_ALL, 0, dc_strs_to_array(&environ, &error, 1, NULL));
+    test_expand_word("$DC_SHELL_UNSET", EXPAND_ALL, 0, dc_strs_to_array(&environ, &error, 1, NULL));
+    test_expand_word("\"$DC_SHELL_UNSET\"", EXPAND_ALL, 1, dc_strs_to_array(&environ, &error, 2, "", NULL));
+    test_expand_word("$", EXPAND_ALL, 1, dc_strs_to_array(&environ, &error, 2, "$", NULL));
+    test_expand_word("$DC_SHELL_ONE", EXPAND_TILDE, 1, dc_strs_to_array(&environ, &error, 2, "$DC_SHELL_ONE", NULL));
+}
+
+Ensure(expand, bad_substitution)
+{
+    char **words;
+    size_t count;
+    size_t capacity;
+
+    words = NULL;
+    count = 0;
+    capacity = 0;
+    expand_word(&environ, &error, "${a b}", 6, EXPAND_ALL, NULL, NULL, NULL, &words, &count, &capacity);
+    assert_true(dc_error_has_error(&error));
+    assert_that(count, is_equal_to(0));
+    free(words);
+}
+
+Ensure(expand, tilde)
+{
+    char *home;
+
+    setenv("HOME", "/home/dc", true);
+    test_expand_word("~", EXPAND_ALL, 1, dc_strs_to_array(&environ, &error, 2, "/home/dc", NULL));
+    test_expand_word("~/bin", EXPAND_ALL, 1, dc_strs_to_array(&environ, &error, 2, "/home/dc/bin", NULL));
+    test_expand_word("a~", EXPAND_ALL, 1, dc_strs_to_array(&environ, &error, 2, "a~", NULL));
+    test_expand_word("'~'", EXPAND_ALL, 1, dc_strs_to_array(&environ, &error, 2, "~", NULL));
+    test_expand_word("~root", EXPAND_ALL, 1, dc_strs_to_array(&environ, &error, 2, "/root", NULL));
+    test_expand_word("~dc_shell_no_such_user", EXPAND_ALL, 1,
+                     dc_strs_to_array(&environ, &error, 2, "~dc_shell_no_such_user", NULL));
+
+    home = expand_string(&environ, &error, "~", EXPAND_TILDE, NULL);
+    assert_that(home, is_equal_to_string("/home/dc"));
+    free(home);
+}
+
+Ensure(expand, glob)
+{
+    char template[32];
+    char path[64];
+    FILE *file;
+
+    strcpy(template, "/tmp/expandXXXXXX");
+    mkdtemp(template);
+    sprintf(path, "%s/b.c", template);
+    file = fopen(path, "w");
+    fclose(file);
+    sprintf(path, "%s/a.c", template);
+    file = fopen(path, "w");
+    fclose(file);
+    chdir(template);
+
+    test_expand_word("*.c", EXPAND_ALL, 2, dc_strs_to_array(&environ, &error, 3, "a.c", "b.c", NULL));
+    test_expand_word("?.c", EXPAND_ALL, 2, dc_strs_to_array(&environ, &error, 3, "a.c", "b.c", NULL));
+    test_expand_word("[b].c", EXPAND_ALL, 1, dc_strs_to_array(&environ, &error, 2, "b.c", NULL));
+    test_expand_word("*.h", EXPAND_ALL, 1, dc_strs_to_array(&environ, &error, 2, "*.h", NULL));
+    test_expand_word("'*'.c", EXPAND_ALL, 1, dc_strs_to_array(&environ, &error, 2, "*.c", NULL));
+    test_expand_word("*.c", EXPAND_ALL & ~EXPAND_GLOB, 1, dc_strs_to_array(&environ, &error, 2, "*.c", NULL));
+
+    unlink("a.c");
+    unlink("b.c");
+    chdir("/tmp");
+    rmdir(template);
+}
+
+Ensure(expand, commands)
+{
+    test_expand_word("$(echo hello)", EXPAND_ALL, 1, dc_strs_to_array(&environ, &error, 2, "hello", NULL));
+    test_expand_word("`echo hello`", EXPAND_ALL, 1, dc_strs_to_array(&environ, &error, 2, "hello", NULL));
+    test_expand_word("$(echo a b | tr ab cd)", EXPAND_ALL, 2, dc_strs_to_array(&environ, &error, 3, "c", "d", NULL));
+    test_expand_word("\"$(echo a b)\"", EXPAND_ALL, 1, dc_strs_to_array(&environ, &error, 2, "a b", NULL));
+    test_expand_word("x$(echo $(echo y))x", EXPAND_ALL, 1, dc_strs_to_array(&environ, &error, 2, "xyx", NULL));
+    test_expand_word("$(true)", EXPAND_ALL, 0, dc_strs_to_array(&environ, &error, 1, NULL));
+    test_expand_word("$(echo hello)", EXPAND_ALL & ~EXPAND_COMMANDS, 1,
+                     dc_strs_to_array(&environ, &error, 2, "$(echo hello)", NULL));
+}
+
+Ensure(expand, command_exit_code)
+{
+    char **words;
+    size_t count;
+    size_t capacity;
+    int exit_code;
+
+    words = NULL;
+    count = 0;
+    capacity = 0;
+    exit_code = -1;
+
+    // the exit code of the last substitution in the word is kept, a word without one leaves it alone
+    expand_word(&environ, &error, "$(exit 3)$(echo a; exit 4)", 26, EXPAND_ALL, NULL, &exit_code, NULL, &words, &count,
+                &capacity);
+    assert_false(dc_error_has_error(&error));
+    assert_that(exit_code, is_equal_to(4));
+    assert_that(words[0], is_equal_to_string("a"));
+    expand_word(&environ, &error, "$(kill -9 $$)", 13, EXPAND_ALL, NULL, &exit_code, NULL, &words, &count, &capacity);
+    assert_that(exit_code, is_equal_to(137));
+    expand_word(&environ, &error, "b", 1, EXPAND_ALL, NULL, &exit_code, NULL, &words, &count, &capacity);
+    assert_that(exit_code, is_equal_to(137));
+    assert_that(count, is_equal_to(2));
+    free(words[0]);
+    free(words[1]);
+    free(words);
+}
+
+static void test_expand_word(const char *word, int flags, size_t expected_count, char **expected_words)
+{
+    char **words;
+    size_t count;
+    size_t capacity;
+    size_t added;
+
+    words = NULL;
+    count = 0;
+    capacity = 0;
+    added = expand_word(&environ, &error, word, strlen(word), flags, NULL, NULL, NULL, &words, &count, &capacity);
+    assert_false(dc_error_has_error(&error));
+    assert_that(added, is_equal_to(expected_count));
+    assert_that(count, is_equal_to(expected_count));
+
+    for (size_t i = 0; i < expected_count; i++)
+    {
+        assert_that(words[i], is_equal_to_string(expected_words[i]));
+        free(words[i]);
+        free(expected_words[i]);
+    }
+
+    if (words != NULL)
+    {
+        assert_that(words[count], is_null);
+        free(words);
+    }
+
+    free(expected_words);
+}
+
+TestSuite *expand_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, expand, quotes);
+    add_test_with_context(suite, expand, parameters);
+    add_test_with_context(suite, expand, bad_substitution);
+    add_test_with_context(suite, expand, tilde);
+    add_test_with_context(suite, expand, glob);
+    add_test_with_context(suite, expand, commands);
+    add_test_with_context(suite, expand, command_exit_code);
+
+    return suite;
+}
@@ -0,0 +1,163 @@
+#include "tests.h"
+#include "history.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+static void write_file(const char *path, const char *text);
+static void check_file(const char *path, const char *expected);
+
+Describe(history);
+
+static struct dc_posix_env environ;
+static struct dc_error error;
+
+BeforeEach(history)
+{
+    dc_posix_env_init(&environ, NULL);
+    dc_error_init(&error, NULL);
+}
+
+AfterEach(history)
+{
+    dc_error_reset(&error);
+}
+
+Ensure(history, ring)
+{
+    struct history *history;
+    char out[256];
+    FILE *out_file;
+
+    history = history_create(&environ, &error, 3);
+    assert_that(history, is_not_null);
+    assert_that(history_get(history, 0), is_null);
+
+    history_add(&environ, &error, history, "axx", 1);
+    history_add(&environ, &error, history, "b", 1);
+    history_add(&environ, &error, history, "c", 1);
+    history_add(&environ, &error, history, "d", 1);
+    history_add(&environ, &error, history, "e", 1);
+    assert_false(dc_error_has_error(&error));
+
+    // the oldest lines are dropped, the numbers go on
+    assert_that(history->count, is_equal_to(3));
+    assert_that(history->number, is_equal_to(3));
+    assert_that(history_get(history, 0)->length, is_equal_to(1));
+    assert_that(history_get(history, 0)->line[0], is_equal_to('c'));
+    assert_that(history_get(history, 2)->line[0], is_equal_to('e'));
+    assert_that(history_get(history, 3), is_null);
+
+    memset(out, 0, sizeof(out));
+    out_file = fmemopen(out, sizeof(out), "w");
+    history_print(history, 2, out_file);
+    fflush(out_file);
+    assert_that(out, is_equal_to_string("    4  d\n    5  e\n"));
+    fclose(out_file);
+
+    history_clear(&environ, history);
+    assert_that(history->count, is_equal_to(0));
+    assert_that(history->number, is_equal_to(1));
+
+    history_destroy(&environ, &history);
+    assert_that(history, is_null);
+}
+
+Ensure(history, file)
+{
+    char path[] = "/tmp/historyXXXXXX";
+    struct history *history;
+    int fd;
+
+    fd = mkstemp(path);
+    close(fd);
+
+    // blank lines are skipped, the last line may not end with a '\n'
+    write_file(path, "a\n\nb\nc");
+    history = history_create(&environ, &error, 2);
+    history_open(&environ, &error, history, path);
+    assert_false(dc_error_has_error(&error));
+    assert_that(history->count, is_equal_to(2));
+    assert_that(history_get(history, 0)->line[0], is_equal_to('b'));
+    assert_that(history_get(history, 1)->line[0], is_equal_to('c'));
+
+    // the lines are buffered until they are flushed
+    history_add(&environ, &error, history, "d", 1);
+    check_file(path, "a\n\nb\nc");
+    history_flush(&environ, &error, history);
+    check_file(path, "a\n\nb\ncd\n");
+
+    // and when the history is destroyed
+    history_add(&environ, &error, history, "e f", 3);
+    history_destroy(&environ, &history);
+    check_file(path, "a\n\nb\ncd\ne f\n");
+    unlink(path);
+}
+
+Ensure(history, large_file)
+{
+    char path[] = "/tmp/historyXXXXXX";
+    struct history *history;
+    char line[32];
+    FILE *file;
+    int fd;
+
+    fd = mkstemp(path);
+    file = fdopen(fd, "w");
+    for (int i = 0; i < 200000; i++)
+    {
+        fprintf(file, "line %d\n", i);
+    }
+    fclose(file);
+
+    // only the end of the file is looked at
+    history = history_create(&environ, &error, 1000);
+    history_open(&environ, &error, history, path);
+    assert_false(dc_error_has_error(&error));
+    assert_that(history->count, is_equal_to(1000));
+    sprintf(line, "line %d", 199000);
+    assert_that(history_get(history, 0)->length, is_equal_to(strlen(line)));
+    assert_that(strncmp(history_get(history, 0)->line, line, strlen(line)), is_equal_to(0));
+
+    // a loaded line is dropped the same as an added one
+    history_add(&environ, &error, history, "new", 3);
+    assert_that(history->count, is_equal_to(1000));
+    assert_that(strncmp(history_get(history, 999)->line, "new", 3), is_equal_to(0));
+
+    history_destroy(&environ, &history);
+    unlink(path);
+}
+
+static void write_file(const char *path, const char *text)
+{
+    int fd;
+
+    fd = open(path, O_WRONLY | O_TRUNC);
+    assert_that(write(fd, text, strlen(text)), is_equal_to(strlen(text)));
+    close(fd);
+}
+
+static void check_file(const char *path, const char *expected)
+{
+    char buf[256];
+    ssize_t length;
+    int fd;
+
+    memset(buf, 0, sizeof(buf));
+    fd = open(path, O_RDONLY);
+    length = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    assert_that(length, is_equal_to(strlen(expected)));
+    assert_that(buf, is_equal_to_string(expected));
+}
+
+TestSuite *history_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, history, ring);
+    add_test_with_context(suite, history, file);
+    add_test_with_context(suite, history, large_file);
+
+    return suite;
+}
@@ -1,6 +1,8 @@
 #include "tests.h"
 #include "util.h"
 #include "input.h"
+#include <sys/wait.h>
+#include <unistd.h>
 
 static void test_read_command_line(const char *data, ...);
 
@@ -22,6 +24,7 @@ AfterEach(input)
 
 Ensure(input, read_command_line)
 {
+    test_read_command_line("", NULL);
     test_read_command_line("hello\n", "hello", NULL);
     test_read_command_line(" evil \n", "evil", NULL);
     test_read_command_line(" \t\f\vabc def  \t\f\v\n", "abc def", NULL);
@@ -29,6 +32,62 @@ Ensure(input, read_command_line)
     test_read_command_line("./a.out hello < in.txt > out.txt 2>err.txt\n", "./a.out hello < in.txt > out.txt 2>err.txt", NULL);
 }
 
+Ensure(input, read_command_line_reuses_buffer)
+{
+    FILE *strstream;
+    char *str;
+    const char *line;
+    char *first_buffer;
+    size_t line_size;
+    struct line_reader *reader;
+
+    str = strdup("one\n  two  \n");
+    strstream = fmemopen(str, strlen(str), "r");
+    reader = line_reader_create(&environ, &error, 1024);
+
+    line = read_command_line(&environ, &error, reader, strstream, &line_size);
+    assert_that(line, is_equal_to_string("one"));
+    first_buffer = reader->buffer;
+
+    line = read_command_line(&environ, &error, reader, strstream, &line_size);
+    assert_that(line, is_equal_to_string("two"));
+    assert_that(line_size, is_equal_to(3));
+    assert_that(reader->buffer, is_equal_to(first_buffer));
+    assert_that(line, is_equal_to(reader->buffer + 2));
+    assert_false(reader->eof);
+
+    line = read_command_line(&environ, &error, reader, strstream, &line_size);
+    assert_that(line, is_equal_to_string(""));
+    assert_that(line_size, is_equal_to(0));
+    assert_true(reader->eof);
+
+    line_reader_destroy(&environ, &reader);
+    fclose(strstream);
+    free(str);
+}
+
+Ensure(input, read_command_line_too_long)
+{
+    FILE *strstream;
+    char *str;
+    const char *line;
+    size_t line_size;
+    struct line_reader *reader;
+
+    str = strdup("0123456789\n");
+    strstream = fmemopen(str, strlen(str), "r");
+    reader = line_reader_create(&environ, &error, 4);
+
+    line = read_command_line(&environ, &error, reader, strstream, &line_size);
+    assert_that(line, is_null);
+    assert_true(dc_error_has_error(&error));
+    assert_that(error.errno_code, is_equal_to(E2BIG));
+
+    line_reader_destroy(&environ, &reader);
+    fclose(strstream);
+    free(str);
+}
+
 static void test_read_command_line(const char *data, ...)
 {
     FILE *strstream;
@@ -36,20 +95,22 @@ static void test_read_command_line(const char *data, ...)
     size_t buf_size;
     char *str;
     char *expected_line;
+    struct line_reader *reader;
 
     buf_size = strlen(data) + 1;
     str = strdup(data);
     strstream = fmemopen(str, buf_size, "r");
+    reader = line_reader_create(&environ, &error, buf_size);
+    assert_that(reader, is_not_null);
 
     va_start(strings, data);
 
     do
     {
-        char *line;
+        const char *line;
         size_t line_size;
 
-        line_size = buf_size;
-        line = read_command_line(&environ, &error, strstream, &line_size);
+        line = read_command_line(&environ, &error, reader, strstream, &line_size);
         expected_line = va_arg(strings, char *);
 
         if(expected_line == NULL)
@@ -62,23 +123,176 @@ static void test_read_command_line(const char *data, ...)
             assert_that(line, is_equal_to_string(expected_line));
             assert_that(line_size, is_equal_to(strlen(line)));
         }
-
-        free(line);
     }
     while(expected_line);
 
     va_end(strings);
 
+    line_reader_destroy(&environ, &reader);
+    assert_that(reader, is_null);
     fclose(strstream);
     free(str);
 }
 
+Ensure(input, read_command_line_string)
+{
+    struct line_reader *reader;
+    const char *line;
+    size_t line_size;
+
+    reader = line_reader_create_string(&environ, &error, "a\n\n  b c \nlast", 1024);
+    assert_that(reader, is_not_null);
+
+    line = read_command_line(&environ, &error, reader, NULL, &line_size);
+    assert_that(line, is_equal_to_string("a"));
+    line = read_command_line(&environ, &error, reader, NULL, &line_size);
+    assert_that(line, is_equal_to_string(""));
+    assert_false(line_reader_done(reader));
+    line = read_command_line(&environ, &error, reader, NULL, &line_size);
+    assert_that(line, is_equal_to_string("b c"));
+    assert_that(line_size, is_equal_to(3));
+    line = read_command_line(&environ, &error, reader, NULL, &line_size);
+    assert_that(line, is_equal_to_string("last"));
+    line = read_command_line(&environ, &error, reader, NULL, &line_size);
+    assert_that(line, is_equal_to_string(""));
+    assert_that(line_size, is_equal_to(0));
+    assert_true(line_reader_done(reader));
+    assert_false(dc_error_has_error(&error));
+
+    line_reader_destroy(&environ, &reader);
+}
+
+Ensure(input, read_command_line_fd)
+{
+    struct line_reader *reader;
+    int fds[2];
+    const char *data;
+    const char *line;
+    size_t line_size;
+
+    data = "ls -l\n \n  pwd\nexit\n";
+    assert_that(pipe(fds), is_equal_to(0));
+    assert_that(write(fds[1], data, strlen(data)), is_equal_to(strlen(data)));
+    close(fds[1]);
+
+    reader = line_reader_create_fd(&environ, &error, fds[0], 1024);
+    line = read_command_line(&environ, &error, reader, NULL, &line_size);
+    assert_that(line, is_equal_to_string("ls -l"));
+    line = read_command_line(&environ, &error, reader, NULL, &line_size);
+    assert_that(line_size, is_equal_to(0));
+    // the whole pipe was read in one block, the rest of the lines are still to come
+    assert_false(line_reader_done(reader));
+    line = read_command_line(&environ, &error, reader, NULL, &line_size);
+    assert_that(line, is_equal_to_string("pwd"));
+    line = read_command_line(&environ, &error, reader, NULL, &line_size);
+    assert_that(line, is_equal_to_string("exit"));
+    line = read_command_line(&environ, &error, reader, NULL, &line_size);
+    assert_that(line_size, is_equal_to(0));
+    assert_true(reader->eof);
+    assert_false(dc_error_has_error(&error));
+
+    line_reader_destroy(&environ, &reader);
+    close(fds[0]);
+}
+
+Ensure(input, read_command_line_fd_too_long)
+{
+    struct line_reader *reader;
+    int fds[2];
+    const char *line;
+    size_t line_size;
+    pid_t pid;
+
+    assert_that(pipe(fds), is_equal_to(0));
+
+    // more than a block without a newline, more than the pipe holds so it is written by another process
+    pid = fork();
+    if (pid == 0)
+    {
+        char block[4096];
+
+        close(fds[0]);
+        memset(block, 'x', sizeof(block));
+        for (int i = 0; i < 40; i++)
+        {
+            write(fds[1], block, sizeof(block));
+        }
+        write(fds[1], "\necho ok\n", 9);
+        _exit(0);
+    }
+
+    close(fds[1]);
+    reader = line_reader_create_fd(&environ, &error, fds[0], 1024);
+    line = read_command_line(&environ, &error, reader, NULL, &line_size);
+    assert_that(line, is_null);
+    assert_that(error.errno_code, is_equal_to(E2BIG));
+    dc_error_reset(&error);
+
+    // the rest of the long line was thrown away, the next read is the next line
+    line = read_command_line(&environ, &error, reader, NULL, &line_size);
+    assert_that(line, is_equal_to_string("echo ok"));
+    line = read_command_line(&environ, &error, reader, NULL, &line_size);
+    assert_that(line_size, is_equal_to(0));
+    assert_true(reader->eof);
+    assert_false(dc_error_has_error(&error));
+
+    line_reader_destroy(&environ, &reader);
+    close(fds[0]);
+    waitpid(pid, NULL, 0);
+}
+
+Ensure(input, read_command_line_map)
+{
+    struct line_reader *reader;
+    char template[32];
+    const char *data;
+    const char *line;
+    size_t line_size;
+    int fd;
+
+    strcpy(template, "/tmp/scriptXXXXXX");
+    fd = mkstemp(template);
+    data = "  echo a  \ncd /\n\nlast";
+    assert_that(write(fd, data, strlen(data)), is_equal_to(strlen(data)));
+
+    reader = line_reader_create_fd(&environ, &error, fd, 1024);
+    assert_that(reader, is_not_null);
+    assert_that(reader->source, is_equal_to(LINE_SOURCE_MAP));
+
+    line = read_command_line(&environ, &error, reader, NULL, &line_size);
+    assert_that(line_size, is_equal_to(6));
+    assert_that(strncmp(line, "echo a", line_size), is_equal_to(0));
+    line = read_command_line(&environ, &error, reader, NULL, &line_size);
+    assert_that(line_size, is_equal_to(4));
+    assert_that(strncmp(line, "cd /", line_size), is_equal_to(0));
+    read_command_line(&environ, &error, reader, NULL, &line_size);
+    assert_that(line_size, is_equal_to(0));
+    assert_false(reader->eof);
+    line = read_command_line(&environ, &error, reader, NULL, &line_size);
+    assert_that(line_size, is_equal_to(4));
+    assert_that(strncmp(line, "last", line_size), is_equal_to(0));
+    read_command_line(&environ, &error, reader, NULL, &line_size);
+    assert_that(line_size, is_equal_to(0));
+    assert_true(reader->eof);
+    assert_false(dc_error_has_error(&error));
+
+    line_reader_destroy(&environ, &reader);
+    close(fd);
+    unlink(template);
+}
+
 TestSuite *input_tests(void)
 {
     TestSuite *suite;
 
     suite = create_test_suite();
     add_test_with_context(suite, input, read_command_line);
+    add_test_with_context(suite, input, read_command_line_reuses_buffer);
+    add_test_with_context(suite, input, read_command_line_too_long);
+    add_test_with_context(suite, input, read_command_line_string);
+    add_test_with_context(suite, input, read_command_line_fd);
+    add_test_with_context(suite, input, read_command_line_fd_too_long);
+    add_test_with_context(suite, input, read_command_line_map);
 
     return suite;
 }
@@ -0,0 +1,152 @@
+#include "tests.h"
+#include "jobs.h"
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+static pid_t start_child(int exit_code, long delay_ms);
+
+Describe(jobs);
+
+static struct dc_posix_env environ;
+static struct dc_error error;
+
+BeforeEach(jobs)
+{
+    dc_posix_env_init(&environ, NULL);
+    dc_error_init(&error, NULL);
+}
+
+AfterEach(jobs)
+{
+    dc_error_reset(&error);
+}
+
+Ensure(jobs, add_and_find)
+{
+    struct job_table *table;
+    struct job *first;
+    struct job *second;
+    pid_t pids[2];
+
+    table = job_table_create(&environ, &error);
+    assert_that(table, is_not_null);
+    assert_that(job_find(table, 0), is_null);
+
+    pids[0] = start_child(0, 0);
+    pids[1] = start_child(3, 0);
+    first = job_add(&environ, &error, table, "a | b &xx", 7, pids, 2, 0);
+    assert_false(dc_error_has_error(&error));
+    assert_that(first->id, is_equal_to(1));
+    assert_that(first->line, is_equal_to_string("a | b &"));
+    assert_that(first->running, is_equal_to(2));
+
+    pids[0] = -1;
+    second = job_add(&environ, &error, table, "c &", 3, pids, 1, 127);
+    assert_that(second->id, is_equal_to(2));
+    assert_that(second->running, is_equal_to(0));
+    assert_that(second->exit_code, is_equal_to(127));
+
+    assert_that(job_find(table, 0), is_equal_to(second));
+    assert_that(job_find(table, 1), is_equal_to(first));
+    assert_that(job_find(table, 3), is_null);
+    assert_that(job_find_pid(table, pids[1]), is_equal_to(first));
+
+    assert_that(job_wait(&environ, &error, first), is_equal_to(3));
+    assert_that(first->running, is_equal_to(0));
+
+    // the current job falls back to the most recent one that is left
+    job_remove(&environ, table, second);
+    assert_that(job_find(table, 0), is_equal_to(first));
+    job_remove(&environ, table, first);
+    assert_that(job_find(table, 0), is_null);
+
+    job_table_destroy(&environ, &table);
+    assert_that(table, is_null);
+}
+
+Ensure(jobs, reap)
+{
+    struct job_table *table;
+    struct job *job;
+    pid_t pid;
+
+    table = job_table_create(&environ, &error);
+    pid = start_child(5, 10);
+    job = job_add(&environ, &error, table, "x &", 3, &pid, 1, 0);
+
+    for (int i = 0; i < 500 && job->running > 0; i++)
+    {
+        struct timespec delay = {0, 10 * 1000 * 1000};
+
+        job_table_reap(&environ, &error, table);
+        assert_false(dc_error_has_error(&error));
+        nanosleep(&delay, NULL);
+    }
+
+    assert_that(job->running, is_equal_to(0));
+    assert_that(job->exit_code, is_equal_to(5));
+    assert_that(waitpid(pid, NULL, WNOHANG), is_equal_to(-1));
+
+    job_table_destroy(&environ, &table);
+}
+
+Ensure(jobs, print)
+{
+    struct job_table *table;
+    char out[1024];
+    FILE *out_file;
+    pid_t pids[2];
+
+    table = job_table_create(&environ, &error);
+    memset(out, 0, sizeof(out));
+    out_file = fmemopen(out, sizeof(out), "w");
+
+    pids[0] = start_child(0, 0);
+    job_add(&environ, &error, table, "a &", 3, pids, 1, 0);
+    pids[1] = start_child(2, 0);
+    job_add(&environ, &error, table, "b &", 3, &pids[1], 1, 0);
+    job_wait(&environ, &error, job_find(table, 1));
+    job_wait(&environ, &error, job_find(table, 2));
+
+    job_table_print(&environ, table, out_file);
+    fflush(out_file);
+    assert_that(out, is_equal_to_string("[1]   Done                    a &\n"
+                                        "[2]+  Exit 2                  b &\n"));
+
+    // the jobs that are done are only displayed once
+    assert_that(table->jobs, is_null);
+
+    fclose(out_file);
+    job_table_destroy(&environ, &table);
+}
+
+static pid_t start_child(int exit_code, long delay_ms)
+{
+    pid_t pid;
+
+    pid = fork();
+    if (pid == 0)
+    {
+        struct timespec delay;
+
+        delay.tv_sec = delay_ms / 1000;
+        delay.tv_nsec = (delay_ms % 1000) * 1000 * 1000;
+        nanosleep(&delay, NULL);
+        _exit(exit_code);
+    }
+
+    return pid;
+}
+
+TestSuite *jobs_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, jobs, add_and_find);
+    add_test_with_context(suite, jobs, reap);
+    add_test_with_context(suite, jobs, print);
+
+    return suite;
+}
@@ -0,0 +1,122 @@
+#include "tests.h"
+#include "lexer.h"
+#include <string.h>
+
+static void test_next_token(const char *line, size_t count, const enum token_type *expected_types, const char **expected_texts);
+
+Describe(lexer);
+
+BeforeEach(lexer)
+{
+}
+
+AfterEach(lexer)
+{
+}
+
+Ensure(lexer, next_token)
+{
+    const enum token_type words_types[] = { TOKEN_WORD, TOKEN_WORD, TOKEN_WORD, TOKEN_END };
+    const char *words_texts[] = { "ls", "-l", "/tmp", "" };
+    const enum token_type redirect_types[] = { TOKEN_REDIRECT_IN, TOKEN_WORD, TOKEN_WORD, TOKEN_REDIRECT_OUT_APPEND, TOKEN_WORD, TOKEN_REDIRECT_ERR, TOKEN_WORD, TOKEN_REDIRECT_OUT, TOKEN_WORD, TOKEN_END };
+    const char *redirect_texts[] = { "<", "in.txt", "./a.out", ">>", "out.txt", "2>", "err.txt", "1>", "x", "" };
+    const enum token_type pipe_types[] = { TOKEN_WORD, TOKEN_PIPE, TOKEN_WORD, TOKEN_REDIRECT_ERR_APPEND, TOKEN_WORD, TOKEN_END };
+    const char *pipe_texts[] = { "cat", "|", "wc", "2>>", "e", "" };
+    const enum token_type quote_types[] = { TOKEN_WORD, TOKEN_WORD, TOKEN_WORD, TOKEN_END };
+    const char *quote_texts[] = { "echo", "'a | b'", "\"c \\\" > d\"e\\ f", "" };
+    const enum token_type digit_types[] = { TOKEN_WORD, TOKEN_REDIRECT_OUT, TOKEN_WORD, TOKEN_WORD, TOKEN_END };
+    const char *digit_texts[] = { "a2", ">", "b", "2", "" };
+    const enum token_type substitution_types[] = { TOKEN_WORD, TOKEN_WORD, TOKEN_WORD, TOKEN_REDIRECT_OUT, TOKEN_WORD, TOKEN_END };
+    const char *substitution_texts[] = { "echo", "$(ls | wc -l)", "\"`a > b`${x}\"", ">", "$(echo \")\")", "" };
+    const enum token_type background_types[] = { TOKEN_WORD, TOKEN_BACKGROUND, TOKEN_WORD, TOKEN_BACKGROUND, TOKEN_END };
+    const char *background_texts[] = { "a", "&", "b", "&", "" };
+    const enum token_type list_types[] = { TOKEN_WORD, TOKEN_AND, TOKEN_WORD, TOKEN_OR, TOKEN_WORD, TOKEN_SEMICOLON, TOKEN_WORD, TOKEN_PIPE, TOKEN_PIPE, TOKEN_END };
+    const char *list_texts[] = { "a", "&&", "b", "||", "c", ";", "d", "|", "|", "" };
+    const enum token_type error_types[] = { TOKEN_WORD, TOKEN_ERROR };
+    const char *error_texts[] = { "echo", "\"abc" };
+    const char *unclosed_texts[] = { "echo", "$(ls" };
+    const enum token_type comment_types[] = { TOKEN_WORD, TOKEN_WORD, TOKEN_SEMICOLON, TOKEN_END };
+    const char *comment_texts[] = { "echo", "a#b", ";", "" };
+    const enum token_type shebang_types[] = { TOKEN_END };
+    const char *shebang_texts[] = { "" };
+
+    test_next_token("  ls -l\t/tmp  ", 4, words_types, words_texts);
+    test_next_token("<in.txt ./a.out >>out.txt 2> err.txt 1>x", 10, redirect_types, redirect_texts);
+    test_next_token("cat|wc 2>>e", 6, pipe_types, pipe_texts);
+    test_next_token("echo 'a | b' \"c \\\" > d\"e\\ f", 4, quote_types, quote_texts);
+    test_next_token("a2>b 2", 5, digit_types, digit_texts);
+    test_next_token("echo $(ls | wc -l) \"`a > b`${x}\">$(echo \")\")", 6, substitution_types, substitution_texts);
+    test_next_token("a&b &", 5, background_types, background_texts);
+    test_next_token("a&&b || c;d| |", 10, list_types, list_texts);
+    test_next_token("echo \"abc", 2, error_types, error_texts);
+    test_next_token("echo $(ls", 2, error_types, unclosed_texts);
+    test_next_token("echo a#b;# c | d", 4, comment_types, comment_texts);
+    test_next_token("#!/bin/sh -e", 1, shebang_types, shebang_texts);
+}
+
+static void test_next_token(const char *line, size_t count, const enum token_type *expected_types, const char **expected_texts)
+{
+    struct lexer lexer;
+    struct token token;
+
+    lexer_init(&lexer, line, strlen(line));
+
+    for(size_t i = 0; i < count; i++)
+    {
+        assert_that(next_token(&lexer, &token), is_equal_to(expected_types[i]));
+        assert_that(token.type, is_equal_to(expected_types[i]));
+        assert_that(token.length, is_equal_to(strlen(expected_texts[i])));
+        assert_that(strncmp(token.text, expected_texts[i], token.length), is_equal_to(0));
+    }
+}
+
+Ensure(lexer, plain_words)
+{
+    struct lexer lexer;
+    struct token token;
+    const char *line;
+
+    line = "ls ~ $HOME *.c 'a' plain";
+    lexer_init(&lexer, line, strlen(line));
+
+    next_token(&lexer, &token);
+    assert_true(token.plain);
+    next_token(&lexer, &token);
+    assert_false(token.plain);
+    next_token(&lexer, &token);
+    assert_false(token.plain);
+    next_token(&lexer, &token);
+    assert_false(token.plain);
+    next_token(&lexer, &token);
+    assert_false(token.plain);
+    next_token(&lexer, &token);
+    assert_true(token.plain);
+    assert_that(next_token(&lexer, &token), is_equal_to(TOKEN_END));
+    assert_that(next_token(&lexer, &token), is_equal_to(TOKEN_END));
+}
+
+Ensure(lexer, not_terminated)
+{
+    struct lexer lexer;
+    struct token token;
+    const char *line;
+
+    // the line is a view, only the first 5 characters are scanned
+    line = "cat |wc";
+    lexer_init(&lexer, line, 5);
+    assert_that(next_token(&lexer, &token), is_equal_to(TOKEN_WORD));
+    assert_that(next_token(&lexer, &token), is_equal_to(TOKEN_PIPE));
+    assert_that(next_token(&lexer, &token), is_equal_to(TOKEN_END));
+}
+
+TestSuite *lexer_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, lexer, next_token);
+    add_test_with_context(suite, lexer, plain_words);
+    add_test_with_context(suite, lexer, not_terminated);
+
+    return suite;
+}
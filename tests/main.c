@@ -9,12 +9,26 @@ int main(int argc, char **argv)
 
     suite    = create_test_suite();
     reporter = create_text_reporter();
+    add_suite(suite, arena_tests());
     add_suite(suite, builtin_tests());
     add_suite(suite, command_tests());
+    add_suite(suite, command_cache_tests());
+    add_suite(suite, command_hash_tests());
+    add_suite(suite, copy_tests());
     add_suite(suite, execute_tests());
+    add_suite(suite, expand_tests());
+    add_suite(suite, history_tests());
     add_suite(suite, input_tests());
+    add_suite(suite, jobs_tests());
+    add_suite(suite, lexer_tests());
+    add_suite(suite, parallel_tests());
+    add_suite(suite, pool_tests());
+    add_suite(suite, profile_tests());
+    add_suite(suite, server_tests());
     add_suite(suite, shell_impl_tests());
     add_suite(suite, shell_tests());
+    add_suite(suite, stats_tests());
+    add_suite(suite, usage_tests());
     add_suite(suite, util_tests());
 
     if(argc > 1)
@@ -0,0 +1,90 @@
+#include "tests.h"
+#include "shell.h"
+#include <time.h>
+#include <unistd.h>
+
+static void test_parallel(const char *lines, const char *arguments, const char *expected_out, const char *expected_err);
+
+Describe(parallel);
+
+static struct dc_posix_env environ;
+static struct dc_error error;
+
+BeforeEach(parallel)
+{
+    dc_posix_env_init(&environ, NULL);
+    dc_error_init(&error, NULL);
+}
+
+AfterEach(parallel)
+{
+    dc_error_reset(&error);
+}
+
+Ensure(parallel, exit_codes)
+{
+    // the exit codes are in input order whatever order the lines finish in
+    test_parallel("sh -c 'sleep 0.2; exit 4'\ntrue\n\nfalse\nls > \nls /does/not/exist 2>/dev/null | wc -l >/dev/null\n",
+                  "-j 2",
+                  "4\tsh -c 'sleep 0.2; exit 4'\n0\ttrue\n1\tfalse\n2\tls >\n0\tls /does/not/exist 2>/dev/null | wc -l >/dev/null\n",
+                  "syntax error near unexpected token `newline'\n");
+    test_parallel("true\n", "-j1", "0\ttrue\n", "");
+    // a builtin is run by a copy of the shell, with its own exit code
+    test_parallel("exit 3\ncd /\n", "-j 2", "3\texit 3\n0\tcd /\n", "");
+    test_parallel("", "-j 0", "", "parallel: 0: invalid job count\n");
+    test_parallel("", "-x", "", "usage: parallel [-j jobs] [file]\n");
+}
+
+Ensure(parallel, concurrent)
+{
+    struct timespec start;
+    struct timespec end;
+    double elapsed;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    test_parallel("sleep 0.3\nsleep 0.3\nsleep 0.3\nsleep 0.3\n", "-j 4",
+                  "0\tsleep 0.3\n0\tsleep 0.3\n0\tsleep 0.3\n0\tsleep 0.3\n", "");
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    elapsed = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+    assert_that_expression(elapsed < 0.9);
+}
+
+static void test_parallel(const char *lines, const char *arguments, const char *expected_out, const char *expected_err)
+{
+    char template[] = "/tmp/parallelXXXXXX";
+    char commands[256];
+    char out_buf[1024];
+    char err_buf[1024];
+    FILE *out_file;
+    FILE *err_file;
+    int fd;
+
+    fd = mkstemp(template);
+    assert_that(write(fd, lines, strlen(lines)), is_equal_to(strlen(lines)));
+    close(fd);
+
+    sprintf(commands, "parallel %s %s\n", arguments, template);
+    memset(out_buf, 0, sizeof(out_buf));
+    memset(err_buf, 0, sizeof(err_buf));
+    out_file = fmemopen(out_buf, sizeof(out_buf), "w");
+    err_file = fmemopen(err_buf, sizeof(err_buf), "w");
+    run_shell_batch(&environ, &error, -1, commands, out_file, err_file, NULL);
+    fflush(out_file);
+    assert_that(out_buf, is_equal_to_string(expected_out));
+    fflush(err_file);
+    assert_that(err_buf, is_equal_to_string(expected_err));
+    fclose(out_file);
+    fclose(err_file);
+    unlink(template);
+}
+
+TestSuite *parallel_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, parallel, exit_codes);
+    add_test_with_context(suite, parallel, concurrent);
+
+    return suite;
+}
@@ -0,0 +1,164 @@
+#include "tests.h"
+#include "execute.h"
+#include "pool.h"
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static pid_t launch_sh(char *script, char *stdout_file, int out_fd);
+static int wait_for(pid_t pid);
+
+Describe(pool);
+
+static struct dc_posix_env environ;
+static struct dc_error error;
+
+BeforeEach(pool)
+{
+    dc_posix_env_init(&environ, NULL);
+    dc_error_init(&error, NULL);
+}
+
+AfterEach(pool)
+{
+    dc_error_reset(&error);
+}
+
+Ensure(pool, launch)
+{
+    char template[] = "/tmp/poolXXXXXX";
+    char script[] = "test \"$POOL_TEST\" = 1 && pwd && exit 3";
+    char buffer[64];
+    char *dir;
+    FILE *file;
+    pid_t pid;
+    int fd;
+
+    fd = mkstemp(template);
+    close(fd);
+    dir = getcwd(NULL, 0);
+    assert_true(worker_pool_start(&environ, &error, 2));
+    assert_false(dc_error_has_error(&error));
+
+    // the directory and environment are the ones of the shell when the program is launched
+    setenv("POOL_TEST", "1", 1);
+    chdir("/");
+    pid = launch_sh(script, template, -1);
+    chdir(dir);
+    unsetenv("POOL_TEST");
+    assert_that(pid, is_greater_than(0));
+    assert_that(wait_for(pid), is_equal_to(3));
+
+    file = fopen(template, "r");
+    assert_that(fgets(buffer, sizeof(buffer), file), is_not_null);
+    assert_that(buffer, is_equal_to_string("/\n"));
+    fclose(file);
+
+    // more programs than workers, each one is replaced after it is used
+    for (int i = 0; i < 5; i++)
+    {
+        pid = launch_sh(script, NULL, -1);
+        assert_that(wait_for(pid), is_equal_to(1));
+    }
+
+    worker_pool_stop(&environ);
+    assert_that(waitpid(-1, NULL, WNOHANG), is_equal_to(-1));
+    unlink(template);
+    free(dir);
+}
+
+Ensure(pool, pipeline)
+{
+    char script[] = "head -c 2 /proc/$$/cmdline; echo";
+    char buffer[64];
+    ssize_t nread;
+    size_t length;
+    int fds[2];
+    pid_t pid;
+
+    assert_true(worker_pool_start(&environ, &error, 1));
+    pipe(fds);
+    pid = launch_sh(script, NULL, fds[1]);
+    close(fds[1]);
+    length = 0;
+    while ((nread = read(fds[0], &buffer[length], sizeof(buffer) - 1 - length)) > 0)
+    {
+        length += (size_t)nread;
+    }
+    assert_that(length, is_equal_to(3));
+    buffer[3] = '\0';
+    // the name as typed, not the path of the program (see run)
+    assert_that(buffer, is_equal_to_string("sh\n"));
+    assert_that(wait_for(pid), is_equal_to(0));
+    close(fds[0]);
+    worker_pool_stop(&environ);
+}
+
+Ensure(pool, not_owner)
+{
+    char script[] = "exit 0";
+    pid_t pid;
+    int status;
+
+    assert_true(worker_pool_start(&environ, &error, 1));
+
+    // the workers are not children of a forked copy of the shell, it cannot use them
+    pid = fork();
+    if (pid == 0)
+    {
+        _exit(worker_pool_launch(&environ, &error, NULL, "/bin/sh", -1, -1) == -1 ? 0 : 1);
+    }
+
+    waitpid(pid, &status, 0);
+    assert_that(WEXITSTATUS(status), is_equal_to(0));
+
+    // without a pool nothing is launched
+    worker_pool_stop(&environ);
+    assert_that(worker_pool_launch(&environ, &error, NULL, "/bin/sh", -1, -1), is_equal_to(-1));
+    pid = launch_sh(script, NULL, -1);
+    assert_that(wait_for(pid), is_equal_to(0));
+}
+
+static pid_t launch_sh(char *script, char *stdout_file, int out_fd)
+{
+    struct command command;
+    char name[] = "sh";
+    char resolved_path[] = "/bin/sh";
+    char option[] = "-c";
+    char *argv[4];
+
+    memset(&command, 0, sizeof(command));
+    argv[0] = NULL;
+    argv[1] = option;
+    argv[2] = script;
+    argv[3] = NULL;
+    command.command = name;
+    command.resolved_path = resolved_path;
+    command.argc = 3;
+    command.argv = argv;
+    command.stdout_file = stdout_file;
+    command.stdout_overwrite = true;
+
+    return launch(&environ, &error, &command, NULL, LAUNCHER_POOL, -1, out_fd);
+}
+
+static int wait_for(pid_t pid)
+{
+    int status;
+
+    waitpid(pid, &status, 0);
+
+    return WEXITSTATUS(status);
+}
+
+TestSuite *pool_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, pool, launch);
+    add_test_with_context(suite, pool, pipeline);
+    add_test_with_context(suite, pool, not_owner);
+
+    return suite;
+}
@@ -0,0 +1,94 @@
+#include "tests.h"
+#include "profile.h"
+#include <time.h>
+
+static void slow_function(void);
+static void fast_function(void);
+
+Describe(profile);
+
+static struct dc_posix_env environ;
+
+BeforeEach(profile)
+{
+    dc_posix_env_init(&environ, profile_tracer);
+}
+
+AfterEach(profile)
+{
+    profile_reset();
+}
+
+Ensure(profile, report)
+{
+    char out[1024];
+    FILE *out_file;
+
+    // nothing is counted until it starts
+    fast_function();
+    assert_true(profile_start(false));
+    assert_false(profile_start(false));
+    fast_function();
+    slow_function();
+    fast_function();
+    profile_stop();
+    fast_function();
+
+    memset(out, 0, sizeof(out));
+    out_file = fmemopen(out, sizeof(out), "w");
+    profile_print_report(out_file);
+    fflush(out_file);
+
+    // the most time first
+    assert_that(strstr(out, "function "), is_equal_to(out));
+    assert_that(strstr(out, "\nslow_function                             1 "), is_not_null);
+    assert_that(strstr(out, "\nfast_function                             2 "), is_not_null);
+    assert_that(strstr(out, "slow_function"), is_less_than(strstr(out, "fast_function")));
+    fclose(out_file);
+}
+
+Ensure(profile, trace)
+{
+    char out[1024];
+    FILE *out_file;
+
+    profile_start(true);
+    slow_function();
+    fast_function();
+    profile_stop();
+
+    memset(out, 0, sizeof(out));
+    out_file = fmemopen(out, sizeof(out), "w");
+    profile_print_trace(out_file);
+    fflush(out_file);
+
+    assert_that(strstr(out, "{\"traceEvents\":[\n{\"name\":\"slow_function\",\"cat\":\"dc_posix\",\"ph\":\"X\","),
+                is_equal_to(out));
+    assert_that(strstr(out, "\n{\"name\":\"fast_function\""), is_not_null);
+    assert_that(strstr(out, "\"dropped_events\":0}}\n"), is_not_null);
+    fclose(out_file);
+}
+
+static void slow_function(void)
+{
+    struct timespec delay = {0, 20 * 1000 * 1000};
+
+    DC_TRACE(&environ);
+    nanosleep(&delay, NULL);
+}
+
+static void fast_function(void)
+{
+    DC_TRACE(&environ);
+}
+
+TestSuite *profile_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, profile, report);
+    add_test_with_context(suite, profile, trace);
+
+    return suite;
+}
@@ -0,0 +1,224 @@
+#include "tests.h"
+#include "server.h"
+#include "shell.h"
+#include <arpa/inet.h>
+#include <dc_util/filesystem.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+static int connect_to(const char *path);
+static int read_reply(int fd, char *out, char *err);
+static bool read_all(int fd, void *buffer, size_t length);
+
+Describe(server);
+
+static struct dc_posix_env environ;
+static struct dc_error error;
+
+BeforeEach(server)
+{
+    dc_posix_env_init(&environ, NULL);
+    dc_error_init(&error, NULL);
+}
+
+AfterEach(server)
+{
+    dc_error_reset(&error);
+}
+
+Ensure(server, reply)
+{
+    char path[] = "/tmp/dc_shell_server_reply.sock";
+    char out[256];
+    char err[256];
+    int listen_fd;
+    int fd;
+    pid_t pid;
+    int status;
+
+    listen_fd = server_listen(&environ, &error, path);
+    assert_false(dc_error_has_error(&error));
+    assert_that(listen_fd, is_greater_than(-1));
+
+    pid = fork();
+    if (pid == 0)
+    {
+        struct server_connection *connection;
+
+        connection = server_connection_create(&environ, &error, server_accept(&environ, &error, listen_fd));
+        printf("out");
+        fprintf(stderr, "err");
+        server_connection_reply(&environ, &error, connection, 3);
+        server_connection_reply(&environ, &error, connection, 0);
+        server_connection_destroy(&environ, &connection);
+        _exit(dc_error_has_error(&error) ? 1 : 0);
+    }
+
+    fd = connect_to(path);
+    assert_that(read_reply(fd, out, err), is_equal_to(3));
+    assert_that(out, is_equal_to_string("out"));
+    assert_that(err, is_equal_to_string("err"));
+
+    // the output of each line is only sent once
+    assert_that(read_reply(fd, out, err), is_equal_to(0));
+    assert_that(out, is_equal_to_string(""));
+    assert_that(err, is_equal_to_string(""));
+
+    waitpid(pid, &status, 0);
+    assert_that(WEXITSTATUS(status), is_equal_to(0));
+    close(fd);
+    close(listen_fd);
+    unlink(path);
+}
+
+Ensure(server, run_shell_server)
+{
+    char path[] = "/tmp/dc_shell_server_run.sock";
+    char lines[] = "echo hi; cd /dev/null\n\ncd /\npwd\nsh -c 'echo x; exit 4'\nexit\n";
+    char out[256];
+    char err[256];
+    char *dir;
+    int fd;
+    pid_t pid;
+
+    dir = dc_get_working_dir(&environ, &error);
+    unlink(path);
+
+    pid = fork();
+    if (pid == 0)
+    {
+        _exit(run_shell_server(&environ, &error, path, stderr, NULL));
+    }
+
+    fd = connect_to(path);
+    assert_that(write(fd, lines, strlen(lines)), is_equal_to(strlen(lines)));
+
+    assert_that(read_reply(fd, out, err), is_equal_to(1));
+    assert_that(out, is_equal_to_string("hi\n"));
+    assert_that(err, is_equal_to_string("/dev/null: is not a directory\n"));
+    assert_that(read_reply(fd, out, err), is_equal_to(0));
+    assert_that(read_reply(fd, out, err), is_equal_to(0));
+    assert_that(read_reply(fd, out, err), is_equal_to(0));
+    assert_that(out, is_equal_to_string("/\n"));
+    assert_that(read_reply(fd, out, err), is_equal_to(4));
+    assert_that(out, is_equal_to_string("x\n"));
+    assert_that(read_reply(fd, out, err), is_equal_to(0));
+    assert_that(read(fd, out, sizeof(out)), is_equal_to(0));
+    close(fd);
+
+    // each client has its own copy of the state, the cd of the last one is not seen
+    fd = connect_to(path);
+    assert_that(write(fd, "pwd\n", 4), is_equal_to(4));
+    assert_that(read_reply(fd, out, err), is_equal_to(0));
+    assert_that(strncmp(out, dir, strlen(dir)), is_equal_to(0));
+    close(fd);
+
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    unlink(path);
+    free(dir);
+}
+
+static int connect_to(const char *path)
+{
+    struct sockaddr_un address;
+    int fd;
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    // the server may not be listening yet
+    for (int i = 0; i < 200 && connect(fd, (struct sockaddr *)&address, sizeof(address)) == -1; i++)
+    {
+        struct timespec delay = {0, 10 * 1000 * 1000};
+
+        nanosleep(&delay, NULL);
+    }
+
+    return fd;
+}
+
+static int read_reply(int fd, char *out, char *err)
+{
+    size_t out_length;
+    size_t err_length;
+
+    out_length = 0;
+    err_length = 0;
+
+    while (true)
+    {
+        unsigned char type;
+        uint32_t length;
+
+        if (!read_all(fd, &type, sizeof(type)) || !read_all(fd, &length, sizeof(length)))
+        {
+            return -1;
+        }
+
+        length = ntohl(length);
+
+        if (type == FRAME_EXIT)
+        {
+            uint32_t code;
+
+            assert_that(length, is_equal_to(sizeof(code)));
+            read_all(fd, &code, sizeof(code));
+            out[out_length] = '\0';
+            err[err_length] = '\0';
+
+            return (int)ntohl(code);
+        }
+
+        if (type == FRAME_STDOUT)
+        {
+            read_all(fd, &out[out_length], length);
+            out_length += length;
+        }
+        else
+        {
+            assert_that(type, is_equal_to(FRAME_STDERR));
+            read_all(fd, &err[err_length], length);
+            err_length += length;
+        }
+    }
+}
+
+static bool read_all(int fd, void *buffer, size_t length)
+{
+    char *position;
+
+    position = buffer;
+    while (length > 0)
+    {
+        ssize_t nread;
+
+        nread = read(fd, position, length);
+        if (nread <= 0)
+        {
+            return false;
+        }
+
+        position += nread;
+        length -= (size_t)nread;
+    }
+
+    return true;
+}
+
+TestSuite *server_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, server, reply);
+    add_test_with_context(suite, server, run_shell_server);
+
+    return suite;
+}
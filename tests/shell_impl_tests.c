@@ -10,6 +10,7 @@ static void test_destroy_state(bool initial_fatal);
 static void test_reset_state(const char *expected_prompt, bool initial_fatal);
 static void test_read_commands(const char *command, const char *expected_command, int expected_return);
 static void test_separate_commands(const char *command, const char *expected_command, int expected_return);
+static void test_separate_pipeline(const char *command, int expected_return, size_t expected_count, const char *expected_lines[], const enum connector expected_connectors[], const char *expected_error_message);
 static void test_parse_commands(const char *command, const char *expected_command, size_t expected_argc);
 static void test_execute_command(const char *command, int expected_next_state, const char *expected_exit_code, const char *expected_error_message);
 static void test_handle_error(const char *current_line, bool is_fatal, int expected_error_code, const char *message, const char *expected_error_message, int expected_next_state);
@@ -48,6 +49,7 @@ static void test_init_state(const char *expected_prompt, FILE *in, FILE *out, FI
     state.stdin  = in;
     state.stdout = out;
     state.stderr = err;
+    state.options = NULL;
     line_length = sysconf(_SC_ARG_MAX);
     assert_that_expression(line_length >= 0);
     next_state = init_state(&environ, &error, &state);
@@ -57,12 +59,17 @@ static void test_init_state(const char *expected_prompt, FILE *in, FILE *out, FI
     assert_that(state.stdin, is_equal_to(in));
     assert_that(state.stdout, is_equal_to(out));
     assert_that(state.stderr, is_equal_to(err));
-    assert_that(state.in_redirect_regex, is_not_null);
-    assert_that(state.out_redirect_regex, is_not_null);
-    assert_that(state.err_redirect_regex, is_not_null);
-    assert_that(state.path, is_not_null);
+    // the path and job table are left until they are needed
+    assert_that(state.path, is_null);
+    assert_that(state.jobs, is_null);
+    assert_that(get_state_path(&environ, &error, &state), is_not_null);
+    assert_that(get_state_path(&environ, &error, &state), is_equal_to(state.path));
+    assert_that(get_job_table(&environ, &error, &state), is_not_null);
     assert_that(state.prompt, is_equal_to_string(expected_prompt));
+    assert_that(state.working_dir, is_null);
+    assert_that(state.prompt_line, is_null);
     assert_that(state.max_line_length, is_equal_to(line_length));
+    assert_that(state.reader, is_not_null);
     assert_that(state.current_line, is_null);
     assert_that(state.current_line_length, is_equal_to(0));
     assert_that(state.command, is_null);
@@ -83,6 +90,7 @@ static void test_destroy_state(bool initial_fatal)
     state.stdin  = stdin;
     state.stdout = stdout;
     state.stderr = stderr;
+    state.options = NULL;
     init_state(&environ, &error, &state);
     state.fatal_error = initial_fatal;
     next_state = destroy_state(&environ, &error, &state);
@@ -92,12 +100,10 @@ static void test_destroy_state(bool initial_fatal)
     assert_that(state.stdin, is_equal_to(stdin));
     assert_that(state.stdout, is_equal_to(stdout));
     assert_that(state.stderr, is_equal_to(stderr));
-    assert_that(state.in_redirect_regex, is_null);
-    assert_that(state.out_redirect_regex, is_null);
-    assert_that(state.err_redirect_regex, is_null);
     assert_that(state.prompt, is_null);
     assert_that(state.path, is_null);
     assert_that(state.max_line_length, is_equal_to(0));
+    assert_that(state.reader, is_null);
     assert_that(state.current_line, is_null);
     assert_that(state.current_line_length, is_equal_to(0));
     assert_that(state.command, is_null);
@@ -127,6 +133,7 @@ static void test_reset_state(const char *expected_prompt, bool initial_fatal)
     state.stdin  = stdin;
     state.stdout = stdout;
     state.stderr = stderr;
+    state.options = NULL;
     line_length = sysconf(_SC_ARG_MAX);
     assert_that_expression(line_length >= 0);
     init_state(&environ, &error, &state);
@@ -138,12 +145,10 @@ static void test_reset_state(const char *expected_prompt, bool initial_fatal)
     assert_that(state.stdin, is_equal_to(stdin));
     assert_that(state.stdout, is_equal_to(stdout));
     assert_that(state.stderr, is_equal_to(stderr));
-    assert_that(state.in_redirect_regex, is_not_null);
-    assert_that(state.out_redirect_regex, is_not_null);
-    assert_that(state.err_redirect_regex, is_not_null);
     assert_that(state.prompt, is_equal_to_string(expected_prompt));
-    assert_that(state.path, is_not_null);
+    assert_that(state.path, is_null);
     assert_that(state.max_line_length, is_equal_to(line_length));
+    assert_that(state.reader, is_not_null);
     assert_that(state.current_line, is_null);
     assert_that(state.current_line_length, is_equal_to(0));
     assert_that(state.command, is_null);
@@ -174,6 +179,7 @@ static void test_read_commands(const char *command, const char *expected_command
     state.stdin = in;
     state.stdout = out;
     state.stderr = stderr;
+    state.options = NULL;
     unsetenv("PS1");
     next_state = init_state(&environ, &error, &state);
     assert_false(dc_error_has_error(&error));
@@ -199,6 +205,52 @@ static void test_read_commands(const char *command, const char *expected_command
     free(in_buf);
 }
 
+Ensure(shell_impl, read_commands_prompt)
+{
+    char in_buf[] = "a\nb\nc\n";
+    char out_buf[1024];
+    char expected[1024];
+    FILE *in;
+    FILE *out;
+    struct state state;
+    char *cwd;
+    const char *prompt_line;
+
+    in = fmemopen(in_buf, strlen(in_buf), "r");
+    out = fmemopen(out_buf, sizeof(out_buf), "w");
+    state.stdin = in;
+    state.stdout = out;
+    state.stderr = stderr;
+    state.options = NULL;
+    setenv("PS1", "X", true);
+    init_state(&environ, &error, &state);
+    cwd = dc_get_working_dir(&environ, &error);
+
+    // the prompt is built once and reused while nothing changes
+    read_commands(&environ, &error, &state);
+    prompt_line = state.prompt_line;
+    read_commands(&environ, &error, &state);
+    assert_that(state.prompt_line, is_equal_to(prompt_line));
+
+    // a new PS1 is picked up before the next line
+    setenv("PS1", "Y", true);
+    read_commands(&environ, &error, &state);
+    assert_false(dc_error_has_error(&error));
+    assert_that(state.prompt, is_equal_to_string("Y"));
+    fflush(out);
+    sprintf(expected, "[%s] X[%s] X[%s] Y", cwd, cwd, cwd);
+    assert_that(out_buf, is_equal_to_string(expected));
+    assert_that(state.prompt_line_length, is_equal_to(strlen(cwd) + 4));
+
+    destroy_state(&environ, &error, &state);
+    assert_that(state.working_dir, is_null);
+    assert_that(state.prompt_line, is_null);
+    unsetenv("PS1");
+    free(cwd);
+    fclose(in);
+    fclose(out);
+}
+
 Ensure(shell_impl, separate_commands)
 {
     test_separate_commands("./a.out", "./a.out", SEPARATE_COMMANDS);
@@ -221,6 +273,7 @@ static void test_separate_commands(const char *command, const char *expected_com
     state.stdin = in;
     state.stdout = out;
     state.stderr = stderr;
+    state.options = NULL;
     unsetenv("PS1");
 
     next_state = init_state(&environ, &error, &state);
@@ -264,6 +317,89 @@ static void test_separate_commands(const char *command, const char *expected_com
     destroy_state(&environ, &error, &state);
 }
 
+Ensure(shell_impl, separate_pipeline)
+{
+    const char *two[] = { "ls -l", "wc -l" };
+    const enum connector two_connectors[] = { CONNECTOR_PIPE, CONNECTOR_END };
+    const char *three[] = { "cat", "grep 'a|b'", "sort \\| uniq" };
+    const enum connector three_connectors[] = { CONNECTOR_PIPE, CONNECTOR_PIPE, CONNECTOR_END };
+    const char *quoted[] = { "echo \"|\"" };
+    const enum connector quoted_connectors[] = { CONNECTOR_END };
+    const char *redirects[] = { "< in.txt sort >out.txt", "wc" };
+    const char *background[] = { "sleep 1", "cat" };
+    const enum connector background_connectors[] = { CONNECTOR_PIPE, CONNECTOR_BACKGROUND };
+    const char *list[] = { "cd /tmp", "ls", "wc", "echo no", "echo 'a;b'", "sleep 1", "true" };
+    const enum connector list_connectors[] = { CONNECTOR_AND, CONNECTOR_PIPE, CONNECTOR_OR, CONNECTOR_SEQUENCE, CONNECTOR_SEQUENCE, CONNECTOR_BACKGROUND, CONNECTOR_SEQUENCE };
+
+    test_separate_pipeline("ls -l | wc -l\n", PARSE_COMMANDS, 2, two, two_connectors, "");
+    test_separate_pipeline("cat|grep 'a|b'  |   sort \\| uniq\n", PARSE_COMMANDS, 3, three, three_connectors, "");
+    test_separate_pipeline("echo \"|\"\n", PARSE_COMMANDS, 1, quoted, quoted_connectors, "");
+    test_separate_pipeline("< in.txt sort >out.txt | wc\n", PARSE_COMMANDS, 2, redirects, two_connectors, "");
+    test_separate_pipeline("ls |\n", RESET_STATE, 0, NULL, NULL, "syntax error near unexpected token `newline'\n");
+    test_separate_pipeline("| ls\n", RESET_STATE, 0, NULL, NULL, "syntax error near unexpected token `|'\n");
+    test_separate_pipeline("ls > | wc\n", RESET_STATE, 0, NULL, NULL, "syntax error near unexpected token `|'\n");
+    test_separate_pipeline("ls 2>>\n", RESET_STATE, 0, NULL, NULL, "syntax error near unexpected token `newline'\n");
+    test_separate_pipeline("echo 'abc\n", RESET_STATE, 0, NULL, NULL, "syntax error: unterminated quote\n");
+    test_separate_pipeline("sleep 1 | cat &\n", PARSE_COMMANDS, 2, background, background_connectors, "");
+    test_separate_pipeline("& ls\n", RESET_STATE, 0, NULL, NULL, "syntax error near unexpected token `&'\n");
+    test_separate_pipeline("cd /tmp&&ls | wc || echo no; echo 'a;b'; sleep 1 & true;\n", PARSE_COMMANDS, 7, list, list_connectors, "");
+    test_separate_pipeline("ls &&\n", RESET_STATE, 0, NULL, NULL, "syntax error near unexpected token `newline'\n");
+    test_separate_pipeline("|| ls\n", RESET_STATE, 0, NULL, NULL, "syntax error near unexpected token `||'\n");
+    test_separate_pipeline("ls ; ; ls\n", RESET_STATE, 0, NULL, NULL, "syntax error near unexpected token `;'\n");
+    test_separate_pipeline("ls & ;\n", RESET_STATE, 0, NULL, NULL, "syntax error near unexpected token `;'\n");
+}
+
+static void test_separate_pipeline(const char *command, int expected_return, size_t expected_count, const char *expected_lines[], const enum connector expected_connectors[], const char *expected_error_message)
+{
+    char *in_buf;
+    char err_buf[1024];
+    FILE *in;
+    FILE *err;
+    struct state state;
+    int next_state;
+
+    in_buf = strdup(command);
+    memset(err_buf, 0, sizeof(err_buf));
+    in = fmemopen(in_buf, strlen(in_buf) + 1, "r");
+    err = fmemopen(err_buf, sizeof(err_buf), "w");
+    state.stdin = in;
+    state.stdout = stdout;
+    state.stderr = err;
+    state.options = NULL;
+    unsetenv("PS1");
+
+    init_state(&environ, &error, &state);
+    state.interactive = false;
+    next_state = read_commands(&environ, &error, &state);
+    assert_that(next_state, is_equal_to(SEPARATE_COMMANDS));
+
+    next_state = separate_commands(&environ, &error, &state);
+    assert_that(next_state, is_equal_to(expected_return));
+    assert_false(state.fatal_error);
+
+    if(expected_return == PARSE_COMMANDS)
+    {
+        assert_that(state.command_count, is_equal_to(expected_count));
+
+        for(size_t i = 0; i < expected_count; i++)
+        {
+            assert_that(state.command[i].line, is_equal_to_string(expected_lines[i]));
+            assert_that(state.command[i].connector, is_equal_to(expected_connectors[i]));
+            assert_that(state.command[i].command, is_null);
+            assert_that(state.command[i].argv, is_null);
+        }
+    }
+
+    fflush(err);
+    assert_that(err_buf, is_equal_to_string(expected_error_message));
+
+    do_reset_state(&environ, &error, &state);
+    destroy_state(&environ, &error, &state);
+    fclose(in);
+    fclose(err);
+    free(in_buf);
+}
+
 Ensure(shell_impl, parse_commands)
 {
     test_parse_commands("hello\n", "hello", 1);
@@ -285,6 +421,7 @@ static void test_parse_commands(const char *command, const char *expected_comman
     state.stdin = in;
     state.stdout = out;
     state.stderr = stderr;
+    state.options = NULL;
     unsetenv("PS1");
 
     next_state = init_state(&environ, &error, &state);
@@ -328,6 +465,10 @@ Ensure(shell_impl, execute_commands)
     free(current_working_dir);
 
     test_execute_command("ls", RESET_STATE, "0\n", "");
+    test_execute_command("ls / | wc -l", RESET_STATE, "0\n", "");
+    test_execute_command("true | false", RESET_STATE, "1\n", "");
+    test_execute_command("false | true", RESET_STATE, "0\n", "");
+    test_execute_command("ls / | grep -q asdasdasdfddfgsdfgasderdfdsf | wc -l", RESET_STATE, "0\n", "");
 }
 
 static void test_execute_command(const char *command, int expected_next_state, const char *expected_exit_code, const char *expected_error_message)
@@ -350,6 +491,7 @@ static void test_execute_command(const char *command, int expected_next_state, c
     state.stdin = in;
     state.stdout = out;
     state.stderr = err;
+    state.options = NULL;
     unsetenv("PS1");
 
     next_state = init_state(&environ, &error, &state);
@@ -429,6 +571,7 @@ static void test_handle_error(const char *current_line, bool is_fatal, int expec
     err_file = fmemopen(err_buf, sizeof(err_buf), "w");
     state.stdout = out_file;
     state.stderr = err_file;
+    state.options = NULL;
     init_state(&environ, &error, &state);
     dc_error_init(&err, NULL);
     err.err_code = expected_error_code;
@@ -436,7 +579,7 @@ static void test_handle_error(const char *current_line, bool is_fatal, int expec
 
     if(current_line != NULL)
     {
-        state.current_line = strdup(current_line);
+        state.current_line = current_line;
         state.current_line_length = strlen(state.current_line);
     }
 
@@ -462,7 +605,9 @@ TestSuite *shell_impl_tests(void)
     add_test_with_context(suite, shell_impl, destroy_state);
     add_test_with_context(suite, shell_impl, reset_state);
     add_test_with_context(suite, shell_impl, read_commands);
+    add_test_with_context(suite, shell_impl, read_commands_prompt);
     add_test_with_context(suite, shell_impl, separate_commands);
+    add_test_with_context(suite, shell_impl, separate_pipeline);
     add_test_with_context(suite, shell_impl, parse_commands);
     add_test_with_context(suite, shell_impl, execute_commands);
     add_test_with_context(suite, shell_impl, do_exit);
@@ -1,8 +1,11 @@
 #include <dc_util/filesystem.h>
 #include "tests.h"
 #include "util.h"
+#include <unistd.h>
 
 static void test_run_shell(const char *in, const char *expected_out, const char *expected_err);
+static void test_run_shell_batch(const char *commands, int expected_exit_code, const char *expected_out,
+                                 const char *expected_err);
 
 Describe(shell);
 
@@ -37,6 +40,13 @@ Ensure(shell, run_shell)
 
     sprintf(str, "[%s] $ 0\n[/] $ ", dir);
     test_run_shell("cd /\nexit\n", str, "");
+    chdir(dir);
+
+    // only the lines typed are kept in the history
+    sprintf(str, "[%1$s] $ a\n0\n[%1$s] $ 0\n[%1$s] $ 0\n[%1$s] $     1  true\n    2  history\n0\n"
+                 "[%1$s] $     3  history 1\n0\n[%1$s] $ 2\n[%1$s] $ 0\n[%1$s] $ ", dir);
+    test_run_shell("echo a\nhistory -c\ntrue\nhistory\nhistory 1\nhistory x\ntrue\nexit\n", str,
+                   "usage: history [-c] [n]\n");
     free(dir);
 }
 
@@ -56,11 +66,11 @@ static void test_run_shell(const char *in, const char *expected_out, const char
     in_file = fmemopen(in_buf, strlen(in_buf) + 1, "r");
     out_file = fmemopen(out_buf, sizeof(out_buf), "w");
     err_file = fmemopen(err_buf, sizeof(err_buf), "w");
-    ret_val = run_shell(&environ, &error, in_file, out_file, err_file);
+    ret_val = run_shell(&environ, &error, in_file, out_file, err_file, NULL);
     assert_that(ret_val, is_equal_to(0));
     fflush(out_file);
     assert_that(out_buf, is_equal_to_string(expected_out));
-    fflush(out_file);
+    fflush(err_file);
     assert_that(err_buf, is_equal_to_string(expected_err));
     fclose(in_file);
     fclose(out_file);
@@ -68,12 +78,95 @@ static void test_run_shell(const char *in, const char *expected_out, const char
     free(in_buf);
 }
 
+Ensure(shell, run_shell_batch)
+{
+    char *dir;
+    char *path;
+
+    dir = dc_get_working_dir(&environ, &error);
+
+    test_run_shell_batch("exit\n", 0, "", "");
+    test_run_shell_batch("cd /\nexit\n", 0, "", "");
+    test_run_shell_batch("cd /dev/null", 1, "", "/dev/null: is not a directory\n");
+    test_run_shell_batch("\n\n", 0, "", "");
+    test_run_shell_batch("echo a\n\n  \necho b\n", 0, "a\nb\n", "");
+    test_run_shell_batch("true &\nwait %1\nwait %1\n", 127, "", "wait: %1: no such job\n");
+    // a builtin in the background is run by a copy of the shell, not looked for on the PATH
+    test_run_shell_batch("exit 3 &\nwait %1\n", 3, "", "");
+    test_run_shell_batch("cd / &\nwait %1\n", 0, "", "");
+    test_run_shell_batch("fg\n", 1, "", "fg: current: no such job\n");
+    test_run_shell_batch("false && cd /dev/null; true || cd /dev/null\n", 0, "", "");
+    test_run_shell_batch("false || cd /dev/null && cd /\n", 1, "", "/dev/null: is not a directory\n");
+    test_run_shell_batch("cd / ; cd /dev/null ;\n", 1, "", "/dev/null: is not a directory\n");
+    test_run_shell_batch("true && exit; cd /dev/null\n", 0, "", "");
+    test_run_shell_batch("echo a b; printf '%s-' x y; echo\n", 0, "a b\nx-y-\n", "");
+    test_run_shell_batch("export DC_SHELL_TEST=1 && test \"$DC_SHELL_TEST\" = 1 && unset DC_SHELL_TEST && echo $DC_SHELL_TEST set\n", 0, "set\n", "");
+    test_run_shell_batch("cd /dev/null; cd /; echo x > /does/not/exist; pwd\n", 0, "/\n",
+                         "/dev/null: is not a directory\n/does/not/exist: does not exist\n");
+    test_run_shell_batch("echo a\nhistory\nhistory x\n", 2, "a\n", "usage: history [-c] [n]\n");
+    test_run_shell_batch("timeout 0.1 sleep 5 || echo timed out; timeout 5 echo in time; timeout -k 1 5 true && echo ok\n", 0,
+                         "timed out\nin time\nok\n", "");
+
+    // a job that starts with timeout is timed out by the shell too, not by a timeout program on the PATH
+    path = strdup(getenv("PATH"));
+    test_run_shell_batch("export PATH=/does/not/exist\ntimeout 0.1 /bin/sleep 5 &\nwait %1\n", 124, "", "");
+    setenv("PATH", path, 1);
+    free(path);
+
+    // the shell exits with the exit code of the last pipeline, or the one exit is given
+    test_run_shell_batch("false\n", 1, "", "");
+    test_run_shell_batch("false\n\n", 1, "", "");
+    test_run_shell_batch("false; exit\necho not run\n", 1, "", "");
+    test_run_shell_batch("exit 3\necho not run\n", 3, "", "");
+    test_run_shell_batch("true; exit 256\n", 0, "", "");
+    test_run_shell_batch("exit x\n", 2, "", "exit: x: numeric argument required\n");
+    test_run_shell_batch("exit 1 2\necho still\n", 0, "still\n", "exit: too many arguments\n");
+    test_run_shell_batch("ls > \n", 2, "", "syntax error near unexpected token `newline'\n");
+    test_run_shell_batch("$(exit 3)\n", 3, "", "");
+    test_run_shell_batch("$(exit 3) true\n", 0, "", "");
+
+    // what echo, printf and test do not know is left to the programs
+    test_run_shell_batch("test \"$(echo -e 'a\\tb')\" = \"$(printf 'a\\tb')\" && echo e\n"
+                         "test \"$(printf '%.2f|%e' 1.5 2)\" = '1.50|2.000000e+00' && echo f\n"
+                         "test -n a -a -n b && echo and; test -n a -a -z b || echo not\n", 0, "e\nf\nand\nnot\n", "");
+
+    // a script can start with "#!" and have comments, '#' inside a word is not one
+    test_run_shell_batch("#!/bin/dc_shell\n# a comment\n  # indented\necho a # b | c\necho b#c; # d\n", 0,
+                         "a\nb#c\n", "");
+    chdir(dir);
+    free(dir);
+}
+
+static void test_run_shell_batch(const char *commands, int expected_exit_code, const char *expected_out,
+                                 const char *expected_err)
+{
+    char out_buf[1024];
+    char err_buf[1024];
+    FILE *out_file;
+    FILE *err_file;
+    int ret_val;
+
+    memset(out_buf, 0, sizeof(out_buf));
+    memset(err_buf, 0, sizeof(err_buf));
+    out_file = fmemopen(out_buf, sizeof(out_buf), "w");
+    err_file = fmemopen(err_buf, sizeof(err_buf), "w");
+    ret_val = run_shell_batch(&environ, &error, -1, commands, out_file, err_file, NULL);
+    assert_that(ret_val, is_equal_to(expected_exit_code));
+    fflush(out_file);
+    assert_that(out_buf, is_equal_to_string(expected_out));
+    fflush(err_file);
+    assert_that(err_buf, is_equal_to_string(expected_err));
+    fclose(out_file);
+    fclose(err_file);
+}
+
 TestSuite *shell_tests(void)
 {
     TestSuite *suite;
 
     suite = create_test_suite();
     add_test_with_context(suite, shell, run_shell);
+    add_test_with_context(suite, shell, run_shell_batch);
 
     return suite;
 }
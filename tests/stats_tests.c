@@ -0,0 +1,118 @@
+#include "tests.h"
+#include "shell.h"
+#include "stats.h"
+
+Describe(stats);
+
+static struct dc_posix_env environ;
+static struct dc_error error;
+
+BeforeEach(stats)
+{
+    dc_posix_env_init(&environ, NULL);
+    dc_error_init(&error, NULL);
+}
+
+AfterEach(stats)
+{
+    dc_error_reset(&error);
+}
+
+Ensure(stats, histogram)
+{
+    static struct histogram histogram;
+
+    assert_that(histogram_percentile(&histogram, 50.0), is_equal_to(0));
+
+    for (uint64_t value = 1; value <= 100; value++)
+    {
+        histogram_record(&histogram, value * 1000);
+    }
+
+    assert_that(histogram.count, is_equal_to(100));
+    assert_that(histogram.min, is_equal_to(1000));
+    assert_that(histogram.max, is_equal_to(100000));
+
+    // the buckets are within 1/16 of the real value
+    assert_that(histogram_percentile(&histogram, 50.0), is_greater_than(50000 - 1));
+    assert_that(histogram_percentile(&histogram, 50.0), is_less_than(50000 + 50000 / 16));
+    assert_that(histogram_percentile(&histogram, 99.0), is_greater_than(99000 - 1));
+    assert_that(histogram_percentile(&histogram, 99.0), is_less_than(99000 + 99000 / 16));
+    assert_that(histogram_percentile(&histogram, 100.0), is_equal_to(100000));
+    assert_that(histogram_percentile(&histogram, 0.0), is_less_than(1000 + 1000 / 16));
+
+    // the small values are exact
+    memset(&histogram, 0, sizeof(histogram));
+    histogram_record(&histogram, 3);
+    histogram_record(&histogram, 7);
+    assert_that(histogram_percentile(&histogram, 50.0), is_equal_to(3));
+    assert_that(histogram_percentile(&histogram, 99.0), is_equal_to(7));
+}
+
+Ensure(stats, fsm_stats)
+{
+    struct fsm_stats *stats;
+    char out[2048];
+    FILE *out_file;
+
+    stats = fsm_stats_create(&environ, &error);
+    assert_that(stats, is_not_null);
+
+    fsm_stats_record(&environ, stats, RESET_STATE, READ_COMMANDS, 2000);
+    fsm_stats_record(&environ, stats, INIT_STATE, READ_COMMANDS, 4000);
+    fsm_stats_record(&environ, stats, READ_COMMANDS, EXIT, 1000);
+    assert_that(stats->states[READ_COMMANDS].count, is_equal_to(2));
+    assert_that(stats->transitions[INIT_STATE][READ_COMMANDS]->count, is_equal_to(1));
+    assert_that(stats->transitions[EXIT][READ_COMMANDS], is_null);
+
+    memset(out, 0, sizeof(out));
+    out_file = fmemopen(out, sizeof(out), "w");
+    fsm_stats_print(stats, out_file);
+    fflush(out_file);
+    assert_that(strstr(out, "READ_COMMANDS                                 2        2.0        4.0        4.0\n"),
+                is_not_null);
+    assert_that(strstr(out, "INIT_STATE -> READ_COMMANDS                   1        4.0        4.0        4.0\n"),
+                is_not_null);
+    assert_that(strstr(out, "RESET_STATE -> READ_COMMANDS"), is_not_null);
+    assert_that(strstr(out, "EXECUTE_COMMANDS"), is_null);
+    fclose(out_file);
+
+    fsm_stats_destroy(&environ, &stats);
+    assert_that(stats, is_null);
+}
+
+Ensure(stats, builtin)
+{
+    char out[4096];
+    char err[256];
+    FILE *out_file;
+    FILE *err_file;
+
+    memset(out, 0, sizeof(out));
+    memset(err, 0, sizeof(err));
+    out_file = fmemopen(out, sizeof(out), "w");
+    err_file = fmemopen(err, sizeof(err), "w");
+    run_shell_batch(&environ, &error, -1, "true\nstats\nstats -x\n", out_file, err_file, NULL);
+    fflush(out_file);
+    fflush(err_file);
+
+    // the stats line itself is still running, the line before it has been through every state
+    assert_that(strstr(out, "\nEXECUTE_COMMANDS "), is_not_null);
+    assert_that(strstr(out, "\nPARSE_COMMANDS -> EXECUTE_COMMANDS "), is_not_null);
+    assert_that(strstr(out, "\nDC_FSM_INIT -> INIT_STATE "), is_not_null);
+    assert_that(err, is_equal_to_string("usage: stats\n"));
+    fclose(out_file);
+    fclose(err_file);
+}
+
+TestSuite *stats_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, stats, histogram);
+    add_test_with_context(suite, stats, fsm_stats);
+    add_test_with_context(suite, stats, builtin);
+
+    return suite;
+}
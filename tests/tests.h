@@ -4,12 +4,26 @@
 
 #include <cgreen/cgreen.h>
 
+TestSuite *arena_tests(void);
 TestSuite *builtin_tests(void);
 TestSuite *command_tests(void);
+TestSuite *command_cache_tests(void);
+TestSuite *command_hash_tests(void);
+TestSuite *copy_tests(void);
 TestSuite *execute_tests(void);
+TestSuite *expand_tests(void);
+TestSuite *history_tests(void);
 TestSuite *input_tests(void);
+TestSuite *jobs_tests(void);
+TestSuite *lexer_tests(void);
+TestSuite *parallel_tests(void);
+TestSuite *pool_tests(void);
+TestSuite *profile_tests(void);
+TestSuite *server_tests(void);
 TestSuite *shell_impl_tests(void);
 TestSuite *shell_tests(void);
+TestSuite *stats_tests(void);
+TestSuite *usage_tests(void);
 TestSuite *util_tests(void);
 
 #endif // LIBDC_POSIX_TESTS_H
@@ -0,0 +1,104 @@
+#include "tests.h"
+#include "usage.h"
+
+static void set_rusage(struct rusage *rusage, long user_us, long system_us, long max_rss, long switches);
+
+Describe(usage);
+
+static struct dc_posix_env environ;
+static struct dc_error error;
+
+BeforeEach(usage)
+{
+    dc_posix_env_init(&environ, NULL);
+    dc_error_init(&error, NULL);
+}
+
+AfterEach(usage)
+{
+    dc_error_reset(&error);
+}
+
+Ensure(usage, set_and_add)
+{
+    struct command_usage first;
+    struct command_usage second;
+    struct command_usage total;
+    struct rusage before;
+    struct rusage after;
+
+    set_rusage(&after, 1500000, 250, 4096, 3);
+    usage_set(&first, &after, 2000000000);
+    assert_that(first.wall, is_equal_to(2000000000));
+    assert_that(first.user, is_equal_to(1500000000));
+    assert_that(first.system, is_equal_to(250000));
+    assert_that(first.max_rss, is_equal_to(4096));
+    assert_that(first.voluntary_switches, is_equal_to(3));
+    assert_that(first.involuntary_switches, is_equal_to(3));
+
+    // a builtin only gets what the shell used while it ran
+    set_rusage(&before, 1000000, 50, 1024, 1);
+    usage_set_difference(&second, &before, &after, 10);
+    assert_that(second.user, is_equal_to(500000000));
+    assert_that(second.system, is_equal_to(200000));
+    assert_that(second.max_rss, is_equal_to(4096));
+    assert_that(second.voluntary_switches, is_equal_to(2));
+
+    memset(&total, 0, sizeof(total));
+    usage_add(&total, &first);
+    usage_add(&total, &second);
+    assert_that(total.wall, is_equal_to(0));
+    assert_that(total.user, is_equal_to(2000000000));
+    assert_that(total.max_rss, is_equal_to(4096));
+    assert_that(total.involuntary_switches, is_equal_to(5));
+}
+
+Ensure(usage, print_and_log)
+{
+    struct command command;
+    char line[] = "sort big.txt";
+    char out[256];
+    FILE *out_file;
+
+    memset(&command, 0, sizeof(command));
+    command.line = line;
+    command.exit_code = 1;
+    command.usage.wall = 1250000000;
+    command.usage.user = 1000000000;
+    command.usage.system = 2000000;
+    command.usage.max_rss = 2048;
+    command.usage.voluntary_switches = 7;
+    command.usage.involuntary_switches = 1;
+
+    memset(out, 0, sizeof(out));
+    out_file = fmemopen(out, sizeof(out), "w");
+    usage_print(&command.usage, out_file);
+    usage_log(&command, out_file);
+    fflush(out_file);
+    assert_that(out, is_equal_to_string("real 1.250s  user 1.000s  sys 0.002s  maxrss 2048KiB  vcsw 7  ivcsw 1\n"
+                                        "1\t1.250000\t1.000000\t0.002000\t2048\t7\t1\tsort big.txt\n"));
+    fclose(out_file);
+}
+
+static void set_rusage(struct rusage *rusage, long user_us, long system_us, long max_rss, long switches)
+{
+    memset(rusage, 0, sizeof(struct rusage));
+    rusage->ru_utime.tv_sec = user_us / 1000000;
+    rusage->ru_utime.tv_usec = user_us % 1000000;
+    rusage->ru_stime.tv_sec = system_us / 1000000;
+    rusage->ru_stime.tv_usec = system_us % 1000000;
+    rusage->ru_maxrss = max_rss;
+    rusage->ru_nvcsw = switches;
+    rusage->ru_nivcsw = switches;
+}
+
+TestSuite *usage_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, usage, set_and_add);
+    add_test_with_context(suite, usage, print_and_log);
+
+    return suite;
+}
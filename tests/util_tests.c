@@ -1,6 +1,7 @@
 #include "tests.h"
 #include "util.h"
 #include "command.h"
+#include "arena.h"
 #include "state.h"
 #include <dc_util/strings.h>
 
@@ -97,6 +98,30 @@ static void test_parse_path(const char *path_str, char **dirs)
     free(path_dirs);
 }
 
+Ensure(util, parse_duration)
+{
+    uint64_t ns;
+
+    assert_true(parse_duration("5", &ns));
+    assert_that(ns, is_equal_to(5000000000ULL));
+    assert_true(parse_duration("0.25s", &ns));
+    assert_that(ns, is_equal_to(250000000));
+    assert_true(parse_duration("1.5m", &ns));
+    assert_that(ns, is_equal_to(90000000000ULL));
+    assert_true(parse_duration("2h", &ns));
+    assert_that(ns, is_equal_to(7200000000000ULL));
+    assert_true(parse_duration("1d", &ns));
+    assert_that(ns, is_equal_to(86400000000000ULL));
+
+    ns = 7;
+    assert_false(parse_duration("", &ns));
+    assert_false(parse_duration("-1", &ns));
+    assert_false(parse_duration("1x", &ns));
+    assert_false(parse_duration("s", &ns));
+    assert_false(parse_duration("1e30", &ns));
+    assert_that(ns, is_equal_to(7));
+}
+
 Ensure(util, do_reset_state)
 {
     struct state state;
@@ -104,33 +129,33 @@ Ensure(util, do_reset_state)
     state.stdin = stdin;
     state.stdout = stdout;
     state.stderr = stderr;
-    state.in_redirect_regex = NULL;
-    state.out_redirect_regex = NULL;
-    state.err_redirect_regex = NULL;
     state.path = NULL;
     state.prompt = NULL;
     state.max_line_length = 0;
     state.current_line = NULL;
     state.current_line_length = 0;
     state.command = NULL;
+    state.command_count = 0;
+    state.arena = NULL;
     state.fatal_error = false;
 
     do_reset_state(&environ, &error, &state);
     check_state_reset(&error, &state, stdin, stdout, stderr);
 
-    state.current_line = strdup("");
+    state.current_line = "";
     state.current_line_length = strlen(state.current_line);
     do_reset_state(&environ, &error, &state);
     check_state_reset(&error, &state, stdin, stdout, stderr);
 
-    state.current_line = strdup("ls");
+    state.current_line = "ls";
     state.current_line_length = strlen(state.current_line);
     do_reset_state(&environ, &error, &state);
     check_state_reset(&error, &state, stdin, stdout, stderr);
 
-    state.current_line = strdup("ls");
+    state.current_line = "ls";
     state.current_line_length = strlen(state.current_line);
-    state.command = calloc(1, sizeof(struct command));
+    state.command = calloc(2, sizeof(struct command));
+    state.command_count = 2;
     do_reset_state(&environ, &error, &state);
     check_state_reset(&error, &state, stdin, stdout, stderr);
 
@@ -141,6 +166,19 @@ Ensure(util, do_reset_state)
     state.fatal_error = true;
     do_reset_state(&environ, &error, &state);
     check_state_reset(&error, &state, stdin, stdout, stderr);
+
+    // commands in an arena are all released by resetting it
+    state.arena = arena_create(&environ, &error, 64);
+    state.command = arena_calloc(&environ, &error, state.arena, 2, sizeof(struct command));
+    state.command_count = 2;
+    state.command[0].arena = state.arena;
+    state.command[0].line = arena_strndup(&environ, &error, state.arena, "ls", 2);
+    state.command[1].arena = state.arena;
+    state.command[1].line = arena_strndup(&environ, &error, state.arena, "wc", 2);
+    do_reset_state(&environ, &error, &state);
+    check_state_reset(&error, &state, stdin, stdout, stderr);
+    assert_that(state.arena->blocks->used, is_equal_to(0));
+    arena_destroy(&environ, &state.arena);
 }
 
 static void check_state_reset(const struct dc_error *error, const struct state *state, FILE *in, FILE *out, FILE *err)
@@ -149,6 +187,7 @@ static void check_state_reset(const struct dc_error *error, const struct state *
     assert_that(state->current_line, is_null);
     assert_that(state->current_line_length, is_equal_to(0));
     assert_that(state->command, is_null);
+    assert_that(state->command_count, is_equal_to(0));
     assert_that(state->stdin, is_equal_to(in));
     assert_that(state->stdout, is_equal_to(out));
     assert_that(state->stderr, is_equal_to(err));
@@ -168,9 +207,6 @@ Ensure(util, state_to_string)
     struct state state;
     char *str;
 
-    state.in_redirect_regex = NULL;
-    state.out_redirect_regex = NULL;
-    state.err_redirect_regex = NULL;
     state.path = NULL;
     state.prompt = NULL;
     state.max_line_length = 0;
@@ -193,29 +229,26 @@ Ensure(util, state_to_string)
     assert_that(str, is_equal_to_string("current_line = NULL, fatal_error = 1"));
     free(str);
 
-    state.current_line = strdup("");
+    state.current_line = "";
     state.fatal_error = false;
     state.current_line_length = 0;
     str = state_to_string(&environ, &error, &state);
     assert_that(str, is_equal_to_string("current_line = \"\", fatal_error = 0"));
     free(str);
-    free(state.current_line);
 
-    state.current_line = strdup("hello");
+    state.current_line = "hello";
     state.current_line_length = strlen(state.current_line);
     state.fatal_error = false;
     str = state_to_string(&environ, &error, &state);
     assert_that(str, is_equal_to_string("current_line = \"hello\", fatal_error = 0"));
     free(str);
-    free(state.current_line);
 
-    state.current_line = strdup("world");
+    state.current_line = "world";
     state.current_line_length = strlen(state.current_line);
     state.fatal_error = true;
     str = state_to_string(&environ, &error, &state);
     assert_that(str, is_equal_to_string("current_line = \"world\", fatal_error = 1"));
     free(str);
-    free(state.current_line);
 }
 
 TestSuite *util_tests(void)
@@ -226,6 +259,7 @@ TestSuite *util_tests(void)
     add_test_with_context(suite, util, get_prompt);
     add_test_with_context(suite, util, get_path);
     add_test_with_context(suite, util, parse_path);
+    add_test_with_context(suite, util, parse_duration);
     add_test_with_context(suite, util, do_reset_state);
     add_test_with_context(suite, util, state_to_string);
 